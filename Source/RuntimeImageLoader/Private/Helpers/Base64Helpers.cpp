@@ -0,0 +1,252 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "Base64Helpers.h"
+
+#if defined(PLATFORM_ENABLE_VECTORINTRINSICS_NEON) && PLATFORM_ENABLE_VECTORINTRINSICS_NEON && (defined(__aarch64__) || defined(_M_ARM64))
+    #define RUNTIMEIMAGELOADER_BASE64_NEON 1
+    #include <arm_neon.h>
+#elif PLATFORM_ENABLE_VECTORINTRINSICS && ((defined(PLATFORM_ALWAYS_HAS_SSE4_1) && PLATFORM_ALWAYS_HAS_SSE4_1) || defined(__SSSE3__) || defined(__AVX__))
+    #define RUNTIMEIMAGELOADER_BASE64_SSSE3 1
+    #include <tmmintrin.h>
+#endif
+
+#ifndef RUNTIMEIMAGELOADER_BASE64_NEON
+    #define RUNTIMEIMAGELOADER_BASE64_NEON 0
+#endif
+
+#ifndef RUNTIMEIMAGELOADER_BASE64_SSSE3
+    #define RUNTIMEIMAGELOADER_BASE64_SSSE3 0
+#endif
+
+
+namespace FBase64Helpers
+{
+    static int8 DecodeChar(TCHAR Char)
+    {
+        if (Char >= TEXT('A') && Char <= TEXT('Z')) return int8(Char - TEXT('A'));
+        if (Char >= TEXT('a') && Char <= TEXT('z')) return int8(Char - TEXT('a') + 26);
+        if (Char >= TEXT('0') && Char <= TEXT('9')) return int8(Char - TEXT('0') + 52);
+        if (Char == TEXT('+') || Char == TEXT('-')) return 62;
+        if (Char == TEXT('/') || Char == TEXT('_')) return 63;
+        return -1;
+    }
+
+    static bool IsWhitespace(TCHAR Char)
+    {
+        return Char == TEXT(' ') || Char == TEXT('\n') || Char == TEXT('\r') || Char == TEXT('\t');
+    }
+
+#if RUNTIMEIMAGELOADER_BASE64_SSSE3 || RUNTIMEIMAGELOADER_BASE64_NEON
+    // Lookup tables of the nibble based validation and translation by Wojciech Mula, "Base64 encoding and decoding at almost the speed of a memory copy"
+    // a character is valid when LutLo[low nibble] & LutHi[high nibble] == 0, then the value is Char + LutRoll[high nibble + (Char == '/')]
+    alignas(16) static const uint8 LutLo[16] = { 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A };
+    alignas(16) static const uint8 LutHi[16] = { 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 };
+    alignas(16) static const int8 LutRoll[16] = { 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0 };
+#endif
+
+#if RUNTIMEIMAGELOADER_BASE64_SSSE3
+    static __m128i LoadChars16(const TCHAR* Encoded)
+    {
+        if (sizeof(TCHAR) == 2)
+        {
+            // characters above 255 saturate to 0xFF which fails validation
+            const __m128i Low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Encoded));
+            const __m128i High = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Encoded + 8));
+            return _mm_packus_epi16(Low, High);
+        }
+
+        alignas(16) uint8 Narrowed[16];
+        for (int32 Index = 0; Index < 16; ++Index)
+        {
+            Narrowed[Index] = uint8(FMath::Min<uint32>(uint32(Encoded[Index]), 0xFF));
+        }
+        return _mm_load_si128(reinterpret_cast<const __m128i*>(Narrowed));
+    }
+
+    /** Decodes 16 characters into 12 bytes per iteration and stops at the first block with a non-alphabet character */
+    static int64 DecodeBlocks(const TCHAR* Encoded, int64 EncodedLength, uint8* OutData, int64 OutDataCapacity, int64& OutWritten)
+    {
+        const __m128i LutLoVec = _mm_load_si128(reinterpret_cast<const __m128i*>(LutLo));
+        const __m128i LutHiVec = _mm_load_si128(reinterpret_cast<const __m128i*>(LutHi));
+        const __m128i LutRollVec = _mm_load_si128(reinterpret_cast<const __m128i*>(LutRoll));
+        const __m128i NibbleMask = _mm_set1_epi8(0x0F);
+        const __m128i Slash = _mm_set1_epi8(0x2F);
+        const __m128i PackShuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+        int64 Consumed = 0;
+        OutWritten = 0;
+
+        // every store writes 16 bytes of which 12 are valid
+        while (EncodedLength - Consumed >= 16 && OutDataCapacity - OutWritten >= 16)
+        {
+            const __m128i Chars = LoadChars16(Encoded + Consumed);
+
+            const __m128i HiNibbles = _mm_and_si128(_mm_srli_epi32(Chars, 4), NibbleMask);
+            const __m128i LoNibbles = _mm_and_si128(Chars, NibbleMask);
+            const __m128i Lo = _mm_shuffle_epi8(LutLoVec, LoNibbles);
+            const __m128i Hi = _mm_shuffle_epi8(LutHiVec, HiNibbles);
+
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(Lo, Hi), _mm_setzero_si128())) != 0xFFFF)
+            {
+                break;
+            }
+
+            const __m128i Roll = _mm_shuffle_epi8(LutRollVec, _mm_add_epi8(_mm_cmpeq_epi8(Chars, Slash), HiNibbles));
+            const __m128i Values = _mm_add_epi8(Chars, Roll);
+
+            // merge 4 x 6 bits into 24 bits per lane, then gather the 3 bytes of every lane in big endian order
+            const __m128i Merged = _mm_madd_epi16(_mm_maddubs_epi16(Values, _mm_set1_epi32(0x01400140)), _mm_set1_epi32(0x00011000));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(OutData + OutWritten), _mm_shuffle_epi8(Merged, PackShuffle));
+
+            Consumed += 16;
+            OutWritten += 12;
+        }
+
+        return Consumed;
+    }
+#elif RUNTIMEIMAGELOADER_BASE64_NEON
+    static uint8x16_t NarrowChars8x2(uint16x8_t Low, uint16x8_t High)
+    {
+        // characters above 255 saturate to 0xFF which fails validation
+        return vcombine_u8(vqmovn_u16(Low), vqmovn_u16(High));
+    }
+
+    static uint8x16_t TranslateChars(uint8x16_t Chars, uint8x16_t& InOutInvalid)
+    {
+        const uint8x16_t HiNibbles = vshrq_n_u8(Chars, 4);
+        const uint8x16_t LoNibbles = vandq_u8(Chars, vdupq_n_u8(0x0F));
+        const uint8x16_t Lo = vqtbl1q_u8(vld1q_u8(LutLo), LoNibbles);
+        const uint8x16_t Hi = vqtbl1q_u8(vld1q_u8(LutHi), HiNibbles);
+
+        InOutInvalid = vorrq_u8(InOutInvalid, vandq_u8(Lo, Hi));
+
+        const uint8x16_t Roll = vqtbl1q_u8(vreinterpretq_u8_s8(vld1q_s8(LutRoll)), vaddq_u8(vceqq_u8(Chars, vdupq_n_u8(0x2F)), HiNibbles));
+        return vaddq_u8(Chars, Roll);
+    }
+
+    /** Decodes 64 characters into 48 bytes per iteration and stops at the first block with a non-alphabet character */
+    static int64 DecodeBlocks(const TCHAR* Encoded, int64 EncodedLength, uint8* OutData, int64 OutDataCapacity, int64& OutWritten)
+    {
+        int64 Consumed = 0;
+        OutWritten = 0;
+
+        while (EncodedLength - Consumed >= 64 && OutDataCapacity - OutWritten >= 48)
+        {
+            uint8x16x4_t Chars;
+            if (sizeof(TCHAR) == 2)
+            {
+                // de-interleaves characters so that each register holds the same position of 16 quanta
+                const uint16x8x4_t Low = vld4q_u16(reinterpret_cast<const uint16*>(Encoded + Consumed));
+                const uint16x8x4_t High = vld4q_u16(reinterpret_cast<const uint16*>(Encoded + Consumed + 32));
+                for (int32 Index = 0; Index < 4; ++Index)
+                {
+                    Chars.val[Index] = NarrowChars8x2(Low.val[Index], High.val[Index]);
+                }
+            }
+            else
+            {
+                alignas(16) uint8 Narrowed[64];
+                for (int32 Index = 0; Index < 64; ++Index)
+                {
+                    Narrowed[Index] = uint8(FMath::Min<uint32>(uint32(Encoded[Consumed + Index]), 0xFF));
+                }
+                Chars = vld4q_u8(Narrowed);
+            }
+
+            uint8x16_t Invalid = vdupq_n_u8(0);
+            const uint8x16_t A = TranslateChars(Chars.val[0], Invalid);
+            const uint8x16_t B = TranslateChars(Chars.val[1], Invalid);
+            const uint8x16_t C = TranslateChars(Chars.val[2], Invalid);
+            const uint8x16_t D = TranslateChars(Chars.val[3], Invalid);
+
+            if (vmaxvq_u8(Invalid) != 0)
+            {
+                break;
+            }
+
+            uint8x16x3_t Bytes;
+            Bytes.val[0] = vorrq_u8(vshlq_n_u8(A, 2), vshrq_n_u8(B, 4));
+            Bytes.val[1] = vorrq_u8(vshlq_n_u8(B, 4), vshrq_n_u8(C, 2));
+            Bytes.val[2] = vorrq_u8(vshlq_n_u8(C, 6), D);
+            vst3q_u8(OutData + OutWritten, Bytes);
+
+            Consumed += 64;
+            OutWritten += 48;
+        }
+
+        return Consumed;
+    }
+#endif
+
+    bool Decode(const TCHAR* Encoded, int64 EncodedLength, uint8* OutData, int64 OutDataCapacity, int64& OutDecodedLength)
+    {
+        int64 InIndex = 0;
+        int64 OutIndex = 0;
+        uint32 Accumulator = 0;
+        int32 NumBits = 0;
+
+#if RUNTIMEIMAGELOADER_BASE64_SSSE3 || RUNTIMEIMAGELOADER_BASE64_NEON
+        int64 NextVectorAttempt = 0;
+#endif
+
+        OutDecodedLength = 0;
+
+        while (InIndex < EncodedLength)
+        {
+#if RUNTIMEIMAGELOADER_BASE64_SSSE3 || RUNTIMEIMAGELOADER_BASE64_NEON
+            // vector path only runs on quantum boundaries, after a failed attempt the scalar path moves past the offending block first
+            if (NumBits == 0 && InIndex >= NextVectorAttempt)
+            {
+                int64 Written = 0;
+                const int64 Consumed = DecodeBlocks(Encoded + InIndex, EncodedLength - InIndex, OutData + OutIndex, OutDataCapacity - OutIndex, Written);
+
+                InIndex += Consumed;
+                OutIndex += Written;
+                NextVectorAttempt = InIndex + 64;
+
+                if (InIndex >= EncodedLength)
+                {
+                    break;
+                }
+            }
+#endif
+
+            const TCHAR Char = Encoded[InIndex++];
+
+            if (IsWhitespace(Char))
+            {
+                continue;
+            }
+
+            // padding terminates the data
+            if (Char == TEXT('='))
+            {
+                break;
+            }
+
+            const int8 Value = DecodeChar(Char);
+            if (Value < 0)
+            {
+                return false;
+            }
+
+            Accumulator = (Accumulator << 6) | uint32(Value);
+            NumBits += 6;
+
+            if (NumBits >= 8)
+            {
+                if (OutIndex >= OutDataCapacity)
+                {
+                    return false;
+                }
+
+                NumBits -= 8;
+                OutData[OutIndex++] = uint8(Accumulator >> NumBits);
+                Accumulator &= (1u << NumBits) - 1;
+            }
+        }
+
+        OutDecodedLength = OutIndex;
+        return true;
+    }
+}
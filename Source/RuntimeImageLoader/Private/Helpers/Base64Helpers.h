@@ -0,0 +1,22 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+namespace FBase64Helpers
+{
+    /** Upper bound of the decoded size, padding and whitespace only make the actual size smaller */
+    inline int64 GetMaxDecodedSize(int64 EncodedLength)
+    {
+        return (EncodedLength / 4) * 3 + 3;
+    }
+
+    /**
+     * Decodes standard or url-safe base64 straight into OutData. Padding and whitespace are accepted.
+     * Long runs of standard alphabet characters are decoded with SSSE3/NEON, everything else goes through the scalar path.
+     * @return false if the input contains invalid characters or OutData is too small
+     */
+    bool Decode(const TCHAR* Encoded, int64 EncodedLength, uint8* OutData, int64 OutDataCapacity, int64& OutDecodedLength);
+}
@@ -0,0 +1,418 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "BlockCompressedHelpers.h"
+#include "RHI.h"
+
+
+namespace FBlockCompressedHelpers
+{
+    static uint32 ReadLE32(const uint8* Data)
+    {
+        return uint32(Data[0]) | (uint32(Data[1]) << 8) | (uint32(Data[2]) << 16) | (uint32(Data[3]) << 24);
+    }
+
+    static uint64 ReadLE64(const uint8* Data)
+    {
+        return uint64(ReadLE32(Data)) | (uint64(ReadLE32(Data + 4)) << 32);
+    }
+
+    static constexpr uint32 MakeFourCC(char A, char B, char C, char D)
+    {
+        return uint32(uint8(A)) | (uint32(uint8(B)) << 8) | (uint32(uint8(C)) << 16) | (uint32(uint8(D)) << 24);
+    }
+
+    static const uint8 KTX2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    // DDS header sizes and flags, field offsets below are counted from the start of the file including the magic
+    static constexpr int64 DDSClassicHeaderSize = 128;
+    static constexpr int64 DDSDX10HeaderSize = 148;
+    static constexpr uint32 DDSD_MIPMAPCOUNT = 0x20000;
+    static constexpr uint32 DDSD_DEPTH = 0x800000;
+    static constexpr uint32 DDPF_FOURCC = 0x4;
+    static constexpr uint32 DDSCAPS2_CUBEMAP = 0x200;
+    static constexpr uint32 DDSCAPS2_CUBEMAP_ALLFACES = 0xFC00;
+    static constexpr uint32 DDSCAPS2_VOLUME = 0x200000;
+    static constexpr uint32 DDS_DIMENSION_TEXTURE2D = 3;
+    static constexpr uint32 DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+
+    bool IsDDS(const uint8* Buffer, int64 Length)
+    {
+        return Length >= 4 && Buffer[0] == 'D' && Buffer[1] == 'D' && Buffer[2] == 'S' && Buffer[3] == ' ';
+    }
+
+    bool IsKTX2(const uint8* Buffer, int64 Length)
+    {
+        return Length >= (int64)sizeof(KTX2Identifier) && FMemory::Memcmp(Buffer, KTX2Identifier, sizeof(KTX2Identifier)) == 0;
+    }
+
+    int64 GetDDSHeaderSize(const uint8* Buffer, int64 Length)
+    {
+        if (Length < DDSClassicHeaderSize)
+        {
+            return DDSClassicHeaderSize;
+        }
+
+        const bool bHasFourCC = (ReadLE32(Buffer + 80) & DDPF_FOURCC) != 0;
+        return bHasFourCC && ReadLE32(Buffer + 84) == MakeFourCC('D', 'X', '1', '0') ? DDSDX10HeaderSize : DDSClassicHeaderSize;
+    }
+
+    /** UE formats are unsigned, signed BC4, BC5 and BC6H blocks would be read with the wrong sign */
+    static bool GetDXGIPixelFormat(uint32 DXGIFormat, EPixelFormat& OutPixelFormat, bool& bOutSRGB)
+    {
+        bOutSRGB = false;
+        switch (DXGIFormat)
+        {
+            case 70: // BC1_TYPELESS
+            case 71: OutPixelFormat = PF_DXT1; return true;
+            case 72: OutPixelFormat = PF_DXT1; bOutSRGB = true; return true;
+            case 73: // BC2_TYPELESS
+            case 74: OutPixelFormat = PF_DXT3; return true;
+            case 75: OutPixelFormat = PF_DXT3; bOutSRGB = true; return true;
+            case 76: // BC3_TYPELESS
+            case 77: OutPixelFormat = PF_DXT5; return true;
+            case 78: OutPixelFormat = PF_DXT5; bOutSRGB = true; return true;
+            case 79: // BC4_TYPELESS
+            case 80: OutPixelFormat = PF_BC4; return true;
+            case 82: // BC5_TYPELESS
+            case 83: OutPixelFormat = PF_BC5; return true;
+            case 94: // BC6H_TYPELESS
+            case 95: OutPixelFormat = PF_BC6H; return true;
+            case 97: // BC7_TYPELESS
+            case 98: OutPixelFormat = PF_BC7; return true;
+            case 99: OutPixelFormat = PF_BC7; bOutSRGB = true; return true;
+            default: return false;
+        }
+    }
+
+    static bool GetFourCCPixelFormat(uint32 FourCC, EPixelFormat& OutPixelFormat, bool& bOutSRGB)
+    {
+        // legacy headers don't tell the color space, color formats are assumed to hold sRGB colors and the one and two channel formats data
+        bOutSRGB = true;
+        switch (FourCC)
+        {
+            case MakeFourCC('D', 'X', 'T', '1'): OutPixelFormat = PF_DXT1; return true;
+            case MakeFourCC('D', 'X', 'T', '2'):
+            case MakeFourCC('D', 'X', 'T', '3'): OutPixelFormat = PF_DXT3; return true;
+            case MakeFourCC('D', 'X', 'T', '4'):
+            case MakeFourCC('D', 'X', 'T', '5'): OutPixelFormat = PF_DXT5; return true;
+            default: break;
+        }
+
+        bOutSRGB = false;
+        switch (FourCC)
+        {
+            case MakeFourCC('A', 'T', 'I', '1'):
+            case MakeFourCC('B', 'C', '4', 'U'): OutPixelFormat = PF_BC4; return true;
+            case MakeFourCC('A', 'T', 'I', '2'):
+            case MakeFourCC('B', 'C', '5', 'U'): OutPixelFormat = PF_BC5; return true;
+            default: return false;
+        }
+    }
+
+    static bool GetVkPixelFormat(uint32 VkFormat, EPixelFormat& OutPixelFormat, bool& bOutSRGB)
+    {
+        bOutSRGB = false;
+        switch (VkFormat)
+        {
+            case 131: // BC1_RGB_UNORM_BLOCK
+            case 133: OutPixelFormat = PF_DXT1; return true;
+            case 132: // BC1_RGB_SRGB_BLOCK
+            case 134: OutPixelFormat = PF_DXT1; bOutSRGB = true; return true;
+            case 135: OutPixelFormat = PF_DXT3; return true;
+            case 136: OutPixelFormat = PF_DXT3; bOutSRGB = true; return true;
+            case 137: OutPixelFormat = PF_DXT5; return true;
+            case 138: OutPixelFormat = PF_DXT5; bOutSRGB = true; return true;
+            case 139: OutPixelFormat = PF_BC4; return true;
+            case 141: OutPixelFormat = PF_BC5; return true;
+            case 143: OutPixelFormat = PF_BC6H; return true;
+            case 145: OutPixelFormat = PF_BC7; return true;
+            case 146: OutPixelFormat = PF_BC7; bOutSRGB = true; return true;
+            default: return false;
+        }
+    }
+
+    static bool ValidateHeader(const TCHAR* ContainerName, FBlockCompressedHeader& InOutHeader, FString& OutError)
+    {
+        if (InOutHeader.Width <= 0 || InOutHeader.Height <= 0 || InOutHeader.Width > (1 << (MAX_TEXTURE_MIP_COUNT - 1)) || InOutHeader.Height > (1 << (MAX_TEXTURE_MIP_COUNT - 1)))
+        {
+            OutError = FString::Printf(TEXT("%s has invalid dimensions: %d x %d"), ContainerName, InOutHeader.Width, InOutHeader.Height);
+            return false;
+        }
+
+        // a KTX2 level count of 0 asks for a chain generated at load time, that needs decoded pixels so the top level is uploaded alone
+        InOutHeader.NumMips = FMath::Max(InOutHeader.NumMips, 1);
+
+        const int32 MaxNumMips = FMath::FloorLog2(FMath::Max(InOutHeader.Width, InOutHeader.Height)) + 1;
+        if (InOutHeader.NumMips > MaxNumMips)
+        {
+            OutError = FString::Printf(TEXT("%s has %d mips, a %d x %d image has at most %d"), ContainerName, InOutHeader.NumMips, InOutHeader.Width, InOutHeader.Height, MaxNumMips);
+            return false;
+        }
+
+        if (InOutHeader.NumFaces == 6 && InOutHeader.Width != InOutHeader.Height)
+        {
+            OutError = FString::Printf(TEXT("%s cubemap faces are not square: %d x %d"), ContainerName, InOutHeader.Width, InOutHeader.Height);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool ReadDDSHeader(const uint8* Buffer, int64 Length, FBlockCompressedHeader& OutHeader, FString& OutError)
+    {
+        if (!IsDDS(Buffer, Length) || Length < GetDDSHeaderSize(Buffer, Length) || ReadLE32(Buffer + 4) != 124)
+        {
+            OutError = TEXT("DDS data is too small to contain a header");
+            return false;
+        }
+
+        const uint32 Flags = ReadLE32(Buffer + 8);
+        const uint32 PixelFormatFlags = ReadLE32(Buffer + 80);
+        const uint32 FourCC = ReadLE32(Buffer + 84);
+        const uint32 Caps2 = ReadLE32(Buffer + 112);
+
+        OutHeader.Height = (int32)ReadLE32(Buffer + 12);
+        OutHeader.Width = (int32)ReadLE32(Buffer + 16);
+        OutHeader.NumMips = (Flags & DDSD_MIPMAPCOUNT) ? (int32)ReadLE32(Buffer + 28) : 1;
+        OutHeader.NumFaces = 1;
+
+        if ((Flags & DDSD_DEPTH) || (Caps2 & DDSCAPS2_VOLUME))
+        {
+            OutError = TEXT("DDS volume textures are not supported");
+            return false;
+        }
+
+        if (!(PixelFormatFlags & DDPF_FOURCC))
+        {
+            OutError = TEXT("DDS holds uncompressed pixels, only BC1-BC7 blocks are supported");
+            return false;
+        }
+
+        if (FourCC == MakeFourCC('D', 'X', '1', '0'))
+        {
+            const uint32 DXGIFormat = ReadLE32(Buffer + 128);
+            const uint32 Dimension = ReadLE32(Buffer + 132);
+            const uint32 MiscFlags = ReadLE32(Buffer + 136);
+            const uint32 ArraySize = ReadLE32(Buffer + 140);
+
+            if (Dimension != DDS_DIMENSION_TEXTURE2D || ArraySize > 1)
+            {
+                OutError = FString::Printf(TEXT("DDS resource is not supported, only single 2D textures and cubemaps can be loaded. Dimension: %u, array size: %u"), Dimension, ArraySize);
+                return false;
+            }
+
+            if (!GetDXGIPixelFormat(DXGIFormat, OutHeader.PixelFormat, OutHeader.bSRGB))
+            {
+                OutError = FString::Printf(TEXT("DDS DXGI format is not supported, only unsigned BC1-BC7 blocks can be loaded: %u"), DXGIFormat);
+                return false;
+            }
+
+            OutHeader.NumFaces = (MiscFlags & DDS_RESOURCE_MISC_TEXTURECUBE) ? 6 : 1;
+        }
+        else
+        {
+            if (!GetFourCCPixelFormat(FourCC, OutHeader.PixelFormat, OutHeader.bSRGB))
+            {
+                OutError = FString::Printf(TEXT("DDS four CC is not supported, only unsigned BC1-BC7 blocks can be loaded: 0x%08x"), FourCC);
+                return false;
+            }
+
+            if (Caps2 & DDSCAPS2_CUBEMAP)
+            {
+                if ((Caps2 & DDSCAPS2_CUBEMAP_ALLFACES) != DDSCAPS2_CUBEMAP_ALLFACES)
+                {
+                    OutError = TEXT("DDS cubemap doesn't hold all six faces");
+                    return false;
+                }
+                OutHeader.NumFaces = 6;
+            }
+        }
+
+        return ValidateHeader(TEXT("DDS"), OutHeader, OutError);
+    }
+
+    bool ReadKTX2Header(const uint8* Buffer, int64 Length, FBlockCompressedHeader& OutHeader, FString& OutError)
+    {
+        if (!IsKTX2(Buffer, Length) || Length < KTX2HeaderSize)
+        {
+            OutError = TEXT("KTX2 data is too small to contain a header");
+            return false;
+        }
+
+        const uint32 VkFormat = ReadLE32(Buffer + 12);
+        const uint32 Depth = ReadLE32(Buffer + 28);
+        const uint32 LayerCount = ReadLE32(Buffer + 32);
+        const uint32 FaceCount = ReadLE32(Buffer + 36);
+        const uint32 SupercompressionScheme = ReadLE32(Buffer + 44);
+
+        OutHeader.Width = (int32)ReadLE32(Buffer + 20);
+        OutHeader.Height = (int32)ReadLE32(Buffer + 24);
+        OutHeader.NumMips = (int32)FMath::Min(ReadLE32(Buffer + 40), 0x7FFFu);
+        OutHeader.NumFaces = (int32)FaceCount;
+
+        if (SupercompressionScheme != 0)
+        {
+            OutError = FString::Printf(TEXT("KTX2 supercompression scheme %u is not supported, the blocks have to be stored as they are"), SupercompressionScheme);
+            return false;
+        }
+
+        if (Depth > 1 || LayerCount > 1 || (FaceCount != 1 && FaceCount != 6))
+        {
+            OutError = FString::Printf(TEXT("KTX2 resource is not supported, only single 2D textures and cubemaps can be loaded. Depth: %u, layers: %u, faces: %u"), Depth, LayerCount, FaceCount);
+            return false;
+        }
+
+        // VK_FORMAT_UNDEFINED is used by Basis Universal payloads that need transcoding
+        if (!GetVkPixelFormat(VkFormat, OutHeader.PixelFormat, OutHeader.bSRGB))
+        {
+            OutError = FString::Printf(TEXT("KTX2 Vulkan format is not supported, only unsigned BC1-BC7 blocks can be loaded: %u"), VkFormat);
+            return false;
+        }
+
+        return ValidateHeader(TEXT("KTX2"), OutHeader, OutError);
+    }
+
+    /**
+     * Copies the mip chain into the face after face layout the RHI expects. The top of the chain is the smallest mip that still covers MinScale.
+     * Mip MipIndex of face FaceIndex starts at MipData[FaceIndex * Header.NumMips + MipIndex]
+     */
+    static bool BuildImage(const TCHAR* ContainerName, const FBlockCompressedHeader& Header, const TArray<const uint8*>& MipData, float MinScale, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        // D3D requires the top mip of block compressed textures to cover whole blocks
+        auto IsBlockAligned = [](int32 SizeX, int32 SizeY)
+        {
+            return SizeX % 4 == 0 && SizeY % 4 == 0;
+        };
+
+        if (!IsBlockAligned(Header.Width, Header.Height))
+        {
+            OutError = FString::Printf(TEXT("%s dimensions have to be multiples of 4 to be uploaded as blocks: %d x %d"), ContainerName, Header.Width, Header.Height);
+            return false;
+        }
+
+        int32 FirstMip = 0;
+        if (MinScale < 1.0f)
+        {
+            const int32 MinSizeX = FMath::CeilToInt(Header.Width * MinScale);
+            const int32 MinSizeY = FMath::CeilToInt(Header.Height * MinScale);
+            while (FirstMip + 1 < Header.NumMips)
+            {
+                const int32 NextSizeX = Header.Width >> (FirstMip + 1);
+                const int32 NextSizeY = Header.Height >> (FirstMip + 1);
+                if (NextSizeX < MinSizeX || NextSizeY < MinSizeY || !IsBlockAligned(NextSizeX, NextSizeY))
+                {
+                    break;
+                }
+                ++FirstMip;
+            }
+        }
+
+        const int32 NumMips = Header.NumMips - FirstMip;
+        const int32 SizeX = FMath::Max(Header.Width >> FirstMip, 1);
+        const int32 SizeY = FMath::Max(Header.Height >> FirstMip, 1);
+
+        TArray<int64, TInlineAllocator<MAX_TEXTURE_MIP_COUNT>> MipSizes;
+        int64 FaceSize = 0;
+        for (int32 MipIndex = 0; MipIndex < NumMips; ++MipIndex)
+        {
+            MipSizes.Add(FRuntimeImageData::GetPixelFormatImageSize(Header.PixelFormat, FMath::Max(SizeX >> MipIndex, 1), FMath::Max(SizeY >> MipIndex, 1)));
+            FaceSize += MipSizes.Last();
+        }
+
+        TArray64<uint8> Data;
+        Data.SetNumUninitialized(FaceSize * Header.NumFaces);
+
+        uint8* Dest = Data.GetData();
+        for (int32 FaceIndex = 0; FaceIndex < Header.NumFaces; ++FaceIndex)
+        {
+            for (int32 MipIndex = 0; MipIndex < NumMips; ++MipIndex)
+            {
+                FMemory::Memcpy(Dest, MipData[FaceIndex * Header.NumMips + FirstMip + MipIndex], MipSizes[MipIndex]);
+                Dest += MipSizes[MipIndex];
+            }
+        }
+
+        OutImage.InitBlockCompressed(SizeX, SizeY, NumMips, Header.NumFaces, Header.PixelFormat, MoveTemp(Data));
+        OutImage.SourceSizeX = Header.Width;
+        OutImage.SourceSizeY = Header.Height;
+        OutImage.SRGB = Header.bSRGB;
+        OutImage.GammaSpace = Header.bSRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+        OutImage.CompressionSettings = Header.PixelFormat == PF_BC6H ? TC_HDR_Compressed : TC_Default;
+
+        return true;
+    }
+
+    bool DecodeDDS(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(STAT_FBlockCompressedHelpers_DecodeDDS);
+
+        FBlockCompressedHeader Header;
+        if (!ReadDDSHeader(Buffer, Length, Header, OutError))
+        {
+            return false;
+        }
+
+        // faces follow each other, each with its whole mip chain
+        TArray<const uint8*> MipData;
+        int64 Offset = GetDDSHeaderSize(Buffer, Length);
+        for (int32 FaceIndex = 0; FaceIndex < Header.NumFaces; ++FaceIndex)
+        {
+            for (int32 MipIndex = 0; MipIndex < Header.NumMips; ++MipIndex)
+            {
+                MipData.Add(Buffer + Offset);
+                Offset += FRuntimeImageData::GetPixelFormatImageSize(Header.PixelFormat, FMath::Max(Header.Width >> MipIndex, 1), FMath::Max(Header.Height >> MipIndex, 1));
+            }
+        }
+
+        if (Offset > Length)
+        {
+            OutError = FString::Printf(TEXT("DDS data is truncated: %lld bytes expected, %lld found"), Offset, Length);
+            return false;
+        }
+
+        return BuildImage(TEXT("DDS"), Header, MipData, Options.MinScale, OutImage, OutError);
+    }
+
+    bool DecodeKTX2(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(STAT_FBlockCompressedHelpers_DecodeKTX2);
+
+        FBlockCompressedHeader Header;
+        if (!ReadKTX2Header(Buffer, Length, Header, OutError))
+        {
+            return false;
+        }
+
+        // the level index follows the header and the data format, key/value and supercompression offsets
+        const int64 LevelIndexOffset = 80;
+        if (Length < LevelIndexOffset + int64(Header.NumMips) * 24)
+        {
+            OutError = TEXT("KTX2 data is truncated before the end of the level index");
+            return false;
+        }
+
+        // levels hold all faces of one mip, they are stored smallest first but the index lists the largest first
+        TArray<const uint8*> MipData;
+        MipData.SetNumZeroed(Header.NumMips * Header.NumFaces);
+        for (int32 MipIndex = 0; MipIndex < Header.NumMips; ++MipIndex)
+        {
+            const uint8* LevelEntry = Buffer + LevelIndexOffset + int64(MipIndex) * 24;
+            const uint64 LevelOffset = ReadLE64(LevelEntry);
+            const uint64 LevelLength = ReadLE64(LevelEntry + 8);
+
+            const int64 FaceSize = FRuntimeImageData::GetPixelFormatImageSize(Header.PixelFormat, FMath::Max(Header.Width >> MipIndex, 1), FMath::Max(Header.Height >> MipIndex, 1));
+            if (LevelLength < uint64(FaceSize * Header.NumFaces) || LevelOffset > uint64(Length) || LevelLength > uint64(Length) - LevelOffset)
+            {
+                OutError = FString::Printf(TEXT("KTX2 level %d is truncated or has an unexpected size: %llu bytes at %llu"), MipIndex, LevelLength, LevelOffset);
+                return false;
+            }
+
+            for (int32 FaceIndex = 0; FaceIndex < Header.NumFaces; ++FaceIndex)
+            {
+                MipData[FaceIndex * Header.NumMips + MipIndex] = Buffer + LevelOffset + FaceIndex * FaceSize;
+            }
+        }
+
+        return BuildImage(TEXT("KTX2"), Header, MipData, Options.MinScale, OutImage, OutError);
+    }
+}
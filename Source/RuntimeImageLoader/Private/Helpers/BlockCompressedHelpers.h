@@ -0,0 +1,45 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RuntimeImageData.h"
+#include "ImageDecoders/IRuntimeImageDecoder.h"
+
+/**
+ * DDS and KTX2 containers of BC1-BC7 textures. The blocks, including pre-built mip chains and cubemap faces,
+ * are handed to the RHI as they are stored, nothing is decoded on the CPU.
+ */
+namespace FBlockCompressedHelpers
+{
+    struct FBlockCompressedHeader
+    {
+        int32 Width = 0;
+        int32 Height = 0;
+        int32 NumMips = 1;
+        /** 1, or 6 for cubemaps */
+        int32 NumFaces = 1;
+        EPixelFormat PixelFormat = PF_Unknown;
+        bool bSRGB = false;
+    };
+
+    /** Magic "DDS " */
+    bool IsDDS(const uint8* Buffer, int64 Length);
+
+    /** 12 byte KTX 2.0 identifier */
+    bool IsKTX2(const uint8* Buffer, int64 Length);
+
+    /** Bytes the DDS header reader needs, 128 for the classic header and 148 when it is followed by the DX10 extension */
+    int64 GetDDSHeaderSize(const uint8* Buffer, int64 Length);
+
+    /** Bytes of the fixed KTX2 header the header reader needs, the level index follows it */
+    constexpr int64 KTX2HeaderSize = 48;
+
+    /** Reads the header without touching the blocks, fails for formats other than BC1-BC7, arrays and volumes */
+    bool ReadDDSHeader(const uint8* Buffer, int64 Length, FBlockCompressedHeader& OutHeader, FString& OutError);
+    bool ReadKTX2Header(const uint8* Buffer, int64 Length, FBlockCompressedHeader& OutHeader, FString& OutError);
+
+    /** Copies the blocks into OutImage. Mips above Options.MinScale of the full size are skipped, OutImage.SourceSizeX/Y keep the full size */
+    bool DecodeDDS(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError);
+    bool DecodeKTX2(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError);
+}
@@ -2,7 +2,11 @@
 
 #include "CubemapUtils.h"
 #include "ImageCore.h"
+#include "Async/ParallelFor.h"
 #include "Runtime/Launch/Resources/Version.h"
+#include "Stats/Stats.h"
+
+#include "PixelKernels.h"
 
 // transform world space vector to a space relative to the face
 static FVector TransformSideToWorldSpace(uint32 CubemapFace, FVector InDirection)
@@ -72,61 +76,23 @@ static uint32 ComputeLongLatCubemapExtents(const FImage& SrcImage, const uint32
     return FMath::Clamp(1U << FMath::FloorLog2(SrcImage.SizeX / 2), 32U, MaxCubemapTextureResolution);
 }
 
-struct FImageView2D
-{
-    /** Pointer to colors in the slice. */
-    FLinearColor* SliceColors;
-    /** Width of the slice. */
-    int32 SizeX;
-    /** Height of the slice. */
-    int32 SizeY;
-
-    FImageView2D() : SliceColors(nullptr), SizeX(0), SizeY(0) {}
-
-    /** Initialization constructor. */
-    FImageView2D(FImage& Image, int32 SliceIndex)
-    {
-        SizeX = Image.SizeX;
-        SizeY = Image.SizeY;
-        SliceColors = (&Image.AsRGBA32F()[0]) + SliceIndex * SizeY * SizeX;
-    }
-
-    /** Access a single texel. */
-    FLinearColor& Access(int32 X, int32 Y)
-    {
-        return SliceColors[X + Y * SizeX];
-    }
-
-    /** Const access to a single texel. */
-    const FLinearColor& Access(int32 X, int32 Y) const
-    {
-        return SliceColors[X + Y * SizeX];
-    }
-
-    bool IsValid() const { return SliceColors != nullptr; }
-
-    static const FImageView2D ConstructConst(const FImage& Image, int32 SliceIndex)
-    {
-        return FImageView2D(const_cast<FImage&>(Image), SliceIndex);
-    }
-
-};
-
-struct FImageViewLongLat
+/** Long-lat panorama pixels, RGBA16F or RGBA32F */
+template <typename PixelType>
+struct TImageViewLongLat
 {
     /** Image colors. */
-    FLinearColor* ImageColors;
+    const PixelType* ImageColors;
     /** Width of the image. */
     int32 SizeX;
     /** Height of the image. */
     int32 SizeY;
 
     /** Initialization constructor. */
-    explicit FImageViewLongLat(FImage& Image, int32 SliceIndex)
+    TImageViewLongLat(const PixelType* InImageColors, int32 InSizeX, int32 InSizeY)
+        : ImageColors(InImageColors)
+        , SizeX(InSizeX)
+        , SizeY(InSizeY)
     {
-        SizeX = Image.SizeX;
-        SizeY = Image.SizeY;
-        ImageColors = (&Image.AsRGBA32F()[0]) + SliceIndex * SizeY * SizeX;
     }
 
     /** Wraps X around W. */
@@ -143,7 +109,7 @@ struct FImageViewLongLat
     /** Const access to a texel. */
     FLinearColor Access(int32 X, int32 Y) const
     {
-        return ImageColors[X + Y * SizeX];
+        return FLinearColor(ImageColors[X + int64(Y) * SizeX]);
     }
 
     /** Makes a filtered lookup. */
@@ -187,35 +153,85 @@ struct FImageViewLongLat
     }
 };
 
-void GenerateBaseCubeMipFromLongitudeLatitude2D(FImage* OutMip, const FImage& SrcImage, const uint32 MaxCubemapTextureResolution, uint8 SourceEncodingOverride)
+// expands the shared exponent pixels in blocks of scanlines, 4 bytes per pixel become 8 instead of the 16 of a linearized copy
+static void ConvertRGBEToHalf(const FImage& SrcImage, TArray64<FFloat16Color>& OutColors)
 {
-    FImage LongLatImage;
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_CubemapUtils_ConvertRGBEToHalf);
 
-#if ENGINE_MAJOR_VERSION < 5
-    SrcImage.CopyTo(LongLatImage, ERawImageFormat::RGBA32F, EGammaSpace::Linear);
-#else
-    SrcImage.Linearize(SourceEncodingOverride, LongLatImage);
-#endif
+    const int32 NumRows = SrcImage.SizeY * SrcImage.NumSlices;
+    const int64 RowPixels = SrcImage.SizeX;
+    OutColors.SetNumUninitialized(RowPixels * NumRows);
 
+    const int32 RowsPerBlock = FMath::Max(1, int32(65536 / FMath::Max<int64>(RowPixels, 1)));
+    const int32 NumBlocks = FMath::DivideAndRoundUp(NumRows, RowsPerBlock);
+
+    const uint8* Source = SrcImage.RawData.GetData();
+    uint16* Dest = reinterpret_cast<uint16*>(OutColors.GetData());
+
+    ParallelFor(NumBlocks, [&](int32 BlockIndex)
+    {
+        const int64 FirstPixel = int64(BlockIndex) * RowsPerBlock * RowPixels;
+        const int64 NumPixels = FMath::Min<int64>(RowsPerBlock, NumRows - int64(BlockIndex) * RowsPerBlock) * RowPixels;
+        FPixelKernels::RGBEToHalf(Source + FirstPixel * 4, Dest + FirstPixel * 4, NumPixels);
+    });
+}
+
+template <typename PixelType>
+static void GenerateCubeFaces(FImage* OutMip, const PixelType* LongLatColors, int32 SizeX, int32 SizeY, int32 NumSlices, uint32 Extent)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_CubemapUtils_GenerateCubeFaces);
+
+    const float InvExtent = 1.0f / Extent;
+    FFloat16Color* CubeColors = reinterpret_cast<FFloat16Color*>(OutMip->RawData.GetData());
+
+    // every row of every face is independent
+    ParallelFor(NumSlices * 6 * int32(Extent), [&](int32 RowIndex)
+    {
+        const int32 FaceIndex = RowIndex / Extent;
+        const uint32 Face = FaceIndex % 6;
+        const uint32 y = RowIndex % Extent;
+
+        TImageViewLongLat<PixelType> LongLatView(LongLatColors + int64(FaceIndex / 6) * SizeX * SizeY, SizeX, SizeY);
+        FFloat16Color* Row = CubeColors + (int64(FaceIndex) * Extent + y) * Extent;
+
+        for (uint32 x = 0; x < Extent; ++x)
+        {
+            FVector DirectionWS = ComputeWSCubeDirectionAtTexelCenter(Face, x, y, InvExtent);
+            Row[x] = FFloat16Color(LongLatView.LookupLongLat(DirectionWS));
+        }
+    });
+}
+
+void GenerateBaseCubeMipFromLongitudeLatitude2D(FImage* OutMip, const FImage& SrcImage, const uint32 MaxCubemapTextureResolution, uint8 SourceEncodingOverride)
+{
     // TODO_TEXTURE: Expose target size to user.
-    uint32 Extent = ComputeLongLatCubemapExtents(LongLatImage, MaxCubemapTextureResolution);
-    float InvExtent = 1.0f / Extent;
-    OutMip->Init(Extent, Extent, SrcImage.NumSlices * 6, ERawImageFormat::RGBA32F, EGammaSpace::Linear);
+    uint32 Extent = ComputeLongLatCubemapExtents(SrcImage, MaxCubemapTextureResolution);
 
-    for (int32 Slice = 0; Slice < SrcImage.NumSlices; ++Slice)
+    // half floats keep the range of RGBE panoramas at half the size of a float cube
+    OutMip->Init(Extent, Extent, SrcImage.NumSlices * 6, ERawImageFormat::RGBA16F, EGammaSpace::Linear);
+
+    if (SrcImage.Format == ERawImageFormat::BGRE8 || SrcImage.Format == ERawImageFormat::RGBA16F)
     {
-        FImageViewLongLat LongLatView(LongLatImage, Slice);
-        for (uint32 Face = 0; Face < 6; ++Face)
+        TArray64<FFloat16Color> HalfColors;
+        const FFloat16Color* LongLatColors = reinterpret_cast<const FFloat16Color*>(SrcImage.RawData.GetData());
+        if (SrcImage.Format == ERawImageFormat::BGRE8)
         {
-            FImageView2D MipView(*OutMip, Slice * 6 + Face);
-            for (uint32 y = 0; y < Extent; ++y)
-            {
-                for (uint32 x = 0; x < Extent; ++x)
-                {
-                    FVector DirectionWS = ComputeWSCubeDirectionAtTexelCenter(Face, x, y, InvExtent);
-                    MipView.Access(x, y) = LongLatView.LookupLongLat(DirectionWS);
-                }
-            }
+            ConvertRGBEToHalf(SrcImage, HalfColors);
+            LongLatColors = HalfColors.GetData();
         }
+
+        GenerateCubeFaces(OutMip, LongLatColors, SrcImage.SizeX, SrcImage.SizeY, SrcImage.NumSlices, Extent);
+    }
+    else
+    {
+        FImage LongLatImage;
+
+#if ENGINE_MAJOR_VERSION < 5
+        SrcImage.CopyTo(LongLatImage, ERawImageFormat::RGBA32F, EGammaSpace::Linear);
+#else
+        SrcImage.Linearize(SourceEncodingOverride, LongLatImage);
+#endif
+
+        GenerateCubeFaces(OutMip, reinterpret_cast<const FLinearColor*>(LongLatImage.RawData.GetData()), LongLatImage.SizeX, LongLatImage.SizeY, LongLatImage.NumSlices, Extent);
     }
 }
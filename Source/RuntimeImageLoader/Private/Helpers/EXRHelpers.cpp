@@ -0,0 +1,421 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "EXRHelpers.h"
+
+#if RUNTIMEIMAGELOADER_WITH_OPENEXR
+
+#include "Async/TaskGraphInterfaces.h"
+#include "Stats/Stats.h"
+
+#include "RuntimeImageUtils.h"
+
+#include <exception>
+#include <stdexcept>
+
+THIRD_PARTY_INCLUDES_START
+#include "Imath/ImathBox.h"
+#include "OpenEXR/IlmThread.h"
+#include "OpenEXR/ImfChannelList.h"
+#include "OpenEXR/ImfFrameBuffer.h"
+#include "OpenEXR/ImfHeader.h"
+#include "OpenEXR/ImfIO.h"
+#include "OpenEXR/ImfInputFile.h"
+#include "OpenEXR/ImfRgbaFile.h"
+#include "OpenEXR/ImfThreading.h"
+THIRD_PARTY_INCLUDES_END
+
+
+namespace FEXRHelpers
+{
+    /** Hands OpenEXR pointers into the buffer instead of copying every line buffer */
+    class FEXRMemoryStream : public Imf::IStream
+    {
+    public:
+        FEXRMemoryStream(const uint8* InBuffer, int64 InLength)
+            : Imf::IStream("RuntimeImageLoader")
+            , Buffer(InBuffer)
+            , Length(InLength)
+        {
+        }
+
+        virtual bool isMemoryMapped() const override
+        {
+            return true;
+        }
+
+        virtual char* readMemoryMapped(int NumBytes) override
+        {
+            if (NumBytes < 0 || Position + NumBytes > Length)
+            {
+                throw std::runtime_error("Unexpected end of file");
+            }
+
+            // OpenEXR only reads through the returned pointer
+            char* Data = reinterpret_cast<char*>(const_cast<uint8*>(Buffer + Position));
+            Position += NumBytes;
+            return Data;
+        }
+
+        virtual bool read(char Data[], int NumBytes) override
+        {
+            FMemory::Memcpy(Data, readMemoryMapped(NumBytes), NumBytes);
+            return Position < Length;
+        }
+
+        virtual uint64_t tellg() override
+        {
+            return uint64_t(Position);
+        }
+
+        virtual void seekg(uint64_t InPosition) override
+        {
+            Position = int64(InPosition);
+        }
+
+    private:
+        const uint8* Buffer;
+        int64 Length;
+        int64 Position = 0;
+    };
+
+    /** OpenEXR reads line buffers through the stream, scanlines are written straight into the image */
+    class FEXRArchiveStream : public Imf::IStream
+    {
+    public:
+        explicit FEXRArchiveStream(FArchive& InArchive)
+            : Imf::IStream("RuntimeImageLoader")
+            , Archive(InArchive)
+        {
+        }
+
+        virtual bool read(char Data[], int NumBytes) override
+        {
+            if (Archive.Tell() + NumBytes > Archive.TotalSize())
+            {
+                throw std::runtime_error("Unexpected end of file");
+            }
+
+            Archive.Serialize(Data, NumBytes);
+            if (Archive.IsError())
+            {
+                throw std::runtime_error("File read error");
+            }
+
+            return Archive.Tell() < Archive.TotalSize();
+        }
+
+        virtual uint64_t tellg() override
+        {
+            return uint64_t(Archive.Tell());
+        }
+
+        virtual void seekg(uint64_t Position) override
+        {
+            Archive.Seek(int64(Position));
+        }
+
+    private:
+        FArchive& Archive;
+    };
+
+    static int32 GetNumDecodeThreads()
+    {
+        // the OpenEXR pool is global, it is sized once to the task graph workers and shared by every file being decoded
+        static const int32 NumThreads = []()
+        {
+            const int32 Num = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+            if (IlmThread::supportsThreads() && Imf::globalThreadCount() < Num)
+            {
+                Imf::setGlobalThreadCount(Num);
+            }
+            return Num;
+        }();
+
+        return NumThreads;
+    }
+
+    static FString ListChannels(const Imf::ChannelList& Channels)
+    {
+        TArray<FString> Names;
+        for (Imf::ChannelList::ConstIterator It = Channels.begin(); It != Channels.end(); ++It)
+        {
+            Names.Add(UTF8_TO_TCHAR(It.name()));
+        }
+
+        return FString::Join(Names, TEXT(", "));
+    }
+
+    /**
+     * Maps the requested channels to the components of the image, an empty name leaves the component at its fill value.
+     * Gives one component for single channel images, four otherwise.
+     */
+    static bool SelectChannels(const Imf::ChannelList& Channels, const TArray<FString>& RequestedChannels, TArray<FString>& OutComponents, FString& OutError)
+    {
+        OutComponents.Reset();
+
+        if (RequestedChannels.Num() == 0)
+        {
+            static const TCHAR* RGBAChannels[] = { TEXT("R"), TEXT("G"), TEXT("B"), TEXT("A") };
+
+            bool bHasColor = false;
+            for (const TCHAR* Channel : RGBAChannels)
+            {
+                const bool bFound = Channels.findChannel(TCHAR_TO_UTF8(Channel)) != nullptr;
+                OutComponents.Add(bFound ? FString(Channel) : FString());
+                bHasColor |= bFound;
+            }
+
+            if (bHasColor)
+            {
+                return true;
+            }
+
+            // depth and other data only files
+            OutComponents.Reset();
+            int32 NumChannels = 0;
+            for (Imf::ChannelList::ConstIterator It = Channels.begin(); It != Channels.end(); ++It)
+            {
+                ++NumChannels;
+            }
+
+            if (NumChannels == 1)
+            {
+                OutComponents.Add(UTF8_TO_TCHAR(Channels.begin().name()));
+                return true;
+            }
+
+            static const TCHAR* DataChannels[] = { TEXT("Y"), TEXT("Z") };
+            for (const TCHAR* Channel : DataChannels)
+            {
+                if (Channels.findChannel(TCHAR_TO_UTF8(Channel)))
+                {
+                    OutComponents.Add(Channel);
+                    return true;
+                }
+            }
+
+            OutError = FString::Printf(TEXT("Failed to decode EXR: the file has no RGBA channels, select channels out of: %s"), *ListChannels(Channels));
+            return false;
+        }
+
+        if (RequestedChannels.Num() > 4)
+        {
+            OutError = FString::Printf(TEXT("Failed to decode EXR: %d channels requested, up to 4 are supported"), RequestedChannels.Num());
+            return false;
+        }
+
+        for (int32 Index = 0; Index < RequestedChannels.Num(); ++Index)
+        {
+            const FString& Channel = RequestedChannels[Index];
+            if (!Channels.findChannel(TCHAR_TO_UTF8(*Channel)))
+            {
+                OutError = FString::Printf(TEXT("Failed to decode EXR: channel '%s' not found, available channels: %s"), *Channel, *ListChannels(Channels));
+                return false;
+            }
+
+            // a frame buffer holds one slice per channel, channel names are case sensitive
+            if (RequestedChannels.IndexOfByPredicate([&Channel](const FString& Other) { return Other.Equals(Channel, ESearchCase::CaseSensitive); }) != Index)
+            {
+                OutError = FString::Printf(TEXT("Failed to decode EXR: channel '%s' is requested twice"), *Channel);
+                return false;
+            }
+        }
+
+        OutComponents = RequestedChannels;
+        if (OutComponents.Num() > 1)
+        {
+            OutComponents.SetNum(4);
+        }
+
+        return true;
+    }
+
+    /** Gives the size of the data window and the part of it to decode, relative to the data window origin */
+    static bool CheckDataWindow(const Imath::Box2i& DataWindow, const FIntRect& RequestedRegion, int32& OutWidth, int32& OutHeight, FIntRect& OutRegion, FString& OutError)
+    {
+        const int64 Width = int64(DataWindow.max.x) - DataWindow.min.x + 1;
+        const int64 Height = int64(DataWindow.max.y) - DataWindow.min.y + 1;
+
+        if (Width <= 0 || Height <= 0 || Width > MAX_int32 || Height > MAX_int32)
+        {
+            OutError = TEXT("Failed to decode EXR: invalid data window");
+            return false;
+        }
+
+        if (!FRuntimeImageUtils::ClipRegion(RequestedRegion, int32(Width), int32(Height), OutRegion, OutError))
+        {
+            return false;
+        }
+
+        if (!FRuntimeImageUtils::IsImportResolutionValid(OutRegion.Width(), OutRegion.Height(), true))
+        {
+            OutError = FString::Printf(TEXT("Failed to decode EXR: resolution %dx%d is not supported"), OutRegion.Width(), OutRegion.Height());
+            return false;
+        }
+
+        OutWidth = int32(Width);
+        OutHeight = int32(Height);
+        return true;
+    }
+
+    /**
+     * OpenEXR reads whole scanlines, so only the rows of the region are decoded into the image.
+     * The columns are cut afterwards and the data window stays the source size of the image.
+     */
+    static void CropRegionColumns(const FIntRect& Region, int32 Width, int32 Height, FRuntimeImageData& Image)
+    {
+        if (Region.Width() != Width)
+        {
+            FRuntimeImageUtils::CropImage(Image, FIntRect(Region.Min.X, 0, Region.Max.X, Region.Height()));
+        }
+
+        Image.SourceSizeX = Width;
+        Image.SourceSizeY = Height;
+    }
+
+    /** Luminance and chroma files store subsampled RY and BY channels, the RGBA interface reconstructs the colors */
+    static void DecodeLuminanceChroma(Imf::IStream& Stream, uint64_t StartPosition, const FIntRect& RequestedRegion, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        Stream.seekg(StartPosition);
+        Imf::RgbaInputFile File(Stream, GetNumDecodeThreads());
+
+        const Imath::Box2i DataWindow = File.dataWindow();
+        int32 Width, Height;
+        FIntRect Region;
+        if (!CheckDataWindow(DataWindow, RequestedRegion, Width, Height, Region, OutError))
+        {
+            return;
+        }
+
+        // Imf::Rgba is four halfs, the memory layout of RGBA16F
+        OutImage.Init2D(Width, Region.Height(), TSF_RGBA16F);
+        Imf::Rgba* Pixels = reinterpret_cast<Imf::Rgba*>(OutImage.RawData.GetData());
+
+        // frame buffer coordinates are relative to the data window origin, the first row of the image is the first row of the region
+        const int32 FirstRow = DataWindow.min.y + Region.Min.Y;
+        File.setFrameBuffer(Pixels - DataWindow.min.x - int64(FirstRow) * Width, 1, Width);
+        File.readPixels(FirstRow, DataWindow.min.y + Region.Max.Y - 1);
+
+        CropRegionColumns(Region, Width, Height, OutImage);
+    }
+
+    static void DecodeChannels(Imf::IStream& Stream, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        const uint64_t StartPosition = Stream.tellg();
+        Imf::InputFile File(Stream, GetNumDecodeThreads());
+
+        const Imf::ChannelList& Channels = File.header().channels();
+        if (Options.Channels.Num() == 0 && (Channels.findChannel("RY") || Channels.findChannel("BY")))
+        {
+            DecodeLuminanceChroma(Stream, StartPosition, Options.Region, OutImage, OutError);
+            return;
+        }
+
+        TArray<FString> Components;
+        if (!SelectChannels(Channels, Options.Channels, Components, OutError))
+        {
+            return;
+        }
+
+        // any 32-bit channel keeps the whole image at 32-bit, OpenEXR converts the other channels while reading
+        bool bFloat = false;
+        for (const FString& Component : Components)
+        {
+            if (const Imf::Channel* Channel = Component.IsEmpty() ? nullptr : Channels.findChannel(TCHAR_TO_UTF8(*Component)))
+            {
+                if (Channel->xSampling != 1 || Channel->ySampling != 1)
+                {
+                    OutError = FString::Printf(TEXT("Failed to decode EXR: channel '%s' is subsampled"), *Component);
+                    return;
+                }
+
+                bFloat |= Channel->type != Imf::HALF;
+            }
+        }
+
+        const Imath::Box2i DataWindow = File.header().dataWindow();
+        int32 Width, Height;
+        FIntRect Region;
+        if (!CheckDataWindow(DataWindow, Options.Region, Width, Height, Region, OutError))
+        {
+            return;
+        }
+
+        ETextureSourceFormat TextureFormat;
+        if (Components.Num() == 1)
+        {
+            TextureFormat = bFloat ? TSF_R32F : TSF_R16F;
+        }
+        else
+        {
+            TextureFormat = bFloat ? TSF_RGBA32F : TSF_RGBA16F;
+        }
+
+        OutImage.Init2D(Width, Region.Height(), TextureFormat);
+
+        const Imf::PixelType PixelType = bFloat ? Imf::FLOAT : Imf::HALF;
+        const int64 ComponentSize = bFloat ? sizeof(float) : sizeof(uint16);
+        const int64 PixelSize = ComponentSize * Components.Num();
+
+        // frame buffer coordinates are relative to the data window origin, the first row of the image is the first row of the region
+        const int32 FirstRow = DataWindow.min.y + Region.Min.Y;
+        char* Base = reinterpret_cast<char*>(OutImage.RawData.GetData()) - (DataWindow.min.x + int64(FirstRow) * Width) * PixelSize;
+
+        Imf::FrameBuffer FrameBuffer;
+        for (int32 Index = 0; Index < Components.Num(); ++Index)
+        {
+            // components without a channel get a name that is not in the file, OpenEXR fills them, alpha with 1
+            const FString SliceName = Components[Index].IsEmpty() ? FString::Printf(TEXT("RuntimeImageLoader.Fill%d"), Index) : Components[Index];
+            const double FillValue = Index == 3 ? 1.0 : 0.0;
+
+            FrameBuffer.insert(TCHAR_TO_UTF8(*SliceName), Imf::Slice(PixelType, Base + Index * ComponentSize, PixelSize, PixelSize * Width, 1, 1, FillValue));
+        }
+
+        File.setFrameBuffer(FrameBuffer);
+        File.readPixels(FirstRow, DataWindow.min.y + Region.Max.Y - 1);
+
+        CropRegionColumns(Region, Width, Height, OutImage);
+    }
+
+    static bool DecodeStream(Imf::IStream& Stream, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        try
+        {
+            DecodeChannels(Stream, Options, OutImage, OutError);
+        }
+        catch (const std::exception& Exception)
+        {
+            OutError = FString::Printf(TEXT("Failed to decode EXR: %s"), ANSI_TO_TCHAR(Exception.what()));
+            return false;
+        }
+
+        if (!OutError.IsEmpty())
+        {
+            return false;
+        }
+
+        OutImage.SRGB = false;
+        OutImage.GammaSpace = EGammaSpace::Linear;
+        OutImage.CompressionSettings = TC_HDR;
+
+        return true;
+    }
+
+    bool Decode(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(STAT_FEXRHelpers_Decode);
+
+        FEXRMemoryStream Stream(Buffer, Length);
+        return DecodeStream(Stream, Options, OutImage, OutError);
+    }
+
+    bool Decode(FArchive& Archive, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(STAT_FEXRHelpers_DecodeArchive);
+
+        FEXRArchiveStream Stream(Archive);
+        return DecodeStream(Stream, Options, OutImage, OutError);
+    }
+}
+
+#endif // RUNTIMEIMAGELOADER_WITH_OPENEXR
@@ -0,0 +1,28 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RuntimeImageData.h"
+#include "ImageDecoders/IRuntimeImageDecoder.h"
+
+#if RUNTIMEIMAGELOADER_WITH_OPENEXR
+
+/**
+ * OpenEXR decoding shared by the in-memory EXR decoder and the streaming EXR decoder.
+ * Scanline and tiled files are decoded through the OpenEXR thread pool. Half channels stay 16-bit float,
+ * files with 32-bit channels are kept at full precision. Only the scanlines of Options.Region are read.
+ */
+namespace FEXRHelpers
+{
+    /**
+     * Decodes the channels listed in Options.Channels, R, G, B and A when the list is empty.
+     * One channel gives a single channel image, up to four channels are stored as RGBA in the order they are listed.
+     */
+    bool Decode(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError);
+
+    /** Same as above, reads the file from the current position of the archive */
+    bool Decode(FArchive& Archive, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError);
+}
+
+#endif // RUNTIMEIMAGELOADER_WITH_OPENEXR
@@ -0,0 +1,230 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageDirectoryScanner.h"
+#include "HAL/FileManager.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Stats/Stats.h"
+
+#include "ImageReaders/ImageHeaderProbe.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogImageDirectoryScanner, Log, All);
+
+
+namespace ImageDirectoryIndex
+{
+    constexpr uint32 Magic = 0x494C4952; // RILI
+    constexpr int32 Version = 2;
+}
+
+class FImageFileStatVisitor : public IPlatformFile::FDirectoryStatVisitor
+{
+public:
+    virtual bool Visit(const TCHAR* FilenameOrDirectory, const FFileStatData& StatData) override
+    {
+        if (!StatData.bIsDirectory)
+        {
+            Files.Emplace(FilenameOrDirectory, StatData);
+        }
+        return true;
+    }
+
+    TArray<TPair<FString, FFileStatData>> Files;
+};
+
+bool FImageDirectoryScanner::Scan(const FString& Directory, bool bIsRecursive, TArray<FImageHeaderInfo>& OutImageInfos, FString& OutError)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDirectoryScanner_Scan);
+
+    const FString FullDirectory = FPaths::ConvertRelativePathToFull(Directory);
+    if (Directory.IsEmpty() || !IFileManager::Get().DirectoryExists(*FullDirectory))
+    {
+        OutError = FString::Printf(TEXT("Directory not found: %s"), *Directory);
+        return false;
+    }
+
+    const FString IndexFilename = GetIndexFilename(FullDirectory, bIsRecursive);
+
+    TMap<FString, FIndexEntry> Index;
+    LoadIndex(IndexFilename, FullDirectory, Index);
+
+    // size and modification time come with the listing, no extra file system call per file
+    FImageFileStatVisitor DirectoryVisitor;
+    if (bIsRecursive)
+    {
+        IFileManager::Get().IterateDirectoryStatRecursively(*FullDirectory, DirectoryVisitor);
+    }
+    else
+    {
+        IFileManager::Get().IterateDirectoryStat(*FullDirectory, DirectoryVisitor);
+    }
+
+    TArray<FIndexEntry> Entries;
+    Entries.Reserve(DirectoryVisitor.Files.Num());
+
+    TArray<int32> StaleEntryIndices;
+    TArray<FString> StaleFilenames;
+
+    for (TPair<FString, FFileStatData>& File : DirectoryVisitor.Files)
+    {
+        const FIndexEntry* CachedEntry = Index.Find(File.Key);
+        if (CachedEntry && CachedEntry->FileSize == File.Value.FileSize && CachedEntry->ModificationTime == File.Value.ModificationTime)
+        {
+            Entries.Add(*CachedEntry);
+            continue;
+        }
+
+        FIndexEntry NewEntry;
+        NewEntry.Filename = MoveTemp(File.Key);
+        NewEntry.FileSize = File.Value.FileSize;
+        NewEntry.ModificationTime = File.Value.ModificationTime;
+
+        StaleFilenames.Add(NewEntry.Filename);
+        StaleEntryIndices.Add(Entries.Add(MoveTemp(NewEntry)));
+    }
+
+    // only new and modified files are probed, in parallel
+    if (StaleFilenames.Num() > 0)
+    {
+        TArray<FImageHeaderInfo> StaleInfos;
+        FImageHeaderProbe::ProbeBatch(StaleFilenames, StaleInfos);
+
+        for (int32 StaleIndex = 0; StaleIndex < StaleInfos.Num(); ++StaleIndex)
+        {
+            const FImageHeaderInfo& StaleInfo = StaleInfos[StaleIndex];
+            FIndexEntry& Entry = Entries[StaleEntryIndices[StaleIndex]];
+
+            // images recognised by the stb fallback only can't be loaded by the plugin
+            if (StaleInfo.bSuccess && StaleInfo.Format != ERuntimeImageFormat::Unknown)
+            {
+                Entry.Format = StaleInfo.Format;
+                Entry.Width = StaleInfo.Width;
+                Entry.Height = StaleInfo.Height;
+                Entry.Channels = StaleInfo.Channels;
+                Entry.BitDepth = StaleInfo.BitDepth;
+                Entry.NumFrames = StaleInfo.NumFrames;
+                Entry.bIsHDR = StaleInfo.bIsHDR;
+                Entry.bHasAlpha = StaleInfo.bHasAlpha;
+            }
+        }
+    }
+
+    if (StaleFilenames.Num() > 0 || Entries.Num() != Index.Num())
+    {
+        SaveIndex(IndexFilename, FullDirectory, Entries);
+    }
+
+    UE_LOG(LogImageDirectoryScanner, Log, TEXT("Scanned %d files, probed %d new or modified files: %s"), Entries.Num(), StaleFilenames.Num(), *FullDirectory);
+
+    OutImageInfos.Reset();
+    for (const FIndexEntry& Entry : Entries)
+    {
+        if (!IsLoadableFormat(Entry.Format))
+        {
+            continue;
+        }
+
+        FImageHeaderInfo& ImageInfo = OutImageInfos.AddDefaulted_GetRef();
+        ImageInfo.ImageFilename = Entry.Filename;
+        ImageInfo.Format = Entry.Format;
+        ImageInfo.Width = Entry.Width;
+        ImageInfo.Height = Entry.Height;
+        ImageInfo.Channels = Entry.Channels;
+        ImageInfo.BitDepth = Entry.BitDepth;
+        ImageInfo.NumFrames = Entry.NumFrames;
+        ImageInfo.bIsHDR = Entry.bIsHDR;
+        ImageInfo.bHasAlpha = Entry.bHasAlpha;
+        ImageInfo.ModificationTime = Entry.ModificationTime;
+        ImageInfo.bSuccess = true;
+    }
+
+    return true;
+}
+
+bool FImageDirectoryScanner::IsLoadableFormat(ERuntimeImageFormat Format)
+{
+    switch (Format)
+    {
+        case ERuntimeImageFormat::PNG:
+        case ERuntimeImageFormat::JPEG:
+        case ERuntimeImageFormat::BMP:
+        case ERuntimeImageFormat::TGA:
+        case ERuntimeImageFormat::EXR:
+        case ERuntimeImageFormat::QOI:
+        case ERuntimeImageFormat::HDR:
+        case ERuntimeImageFormat::DDS:
+        case ERuntimeImageFormat::KTX2:
+            return true;
+#if WITH_FREEIMAGE_LIB || RUNTIMEIMAGELOADER_WITH_LIBTIFF
+        case ERuntimeImageFormat::TIFF:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+FString FImageDirectoryScanner::GetIndexFilename(const FString& Directory, bool bIsRecursive)
+{
+    const FString IndexKey = FString::Printf(TEXT("%s|%d"), *Directory, bIsRecursive ? 1 : 0);
+    return FPaths::ProjectSavedDir() / TEXT("RuntimeImageLoader") / TEXT("DirectoryIndex") / FMD5::HashAnsiString(*IndexKey) + TEXT(".idx");
+}
+
+void FImageDirectoryScanner::LoadIndex(const FString& IndexFilename, const FString& Directory, TMap<FString, FIndexEntry>& OutIndex)
+{
+    TArray<uint8> IndexData;
+    if (!FFileHelper::LoadFileToArray(IndexData, *IndexFilename, FILEREAD_Silent))
+    {
+        return;
+    }
+
+    FMemoryReader IndexReader(IndexData);
+
+    uint32 Magic = 0;
+    int32 Version = 0;
+    FString IndexDirectory;
+    IndexReader << Magic << Version;
+
+    if (Magic != ImageDirectoryIndex::Magic || Version != ImageDirectoryIndex::Version)
+    {
+        UE_LOG(LogImageDirectoryScanner, Log, TEXT("Directory index is outdated, rescanning: %s"), *Directory);
+        return;
+    }
+
+    TArray<FIndexEntry> Entries;
+    IndexReader << IndexDirectory << Entries;
+
+    // a hash collision or a corrupted file only costs a full rescan
+    if (IndexReader.IsError() || IndexDirectory != Directory)
+    {
+        UE_LOG(LogImageDirectoryScanner, Warning, TEXT("Directory index is corrupted, rescanning: %s"), *Directory);
+        return;
+    }
+
+    OutIndex.Reserve(Entries.Num());
+    for (FIndexEntry& Entry : Entries)
+    {
+        FString Filename = Entry.Filename;
+        OutIndex.Add(MoveTemp(Filename), MoveTemp(Entry));
+    }
+}
+
+void FImageDirectoryScanner::SaveIndex(const FString& IndexFilename, const FString& Directory, TArray<FIndexEntry>& Entries)
+{
+    TArray<uint8> IndexData;
+    FMemoryWriter IndexWriter(IndexData);
+
+    uint32 Magic = ImageDirectoryIndex::Magic;
+    int32 Version = ImageDirectoryIndex::Version;
+    FString IndexDirectory = Directory;
+    IndexWriter << Magic << Version << IndexDirectory << Entries;
+
+    if (!FFileHelper::SaveArrayToFile(IndexData, *IndexFilename))
+    {
+        UE_LOG(LogImageDirectoryScanner, Warning, TEXT("Failed to save directory index: %s"), *IndexFilename);
+    }
+}
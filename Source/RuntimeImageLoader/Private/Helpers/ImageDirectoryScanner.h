@@ -0,0 +1,51 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageHeaderInfo.h"
+
+/**
+ * Finds images in a directory by their content rather than by extension.
+ * Headers of new and modified files are probed in parallel, results are kept in an index under Saved/ so rescans only probe what changed.
+ */
+class FImageDirectoryScanner
+{
+public:
+    /** Lists the images LoadImage can decode, other recognised formats such as GIF and WebP are left out */
+    static bool Scan(const FString& Directory, bool bIsRecursive, TArray<FImageHeaderInfo>& OutImageInfos, FString& OutError);
+
+    /** Formats the built-in decoders of the image loader handle, GIF and WebP have their own loaders */
+    static bool IsLoadableFormat(ERuntimeImageFormat Format);
+
+private:
+    struct FIndexEntry
+    {
+        FString Filename;
+        int64 FileSize = 0;
+        FDateTime ModificationTime;
+        ERuntimeImageFormat Format = ERuntimeImageFormat::Unknown;
+        int32 Width = 0;
+        int32 Height = 0;
+        int32 Channels = 0;
+        int32 BitDepth = 0;
+        int32 NumFrames = 1;
+        bool bIsHDR = false;
+        bool bHasAlpha = false;
+
+        friend FArchive& operator<<(FArchive& Ar, FIndexEntry& Entry)
+        {
+            uint8 FormatValue = static_cast<uint8>(Entry.Format);
+
+            Ar << Entry.Filename << Entry.FileSize << Entry.ModificationTime << FormatValue << Entry.Width << Entry.Height << Entry.Channels;
+            Ar << Entry.BitDepth << Entry.NumFrames << Entry.bIsHDR << Entry.bHasAlpha;
+
+            Entry.Format = static_cast<ERuntimeImageFormat>(FormatValue);
+            return Ar;
+        }
+    };
+
+    static FString GetIndexFilename(const FString& Directory, bool bIsRecursive);
+    static void LoadIndex(const FString& IndexFilename, const FString& Directory, TMap<FString, FIndexEntry>& OutIndex);
+    static void SaveIndex(const FString& IndexFilename, const FString& Directory, TArray<FIndexEntry>& Entries);
+};
@@ -0,0 +1,338 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageDirectoryWatcher.h"
+#include "HAL/FileManager.h"
+#include "Async/Async.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Paths.h"
+#include "Modules/ModuleManager.h"
+#include "Stats/Stats.h"
+
+#if WITH_EDITOR
+#include "DirectoryWatcherModule.h"
+#include "IDirectoryWatcher.h"
+#endif
+
+#include "Helpers/ImageDirectoryScanner.h"
+#include "ImageReaders/ImageHeaderProbe.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogImageDirectoryWatcher, Log, All);
+
+
+static TAutoConsoleVariable<float> CVarWatchPollInterval(
+    TEXT("RuntimeImageLoader.Watch.PollInterval"), 1.0f,
+    TEXT("Seconds between directory listings of watched directories when no native directory watcher is available."));
+
+static TAutoConsoleVariable<float> CVarWatchDebounceDelay(
+    TEXT("RuntimeImageLoader.Watch.DebounceDelay"), 0.5f,
+    TEXT("Seconds without any new change in a watched directory before changed images are reloaded."));
+
+class FWatchedFileStatVisitor : public IPlatformFile::FDirectoryStatVisitor
+{
+public:
+    explicit FWatchedFileStatVisitor(TMap<FString, FFileStatData>& InFiles)
+        : Files(InFiles)
+    {
+    }
+
+    virtual bool Visit(const TCHAR* FilenameOrDirectory, const FFileStatData& StatData) override
+    {
+        if (!StatData.bIsDirectory)
+        {
+            Files.Add(FilenameOrDirectory, StatData);
+        }
+        return true;
+    }
+
+    TMap<FString, FFileStatData>& Files;
+};
+
+static void ListFiles(const FString& Directory, bool bIsRecursive, TMap<FString, FFileStatData>& OutFiles)
+{
+    FWatchedFileStatVisitor DirectoryVisitor(OutFiles);
+    if (bIsRecursive)
+    {
+        IFileManager::Get().IterateDirectoryStatRecursively(*Directory, DirectoryVisitor);
+    }
+    else
+    {
+        IFileManager::Get().IterateDirectoryStat(*Directory, DirectoryVisitor);
+    }
+}
+
+static bool IsSameFileContent(const FFileStatData& A, const FFileStatData& B)
+{
+    return A.FileSize == B.FileSize && A.ModificationTime == B.ModificationTime;
+}
+
+FImageDirectoryWatcher::FImageDirectoryWatcher(const FString& InDirectory, bool bInIsRecursive)
+    : Directory(FPaths::ConvertRelativePathToFull(InDirectory))
+    , bIsRecursive(bInIsRecursive)
+    , State(MakeShared<FWatchState, ESPMode::ThreadSafe>())
+{
+    FPaths::NormalizeDirectoryName(Directory);
+}
+
+FImageDirectoryWatcher::~FImageDirectoryWatcher()
+{
+#if WITH_EDITOR
+    if (WatcherHandle.IsValid())
+    {
+        // the module may be gone already at engine shutdown
+        FDirectoryWatcherModule* DirectoryWatcherModule = FModuleManager::GetModulePtr<FDirectoryWatcherModule>(TEXT("DirectoryWatcher"));
+        if (IDirectoryWatcher* DirectoryWatcher = DirectoryWatcherModule ? DirectoryWatcherModule->Get() : nullptr)
+        {
+            DirectoryWatcher->UnregisterDirectoryChangedCallback_Handle(Directory, WatcherHandle);
+        }
+    }
+#endif
+
+    // a running task keeps its state alive and its result is dropped
+}
+
+bool FImageDirectoryWatcher::Start(FString& OutError)
+{
+    if (Directory.IsEmpty() || !IFileManager::Get().DirectoryExists(*Directory))
+    {
+        OutError = FString::Printf(TEXT("Directory not found: %s"), *Directory);
+        return false;
+    }
+
+#if WITH_EDITOR
+    if (FDirectoryWatcherModule* DirectoryWatcherModule = FModuleManager::LoadModulePtr<FDirectoryWatcherModule>(TEXT("DirectoryWatcher")))
+    {
+        if (IDirectoryWatcher* DirectoryWatcher = DirectoryWatcherModule->Get())
+        {
+            bIsPolling = !DirectoryWatcher->RegisterDirectoryChangedCallback_Handle(
+                Directory, IDirectoryWatcher::FDirectoryChanged::CreateRaw(this, &FImageDirectoryWatcher::OnDirectoryChanged), WatcherHandle);
+        }
+    }
+#endif
+
+    const double CurrentTime = FPlatformTime::Seconds();
+    LaunchWatchTask(true, bIsPolling, CurrentTime);
+
+    UE_LOG(LogImageDirectoryWatcher, Log, TEXT("Watching (%s): %s"), bIsPolling ? TEXT("polling") : TEXT("directory watcher"), *Directory);
+
+    return true;
+}
+
+void FImageDirectoryWatcher::Tick(double CurrentTime, TArray<FString>& OutChangedImages, TArray<FString>& OutRemovedFiles)
+{
+    if (WatchTask.IsValid())
+    {
+        if (!WatchTask.IsReady())
+        {
+            return;
+        }
+
+        FWatchTaskResult Result = WatchTask.Get();
+        WatchTask = TFuture<FWatchTaskResult>();
+
+        OutChangedImages = MoveTemp(Result.ChangedImages);
+        OutRemovedFiles = MoveTemp(Result.RemovedFiles);
+
+        // events that arrived while the task was running are newer than its view of the files
+        bHasDirtyFiles = Result.bHasDirtyFiles || ChangedFiles.Num() > 0;
+        LastChangeTime = FMath::Max(LastChangeTime, Result.LastChangeTime);
+
+        if (OutChangedImages.Num() > 0 || OutRemovedFiles.Num() > 0)
+        {
+            UE_LOG(LogImageDirectoryWatcher, Log, TEXT("%d images changed, %d files removed: %s"), OutChangedImages.Num(), OutRemovedFiles.Num(), *Directory);
+        }
+    }
+
+    const bool bPollDue = bIsPolling && CurrentTime >= NextPollTime;
+    const bool bFlushDue = bHasDirtyFiles && CurrentTime - LastChangeTime >= CVarWatchDebounceDelay.GetValueOnGameThread();
+
+    if (bPollDue || bFlushDue)
+    {
+        LaunchWatchTask(false, bPollDue, CurrentTime);
+    }
+}
+
+void FImageDirectoryWatcher::LaunchWatchTask(bool bInitialScan, bool bPoll, double CurrentTime)
+{
+    if (bPoll)
+    {
+        NextPollTime = CurrentTime + FMath::Max(CVarWatchPollInterval.GetValueOnGameThread(), 0.1f);
+    }
+
+    WatchTask = Async(
+        EAsyncExecution::ThreadPool,
+        [State = State, Directory = Directory, bIsRecursive = bIsRecursive, bInitialScan, bPoll, ChangedFiles = MoveTemp(ChangedFiles),
+            ChangeTime = LastChangeTime, DebounceDelay = double(CVarWatchDebounceDelay.GetValueOnGameThread())]() mutable
+        {
+            return RunWatchTask(*State, Directory, bIsRecursive, bInitialScan, bPoll, MoveTemp(ChangedFiles), ChangeTime, DebounceDelay);
+        }
+    );
+
+    ChangedFiles.Reset();
+}
+
+FImageDirectoryWatcher::FWatchTaskResult FImageDirectoryWatcher::RunWatchTask(FWatchState& State, const FString& Directory, bool bIsRecursive, bool bInitialScan, bool bPoll, TSet<FString>&& ChangedFiles, double ChangeTime, double DebounceDelay)
+{
+    FWatchTaskResult Result;
+
+    if (bInitialScan)
+    {
+        ScanInitialImages(State, Directory, bIsRecursive, bPoll, Result);
+    }
+    else if (bPoll)
+    {
+        PollFiles(State, Directory, bIsRecursive);
+    }
+
+    if (ChangedFiles.Num() > 0)
+    {
+        State.DirtyFiles.Append(MoveTemp(ChangedFiles));
+        State.LastChangeTime = FMath::Max(State.LastChangeTime, ChangeTime);
+    }
+
+    if (State.DirtyFiles.Num() > 0 && FPlatformTime::Seconds() - State.LastChangeTime >= DebounceDelay)
+    {
+        FlushDirtyFiles(State, Result);
+    }
+
+    Result.bHasDirtyFiles = State.DirtyFiles.Num() > 0;
+    Result.LastChangeTime = State.LastChangeTime;
+
+    return Result;
+}
+
+void FImageDirectoryWatcher::ScanInitialImages(FWatchState& State, const FString& Directory, bool bIsRecursive, bool bPoll, FWatchTaskResult& OutResult)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDirectoryWatcher_ScanInitialImages);
+
+    TArray<FImageHeaderInfo> ImageInfos;
+    FString Error;
+    if (!FImageDirectoryScanner::Scan(Directory, bIsRecursive, ImageInfos, Error))
+    {
+        UE_LOG(LogImageDirectoryWatcher, Warning, TEXT("Failed to scan watched directory. Error: %s"), *Error);
+        return;
+    }
+
+    TMap<FString, FFileStatData> Files;
+    ListFiles(Directory, bIsRecursive, Files);
+
+    OutResult.ChangedImages.Reserve(ImageInfos.Num());
+    for (const FImageHeaderInfo& ImageInfo : ImageInfos)
+    {
+        if (const FFileStatData* StatData = Files.Find(ImageInfo.ImageFilename))
+        {
+            State.ReportedFiles.Add(ImageInfo.ImageFilename, *StatData);
+        }
+        OutResult.ChangedImages.Add(ImageInfo.ImageFilename);
+    }
+
+    if (bPoll)
+    {
+        State.PolledFiles = MoveTemp(Files);
+    }
+}
+
+void FImageDirectoryWatcher::PollFiles(FWatchState& State, const FString& Directory, bool bIsRecursive)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDirectoryWatcher_Poll);
+
+    TMap<FString, FFileStatData> Files;
+    ListFiles(Directory, bIsRecursive, Files);
+
+    const double CurrentTime = FPlatformTime::Seconds();
+
+    for (const TPair<FString, FFileStatData>& File : Files)
+    {
+        const FFileStatData* PolledStatData = State.PolledFiles.Find(File.Key);
+        if (!PolledStatData || !IsSameFileContent(*PolledStatData, File.Value))
+        {
+            State.DirtyFiles.Add(File.Key);
+            State.LastChangeTime = CurrentTime;
+        }
+    }
+
+    for (const TPair<FString, FFileStatData>& PolledFile : State.PolledFiles)
+    {
+        if (!Files.Contains(PolledFile.Key))
+        {
+            State.DirtyFiles.Add(PolledFile.Key);
+            State.LastChangeTime = CurrentTime;
+        }
+    }
+
+    State.PolledFiles = MoveTemp(Files);
+}
+
+void FImageDirectoryWatcher::FlushDirtyFiles(FWatchState& State, FWatchTaskResult& OutResult)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDirectoryWatcher_Flush);
+
+    TArray<FString> CandidateFiles;
+    TArray<FFileStatData> CandidateStats;
+
+    for (const FString& Filename : State.DirtyFiles)
+    {
+        const FFileStatData StatData = IFileManager::Get().GetStatData(*Filename);
+        if (!StatData.bIsValid || StatData.bIsDirectory)
+        {
+            if (State.ReportedFiles.Remove(Filename) > 0)
+            {
+                OutResult.RemovedFiles.Add(Filename);
+            }
+            continue;
+        }
+
+        // events are also raised for touched or re-saved files with identical content
+        const FFileStatData* ReportedStatData = State.ReportedFiles.Find(Filename);
+        if (ReportedStatData && IsSameFileContent(*ReportedStatData, StatData))
+        {
+            continue;
+        }
+
+        CandidateFiles.Add(Filename);
+        CandidateStats.Add(StatData);
+    }
+
+    State.DirtyFiles.Reset();
+
+    if (CandidateFiles.Num() == 0)
+    {
+        return;
+    }
+
+    // only files recognised by their header as images the loader can decode are reported
+    TArray<FImageHeaderInfo> ImageInfos;
+    FImageHeaderProbe::ProbeBatch(CandidateFiles, ImageInfos);
+
+    for (int32 Index = 0; Index < ImageInfos.Num(); ++Index)
+    {
+        if (ImageInfos[Index].bSuccess && FImageDirectoryScanner::IsLoadableFormat(ImageInfos[Index].Format))
+        {
+            State.ReportedFiles.Add(CandidateFiles[Index], CandidateStats[Index]);
+            OutResult.ChangedImages.Add(CandidateFiles[Index]);
+        }
+    }
+}
+
+bool FImageDirectoryWatcher::IsInWatchedDirectory(const FString& Filename) const
+{
+    return bIsRecursive ? FPaths::IsUnderDirectory(Filename, Directory) : FPaths::GetPath(Filename) == Directory;
+}
+
+#if WITH_EDITOR
+void FImageDirectoryWatcher::OnDirectoryChanged(const TArray<FFileChangeData>& FileChanges)
+{
+    const double CurrentTime = FPlatformTime::Seconds();
+
+    for (const FFileChangeData& FileChange : FileChanges)
+    {
+        const FString Filename = FPaths::ConvertRelativePathToFull(FileChange.Filename);
+        if (IsInWatchedDirectory(Filename))
+        {
+            ChangedFiles.Add(Filename);
+            bHasDirtyFiles = true;
+            LastChangeTime = CurrentTime;
+        }
+    }
+}
+#endif
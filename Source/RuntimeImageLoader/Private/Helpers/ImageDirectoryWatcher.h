@@ -0,0 +1,82 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Async/Future.h"
+
+struct FFileChangeData;
+
+/**
+ * Tracks image files of a directory and reports the ones whose content changed.
+ * Uses IDirectoryWatcher in editor builds and periodic stat polling everywhere else.
+ * Bursts of events are debounced, so a file that is still being written is reported once the writes settle.
+ * Listing, stat calls and header probes run on the thread pool, the game thread only receives the changed and removed files.
+ */
+class FImageDirectoryWatcher
+{
+public:
+    FImageDirectoryWatcher(const FString& InDirectory, bool bInIsRecursive);
+    ~FImageDirectoryWatcher();
+
+    /** Starts watching. The images that are in the directory right now are scanned in the background and reported by Tick as changed */
+    bool Start(FString& OutError);
+
+    /** Returns images that were added or modified and files that were removed since the last report, once no change arrived for the debounce delay */
+    void Tick(double CurrentTime, TArray<FString>& OutChangedImages, TArray<FString>& OutRemovedFiles);
+
+    const FString& GetDirectory() const { return Directory; }
+
+private:
+    /** Files as the background tasks see them, only touched by one task at a time */
+    struct FWatchState
+    {
+        /** Stats of the files as they were last reported, unchanged files are filtered out by these */
+        TMap<FString, FFileStatData> ReportedFiles;
+        /** Stats seen by the last poll, a difference restarts the debounce */
+        TMap<FString, FFileStatData> PolledFiles;
+
+        TSet<FString> DirtyFiles;
+        double LastChangeTime = 0.0;
+    };
+
+    struct FWatchTaskResult
+    {
+        TArray<FString> ChangedImages;
+        TArray<FString> RemovedFiles;
+
+        bool bHasDirtyFiles = false;
+        double LastChangeTime = 0.0;
+    };
+
+    static FWatchTaskResult RunWatchTask(FWatchState& State, const FString& Directory, bool bIsRecursive, bool bInitialScan, bool bPoll, TSet<FString>&& ChangedFiles, double ChangeTime, double DebounceDelay);
+    static void ScanInitialImages(FWatchState& State, const FString& Directory, bool bIsRecursive, bool bPoll, FWatchTaskResult& OutResult);
+    static void PollFiles(FWatchState& State, const FString& Directory, bool bIsRecursive);
+    static void FlushDirtyFiles(FWatchState& State, FWatchTaskResult& OutResult);
+
+    void LaunchWatchTask(bool bInitialScan, bool bPoll, double CurrentTime);
+    bool IsInWatchedDirectory(const FString& Filename) const;
+
+#if WITH_EDITOR
+    void OnDirectoryChanged(const TArray<FFileChangeData>& FileChanges);
+
+    FDelegateHandle WatcherHandle;
+#endif
+
+    FString Directory;
+    bool bIsRecursive = false;
+    bool bIsPolling = true;
+
+    /** Shared with the running task, so the watcher can be destroyed without waiting for it */
+    TSharedPtr<FWatchState, ESPMode::ThreadSafe> State;
+    TFuture<FWatchTaskResult> WatchTask;
+
+    /** Native change events that arrived since the last task was launched */
+    TSet<FString> ChangedFiles;
+
+    /** Debounce state as of the last finished task and the events since */
+    bool bHasDirtyFiles = false;
+    double LastChangeTime = 0.0;
+    double NextPollTime = 0.0;
+};
@@ -0,0 +1,897 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageHeaderHelpers.h"
+#include "BlockCompressedHelpers.h"
+
+
+namespace FImageHeaderHelpers
+{
+    static uint32 ReadBE16(const uint8* Data)
+    {
+        return (uint32(Data[0]) << 8) | uint32(Data[1]);
+    }
+
+    static uint32 ReadBE32(const uint8* Data)
+    {
+        return (uint32(Data[0]) << 24) | (uint32(Data[1]) << 16) | (uint32(Data[2]) << 8) | uint32(Data[3]);
+    }
+
+    static uint32 ReadLE16(const uint8* Data)
+    {
+        return uint32(Data[0]) | (uint32(Data[1]) << 8);
+    }
+
+    static uint32 ReadLE24(const uint8* Data)
+    {
+        return uint32(Data[0]) | (uint32(Data[1]) << 8) | (uint32(Data[2]) << 16);
+    }
+
+    static uint32 ReadLE32(const uint8* Data)
+    {
+        return uint32(Data[0]) | (uint32(Data[1]) << 8) | (uint32(Data[2]) << 16) | (uint32(Data[3]) << 24);
+    }
+
+    static uint32 Read16(const uint8* Data, bool bBigEndian)
+    {
+        return bBigEndian ? ReadBE16(Data) : ReadLE16(Data);
+    }
+
+    static uint32 Read32(const uint8* Data, bool bBigEndian)
+    {
+        return bBigEndian ? ReadBE32(Data) : ReadLE32(Data);
+    }
+
+    static EParseResult ParsePNG(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo, int64& OutRequiredBytes)
+    {
+        static const uint8 Signature[] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+
+        if (Length < (int64)sizeof(Signature) || FMemory::Memcmp(Buffer, Signature, sizeof(Signature)) != 0)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        // signature + IHDR length + IHDR tag + width + height + bit depth + colour type
+        const int64 HeaderSize = 26;
+        if (Length < HeaderSize)
+        {
+            OutRequiredBytes = HeaderSize;
+            return EParseResult::NeedMoreData;
+        }
+
+        if (FMemory::Memcmp(Buffer + 12, "IHDR", 4) != 0)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        OutInfo.Format = ERuntimeImageFormat::PNG;
+        OutInfo.Width = ReadBE32(Buffer + 16);
+        OutInfo.Height = ReadBE32(Buffer + 20);
+
+        const uint8 ColorType = Buffer[25];
+        switch (ColorType)
+        {
+            case 0:     OutInfo.Channels = 1; break; // grayscale
+            case 4:     OutInfo.Channels = 2; break; // grayscale + alpha
+            case 6:     OutInfo.Channels = 4; break; // RGBA
+            default:    OutInfo.Channels = 3; break; // RGB and palette
+        }
+
+        // palette indices are expanded to 8-bit colors
+        OutInfo.BitDepth = (ColorType == 3) ? 8 : Buffer[24];
+        OutInfo.bIsHDR = false;
+        OutInfo.bHasAlpha = ColorType == 4 || ColorType == 6;
+        OutInfo.NumFrames = 1;
+
+        // transparency and APNG animation chunks come before the image data, chunks past the probed bytes are not looked at
+        int64 ChunkOffset = 33;
+        while (ChunkOffset + 8 <= Length && FMemory::Memcmp(Buffer + ChunkOffset + 4, "IDAT", 4) != 0)
+        {
+            const uint8* ChunkType = Buffer + ChunkOffset + 4;
+            if (FMemory::Memcmp(ChunkType, "tRNS", 4) == 0)
+            {
+                OutInfo.bHasAlpha = true;
+            }
+            else if (FMemory::Memcmp(ChunkType, "acTL", 4) == 0 && ChunkOffset + 12 <= Length)
+            {
+                OutInfo.NumFrames = int32(FMath::Min<uint32>(ReadBE32(Buffer + ChunkOffset + 8), MAX_int32));
+            }
+
+            // length + type + data + CRC
+            ChunkOffset += 12 + int64(ReadBE32(Buffer + ChunkOffset));
+        }
+
+        return EParseResult::Success;
+    }
+
+    // data sub-blocks end with an empty block, returns the offset past it or INDEX_NONE when the blocks reach past the buffer
+    static int64 SkipGIFSubBlocks(const uint8* Buffer, int64 Length, int64 Offset)
+    {
+        while (Offset < Length)
+        {
+            const uint8 BlockSize = Buffer[Offset];
+            Offset += 1 + BlockSize;
+            if (BlockSize == 0)
+            {
+                return Offset;
+            }
+        }
+
+        return INDEX_NONE;
+    }
+
+    // walks the blocks within the probed bytes, frames are only counted exactly when the trailer is reached
+    static void CountGIFFrames(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo)
+    {
+        int32 NumFrames = 0;
+        bool bLooping = false;
+        bool bReachedTrailer = false;
+        OutInfo.bHasAlpha = false;
+
+        const uint8 ScreenFlags = Buffer[10];
+        int64 Offset = 13 + ((ScreenFlags & 0x80) ? 3 * (int64(2) << (ScreenFlags & 0x07)) : 0);
+
+        while (Offset != INDEX_NONE && Offset < Length)
+        {
+            const uint8 Introducer = Buffer[Offset];
+            if (Introducer == 0x3B)
+            {
+                bReachedTrailer = true;
+                break;
+            }
+
+            if (Introducer == 0x21 && Offset + 2 < Length)
+            {
+                const uint8 Label = Buffer[Offset + 1];
+                const int64 DataOffset = Offset + 2;
+
+                // graphic control extension: block size, flags with the transparency bit, delay, transparent index
+                if (Label == 0xF9 && DataOffset + 2 <= Length && (Buffer[DataOffset + 1] & 0x01))
+                {
+                    OutInfo.bHasAlpha = true;
+                }
+                else if (Label == 0xFF && DataOffset + 12 <= Length && FMemory::Memcmp(Buffer + DataOffset + 1, "NETSCAPE2.0", 11) == 0)
+                {
+                    bLooping = true;
+                }
+
+                Offset = SkipGIFSubBlocks(Buffer, Length, DataOffset);
+            }
+            else if (Introducer == 0x2C && Offset + 11 <= Length)
+            {
+                ++NumFrames;
+
+                // image descriptor, optional local color table, LZW code size and the image data
+                const uint8 ImageFlags = Buffer[Offset + 9];
+                Offset += 10 + ((ImageFlags & 0x80) ? 3 * (int64(2) << (ImageFlags & 0x07)) : 0) + 1;
+                Offset = SkipGIFSubBlocks(Buffer, Length, Offset);
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        if (bReachedTrailer)
+        {
+            OutInfo.NumFrames = FMath::Max(NumFrames, 1);
+        }
+        else
+        {
+            OutInfo.NumFrames = (bLooping || NumFrames > 1) ? 0 : 1;
+        }
+    }
+
+    static EParseResult ParseGIF(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo, int64& OutRequiredBytes)
+    {
+        if (Length < 6 || FMemory::Memcmp(Buffer, "GIF8", 4) != 0 || (Buffer[4] != '7' && Buffer[4] != '9') || Buffer[5] != 'a')
+        {
+            return EParseResult::Unsupported;
+        }
+
+        // logical screen descriptor follows the 6 byte signature
+        const int64 HeaderSize = 13;
+        if (Length < HeaderSize)
+        {
+            OutRequiredBytes = HeaderSize;
+            return EParseResult::NeedMoreData;
+        }
+
+        OutInfo.Format = ERuntimeImageFormat::GIF;
+        OutInfo.Width = ReadLE16(Buffer + 6);
+        OutInfo.Height = ReadLE16(Buffer + 8);
+        OutInfo.Channels = 4;
+        OutInfo.BitDepth = 8;
+        OutInfo.bIsHDR = false;
+
+        CountGIFFrames(Buffer, Length, OutInfo);
+
+        return EParseResult::Success;
+    }
+
+    // counts the ANMF chunks of an animated WebP, 0 when the chunks reach past the probed bytes
+    static int32 CountWebPFrames(const uint8* Buffer, int64 Length)
+    {
+        const int64 FileEnd = 8 + int64(ReadLE32(Buffer + 4));
+
+        int32 NumFrames = 0;
+        int64 Offset = 12;
+        while (Offset + 8 <= Length && Offset < FileEnd)
+        {
+            if (FMemory::Memcmp(Buffer + Offset, "ANMF", 4) == 0)
+            {
+                ++NumFrames;
+            }
+
+            // chunk data is padded to an even size
+            const int64 ChunkSize = ReadLE32(Buffer + Offset + 4);
+            Offset += 8 + ChunkSize + (ChunkSize & 1);
+        }
+
+        return Offset >= FileEnd ? NumFrames : 0;
+    }
+
+    static EParseResult ParseWebP(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo, int64& OutRequiredBytes)
+    {
+        if (Length < 12 || FMemory::Memcmp(Buffer, "RIFF", 4) != 0 || FMemory::Memcmp(Buffer + 8, "WEBP", 4) != 0)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        const int64 HeaderSize = 30;
+        if (Length < HeaderSize)
+        {
+            OutRequiredBytes = HeaderSize;
+            return EParseResult::NeedMoreData;
+        }
+
+        const uint8* Chunk = Buffer + 12;
+        const uint8* ChunkData = Buffer + 20;
+
+        if (FMemory::Memcmp(Chunk, "VP8X", 4) == 0)
+        {
+            // extended format: canvas size is stored as 24-bit values minus one
+            OutInfo.Width = ReadLE24(ChunkData + 4) + 1;
+            OutInfo.Height = ReadLE24(ChunkData + 7) + 1;
+            OutInfo.Channels = (ChunkData[0] & 0x10) ? 4 : 3;
+            OutInfo.NumFrames = (ChunkData[0] & 0x02) ? CountWebPFrames(Buffer, Length) : 1;
+        }
+        else if (FMemory::Memcmp(Chunk, "VP8 ", 4) == 0)
+        {
+            // lossy: 3 byte frame tag followed by the 9D 01 2A start code
+            if (ChunkData[3] != 0x9D || ChunkData[4] != 0x01 || ChunkData[5] != 0x2A)
+            {
+                return EParseResult::Unsupported;
+            }
+
+            OutInfo.Width = ReadLE16(ChunkData + 6) & 0x3FFF;
+            OutInfo.Height = ReadLE16(ChunkData + 8) & 0x3FFF;
+            OutInfo.Channels = 3;
+            OutInfo.NumFrames = 1;
+        }
+        else if (FMemory::Memcmp(Chunk, "VP8L", 4) == 0)
+        {
+            // lossless: signature byte followed by 14 bit width - 1, 14 bit height - 1 and the alpha hint
+            if (ChunkData[0] != 0x2F)
+            {
+                return EParseResult::Unsupported;
+            }
+
+            const uint32 Bits = ReadLE32(ChunkData + 1);
+            OutInfo.Width = (Bits & 0x3FFF) + 1;
+            OutInfo.Height = ((Bits >> 14) & 0x3FFF) + 1;
+            OutInfo.Channels = ((Bits >> 28) & 0x1) ? 4 : 3;
+            OutInfo.NumFrames = 1;
+        }
+        else
+        {
+            return EParseResult::Unsupported;
+        }
+
+        OutInfo.Format = ERuntimeImageFormat::WebP;
+        OutInfo.BitDepth = 8;
+        OutInfo.bIsHDR = false;
+        OutInfo.bHasAlpha = OutInfo.Channels == 4;
+
+        return EParseResult::Success;
+    }
+
+    static bool IsJPEGStartOfFrame(uint8 Marker)
+    {
+        // SOF0..SOF15 except DHT (C4), JPG (C8) and DAC (CC)
+        return Marker >= 0xC0 && Marker <= 0xCF && Marker != 0xC4 && Marker != 0xC8 && Marker != 0xCC;
+    }
+
+    static EParseResult ParseJPEG(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo, int64& OutRequiredBytes)
+    {
+        if (Length < 3 || Buffer[0] != 0xFF || Buffer[1] != 0xD8 || Buffer[2] != 0xFF)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        // marker + length + precision + height + width + number of components
+        const int64 StartOfFrameSize = 10;
+
+        int64 Offset = 2;
+        while (true)
+        {
+            if (Offset + 4 > Length)
+            {
+                OutRequiredBytes = Offset + StartOfFrameSize;
+                return EParseResult::NeedMoreData;
+            }
+
+            if (Buffer[Offset] != 0xFF)
+            {
+                return EParseResult::Unsupported;
+            }
+
+            const uint8 Marker = Buffer[Offset + 1];
+
+            // fill bytes
+            if (Marker == 0xFF)
+            {
+                ++Offset;
+                continue;
+            }
+
+            // standalone markers carry no length
+            if (Marker == 0xD8 || Marker == 0x01 || (Marker >= 0xD0 && Marker <= 0xD7))
+            {
+                Offset += 2;
+                continue;
+            }
+
+            // reached entropy coded data or end of image without a frame header
+            if (Marker == 0xDA || Marker == 0xD9)
+            {
+                return EParseResult::Unsupported;
+            }
+
+            const int64 SegmentLength = ReadBE16(Buffer + Offset + 2);
+            if (SegmentLength < 2)
+            {
+                return EParseResult::Unsupported;
+            }
+
+            if (IsJPEGStartOfFrame(Marker))
+            {
+                if (Offset + StartOfFrameSize > Length)
+                {
+                    OutRequiredBytes = Offset + StartOfFrameSize;
+                    return EParseResult::NeedMoreData;
+                }
+
+                OutInfo.Format = ERuntimeImageFormat::JPEG;
+                OutInfo.BitDepth = Buffer[Offset + 4];
+                OutInfo.Height = ReadBE16(Buffer + Offset + 5);
+                OutInfo.Width = ReadBE16(Buffer + Offset + 7);
+                OutInfo.Channels = Buffer[Offset + 9];
+                OutInfo.NumFrames = 1;
+                OutInfo.bIsHDR = false;
+                OutInfo.bHasAlpha = false;
+
+                return EParseResult::Success;
+            }
+
+            Offset += 2 + SegmentLength;
+        }
+    }
+
+    static EParseResult ParseBMP(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo, int64& OutRequiredBytes)
+    {
+        if (Length < 2 || Buffer[0] != 'B' || Buffer[1] != 'M')
+        {
+            return EParseResult::Unsupported;
+        }
+
+        // file header + DIB header size + width + height + planes + bits per pixel
+        const int64 HeaderSize = 30;
+        if (Length < HeaderSize)
+        {
+            OutRequiredBytes = HeaderSize;
+            return EParseResult::NeedMoreData;
+        }
+
+        const uint32 InfoHeaderSize = ReadLE32(Buffer + 14);
+        uint32 BitsPerPixel = 0;
+
+        if (InfoHeaderSize == 12)
+        {
+            // OS/2 BITMAPCOREHEADER stores 16 bit dimensions
+            OutInfo.Width = ReadLE16(Buffer + 18);
+            OutInfo.Height = ReadLE16(Buffer + 20);
+            BitsPerPixel = ReadLE16(Buffer + 24);
+        }
+        else if (InfoHeaderSize >= 40)
+        {
+            // negative height marks a top-down bitmap
+            OutInfo.Width = int32(ReadLE32(Buffer + 18));
+            OutInfo.Height = FMath::Abs(int32(ReadLE32(Buffer + 22)));
+            BitsPerPixel = ReadLE16(Buffer + 28);
+        }
+        else
+        {
+            return EParseResult::Unsupported;
+        }
+
+        if (OutInfo.Width <= 0 || OutInfo.Height <= 0)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        OutInfo.Format = ERuntimeImageFormat::BMP;
+        OutInfo.Channels = (BitsPerPixel == 32) ? 4 : 3;
+        OutInfo.BitDepth = 8;
+        OutInfo.NumFrames = 1;
+        OutInfo.bIsHDR = false;
+        OutInfo.bHasAlpha = OutInfo.Channels == 4;
+
+        return EParseResult::Success;
+    }
+
+    static EParseResult ParseQOI(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo, int64& OutRequiredBytes)
+    {
+        if (Length < 4 || FMemory::Memcmp(Buffer, "qoif", 4) != 0)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        // magic + width + height + channels + colorspace
+        const int64 HeaderSize = 14;
+        if (Length < HeaderSize)
+        {
+            OutRequiredBytes = HeaderSize;
+            return EParseResult::NeedMoreData;
+        }
+
+        OutInfo.Format = ERuntimeImageFormat::QOI;
+        OutInfo.Width = ReadBE32(Buffer + 4);
+        OutInfo.Height = ReadBE32(Buffer + 8);
+        OutInfo.Channels = Buffer[12];
+        OutInfo.BitDepth = 8;
+        OutInfo.NumFrames = 1;
+        OutInfo.bIsHDR = false;
+        OutInfo.bHasAlpha = OutInfo.Channels == 4;
+
+        return EParseResult::Success;
+    }
+
+    static bool ParseHDRDimension(const uint8* Line, int64 LineLength, int64& InOutOffset, uint8& OutAxis, int32& OutValue)
+    {
+        while (InOutOffset < LineLength && Line[InOutOffset] == ' ')
+        {
+            ++InOutOffset;
+        }
+
+        if (InOutOffset + 2 >= LineLength || (Line[InOutOffset] != '+' && Line[InOutOffset] != '-') || (Line[InOutOffset + 1] != 'X' && Line[InOutOffset + 1] != 'Y'))
+        {
+            return false;
+        }
+
+        OutAxis = Line[InOutOffset + 1];
+        InOutOffset += 2;
+
+        while (InOutOffset < LineLength && Line[InOutOffset] == ' ')
+        {
+            ++InOutOffset;
+        }
+
+        int64 Value = 0;
+        const int64 DigitsStart = InOutOffset;
+        while (InOutOffset < LineLength && Line[InOutOffset] >= '0' && Line[InOutOffset] <= '9' && Value <= MAX_int32)
+        {
+            Value = Value * 10 + (Line[InOutOffset] - '0');
+            ++InOutOffset;
+        }
+
+        OutValue = int32(Value);
+        return InOutOffset > DigitsStart && Value > 0 && Value <= MAX_int32;
+    }
+
+    static EParseResult ParseHDR(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo, int64& OutRequiredBytes)
+    {
+        if (!(Length >= 10 && FMemory::Memcmp(Buffer, "#?RADIANCE", 10) == 0) && !(Length >= 6 && FMemory::Memcmp(Buffer, "#?RGBE", 6) == 0))
+        {
+            return EParseResult::Unsupported;
+        }
+
+        // header lines are terminated by an empty line, the resolution string follows it
+        int64 Offset = 0;
+        while (Offset + 1 < Length && !(Buffer[Offset] == '\n' && Buffer[Offset + 1] == '\n'))
+        {
+            ++Offset;
+        }
+
+        const int64 LineStart = Offset + 2;
+        int64 LineEnd = LineStart;
+        while (LineEnd < Length && Buffer[LineEnd] != '\n')
+        {
+            ++LineEnd;
+        }
+
+        if (LineEnd >= Length)
+        {
+            OutRequiredBytes = Length + 1;
+            return EParseResult::NeedMoreData;
+        }
+
+        // usually "-Y height +X width", other orientations swap the order
+        const uint8* Line = Buffer + LineStart;
+        const int64 LineLength = LineEnd - LineStart;
+
+        int64 LineOffset = 0;
+        uint8 FirstAxis = 0, SecondAxis = 0;
+        int32 FirstValue = 0, SecondValue = 0;
+
+        if (!ParseHDRDimension(Line, LineLength, LineOffset, FirstAxis, FirstValue) ||
+            !ParseHDRDimension(Line, LineLength, LineOffset, SecondAxis, SecondValue) ||
+            FirstAxis == SecondAxis)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        OutInfo.Format = ERuntimeImageFormat::HDR;
+        OutInfo.Width = (FirstAxis == 'X') ? FirstValue : SecondValue;
+        OutInfo.Height = (FirstAxis == 'Y') ? FirstValue : SecondValue;
+        OutInfo.Channels = 3;
+        OutInfo.BitDepth = 32;
+        OutInfo.NumFrames = 1;
+        OutInfo.bIsHDR = true;
+        OutInfo.bHasAlpha = false;
+
+        return EParseResult::Success;
+    }
+
+    static EParseResult ParseTIFF(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo, int64& OutRequiredBytes)
+    {
+        if (Length < 4)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        const bool bLittleEndian = Buffer[0] == 'I' && Buffer[1] == 'I' && Buffer[2] == 42 && Buffer[3] == 0;
+        const bool bBigEndian = Buffer[0] == 'M' && Buffer[1] == 'M' && Buffer[2] == 0 && Buffer[3] == 42;
+        if (!bLittleEndian && !bBigEndian)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        if (Length < 8)
+        {
+            OutRequiredBytes = 8;
+            return EParseResult::NeedMoreData;
+        }
+
+        // first image file directory may be stored anywhere in the file
+        const int64 DirectoryOffset = Read32(Buffer + 4, bBigEndian);
+        if (DirectoryOffset + 2 > Length)
+        {
+            OutRequiredBytes = DirectoryOffset + 2;
+            return EParseResult::NeedMoreData;
+        }
+
+        const int64 NumEntries = Read16(Buffer + DirectoryOffset, bBigEndian);
+        const int64 EntrySize = 12;
+        if (DirectoryOffset + 2 + NumEntries * EntrySize > Length)
+        {
+            OutRequiredBytes = DirectoryOffset + 2 + NumEntries * EntrySize;
+            return EParseResult::NeedMoreData;
+        }
+
+        constexpr uint32 TagImageWidth = 256;
+        constexpr uint32 TagImageLength = 257;
+        constexpr uint32 TagBitsPerSample = 258;
+        constexpr uint32 TagSamplesPerPixel = 277;
+        constexpr uint32 TagExtraSamples = 338;
+        constexpr uint32 TagSampleFormat = 339;
+        constexpr uint32 TypeShort = 3;
+        constexpr uint32 SampleFormatFloat = 3;
+
+        // TIFF defaults for missing tags
+        OutInfo.Channels = 1;
+        uint32 BitsPerSample = 1;
+        uint32 SampleFormat = 1;
+        uint32 ExtraSample = 0;
+
+        for (int64 EntryIndex = 0; EntryIndex < NumEntries; ++EntryIndex)
+        {
+            const uint8* Entry = Buffer + DirectoryOffset + 2 + EntryIndex * EntrySize;
+            const uint32 Tag = Read16(Entry, bBigEndian);
+            const uint32 Type = Read16(Entry + 2, bBigEndian);
+            const int64 Count = Read32(Entry + 4, bBigEndian);
+
+            // values that fit into 4 bytes are stored inline, left-justified
+            uint32 Value = (Type == TypeShort) ? Read16(Entry + 8, bBigEndian) : Read32(Entry + 8, bBigEndian);
+
+            // per sample arrays of more than two shorts are stored elsewhere, every sample is assumed to match the first
+            if (Type == TypeShort && Count > 2 && (Tag == TagBitsPerSample || Tag == TagSampleFormat || Tag == TagExtraSamples))
+            {
+                const int64 ValueOffset = Read32(Entry + 8, bBigEndian);
+                if (ValueOffset + 2 > Length)
+                {
+                    OutRequiredBytes = ValueOffset + 2;
+                    return EParseResult::NeedMoreData;
+                }
+                Value = Read16(Buffer + ValueOffset, bBigEndian);
+            }
+
+            switch (Tag)
+            {
+                case TagImageWidth:         OutInfo.Width = Value; break;
+                case TagImageLength:        OutInfo.Height = Value; break;
+                case TagBitsPerSample:      BitsPerSample = Value; break;
+                case TagSamplesPerPixel:    OutInfo.Channels = Value; break;
+                case TagExtraSamples:       ExtraSample = Value; break;
+                case TagSampleFormat:       SampleFormat = Value; break;
+                default: break;
+            }
+        }
+
+        if (OutInfo.Width <= 0 || OutInfo.Height <= 0)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        OutInfo.Format = ERuntimeImageFormat::TIFF;
+        OutInfo.BitDepth = BitsPerSample;
+        OutInfo.NumFrames = 1;
+        OutInfo.bIsHDR = SampleFormat == SampleFormatFloat;
+        // extra samples 1 and 2 are associated and unassociated alpha
+        OutInfo.bHasAlpha = ExtraSample == 1 || ExtraSample == 2;
+
+        return EParseResult::Success;
+    }
+
+    static EParseResult ParseEXR(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo, int64& OutRequiredBytes)
+    {
+        static const uint8 Magic[] = { 0x76, 0x2F, 0x31, 0x01 };
+
+        if (Length < (int64)sizeof(Magic) || FMemory::Memcmp(Buffer, Magic, sizeof(Magic)) != 0)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        // magic + version are followed by attributes: name\0 type\0 size value
+        bool bHasDataWindow = false;
+        int64 Offset = 8;
+
+        while (true)
+        {
+            const int64 NameEnd = Offset + FCStringAnsi::Strnlen(reinterpret_cast<const ANSICHAR*>(Buffer + Offset), FMath::Max<int64>(0, Length - Offset));
+            if (NameEnd >= Length)
+            {
+                OutRequiredBytes = Length + 1;
+                return EParseResult::NeedMoreData;
+            }
+
+            // empty name terminates the header
+            if (NameEnd == Offset)
+            {
+                break;
+            }
+
+            const int64 TypeStart = NameEnd + 1;
+            const int64 TypeEnd = TypeStart + FCStringAnsi::Strnlen(reinterpret_cast<const ANSICHAR*>(Buffer + TypeStart), FMath::Max<int64>(0, Length - TypeStart));
+            if (TypeEnd + 5 > Length)
+            {
+                OutRequiredBytes = TypeEnd + 5;
+                return EParseResult::NeedMoreData;
+            }
+
+            const int64 ValueSize = int32(ReadLE32(Buffer + TypeEnd + 1));
+            const int64 ValueStart = TypeEnd + 5;
+            if (ValueSize < 0)
+            {
+                return EParseResult::Unsupported;
+            }
+
+            if (ValueStart + ValueSize > Length)
+            {
+                OutRequiredBytes = ValueStart + ValueSize;
+                return EParseResult::NeedMoreData;
+            }
+
+            const ANSICHAR* Name = reinterpret_cast<const ANSICHAR*>(Buffer + Offset);
+            const uint8* Value = Buffer + ValueStart;
+
+            if (FCStringAnsi::Strcmp(Name, "dataWindow") == 0 && ValueSize == 16)
+            {
+                // box2i: xMin, yMin, xMax, yMax
+                OutInfo.Width = int32(ReadLE32(Value + 8)) - int32(ReadLE32(Value)) + 1;
+                OutInfo.Height = int32(ReadLE32(Value + 12)) - int32(ReadLE32(Value + 4)) + 1;
+                bHasDataWindow = true;
+            }
+            else if (FCStringAnsi::Strcmp(Name, "channels") == 0)
+            {
+                // chlist: name\0 followed by 16 bytes of channel description starting with the pixel type, terminated by an empty name
+                constexpr int32 PixelTypeHalf = 1;
+
+                OutInfo.Channels = 0;
+                OutInfo.BitDepth = 16;
+                OutInfo.bHasAlpha = false;
+
+                int64 ChannelOffset = 0;
+                while (ChannelOffset < ValueSize && Value[ChannelOffset] != 0)
+                {
+                    const ANSICHAR* ChannelName = reinterpret_cast<const ANSICHAR*>(Value + ChannelOffset);
+                    const int64 DescriptionOffset = ChannelOffset + FCStringAnsi::Strnlen(ChannelName, ValueSize - ChannelOffset) + 1;
+                    if (DescriptionOffset + 16 > ValueSize)
+                    {
+                        return EParseResult::Unsupported;
+                    }
+
+                    // UINT and FLOAT channels are 32-bit
+                    if (int32(ReadLE32(Value + DescriptionOffset)) != PixelTypeHalf)
+                    {
+                        OutInfo.BitDepth = 32;
+                    }
+                    OutInfo.bHasAlpha |= FCStringAnsi::Strcmp(ChannelName, "A") == 0;
+
+                    ChannelOffset = DescriptionOffset + 16;
+                    ++OutInfo.Channels;
+                }
+            }
+
+            Offset = ValueStart + ValueSize;
+        }
+
+        if (!bHasDataWindow || OutInfo.Width <= 0 || OutInfo.Height <= 0)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        OutInfo.Format = ERuntimeImageFormat::EXR;
+        OutInfo.NumFrames = 1;
+        OutInfo.bIsHDR = true;
+
+        return EParseResult::Success;
+    }
+
+    static EParseResult ParseTGA(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo, int64& OutRequiredBytes)
+    {
+        // TGA has no magic, so the fixed 18 byte header is validated field by field instead
+        const int64 HeaderSize = 18;
+        if (Length < HeaderSize)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        const uint8 ColorMapType = Buffer[1];
+        const uint8 ImageType = Buffer[2];
+        const uint8 BitsPerPixel = Buffer[16];
+        const uint8 Descriptor = Buffer[17];
+
+        const bool bColorMapped = ImageType == 1 || ImageType == 9;
+        const bool bTrueColor = ImageType == 2 || ImageType == 10;
+        const bool bGrayscale = ImageType == 3 || ImageType == 11;
+
+        if (ColorMapType > 1 || (!bColorMapped && !bTrueColor && !bGrayscale) || bColorMapped != (ColorMapType == 1))
+        {
+            return EParseResult::Unsupported;
+        }
+
+        if (BitsPerPixel != 8 && BitsPerPixel != 15 && BitsPerPixel != 16 && BitsPerPixel != 24 && BitsPerPixel != 32)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        // interleaving bits are obsolete and always zero in practice
+        if ((Descriptor & 0xC0) != 0)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        const int32 Width = ReadLE16(Buffer + 12);
+        const int32 Height = ReadLE16(Buffer + 14);
+        if (Width == 0 || Height == 0)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        OutInfo.Format = ERuntimeImageFormat::TGA;
+        OutInfo.Width = Width;
+        OutInfo.Height = Height;
+        OutInfo.Channels = bGrayscale ? 1 : ((BitsPerPixel == 32 || (Descriptor & 0x0F) != 0) ? 4 : 3);
+        OutInfo.BitDepth = 8;
+        OutInfo.NumFrames = 1;
+        OutInfo.bIsHDR = false;
+        OutInfo.bHasAlpha = OutInfo.Channels == 4;
+
+        return EParseResult::Success;
+    }
+
+    static EParseResult FillBlockCompressedInfo(ERuntimeImageFormat Format, const FBlockCompressedHelpers::FBlockCompressedHeader& Header, FImageHeaderInfo& OutInfo)
+    {
+        OutInfo.Format = Format;
+        OutInfo.Width = Header.Width;
+        OutInfo.Height = Header.Height;
+        OutInfo.NumFrames = 1;
+        OutInfo.BitDepth = Header.PixelFormat == PF_BC6H ? 16 : 8;
+        OutInfo.bIsHDR = Header.PixelFormat == PF_BC6H;
+
+        switch (Header.PixelFormat)
+        {
+            case PF_BC4:    OutInfo.Channels = 1; break;
+            case PF_BC5:    OutInfo.Channels = 2; break;
+            case PF_DXT1:
+            case PF_BC6H:   OutInfo.Channels = 3; break;
+            default:        OutInfo.Channels = 4; break;
+        }
+        OutInfo.bHasAlpha = OutInfo.Channels == 4;
+
+        return EParseResult::Success;
+    }
+
+    static EParseResult ParseDDS(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo, int64& OutRequiredBytes)
+    {
+        if (!FBlockCompressedHelpers::IsDDS(Buffer, Length))
+        {
+            return EParseResult::Unsupported;
+        }
+
+        const int64 HeaderSize = FBlockCompressedHelpers::GetDDSHeaderSize(Buffer, Length);
+        if (Length < HeaderSize)
+        {
+            OutRequiredBytes = HeaderSize;
+            return EParseResult::NeedMoreData;
+        }
+
+        // containers of anything but BC1-BC7 blocks are left to the loaders to report
+        FBlockCompressedHelpers::FBlockCompressedHeader Header;
+        FString HeaderError;
+        if (!FBlockCompressedHelpers::ReadDDSHeader(Buffer, Length, Header, HeaderError))
+        {
+            return EParseResult::Unsupported;
+        }
+
+        return FillBlockCompressedInfo(ERuntimeImageFormat::DDS, Header, OutInfo);
+    }
+
+    static EParseResult ParseKTX2(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo, int64& OutRequiredBytes)
+    {
+        if (!FBlockCompressedHelpers::IsKTX2(Buffer, Length))
+        {
+            return EParseResult::Unsupported;
+        }
+
+        if (Length < FBlockCompressedHelpers::KTX2HeaderSize)
+        {
+            OutRequiredBytes = FBlockCompressedHelpers::KTX2HeaderSize;
+            return EParseResult::NeedMoreData;
+        }
+
+        FBlockCompressedHelpers::FBlockCompressedHeader Header;
+        FString HeaderError;
+        if (!FBlockCompressedHelpers::ReadKTX2Header(Buffer, Length, Header, HeaderError))
+        {
+            return EParseResult::Unsupported;
+        }
+
+        return FillBlockCompressedInfo(ERuntimeImageFormat::KTX2, Header, OutInfo);
+    }
+
+    EParseResult ParseHeader(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo, int64& OutRequiredBytes)
+    {
+        OutRequiredBytes = 0;
+
+        if (Buffer == nullptr || Length <= 0)
+        {
+            return EParseResult::Unsupported;
+        }
+
+        using FParseFunction = EParseResult(*)(const uint8*, int64, FImageHeaderInfo&, int64&);
+        // TGA is checked last as it is recognised by header plausibility only
+        static const FParseFunction Parsers[] = { &ParsePNG, &ParseJPEG, &ParseWebP, &ParseGIF, &ParseBMP, &ParseQOI, &ParseHDR, &ParseTIFF, &ParseEXR, &ParseDDS, &ParseKTX2, &ParseTGA };
+
+        for (FParseFunction Parser : Parsers)
+        {
+            const EParseResult Result = Parser(Buffer, Length, OutInfo, OutRequiredBytes);
+            if (Result != EParseResult::Unsupported)
+            {
+                return Result;
+            }
+        }
+
+        return EParseResult::Unsupported;
+    }
+}
@@ -0,0 +1,30 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageHeaderInfo.h"
+
+
+namespace FImageHeaderHelpers
+{
+    enum class EParseResult : uint8
+    {
+        Success,
+        // Format was recognised but the dimensions are stored past the end of the supplied bytes
+        NeedMoreData,
+        Unsupported
+    };
+
+    // Enough for PNG IHDR, GIF logical screen descriptor, WebP VP8/VP8L/VP8X and JPEG files without large APP segments
+    constexpr int64 DefaultProbeBytes = 4 * 1024;
+
+    // JPEG APPn segments (EXIF, ICC, XMP) are limited to 64 KB each, so this covers almost every JPEG SOF
+    constexpr int64 ExtendedProbeBytes = 64 * 1024;
+
+    /**
+     * Reads the format, dimensions, channels, bit depth, frame count and HDR and alpha flags from the first bytes of an encoded image without decoding it.
+     * @param OutRequiredBytes - when NeedMoreData is returned, the minimum number of bytes needed to continue
+     */
+    EParseResult ParseHeader(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo, int64& OutRequiredBytes);
+}
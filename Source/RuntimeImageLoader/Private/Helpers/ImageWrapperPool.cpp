@@ -0,0 +1,196 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageWrapperPool.h"
+#include "IImageWrapperModule.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/CoreDelegates.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Modules/ModuleManager.h"
+
+
+static TAutoConsoleVariable<int32> CVarImageWrapperPoolMaxMegabytes(
+    TEXT("RuntimeImageLoader.ImageWrapperPool.MaxMegabytes"), 32,
+    TEXT("Memory that pooled wrappers may keep alive in total, the least recently used wrappers are destroyed beyond it. 0 disables the pool."));
+
+namespace FImageWrapperPool
+{
+    struct FPooledWrapper
+    {
+        EImageFormat Format;
+        TSharedPtr<IImageWrapper> Wrapper;
+        int64 RetainedBytes = 0;
+    };
+
+    static FCriticalSection& GetLock()
+    {
+        static FCriticalSection Lock;
+        return Lock;
+    }
+
+    static IImageWrapperModule*& GetModule()
+    {
+        static IImageWrapperModule* Module = nullptr;
+        return Module;
+    }
+
+    /** Wrappers of every format from least to most recently returned */
+    static TArray<FPooledWrapper>& GetFreeWrappers()
+    {
+        static TArray<FPooledWrapper> FreeWrappers;
+        return FreeWrappers;
+    }
+
+    static int64& GetFreeWrappersBytes()
+    {
+        static int64 FreeWrappersBytes = 0;
+        return FreeWrappersBytes;
+    }
+
+    static FDelegateHandle& GetMemoryTrimHandle()
+    {
+        static FDelegateHandle MemoryTrimHandle;
+        return MemoryTrimHandle;
+    }
+
+    // more wrappers of one format than threads that can decode at once are never borrowed together
+    static int32 GetMaxPooledPerFormat()
+    {
+        return FTaskGraphInterface::IsRunning() ? FTaskGraphInterface::Get().GetNumWorkerThreads() + 1 : 1;
+    }
+
+    static void EmptyFreeWrappers()
+    {
+        GetFreeWrappers().Empty();
+        GetFreeWrappersBytes() = 0;
+    }
+
+    void Initialize()
+    {
+        FScopeLock Lock(&GetLock());
+        GetModule() = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+
+        if (!GetMemoryTrimHandle().IsValid())
+        {
+            GetMemoryTrimHandle() = FCoreDelegates::GetMemoryTrimDelegate().AddStatic(&FImageWrapperPool::Trim);
+        }
+    }
+
+    void Shutdown()
+    {
+        FCoreDelegates::GetMemoryTrimDelegate().Remove(GetMemoryTrimHandle());
+        GetMemoryTrimHandle().Reset();
+
+        FScopeLock Lock(&GetLock());
+        EmptyFreeWrappers();
+        GetModule() = nullptr;
+    }
+
+    void Trim()
+    {
+        TArray<FPooledWrapper> TrimmedWrappers;
+        {
+            FScopeLock Lock(&GetLock());
+            TrimmedWrappers = MoveTemp(GetFreeWrappers());
+            EmptyFreeWrappers();
+        }
+
+        // wrappers are destroyed outside of the lock
+        TrimmedWrappers.Empty();
+    }
+
+    FScopedImageWrapper::FScopedImageWrapper(EImageFormat InFormat)
+        : Format(InFormat)
+    {
+        IImageWrapperModule* Module = nullptr;
+        {
+            FScopeLock Lock(&GetLock());
+
+            TArray<FPooledWrapper>& FreeWrappers = GetFreeWrappers();
+            for (int32 Index = FreeWrappers.Num() - 1; Index >= 0; --Index)
+            {
+                if (FreeWrappers[Index].Format == Format)
+                {
+                    GetFreeWrappersBytes() -= FreeWrappers[Index].RetainedBytes;
+                    Wrapper = MoveTemp(FreeWrappers[Index].Wrapper);
+                    FreeWrappers.RemoveAt(Index, 1, false);
+                    return;
+                }
+            }
+
+            Module = GetModule();
+        }
+
+        // decodes that run before the module started up look the module up themselves
+        if (Module == nullptr)
+        {
+            Module = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+        }
+
+        Wrapper = Module->CreateImageWrapper(Format);
+    }
+
+    FScopedImageWrapper::~FScopedImageWrapper()
+    {
+        const int64 MaxBytes = int64(FMath::Max(CVarImageWrapperPoolMaxMegabytes.GetValueOnAnyThread(), 0)) * 1024 * 1024;
+        const int64 RetainedBytes = GetRetainedBytes();
+        if (!Wrapper.IsValid() || RetainedBytes > MaxBytes)
+        {
+            return;
+        }
+
+        // evicted wrappers are destroyed outside of the lock
+        TArray<FPooledWrapper> EvictedWrappers;
+        {
+            FScopeLock Lock(&GetLock());
+
+            // wrappers returned after shutdown are destroyed with the scope
+            if (GetModule() == nullptr)
+            {
+                return;
+            }
+
+            TArray<FPooledWrapper>& FreeWrappers = GetFreeWrappers();
+            int32 NumPooledOfFormat = 0;
+            for (const FPooledWrapper& FreeWrapper : FreeWrappers)
+            {
+                NumPooledOfFormat += FreeWrapper.Format == Format ? 1 : 0;
+            }
+
+            if (NumPooledOfFormat >= GetMaxPooledPerFormat())
+            {
+                return;
+            }
+
+            int32 NumEvicted = 0;
+            while (NumEvicted < FreeWrappers.Num() && GetFreeWrappersBytes() + RetainedBytes > MaxBytes)
+            {
+                GetFreeWrappersBytes() -= FreeWrappers[NumEvicted].RetainedBytes;
+                EvictedWrappers.Add(MoveTemp(FreeWrappers[NumEvicted]));
+                ++NumEvicted;
+            }
+            FreeWrappers.RemoveAt(0, NumEvicted);
+
+            GetFreeWrappersBytes() += RetainedBytes;
+            FreeWrappers.Add({ Format, MoveTemp(Wrapper), RetainedBytes });
+        }
+    }
+
+    bool FScopedImageWrapper::SetCompressed(const uint8* Buffer, int64 Length)
+    {
+        CompressedSize = Length;
+        return Wrapper.IsValid() && Wrapper->SetCompressed(Buffer, Length);
+    }
+
+    int64 FScopedImageWrapper::GetRetainedBytes() const
+    {
+        if (!Wrapper.IsValid())
+        {
+            return 0;
+        }
+
+        // decoded pixels are counted as RGBA of the image's bit depth, whether the engine keeps them or not
+        const int64 BytesPerChannel = FMath::Max<int64>(Wrapper->GetBitDepth() / 8, 1);
+        return CompressedSize + int64(Wrapper->GetWidth()) * int64(Wrapper->GetHeight()) * 4 * BytesPerChannel;
+    }
+}
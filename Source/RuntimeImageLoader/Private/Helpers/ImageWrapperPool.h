@@ -0,0 +1,48 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IImageWrapper.h"
+
+/**
+ * ImageWrapper instances reused across decodes. Creating a wrapper allocates its codec state and buffers,
+ * which is a visible part of the cost of small images such as icons. Every decoding thread borrows a wrapper
+ * for one decode at a time, so the pool grows to the number of threads decoding the same format at once.
+ * The memory pooled wrappers keep alive is capped by RuntimeImageLoader.ImageWrapperPool.MaxMegabytes and released on memory trim.
+ */
+namespace FImageWrapperPool
+{
+    /** Looks up the ImageWrapper module once, on the game thread, so that decoding threads never go through the module manager */
+    void Initialize();
+
+    /** Destroys the pooled wrappers while the ImageWrapper module is still loaded */
+    void Shutdown();
+
+    /** Destroys the pooled wrappers and their buffers, wrappers borrowed at the moment are pooled again when returned */
+    void Trim();
+
+    /** Borrows a wrapper of the format for the lifetime of the scope */
+    class FScopedImageWrapper
+    {
+    public:
+        explicit FScopedImageWrapper(EImageFormat InFormat);
+        ~FScopedImageWrapper();
+
+        UE_NONCOPYABLE(FScopedImageWrapper);
+
+        bool IsValid() const { return Wrapper.IsValid(); }
+        IImageWrapper* operator->() const { return Wrapper.Get(); }
+
+        /** Hands the compressed image to the wrapper, the wrapper keeps a copy of it */
+        bool SetCompressed(const uint8* Buffer, int64 Length);
+
+    private:
+        EImageFormat Format;
+        TSharedPtr<IImageWrapper> Wrapper;
+        int64 CompressedSize = 0;
+
+        /** Compressed copy and decoded image the wrapper may hold on to, depending on the engine version GetRaw copies the pixels out or keeps them */
+        int64 GetRetainedBytes() const;
+    };
+}
@@ -0,0 +1,400 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "JPEGParallelDecoder.h"
+
+#if RUNTIMEIMAGELOADER_WITH_LIBJPEGTURBO
+
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Stats/Stats.h"
+#include "IImageWrapper.h"
+#include "Helpers/ImageWrapperPool.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "turbojpeg.h"
+THIRD_PARTY_INCLUDES_END
+
+DEFINE_LOG_CATEGORY_STATIC(LogJPEGParallelDecoder, Log, All);
+
+
+namespace FJPEGParallelDecoder
+{
+    static uint16 ReadBigEndian16(const uint8* Data)
+    {
+        return uint16(Data[0] << 8 | Data[1]);
+    }
+
+    static bool IsSequentialHuffmanFrame(uint8 Marker)
+    {
+        // SOF0 baseline and SOF1 extended sequential
+        return Marker == 0xC0 || Marker == 0xC1;
+    }
+
+    static bool IsOtherFrame(uint8 Marker)
+    {
+        // progressive, lossless, hierarchical and arithmetic coded frames; 0xC4 DHT and 0xCC DAC are tables
+        return Marker >= 0xC2 && Marker <= 0xCF && Marker != 0xC4 && Marker != 0xCC;
+    }
+
+    bool ParseRestartLayout(const uint8* Buffer, int64 Length, FRestartLayout& OutLayout)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(STAT_FJPEGParallelDecoder_ParseRestartLayout);
+
+        if (Length < 4 || Buffer[0] != 0xFF || Buffer[1] != 0xD8)
+        {
+            return false;
+        }
+
+        int32 RestartInterval = 0;
+        int32 NumComponents = 0;
+        int32 MaxSamplingH = 1;
+        int32 MaxSamplingV = 1;
+        int32 MinSamplingV = 4;
+
+        int64 Position = 2;
+        while (true)
+        {
+            if (Position >= Length || Buffer[Position] != 0xFF)
+            {
+                return false;
+            }
+            while (Position < Length && Buffer[Position] == 0xFF)
+            {
+                ++Position;
+            }
+            if (Position >= Length)
+            {
+                return false;
+            }
+
+            const uint8 Marker = Buffer[Position++];
+
+            // markers without a segment
+            if ((Marker >= 0xD0 && Marker <= 0xD7) || Marker == 0x01)
+            {
+                continue;
+            }
+            if (Marker == 0xD9 || Position + 2 > Length)
+            {
+                return false;
+            }
+
+            const int64 SegmentLength = ReadBigEndian16(Buffer + Position);
+            if (SegmentLength < 2 || Position + SegmentLength > Length)
+            {
+                return false;
+            }
+            const uint8* Segment = Buffer + Position;
+
+            if (IsSequentialHuffmanFrame(Marker))
+            {
+                if (SegmentLength < 8 || Segment[2] != 8)
+                {
+                    return false;
+                }
+
+                OutLayout.FrameHeightOffset = Position + 3;
+                OutLayout.Height = ReadBigEndian16(Segment + 3);
+                OutLayout.Width = ReadBigEndian16(Segment + 5);
+                NumComponents = Segment[7];
+
+                if (SegmentLength < 8 + 3 * NumComponents || NumComponents == 0)
+                {
+                    return false;
+                }
+
+                for (int32 ComponentIndex = 0; ComponentIndex < NumComponents; ++ComponentIndex)
+                {
+                    const uint8 Sampling = Segment[8 + ComponentIndex * 3 + 1];
+                    MaxSamplingH = FMath::Max<int32>(MaxSamplingH, Sampling >> 4);
+                    MaxSamplingV = FMath::Max<int32>(MaxSamplingV, Sampling & 0x0F);
+                    MinSamplingV = FMath::Min<int32>(MinSamplingV, Sampling & 0x0F);
+                }
+            }
+            else if (IsOtherFrame(Marker))
+            {
+                return false;
+            }
+            else if (Marker == 0xDD && SegmentLength >= 4)
+            {
+                RestartInterval = ReadBigEndian16(Segment + 2);
+            }
+            else if (Marker == 0xDA)
+            {
+                // only a single interleaved scan holds the whole image
+                if (NumComponents == 0 || Segment[2] != NumComponents)
+                {
+                    return false;
+                }
+
+                OutLayout.ScanStart = Position + SegmentLength;
+                break;
+            }
+
+            Position += SegmentLength;
+        }
+
+        // the height can also be defined by a DNL marker after the scan, such files are rare and not split
+        if (RestartInterval == 0 || OutLayout.Width == 0 || OutLayout.Height == 0)
+        {
+            return false;
+        }
+
+        // a non-interleaved scan of one component uses one block per MCU whatever its sampling factors are
+        const int32 McuWidth = NumComponents == 1 ? 8 : 8 * MaxSamplingH;
+        OutLayout.McuHeight = NumComponents == 1 ? 8 : 8 * MaxSamplingV;
+        OutLayout.bIsGray = NumComponents == 1;
+        OutLayout.bIsVerticallySubsampled = NumComponents > 1 && MinSamplingV < MaxSamplingV;
+
+        const int32 McusPerRow = FMath::DivideAndRoundUp(OutLayout.Width, McuWidth);
+        const int32 McuRows = FMath::DivideAndRoundUp(OutLayout.Height, OutLayout.McuHeight);
+
+        // restart markers that are not on a row boundary are skipped until they line up again
+        int32 A = RestartInterval, B = McusPerRow;
+        while (B != 0)
+        {
+            const int32 Remainder = A % B;
+            A = B;
+            B = Remainder;
+        }
+        OutLayout.IntervalsPerGroup = McusPerRow / A;
+        OutLayout.McuRowsPerGroup = RestartInterval / A;
+
+        // split the entropy coded data at restart markers
+        OutLayout.IntervalStarts.Reset();
+        OutLayout.IntervalEnds.Reset();
+        OutLayout.IntervalStarts.Add(OutLayout.ScanStart);
+
+        int64 ScanEnd = Length;
+        Position = OutLayout.ScanStart;
+        while (Position + 1 < Length)
+        {
+            const uint8* NextMarker = static_cast<const uint8*>(memchr(Buffer + Position, 0xFF, Length - Position - 1));
+            if (NextMarker == nullptr)
+            {
+                break;
+            }
+
+            Position = NextMarker - Buffer;
+            const uint8 Marker = Buffer[Position + 1];
+            if (Marker == 0x00)
+            {
+                // stuffed byte
+                Position += 2;
+            }
+            else if (Marker == 0xFF)
+            {
+                // fill byte
+                Position += 1;
+            }
+            else if (Marker >= 0xD0 && Marker <= 0xD7)
+            {
+                OutLayout.IntervalEnds.Add(Position);
+                OutLayout.IntervalStarts.Add(Position + 2);
+                Position += 2;
+            }
+            else
+            {
+                ScanEnd = Position;
+                break;
+            }
+        }
+        OutLayout.IntervalEnds.Add(ScanEnd);
+
+        // a truncated or damaged scan is left to the serial decoder and its error handling
+        const int64 NumMcus = int64(McusPerRow) * McuRows;
+        return OutLayout.IntervalStarts.Num() == FMath::DivideAndRoundUp<int64>(NumMcus, RestartInterval) && OutLayout.GetNumGroups() > 1;
+    }
+
+    bool Decode(const uint8* Buffer, int64 Length, const FRestartLayout& Layout, int32 MaxParts, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(STAT_FJPEGParallelDecoder_Decode);
+
+        const int32 NumGroups = Layout.GetNumGroups();
+        const int32 GroupsPerPart = FMath::DivideAndRoundUp(NumGroups, FMath::Clamp(MaxParts, 1, NumGroups));
+        const int32 NumParts = FMath::DivideAndRoundUp(NumGroups, GroupsPerPart);
+
+        const int PixelFormat = Layout.bIsGray ? TJPF_GRAY : TJPF_BGRA;
+        const int32 Pitch = Layout.Width * tjPixelSize[PixelFormat];
+
+        // fancy upsampling of vertically subsampled chroma blends every row with the chroma rows above and below it,
+        // which may belong to the neighbouring part. Such parts are decoded together with one row group on either side
+        // that is dropped afterwards, every kept row then sees the same chroma rows as in the serial decode
+        const int32 OverlapGroups = Layout.bIsVerticallySubsampled ? 1 : 0;
+        const int32 RowsPerGroup = Layout.McuRowsPerGroup * Layout.McuHeight;
+
+        TArray64<uint8> RawJPEG;
+        RawJPEG.SetNumUninitialized(int64(Pitch) * Layout.Height);
+
+        TArray<FString> PartErrors;
+        PartErrors.SetNum(NumParts);
+
+        ParallelFor(NumParts, [&](int32 PartIndex)
+        {
+            const int32 FirstGroup = PartIndex * GroupsPerPart;
+            const int32 EndGroup = FMath::Min(FirstGroup + GroupsPerPart, NumGroups);
+            const int32 DecodeFirstGroup = FMath::Max(FirstGroup - OverlapGroups, 0);
+            const int32 DecodeEndGroup = FMath::Min(EndGroup + OverlapGroups, NumGroups);
+
+            const int32 FirstInterval = DecodeFirstGroup * Layout.IntervalsPerGroup;
+            const int32 EndInterval = FMath::Min(DecodeEndGroup * Layout.IntervalsPerGroup, Layout.IntervalStarts.Num());
+
+            const int32 FirstRow = FirstGroup * RowsPerGroup;
+            const int32 EndRow = FMath::Min(EndGroup * RowsPerGroup, Layout.Height);
+            const int32 NumRows = EndRow - FirstRow;
+
+            const int32 DecodeFirstRow = DecodeFirstGroup * RowsPerGroup;
+            const int32 DecodeEndRow = FMath::Min(DecodeEndGroup * RowsPerGroup, Layout.Height);
+            const int32 DecodeNumRows = DecodeEndRow - DecodeFirstRow;
+
+            // standalone JPEG: the original headers with the height of this part, then its intervals
+            TArray64<uint8> PartJPEG;
+            PartJPEG.Reserve(Layout.ScanStart + (Layout.IntervalEnds[EndInterval - 1] - Layout.IntervalStarts[FirstInterval]) + 2);
+            PartJPEG.Append(Buffer, Layout.ScanStart);
+            PartJPEG[Layout.FrameHeightOffset] = uint8(DecodeNumRows >> 8);
+            PartJPEG[Layout.FrameHeightOffset + 1] = uint8(DecodeNumRows & 0xFF);
+
+            for (int32 Interval = FirstInterval; Interval < EndInterval; ++Interval)
+            {
+                PartJPEG.Append(Buffer + Layout.IntervalStarts[Interval], Layout.IntervalEnds[Interval] - Layout.IntervalStarts[Interval]);
+
+                // restart markers are renumbered, the decoder expects the sequence to start over at RST0
+                if (Interval + 1 < EndInterval)
+                {
+                    PartJPEG.Add(0xFF);
+                    PartJPEG.Add(uint8(0xD0 + (Interval - FirstInterval) % 8));
+                }
+            }
+            PartJPEG.Add(0xFF);
+            PartJPEG.Add(0xD9);
+
+            tjhandle Decompressor = tjInitDecompress();
+            if (Decompressor == nullptr)
+            {
+                PartErrors[PartIndex] = TEXT("Failed to create JPEG decompressor");
+                return;
+            }
+
+            // overlapping rows would be written by two parts at once, they go to a buffer of the part instead
+            TArray64<uint8> PartPixels;
+            uint8* Destination = RawJPEG.GetData() + int64(FirstRow) * Pitch;
+            if (DecodeNumRows != NumRows)
+            {
+                PartPixels.SetNumUninitialized(int64(DecodeNumRows) * Pitch);
+                Destination = PartPixels.GetData();
+            }
+
+            if (tjDecompress2(Decompressor, PartJPEG.GetData(), (unsigned long)PartJPEG.Num(), Destination, Layout.Width, Pitch, DecodeNumRows, PixelFormat, 0) != 0)
+            {
+                PartErrors[PartIndex] = UTF8_TO_TCHAR(tjGetErrorStr2(Decompressor));
+            }
+            else if (PartPixels.Num() > 0)
+            {
+                FMemory::Memcpy(RawJPEG.GetData() + int64(FirstRow) * Pitch, PartPixels.GetData() + int64(FirstRow - DecodeFirstRow) * Pitch, int64(NumRows) * Pitch);
+            }
+
+            tjDestroy(Decompressor);
+        });
+
+        for (const FString& PartError : PartErrors)
+        {
+            if (!PartError.IsEmpty())
+            {
+                OutError = FString::Printf(TEXT("Failed to decode JPEG. %s"), *PartError);
+                return false;
+            }
+        }
+
+        OutImage.Init2D(Layout.Width, Layout.Height, Layout.bIsGray ? TSF_G8 : TSF_BGRA8, MoveTemp(RawJPEG));
+        OutImage.SRGB = true;
+        OutImage.GammaSpace = EGammaSpace::sRGB;
+
+        return true;
+    }
+}
+
+//
+// Benchmark
+//
+// RuntimeImageLoader.BenchmarkJPEGDecode <ImageFile> [Iterations]
+// Compares the serial ImageWrapper decode that FImageDecoderJPEG falls back to with the parallel decode split into 1, 2, 4... parts
+// up to the number of cores, the pixels of both have to be the same
+static void BenchmarkJPEGDecode(const TArray<FString>& Args)
+{
+    if (Args.Num() == 0)
+    {
+        UE_LOG(LogJPEGParallelDecoder, Display, TEXT("Usage: RuntimeImageLoader.BenchmarkJPEGDecode <ImageFile> [Iterations]"));
+        return;
+    }
+
+    TArray<uint8> ImageBytes;
+    if (!FFileHelper::LoadFileToArray(ImageBytes, *Args[0]))
+    {
+        UE_LOG(LogJPEGParallelDecoder, Warning, TEXT("Failed to read %s"), *Args[0]);
+        return;
+    }
+
+    const int32 NumIterations = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 5;
+
+    FJPEGParallelDecoder::FRestartLayout Layout;
+    if (!FJPEGParallelDecoder::ParseRestartLayout(ImageBytes.GetData(), ImageBytes.Num(), Layout))
+    {
+        UE_LOG(LogJPEGParallelDecoder, Display, TEXT("%s can't be decoded in parallel: not a single scan baseline JPEG with restart markers"), *FPaths::GetCleanFilename(Args[0]));
+        return;
+    }
+
+    TArray64<uint8> SerialPixels;
+
+    const uint64 SerialStartCycles = FPlatformTime::Cycles64();
+    for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+    {
+        FImageWrapperPool::FScopedImageWrapper JpegImageWrapper(EImageFormat::JPEG);
+        if (!JpegImageWrapper.SetCompressed(ImageBytes.GetData(), ImageBytes.Num()) || !JpegImageWrapper->GetRaw(Layout.bIsGray ? ERGBFormat::Gray : ERGBFormat::BGRA, 8, SerialPixels))
+        {
+            UE_LOG(LogJPEGParallelDecoder, Warning, TEXT("  Serial decode of %s failed"), *FPaths::GetCleanFilename(Args[0]));
+            return;
+        }
+    }
+    const double SerialMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - SerialStartCycles) / NumIterations;
+
+    UE_LOG(LogJPEGParallelDecoder, Display, TEXT("%s: %d x %d, %d restart intervals in %d row groups"),
+        *FPaths::GetCleanFilename(Args[0]), Layout.Width, Layout.Height, Layout.IntervalStarts.Num(), Layout.GetNumGroups());
+    UE_LOG(LogJPEGParallelDecoder, Display, TEXT("  serial       %8.2f ms"), SerialMs);
+
+    const int32 NumCores = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+    for (int32 NumParts = 1; ; NumParts = FMath::Min(NumParts * 2, NumCores))
+    {
+        FRuntimeImageData ImageData;
+        FString Error;
+
+        const uint64 StartCycles = FPlatformTime::Cycles64();
+        for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+        {
+            if (!FJPEGParallelDecoder::Decode(ImageBytes.GetData(), ImageBytes.Num(), Layout, NumParts, ImageData, Error))
+            {
+                UE_LOG(LogJPEGParallelDecoder, Warning, TEXT("  %s"), *Error);
+                return;
+            }
+        }
+        const double ParallelMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) / NumIterations;
+
+        const bool bMatchesSerial = ImageData.RawData.Num() == SerialPixels.Num() && FMemory::Memcmp(ImageData.RawData.GetData(), SerialPixels.GetData(), SerialPixels.Num()) == 0;
+        UE_LOG(LogJPEGParallelDecoder, Display, TEXT("  %3d parts    %8.2f ms  x%.2f%s"), NumParts, ParallelMs, SerialMs / ParallelMs, bMatchesSerial ? TEXT("") : TEXT("  (pixels differ from serial decode)"));
+
+        if (NumParts >= NumCores || NumParts >= Layout.GetNumGroups())
+        {
+            break;
+        }
+    }
+}
+
+static FAutoConsoleCommand BenchmarkJPEGDecodeCommand(
+    TEXT("RuntimeImageLoader.BenchmarkJPEGDecode"),
+    TEXT("Measures how JPEG decoding with restart markers scales with the number of cores. Usage: RuntimeImageLoader.BenchmarkJPEGDecode <ImageFile> [Iterations]"),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkJPEGDecode));
+
+#endif // RUNTIMEIMAGELOADER_WITH_LIBJPEGTURBO
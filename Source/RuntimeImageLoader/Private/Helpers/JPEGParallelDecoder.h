@@ -0,0 +1,50 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RuntimeImageData.h"
+
+#if RUNTIMEIMAGELOADER_WITH_LIBJPEGTURBO
+
+/**
+ * Decodes baseline JPEGs that contain restart markers on several threads.
+ * The entropy coded data is cut at restart markers that fall on MCU row boundaries, every part is wrapped into
+ * a standalone JPEG with the original tables and decoded by its own TurboJPEG instance straight into the final image rows.
+ * Vertically subsampled images are decoded with one row group of overlap between parts, so that fancy upsampling sees the same
+ * neighbouring chroma rows as in a serial decode and the pixels match the ImageWrapper decode exactly.
+ */
+namespace FJPEGParallelDecoder
+{
+    struct FRestartLayout
+    {
+        int32 Width = 0;
+        int32 Height = 0;
+        int32 McuHeight = 0;
+        bool bIsGray = false;
+        bool bIsVerticallySubsampled = false;
+
+        /** Offset of the frame height in the SOF segment, rewritten for every part */
+        int64 FrameHeightOffset = 0;
+        /** Tables, frame and scan headers end here */
+        int64 ScanStart = 0;
+
+        /** Entropy coded data of every restart interval, without the markers in between */
+        TArray<int64> IntervalStarts;
+        TArray<int64> IntervalEnds;
+
+        /** Number of consecutive restart intervals that make up whole MCU rows, and the MCU rows they cover */
+        int32 IntervalsPerGroup = 0;
+        int32 McuRowsPerGroup = 0;
+
+        int32 GetNumGroups() const { return IntervalsPerGroup > 0 ? FMath::DivideAndRoundUp(IntervalStarts.Num(), IntervalsPerGroup) : 0; }
+    };
+
+    /** Finds the restart intervals of a single scan baseline JPEG, fails for progressive images and images without restart markers */
+    bool ParseRestartLayout(const uint8* Buffer, int64 Length, FRestartLayout& OutLayout);
+
+    /** Decodes the image as up to MaxParts independent parts in parallel */
+    bool Decode(const uint8* Buffer, int64 Length, const FRestartLayout& Layout, int32 MaxParts, FRuntimeImageData& OutImage, FString& OutError);
+}
+
+#endif // RUNTIMEIMAGELOADER_WITH_LIBJPEGTURBO
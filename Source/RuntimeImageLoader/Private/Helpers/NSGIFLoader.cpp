@@ -2,6 +2,7 @@
 
 #include "NSGIFLoader.h"
 #include "RuntimeImageLoaderLog.h"
+#include "PixelKernels.h"
 
 DEFINE_LOG_CATEGORY(LibNsGifHelper);
 
@@ -152,21 +153,9 @@ bool FNSGIFLoader::DecodeInternal(nsgif_t* gif, bool first)
 		{
 			image = (const uint8*)bitmap;
 
-			// TODO: Optimize this loop later? Use memcpy?
-
-			for (uint32_t i = 0; i < info->height * info->width; i++) {
-				uint32_t y = i / info->width;
-				uint32_t x = i % info->width;
-
-				size_t z = (y * info->width + x) * 4;
-				uint8 Red = image[z];
-				uint8 Green = image[z + 1];
-				uint8 Blue = image[z + 2];
-				uint8 Alpha = image[z + 3];
-
-				int32 PixelIndex = ((frame_new * info->height + y) * info->width + x);
-				TextureData[PixelIndex] = FColor(Red, Green, Blue, Alpha);
-			}
+			// libnsgif decodes to RGBA, FColor is BGRA
+			const int64 FramePixels = int64(info->height) * info->width;
+			FPixelKernels::RGBAToBGRA(image, (uint8*)(TextureData.GetData() + frame_new * FramePixels), FramePixels);
 		}
 
 		Timestamps.Emplace(delay_cs * 10.f / 1000.f);
@@ -1,6 +1,13 @@
 // Copyright 2023 Petr Leontev. All Rights Reserved.
 
 #include "PNGHelpers.h"
+#include "Stats/Stats.h"
+
+#include <setjmp.h>
+
+THIRD_PARTY_INCLUDES_START
+#include "png.h"
+THIRD_PARTY_INCLUDES_END
 
 namespace FPNGHelpers
 {
@@ -23,4 +30,116 @@ namespace FPNGHelpers
             }
         }
     }
-}
\ No newline at end of file
+
+    struct FPNGMemoryReader
+    {
+        const uint8* Data;
+        int64 Length;
+        int64 Offset;
+    };
+
+    static void PNGReadFromMemory(png_structp PngPtr, png_bytep Data, png_size_t Length)
+    {
+        FPNGMemoryReader* Reader = static_cast<FPNGMemoryReader*>(png_get_io_ptr(PngPtr));
+        if (Reader->Offset + int64(Length) > Reader->Length)
+        {
+            png_error(PngPtr, "Unexpected end of file");
+        }
+
+        FMemory::Memcpy(Data, Reader->Data + Reader->Offset, Length);
+        Reader->Offset += Length;
+    }
+
+    static void PNGError(png_structp PngPtr, png_const_charp Message)
+    {
+        FString* OutError = static_cast<FString*>(png_get_error_ptr(PngPtr));
+        *OutError = FString::Printf(TEXT("Failed to decode PNG preview: %s"), ANSI_TO_TCHAR(Message));
+
+        longjmp(png_jmpbuf(PngPtr), 1);
+    }
+
+    static void PNGWarning(png_structp PngPtr, png_const_charp Message)
+    {
+    }
+
+#ifdef _MSC_VER
+#pragma warning(push)
+    // no objects with destructors are created between setjmp and the libpng calls that may jump back
+#pragma warning(disable : 4611)
+#endif
+
+    bool DecodeInterlacedPreview(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(STAT_FPNGHelpers_DecodeInterlacedPreview);
+
+        png_structp PngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, &OutError, PNGError, PNGWarning);
+        png_infop InfoPtr = PngPtr ? png_create_info_struct(PngPtr) : nullptr;
+        if (!InfoPtr)
+        {
+            png_destroy_read_struct(&PngPtr, nullptr, nullptr);
+            OutError = TEXT("Failed to decode PNG preview: out of memory");
+            return false;
+        }
+
+        FPNGMemoryReader Reader = { Buffer, Length, 0 };
+        TArray<uint8> RowBuffer;
+        bool bSuccess = false;
+
+        if (setjmp(png_jmpbuf(PngPtr)) == 0)
+        {
+            png_set_read_fn(PngPtr, &Reader, PNGReadFromMemory);
+            png_read_info(PngPtr, InfoPtr);
+
+            png_uint_32 Width = 0;
+            png_uint_32 Height = 0;
+            int32 BitDepth = 0;
+            int32 ColorType = 0;
+            int32 InterlaceType = 0;
+            png_get_IHDR(PngPtr, InfoPtr, &Width, &Height, &BitDepth, &ColorType, &InterlaceType, nullptr, nullptr);
+
+            if (InterlaceType == PNG_INTERLACE_ADAM7 && Width <= png_uint_32(MAX_int32) && Height <= png_uint_32(MAX_int32))
+            {
+                // the preview is shown for a moment only, 16-bit images are cut down to 8 bits
+                png_set_expand(PngPtr);
+                png_set_strip_16(PngPtr);
+                png_set_gray_to_rgb(PngPtr);
+                png_set_bgr(PngPtr);
+                png_set_add_alpha(PngPtr, 0xFF, PNG_FILLER_AFTER);
+
+                // without interlace handling libpng returns the rows of every pass as they are stored, the first pass holds every 8th pixel of every 8th row
+                png_read_update_info(PngPtr, InfoPtr);
+
+                const int32 PassWidth = int32((Width + 7) / 8);
+                const int32 PassHeight = int32((Height + 7) / 8);
+                OutImage.Init2D(PassWidth, PassHeight, TSF_BGRA8);
+
+                // libpng may touch the full row while unfiltering
+                RowBuffer.SetNumUninitialized(png_get_rowbytes(PngPtr, InfoPtr));
+
+                const int64 PassRowBytes = int64(PassWidth) * 4;
+                for (int32 Y = 0; Y < PassHeight; ++Y)
+                {
+                    png_read_row(PngPtr, RowBuffer.GetData(), nullptr);
+                    FMemory::Memcpy(OutImage.RawData.GetData() + Y * PassRowBytes, RowBuffer.GetData(), PassRowBytes);
+                }
+
+                OutImage.SourceSizeX = int32(Width);
+                OutImage.SourceSizeY = int32(Height);
+
+                // same gamma as the full image, which keeps 16-bit PNGs linear
+                OutImage.SRGB = BitDepth < 16;
+                OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+
+                bSuccess = true;
+            }
+        }
+
+        png_destroy_read_struct(&PngPtr, &InfoPtr, nullptr);
+
+        return bSuccess;
+    }
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+}
@@ -4,8 +4,10 @@
 
 #include "CoreMinimal.h"
 #include "Engine/Texture.h"
+#include "Async/ParallelFor.h"
 
 #include "RuntimeImageData.h"
+#include "PixelKernels.h"
 
 
 namespace FPNGHelpers
@@ -27,15 +29,41 @@ namespace FPNGHelpers
 
         void ProcessData()
         {
+            // most images have no white pixels with zero alpha at all, finding that out is far cheaper than the fill passes
+            const int64 NumPixels = int64(TextureWidth) * TextureHeight;
+            if (FindColor(reinterpret_cast<const ColorDataType*>(SourceData), NumPixels, GetWhiteWithZeroAlpha()) == INDEX_NONE)
+            {
+                return;
+            }
+
+            const int32 RowsPerTask = FMath::Max(1, MinPixelsPerTask / FMath::Max(TextureWidth, 1));
+            const int32 NumTasks = FMath::DivideAndRoundUp(TextureHeight, RowsPerTask);
+
+            // rows only touch their own pixels in the horizontal pass
+            TArray<bool> RowsWithColor;
+            RowsWithColor.SetNumUninitialized(TextureHeight);
+            ParallelFor(NumTasks, [this, RowsPerTask, &RowsWithColor](int32 TaskIndex)
+            {
+                const int32 EndY = FMath::Min((TaskIndex + 1) * RowsPerTask, TextureHeight);
+                for (int32 Y = TaskIndex * RowsPerTask; Y < EndY; ++Y)
+                {
+                    RowsWithColor[Y] = ProcessHorizontalRow(Y);
+                }
+            });
+
+            // fully zeroed rows take the colors of the nearest row above that has any, or of the first such row when at the top
+            TArray<int32> FillColorRows;
+            FillColorRows.Init(INDEX_NONE, TextureHeight);
+
             int32 NumZeroedTopRowsToProcess = 0;
             int32 FillColorRow = -1;
             for (int32 Y = 0; Y < TextureHeight; ++Y)
             {
-                if (!ProcessHorizontalRow(Y))
+                if (!RowsWithColor[Y])
                 {
                     if (FillColorRow != -1)
                     {
-                        FillRowColorPixels(FillColorRow, Y);
+                        FillColorRows[Y] = FillColorRow;
                     }
                     else
                     {
@@ -53,27 +81,53 @@ namespace FPNGHelpers
             {
                 for (int32 Y = 0; Y <= NumZeroedTopRowsToProcess; ++Y)
                 {
-                    FillRowColorPixels(NumZeroedTopRowsToProcess + 1, Y);
+                    FillColorRows[Y] = NumZeroedTopRowsToProcess + 1;
                 }
             }
+
+            // source rows always have colors and are never written here
+            ParallelFor(NumTasks, [this, RowsPerTask, &FillColorRows](int32 TaskIndex)
+            {
+                const int32 EndY = FMath::Min((TaskIndex + 1) * RowsPerTask, TextureHeight);
+                for (int32 Y = TaskIndex * RowsPerTask; Y < EndY; ++Y)
+                {
+                    if (FillColorRows[Y] != INDEX_NONE)
+                    {
+                        FillRowColorPixels(FillColorRows[Y], Y);
+                    }
+                }
+            });
         }
 
         /* returns False if requires further processing because entire row is filled with zeroed alpha values */
         bool ProcessHorizontalRow(int32 Y)
         {
             // only wipe out colors that are affected by png turning valid colors white if alpha = 0
-            const uint32 WhiteWithZeroAlpha = FColor(255, 255, 255, 0).DWColor();
+            const uint32 WhiteWithZeroAlpha = GetWhiteWithZeroAlpha();
 
-            // Left -> Right
+            PixelDataType* RowData = SourceData + int64(Y) * TextureWidth * 4;
+            ColorDataType* RowColors = reinterpret_cast<ColorDataType*>(RowData);
+
+            // Left -> Right, jumping over opaque runs with the vectorized search
             int32 NumLeftmostZerosToProcess = 0;
             const PixelDataType* FillColor = nullptr;
-            for (int32 X = 0; X < TextureWidth; ++X)
+            int32 X = 0;
+            while (X < TextureWidth)
             {
-                PixelDataType* PixelData = SourceData + (Y * TextureWidth + X) * 4;
-                ColorDataType* ColorData = reinterpret_cast<ColorDataType*>(PixelData);
+                const int64 NumToSkip = FindColor(RowColors + X, TextureWidth - X, WhiteWithZeroAlpha);
+                if (NumToSkip == INDEX_NONE)
+                {
+                    break;
+                }
+                if (NumToSkip > 0)
+                {
+                    X += int32(NumToSkip);
+                    FillColor = RowData + (X - 1) * 4;
+                }
 
-                if (*ColorData == WhiteWithZeroAlpha)
+                for (; X < TextureWidth && RowColors[X] == WhiteWithZeroAlpha; ++X)
                 {
+                    PixelDataType* PixelData = RowData + X * 4;
                     if (FillColor)
                     {
                         PixelData[RIdx] = FillColor[RIdx];
@@ -83,16 +137,12 @@ namespace FPNGHelpers
                     else
                     {
                         // Mark pixel as needing fill
-                        *ColorData = 0;
+                        RowColors[X] = 0;
 
                         // Keep track of how many pixels to fill starting at beginning of row
                         NumLeftmostZerosToProcess = X;
                     }
                 }
-                else
-                {
-                    FillColor = PixelData;
-                }
             }
 
             if (NumLeftmostZerosToProcess == 0)
@@ -108,12 +158,12 @@ namespace FPNGHelpers
             }
 
             // Fill using non zero pixel immediately to the right of the beginning series of zeros
-            FillColor = SourceData + (Y * TextureWidth + NumLeftmostZerosToProcess + 1) * 4;
+            FillColor = RowData + (NumLeftmostZerosToProcess + 1) * 4;
 
             // Fill zero pixels found at beginning of row that could not be filled during the Left to Right pass
-            for (int32 X = 0; X <= NumLeftmostZerosToProcess; ++X)
+            for (X = 0; X <= NumLeftmostZerosToProcess; ++X)
             {
-                PixelDataType* PixelData = SourceData + (Y * TextureWidth + X) * 4;
+                PixelDataType* PixelData = RowData + X * 4;
                 PixelData[RIdx] = FillColor[RIdx];
                 PixelData[GIdx] = FillColor[GIdx];
                 PixelData[BIdx] = FillColor[BIdx];
@@ -126,18 +176,49 @@ namespace FPNGHelpers
         {
             for (int32 X = 0; X < TextureWidth; ++X)
             {
-                const PixelDataType* FillColor = SourceData + (FillColorRow * TextureWidth + X) * 4;
-                PixelDataType* PixelData = SourceData + (Y * TextureWidth + X) * 4;
+                const PixelDataType* FillColor = SourceData + (int64(FillColorRow) * TextureWidth + X) * 4;
+                PixelDataType* PixelData = SourceData + (int64(Y) * TextureWidth + X) * 4;
                 PixelData[RIdx] = FillColor[RIdx];
                 PixelData[GIdx] = FillColor[GIdx];
                 PixelData[BIdx] = FillColor[BIdx];
             }
         }
 
+        static uint32 GetWhiteWithZeroAlpha()
+        {
+            return FColor(255, 255, 255, 0).DWColor();
+        }
+
+        static int64 FindColor(const uint32* Colors, int64 NumColors, uint32 Color)
+        {
+            return FPixelKernels::FindPixel32(Colors, NumColors, Color);
+        }
+
+        static int64 FindColor(const uint64* Colors, int64 NumColors, uint32 Color)
+        {
+            for (int64 Index = 0; Index < NumColors; ++Index)
+            {
+                if (Colors[Index] == Color)
+                {
+                    return Index;
+                }
+            }
+            return INDEX_NONE;
+        }
+
+        /** Rows are handed out to worker threads in blocks of at least this many pixels */
+        static constexpr int32 MinPixelsPerTask = 64 * 1024;
+
         PixelDataType* SourceData;
         int32 TextureWidth;
         int32 TextureHeight;
     };
 
     void FillZeroAlphaPNGData(int32 SizeX, int32 SizeY, ETextureSourceFormat SourceFormat, uint8* SourceData);
+
+    /**
+     * Decodes the first Adam7 pass of an interlaced PNG into a BGRA8 image of 1/8 the size in both directions.
+     * The pass comes first in the file, so only about 1/64 of the image data is inflated. Fails without an error for non-interlaced PNGs
+     */
+    bool DecodeInterlacedPreview(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError);
 }
\ No newline at end of file
@@ -0,0 +1,801 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "PixelKernels.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/Float16.h"
+#include "Stats/Stats.h"
+
+#define PIXELKERNELS_WITH_X86 (PLATFORM_CPU_X86_FAMILY && PLATFORM_ENABLE_VECTORINTRINSICS)
+#define PIXELKERNELS_WITH_NEON (PLATFORM_CPU_ARM_FAMILY && PLATFORM_ENABLE_VECTORINTRINSICS_NEON && PLATFORM_64BITS)
+
+#if PIXELKERNELS_WITH_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#elif PIXELKERNELS_WITH_NEON
+#include <arm_neon.h>
+#endif
+
+// AVX2 functions are compiled for AVX2 even when the module targets plain SSE and are only called after a CPUID check
+#if PIXELKERNELS_WITH_X86 && (defined(__clang__) || defined(__GNUC__))
+#define PIXELKERNELS_TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#else
+#define PIXELKERNELS_TARGET_AVX2
+#endif
+
+DEFINE_LOG_CATEGORY_STATIC(LogPixelKernels, Log, All);
+
+
+namespace FPixelKernels
+{
+    struct FKernelTable
+    {
+        void (*RGBAToBGRA)(const uint8*, uint8*, int64);
+        void (*RGBToBGRA)(const uint8*, uint8*, int64);
+        void (*BGRToBGRA)(const uint8*, uint8*, int64);
+        void (*G8ToBGRA)(const uint8*, uint8*, int64);
+        void (*RGBA16ToBGRA8)(const uint16*, uint8*, int64);
+        void (*HalfToFloat)(const uint16*, float*, int64);
+        void (*FloatToHalf)(const float*, uint16*, int64);
+        int64 (*FindPixel32)(const uint32*, int64, uint32);
+        void (*RGBEToHalf)(const uint8*, uint16*, int64);
+    };
+
+    // round(Value * 255 / 65535) without a division
+    FORCEINLINE uint8 Unorm16ToUnorm8(uint16 Value)
+    {
+        const uint32 Rounded = FMath::Min<uint32>(Value + 128, 0xFFFF);
+        return uint8((Rounded - (Rounded >> 8)) >> 8);
+    }
+
+    // 2^(Exponent - 128) / 255 built from the float exponent bits, zero exponents give black
+    FORCEINLINE float RGBEScale(uint8 Exponent)
+    {
+        const uint32 ScaleBits = Exponent == 0 ? 0 : uint32(Exponent - 1) << 23;
+        float Scale;
+        FMemory::Memcpy(&Scale, &ScaleBits, sizeof(float));
+        return Scale * (1.0f / 255.0f);
+    }
+
+    constexpr uint16 HalfOne = 0x3C00;
+
+    //
+    // Scalar, also finishes the tails of the vector kernels
+    //
+    namespace Scalar
+    {
+        static void RGBAToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+        {
+            for (int64 Index = 0; Index < NumPixels; ++Index, Source += 4, Dest += 4)
+            {
+                const uint8 Red = Source[0];
+                Dest[0] = Source[2];
+                Dest[1] = Source[1];
+                Dest[2] = Red;
+                Dest[3] = Source[3];
+            }
+        }
+
+        static void RGBToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+        {
+            for (int64 Index = 0; Index < NumPixels; ++Index, Source += 3, Dest += 4)
+            {
+                Dest[0] = Source[2];
+                Dest[1] = Source[1];
+                Dest[2] = Source[0];
+                Dest[3] = 0xFF;
+            }
+        }
+
+        static void BGRToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+        {
+            for (int64 Index = 0; Index < NumPixels; ++Index, Source += 3, Dest += 4)
+            {
+                Dest[0] = Source[0];
+                Dest[1] = Source[1];
+                Dest[2] = Source[2];
+                Dest[3] = 0xFF;
+            }
+        }
+
+        static void G8ToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+        {
+            for (int64 Index = 0; Index < NumPixels; ++Index, Dest += 4)
+            {
+                Dest[0] = Dest[1] = Dest[2] = Source[Index];
+                Dest[3] = 0xFF;
+            }
+        }
+
+        static void RGBA16ToBGRA8(const uint16* Source, uint8* Dest, int64 NumPixels)
+        {
+            for (int64 Index = 0; Index < NumPixels; ++Index, Source += 4, Dest += 4)
+            {
+                Dest[0] = Unorm16ToUnorm8(Source[2]);
+                Dest[1] = Unorm16ToUnorm8(Source[1]);
+                Dest[2] = Unorm16ToUnorm8(Source[0]);
+                Dest[3] = Unorm16ToUnorm8(Source[3]);
+            }
+        }
+
+        static void HalfToFloat(const uint16* Source, float* Dest, int64 NumValues)
+        {
+            FFloat16 Half;
+            for (int64 Index = 0; Index < NumValues; ++Index)
+            {
+                Half.Encoded = Source[Index];
+                Dest[Index] = Half.GetFloat();
+            }
+        }
+
+        static void FloatToHalf(const float* Source, uint16* Dest, int64 NumValues)
+        {
+            for (int64 Index = 0; Index < NumValues; ++Index)
+            {
+                Dest[Index] = FFloat16(Source[Index]).Encoded;
+            }
+        }
+
+        static int64 FindPixel32(const uint32* Pixels, int64 NumPixels, uint32 Value)
+        {
+            for (int64 Index = 0; Index < NumPixels; ++Index)
+            {
+                if (Pixels[Index] == Value)
+                {
+                    return Index;
+                }
+            }
+            return INDEX_NONE;
+        }
+
+        static void RGBEToHalf(const uint8* Source, uint16* Dest, int64 NumPixels)
+        {
+            for (int64 Index = 0; Index < NumPixels; ++Index, Source += 4, Dest += 4)
+            {
+                const float Scale = RGBEScale(Source[3]);
+                Dest[0] = FFloat16(Source[2] * Scale).Encoded;
+                Dest[1] = FFloat16(Source[1] * Scale).Encoded;
+                Dest[2] = FFloat16(Source[0] * Scale).Encoded;
+                Dest[3] = HalfOne;
+            }
+        }
+    }
+
+#if PIXELKERNELS_WITH_X86
+    //
+    // SSE2, part of every x86-64 CPU
+    //
+    namespace SSE2
+    {
+        FORCEINLINE __m128i SwapRedBlue(__m128i Pixels)
+        {
+            const __m128i GreenAlpha = _mm_and_si128(Pixels, _mm_set1_epi32(0xFF00FF00));
+            const __m128i RedBlue = _mm_and_si128(Pixels, _mm_set1_epi32(0x00FF00FF));
+            return _mm_or_si128(GreenAlpha, _mm_or_si128(_mm_slli_epi32(RedBlue, 16), _mm_srli_epi32(RedBlue, 16)));
+        }
+
+        FORCEINLINE __m128i Unorm16ToUnorm8(__m128i Values)
+        {
+            const __m128i Rounded = _mm_adds_epu16(Values, _mm_set1_epi16(128));
+            return _mm_srli_epi16(_mm_sub_epi16(Rounded, _mm_srli_epi16(Rounded, 8)), 8);
+        }
+
+        static void RGBAToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+        {
+            int64 Index = 0;
+            for (; Index + 4 <= NumPixels; Index += 4)
+            {
+                const __m128i Pixels = _mm_loadu_si128((const __m128i*)(Source + Index * 4));
+                _mm_storeu_si128((__m128i*)(Dest + Index * 4), SwapRedBlue(Pixels));
+            }
+            Scalar::RGBAToBGRA(Source + Index * 4, Dest + Index * 4, NumPixels - Index);
+        }
+
+        static void G8ToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+        {
+            const __m128i Opaque = _mm_set1_epi8((char)0xFF);
+
+            int64 Index = 0;
+            for (; Index + 16 <= NumPixels; Index += 16)
+            {
+                const __m128i Gray = _mm_loadu_si128((const __m128i*)(Source + Index));
+                const __m128i GrayGrayLow = _mm_unpacklo_epi8(Gray, Gray);
+                const __m128i GrayGrayHigh = _mm_unpackhi_epi8(Gray, Gray);
+                const __m128i GrayAlphaLow = _mm_unpacklo_epi8(Gray, Opaque);
+                const __m128i GrayAlphaHigh = _mm_unpackhi_epi8(Gray, Opaque);
+
+                __m128i* Target = (__m128i*)(Dest + Index * 4);
+                _mm_storeu_si128(Target + 0, _mm_unpacklo_epi16(GrayGrayLow, GrayAlphaLow));
+                _mm_storeu_si128(Target + 1, _mm_unpackhi_epi16(GrayGrayLow, GrayAlphaLow));
+                _mm_storeu_si128(Target + 2, _mm_unpacklo_epi16(GrayGrayHigh, GrayAlphaHigh));
+                _mm_storeu_si128(Target + 3, _mm_unpackhi_epi16(GrayGrayHigh, GrayAlphaHigh));
+            }
+            Scalar::G8ToBGRA(Source + Index, Dest + Index * 4, NumPixels - Index);
+        }
+
+        static void RGBA16ToBGRA8(const uint16* Source, uint8* Dest, int64 NumPixels)
+        {
+            int64 Index = 0;
+            for (; Index + 4 <= NumPixels; Index += 4)
+            {
+                const __m128i PixelsLow = Unorm16ToUnorm8(_mm_loadu_si128((const __m128i*)(Source + Index * 4)));
+                const __m128i PixelsHigh = Unorm16ToUnorm8(_mm_loadu_si128((const __m128i*)(Source + Index * 4 + 8)));
+                _mm_storeu_si128((__m128i*)(Dest + Index * 4), SwapRedBlue(_mm_packus_epi16(PixelsLow, PixelsHigh)));
+            }
+            Scalar::RGBA16ToBGRA8(Source + Index * 4, Dest + Index * 4, NumPixels - Index);
+        }
+
+        static int64 FindPixel32(const uint32* Pixels, int64 NumPixels, uint32 Value)
+        {
+            const __m128i Needle = _mm_set1_epi32(int32(Value));
+
+            int64 Index = 0;
+            for (; Index + 8 <= NumPixels; Index += 8)
+            {
+                const __m128i MatchesLow = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(Pixels + Index)), Needle);
+                const __m128i MatchesHigh = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(Pixels + Index + 4)), Needle);
+                const int32 Mask = _mm_movemask_ps(_mm_castsi128_ps(MatchesLow)) | (_mm_movemask_ps(_mm_castsi128_ps(MatchesHigh)) << 4);
+                if (Mask != 0)
+                {
+                    return Index + FMath::CountTrailingZeros(uint32(Mask));
+                }
+            }
+
+            const int64 TailIndex = Scalar::FindPixel32(Pixels + Index, NumPixels - Index, Value);
+            return TailIndex == INDEX_NONE ? INDEX_NONE : Index + TailIndex;
+        }
+    }
+
+    //
+    // AVX2 with F16C, detected at runtime
+    //
+    namespace AVX2
+    {
+        PIXELKERNELS_TARGET_AVX2 static void RGBAToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+        {
+            const __m256i Shuffle = _mm256_setr_epi8(
+                2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+            int64 Index = 0;
+            for (; Index + 8 <= NumPixels; Index += 8)
+            {
+                const __m256i Pixels = _mm256_loadu_si256((const __m256i*)(Source + Index * 4));
+                _mm256_storeu_si256((__m256i*)(Dest + Index * 4), _mm256_shuffle_epi8(Pixels, Shuffle));
+            }
+            Scalar::RGBAToBGRA(Source + Index * 4, Dest + Index * 4, NumPixels - Index);
+        }
+
+        // 8 pixels from two 12 byte groups, one per 128-bit lane
+        PIXELKERNELS_TARGET_AVX2 FORCEINLINE void ExpandThreeChannels(const uint8* Source, uint8* Dest, int64 NumPixels, const __m256i Shuffle, void (*ScalarTail)(const uint8*, uint8*, int64))
+        {
+            const __m256i Opaque = _mm256_set1_epi32(0xFF000000);
+
+            int64 Index = 0;
+            // the second load reads 4 bytes past the 24 bytes of the 8 pixels
+            for (; Index + 10 <= NumPixels; Index += 8)
+            {
+                const __m128i Low = _mm_loadu_si128((const __m128i*)(Source + Index * 3));
+                const __m128i High = _mm_loadu_si128((const __m128i*)(Source + Index * 3 + 12));
+                const __m256i Pixels = _mm256_inserti128_si256(_mm256_castsi128_si256(Low), High, 1);
+                _mm256_storeu_si256((__m256i*)(Dest + Index * 4), _mm256_or_si256(_mm256_shuffle_epi8(Pixels, Shuffle), Opaque));
+            }
+            ScalarTail(Source + Index * 3, Dest + Index * 4, NumPixels - Index);
+        }
+
+        PIXELKERNELS_TARGET_AVX2 static void RGBToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+        {
+            const __m256i Shuffle = _mm256_setr_epi8(
+                2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+                2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+            ExpandThreeChannels(Source, Dest, NumPixels, Shuffle, &Scalar::RGBToBGRA);
+        }
+
+        PIXELKERNELS_TARGET_AVX2 static void BGRToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+        {
+            const __m256i Shuffle = _mm256_setr_epi8(
+                0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+            ExpandThreeChannels(Source, Dest, NumPixels, Shuffle, &Scalar::BGRToBGRA);
+        }
+
+        PIXELKERNELS_TARGET_AVX2 static void HalfToFloat(const uint16* Source, float* Dest, int64 NumValues)
+        {
+            int64 Index = 0;
+            for (; Index + 8 <= NumValues; Index += 8)
+            {
+                _mm256_storeu_ps(Dest + Index, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(Source + Index))));
+            }
+            Scalar::HalfToFloat(Source + Index, Dest + Index, NumValues - Index);
+        }
+
+        PIXELKERNELS_TARGET_AVX2 static void FloatToHalf(const float* Source, uint16* Dest, int64 NumValues)
+        {
+            int64 Index = 0;
+            for (; Index + 8 <= NumValues; Index += 8)
+            {
+                _mm_storeu_si128((__m128i*)(Dest + Index), _mm256_cvtps_ph(_mm256_loadu_ps(Source + Index), _MM_FROUND_TO_NEAREST_INT));
+            }
+            Scalar::FloatToHalf(Source + Index, Dest + Index, NumValues - Index);
+        }
+
+        PIXELKERNELS_TARGET_AVX2 static int64 FindPixel32(const uint32* Pixels, int64 NumPixels, uint32 Value)
+        {
+            const __m256i Needle = _mm256_set1_epi32(int32(Value));
+
+            int64 Index = 0;
+            for (; Index + 16 <= NumPixels; Index += 16)
+            {
+                const __m256i MatchesLow = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(Pixels + Index)), Needle);
+                const __m256i MatchesHigh = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(Pixels + Index + 8)), Needle);
+                const int32 Mask = _mm256_movemask_ps(_mm256_castsi256_ps(MatchesLow)) | (_mm256_movemask_ps(_mm256_castsi256_ps(MatchesHigh)) << 8);
+                if (Mask != 0)
+                {
+                    return Index + FMath::CountTrailingZeros(uint32(Mask));
+                }
+            }
+
+            const int64 TailIndex = Scalar::FindPixel32(Pixels + Index, NumPixels - Index, Value);
+            return TailIndex == INDEX_NONE ? INDEX_NONE : Index + TailIndex;
+        }
+
+        // two BGRE pixels widened to 32-bit lanes, one pixel per 128-bit lane
+        PIXELKERNELS_TARGET_AVX2 FORCEINLINE __m128i RGBEPairToHalf(__m128i Pixels)
+        {
+            const __m256i Values = _mm256_cvtepu8_epi32(Pixels);
+            const __m256i Exponent = _mm256_shuffle_epi32(Values, _MM_SHUFFLE(3, 3, 3, 3));
+
+            const __m256i ScaleBits = _mm256_andnot_si256(_mm256_cmpeq_epi32(Exponent, _mm256_setzero_si256()), _mm256_slli_epi32(_mm256_sub_epi32(Exponent, _mm256_set1_epi32(1)), 23));
+            const __m256 Scale = _mm256_mul_ps(_mm256_castsi256_ps(ScaleBits), _mm256_set1_ps(1.0f / 255.0f));
+
+            const __m256 Color = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_shuffle_epi32(Values, _MM_SHUFFLE(3, 0, 1, 2))), Scale);
+            return _mm256_cvtps_ph(_mm256_blend_ps(Color, _mm256_set1_ps(1.0f), 0x88), _MM_FROUND_TO_NEAREST_INT);
+        }
+
+        PIXELKERNELS_TARGET_AVX2 static void RGBEToHalf(const uint8* Source, uint16* Dest, int64 NumPixels)
+        {
+            int64 Index = 0;
+            for (; Index + 4 <= NumPixels; Index += 4)
+            {
+                const __m128i Pixels = _mm_loadu_si128((const __m128i*)(Source + Index * 4));
+                _mm_storeu_si128((__m128i*)(Dest + Index * 4), RGBEPairToHalf(Pixels));
+                _mm_storeu_si128((__m128i*)(Dest + Index * 4 + 8), RGBEPairToHalf(_mm_srli_si128(Pixels, 8)));
+            }
+            Scalar::RGBEToHalf(Source + Index * 4, Dest + Index * 4, NumPixels - Index);
+        }
+    }
+
+    static void CPUID(uint32 Leaf, uint32 SubLeaf, uint32 OutRegisters[4])
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        __cpuidex((int*)OutRegisters, (int)Leaf, (int)SubLeaf);
+#else
+        __asm__ __volatile__("cpuid" : "=a"(OutRegisters[0]), "=b"(OutRegisters[1]), "=c"(OutRegisters[2]), "=d"(OutRegisters[3]) : "a"(Leaf), "c"(SubLeaf));
+#endif
+    }
+
+    static uint64 ReadExtendedControlRegister()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        return _xgetbv(0);
+#else
+        uint32 Low, High;
+        __asm__ __volatile__("xgetbv" : "=a"(Low), "=d"(High) : "c"(0));
+        return (uint64(High) << 32) | Low;
+#endif
+    }
+
+    static bool HasAVX2()
+    {
+        uint32 Registers[4];
+        CPUID(0, 0, Registers);
+        if (Registers[0] < 7)
+        {
+            return false;
+        }
+
+        CPUID(1, 0, Registers);
+        const bool bHasOSXSave = (Registers[2] & (1 << 27)) != 0;
+        const bool bHasAVX = (Registers[2] & (1 << 28)) != 0;
+        const bool bHasF16C = (Registers[2] & (1 << 29)) != 0;
+
+        // the OS has to save the YMM registers on context switches
+        if (!bHasOSXSave || !bHasAVX || !bHasF16C || (ReadExtendedControlRegister() & 0x6) != 0x6)
+        {
+            return false;
+        }
+
+        CPUID(7, 0, Registers);
+        return (Registers[1] & (1 << 5)) != 0;
+    }
+#endif // PIXELKERNELS_WITH_X86
+
+#if PIXELKERNELS_WITH_NEON
+    //
+    // NEON, part of every arm64 CPU
+    //
+    namespace NEON
+    {
+        FORCEINLINE uint8x8_t Unorm16ToUnorm8(uint16x8_t Values)
+        {
+            const uint16x8_t Rounded = vqaddq_u16(Values, vdupq_n_u16(128));
+            return vshrn_n_u16(vsubq_u16(Rounded, vshrq_n_u16(Rounded, 8)), 8);
+        }
+
+        static void RGBAToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+        {
+            int64 Index = 0;
+            for (; Index + 16 <= NumPixels; Index += 16)
+            {
+                uint8x16x4_t Pixels = vld4q_u8(Source + Index * 4);
+                const uint8x16_t Red = Pixels.val[0];
+                Pixels.val[0] = Pixels.val[2];
+                Pixels.val[2] = Red;
+                vst4q_u8(Dest + Index * 4, Pixels);
+            }
+            Scalar::RGBAToBGRA(Source + Index * 4, Dest + Index * 4, NumPixels - Index);
+        }
+
+        static void RGBToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+        {
+            int64 Index = 0;
+            for (; Index + 16 <= NumPixels; Index += 16)
+            {
+                const uint8x16x3_t Pixels = vld3q_u8(Source + Index * 3);
+                const uint8x16x4_t Expanded = { { Pixels.val[2], Pixels.val[1], Pixels.val[0], vdupq_n_u8(0xFF) } };
+                vst4q_u8(Dest + Index * 4, Expanded);
+            }
+            Scalar::RGBToBGRA(Source + Index * 3, Dest + Index * 4, NumPixels - Index);
+        }
+
+        static void BGRToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+        {
+            int64 Index = 0;
+            for (; Index + 16 <= NumPixels; Index += 16)
+            {
+                const uint8x16x3_t Pixels = vld3q_u8(Source + Index * 3);
+                const uint8x16x4_t Expanded = { { Pixels.val[0], Pixels.val[1], Pixels.val[2], vdupq_n_u8(0xFF) } };
+                vst4q_u8(Dest + Index * 4, Expanded);
+            }
+            Scalar::BGRToBGRA(Source + Index * 3, Dest + Index * 4, NumPixels - Index);
+        }
+
+        static void G8ToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+        {
+            int64 Index = 0;
+            for (; Index + 16 <= NumPixels; Index += 16)
+            {
+                const uint8x16_t Gray = vld1q_u8(Source + Index);
+                const uint8x16x4_t Expanded = { { Gray, Gray, Gray, vdupq_n_u8(0xFF) } };
+                vst4q_u8(Dest + Index * 4, Expanded);
+            }
+            Scalar::G8ToBGRA(Source + Index, Dest + Index * 4, NumPixels - Index);
+        }
+
+        static void RGBA16ToBGRA8(const uint16* Source, uint8* Dest, int64 NumPixels)
+        {
+            int64 Index = 0;
+            for (; Index + 8 <= NumPixels; Index += 8)
+            {
+                const uint16x8x4_t Pixels = vld4q_u16(Source + Index * 4);
+                const uint8x8x4_t Converted = { { Unorm16ToUnorm8(Pixels.val[2]), Unorm16ToUnorm8(Pixels.val[1]), Unorm16ToUnorm8(Pixels.val[0]), Unorm16ToUnorm8(Pixels.val[3]) } };
+                vst4_u8(Dest + Index * 4, Converted);
+            }
+            Scalar::RGBA16ToBGRA8(Source + Index * 4, Dest + Index * 4, NumPixels - Index);
+        }
+
+        static void HalfToFloat(const uint16* Source, float* Dest, int64 NumValues)
+        {
+            int64 Index = 0;
+            for (; Index + 4 <= NumValues; Index += 4)
+            {
+                vst1q_f32(Dest + Index, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(Source + Index))));
+            }
+            Scalar::HalfToFloat(Source + Index, Dest + Index, NumValues - Index);
+        }
+
+        static void FloatToHalf(const float* Source, uint16* Dest, int64 NumValues)
+        {
+            int64 Index = 0;
+            for (; Index + 4 <= NumValues; Index += 4)
+            {
+                vst1_u16(Dest + Index, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(Source + Index))));
+            }
+            Scalar::FloatToHalf(Source + Index, Dest + Index, NumValues - Index);
+        }
+
+        static int64 FindPixel32(const uint32* Pixels, int64 NumPixels, uint32 Value)
+        {
+            const uint32x4_t Needle = vdupq_n_u32(Value);
+
+            int64 Index = 0;
+            for (; Index + 8 <= NumPixels; Index += 8)
+            {
+                const uint32x4_t MatchesLow = vceqq_u32(vld1q_u32(Pixels + Index), Needle);
+                const uint32x4_t MatchesHigh = vceqq_u32(vld1q_u32(Pixels + Index + 4), Needle);
+                if (vmaxvq_u32(vorrq_u32(MatchesLow, MatchesHigh)) != 0)
+                {
+                    // the exact position comes from the scalar search of this block
+                    return Index + Scalar::FindPixel32(Pixels + Index, 8, Value);
+                }
+            }
+
+            const int64 TailIndex = Scalar::FindPixel32(Pixels + Index, NumPixels - Index, Value);
+            return TailIndex == INDEX_NONE ? INDEX_NONE : Index + TailIndex;
+        }
+
+        FORCEINLINE float16x4_t ScaleToHalf(uint16x4_t Values, float32x4_t Scale)
+        {
+            return vcvt_f16_f32(vmulq_f32(vcvtq_f32_u32(vmovl_u16(Values)), Scale));
+        }
+
+        static void RGBEToHalf(const uint8* Source, uint16* Dest, int64 NumPixels)
+        {
+            const float32x4_t InvByte = vdupq_n_f32(1.0f / 255.0f);
+            const uint16x4_t One = vdup_n_u16(HalfOne);
+
+            int64 Index = 0;
+            for (; Index + 8 <= NumPixels; Index += 8)
+            {
+                // planes of blue, green, red and exponent
+                const uint8x8x4_t Pixels = vld4_u8(Source + Index * 4);
+                const uint16x8_t Blue = vmovl_u8(Pixels.val[0]);
+                const uint16x8_t Green = vmovl_u8(Pixels.val[1]);
+                const uint16x8_t Red = vmovl_u8(Pixels.val[2]);
+                const uint16x8_t Exponent = vmovl_u8(Pixels.val[3]);
+
+                for (int32 Part = 0; Part < 2; ++Part)
+                {
+                    const uint32x4_t HalfExponent = vmovl_u16(Part == 0 ? vget_low_u16(Exponent) : vget_high_u16(Exponent));
+                    const uint32x4_t ScaleBits = vbicq_u32(vshlq_n_u32(vsubq_u32(HalfExponent, vdupq_n_u32(1)), 23), vceqq_u32(HalfExponent, vdupq_n_u32(0)));
+                    const float32x4_t Scale = vmulq_f32(vreinterpretq_f32_u32(ScaleBits), InvByte);
+
+                    uint16x4x4_t Output;
+                    Output.val[0] = vreinterpret_u16_f16(ScaleToHalf(Part == 0 ? vget_low_u16(Red) : vget_high_u16(Red), Scale));
+                    Output.val[1] = vreinterpret_u16_f16(ScaleToHalf(Part == 0 ? vget_low_u16(Green) : vget_high_u16(Green), Scale));
+                    Output.val[2] = vreinterpret_u16_f16(ScaleToHalf(Part == 0 ? vget_low_u16(Blue) : vget_high_u16(Blue), Scale));
+                    Output.val[3] = One;
+                    vst4_u16(Dest + (Index + Part * 4) * 4, Output);
+                }
+            }
+            Scalar::RGBEToHalf(Source + Index * 4, Dest + Index * 4, NumPixels - Index);
+        }
+    }
+#endif // PIXELKERNELS_WITH_NEON
+
+    static FKernelTable MakeKernelTable(EInstructionSet InstructionSet)
+    {
+        FKernelTable Table = { &Scalar::RGBAToBGRA, &Scalar::RGBToBGRA, &Scalar::BGRToBGRA, &Scalar::G8ToBGRA, &Scalar::RGBA16ToBGRA8, &Scalar::HalfToFloat, &Scalar::FloatToHalf, &Scalar::FindPixel32, &Scalar::RGBEToHalf };
+
+#if PIXELKERNELS_WITH_X86
+        // SSE2 has no byte shuffle, three channel expansion and half conversion stay scalar below AVX2
+        if (InstructionSet == EInstructionSet::SSE2 || InstructionSet == EInstructionSet::AVX2)
+        {
+            Table.RGBAToBGRA = &SSE2::RGBAToBGRA;
+            Table.G8ToBGRA = &SSE2::G8ToBGRA;
+            Table.RGBA16ToBGRA8 = &SSE2::RGBA16ToBGRA8;
+            Table.FindPixel32 = &SSE2::FindPixel32;
+        }
+        if (InstructionSet == EInstructionSet::AVX2)
+        {
+            Table.RGBAToBGRA = &AVX2::RGBAToBGRA;
+            Table.RGBToBGRA = &AVX2::RGBToBGRA;
+            Table.BGRToBGRA = &AVX2::BGRToBGRA;
+            Table.HalfToFloat = &AVX2::HalfToFloat;
+            Table.FloatToHalf = &AVX2::FloatToHalf;
+            Table.FindPixel32 = &AVX2::FindPixel32;
+            Table.RGBEToHalf = &AVX2::RGBEToHalf;
+        }
+#elif PIXELKERNELS_WITH_NEON
+        if (InstructionSet == EInstructionSet::NEON)
+        {
+            Table = { &NEON::RGBAToBGRA, &NEON::RGBToBGRA, &NEON::BGRToBGRA, &NEON::G8ToBGRA, &NEON::RGBA16ToBGRA8, &NEON::HalfToFloat, &NEON::FloatToHalf, &NEON::FindPixel32, &NEON::RGBEToHalf };
+        }
+#endif
+
+        return Table;
+    }
+
+    static EInstructionSet DetectInstructionSet()
+    {
+#if PIXELKERNELS_WITH_X86
+        return HasAVX2() ? EInstructionSet::AVX2 : EInstructionSet::SSE2;
+#elif PIXELKERNELS_WITH_NEON
+        return EInstructionSet::NEON;
+#else
+        return EInstructionSet::Scalar;
+#endif
+    }
+
+    static const FKernelTable& GetKernelTable()
+    {
+        static const FKernelTable Table = MakeKernelTable(GetInstructionSet());
+        return Table;
+    }
+
+    EInstructionSet GetInstructionSet()
+    {
+        static const EInstructionSet InstructionSet = DetectInstructionSet();
+        return InstructionSet;
+    }
+
+    const TCHAR* GetInstructionSetName(EInstructionSet InstructionSet)
+    {
+        switch (InstructionSet)
+        {
+            case EInstructionSet::SSE2: return TEXT("SSE2");
+            case EInstructionSet::AVX2: return TEXT("AVX2");
+            case EInstructionSet::NEON: return TEXT("NEON");
+            default:                    return TEXT("Scalar");
+        }
+    }
+
+    void RGBAToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        GetKernelTable().RGBAToBGRA(Source, Dest, NumPixels);
+    }
+
+    void RGBToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        GetKernelTable().RGBToBGRA(Source, Dest, NumPixels);
+    }
+
+    void BGRToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        GetKernelTable().BGRToBGRA(Source, Dest, NumPixels);
+    }
+
+    void G8ToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        GetKernelTable().G8ToBGRA(Source, Dest, NumPixels);
+    }
+
+    void RGBA16ToBGRA8(const uint16* Source, uint8* Dest, int64 NumPixels)
+    {
+        GetKernelTable().RGBA16ToBGRA8(Source, Dest, NumPixels);
+    }
+
+    void HalfToFloat(const uint16* Source, float* Dest, int64 NumValues)
+    {
+        GetKernelTable().HalfToFloat(Source, Dest, NumValues);
+    }
+
+    void FloatToHalf(const float* Source, uint16* Dest, int64 NumValues)
+    {
+        GetKernelTable().FloatToHalf(Source, Dest, NumValues);
+    }
+
+    int64 FindPixel32(const uint32* Pixels, int64 NumPixels, uint32 Value)
+    {
+        return GetKernelTable().FindPixel32(Pixels, NumPixels, Value);
+    }
+
+    void RGBEToHalf(const uint8* Source, uint16* Dest, int64 NumPixels)
+    {
+        GetKernelTable().RGBEToHalf(Source, Dest, NumPixels);
+    }
+}
+
+//
+// Benchmark
+//
+// Half floats as integers that are ordered like the values, neighbouring halfs differ by one
+static int32 HalfToOrderedInt(uint16 Half)
+{
+    return (Half & 0x8000) ? -int32(Half & 0x7FFF) : int32(Half);
+}
+
+static bool HalfsMatchWithinOneUlp(const uint16* Reference, const uint16* Result, int64 NumHalfs)
+{
+    for (int64 Index = 0; Index < NumHalfs; ++Index)
+    {
+        if (FMath::Abs(HalfToOrderedInt(Reference[Index]) - HalfToOrderedInt(Result[Index])) > 1)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// RuntimeImageLoader.BenchmarkPixelKernels [Megapixels]
+// Runs every kernel with every instruction set available on this CPU and checks the results against the scalar kernels
+//
+static void BenchmarkPixelKernels(const TArray<FString>& Args)
+{
+    using namespace FPixelKernels;
+
+    const int64 NumPixels = int64(FMath::Max(Args.Num() > 0 ? FCString::Atof(*Args[0]) : 16.0f, 0.01f) * 1000000.0f);
+    constexpr int32 NumRuns = 5;
+
+    TArray<EInstructionSet> InstructionSets = { EInstructionSet::Scalar };
+    if (GetInstructionSet() == EInstructionSet::AVX2)
+    {
+        InstructionSets.Add(EInstructionSet::SSE2);
+    }
+    if (GetInstructionSet() != EInstructionSet::Scalar)
+    {
+        InstructionSets.Add(GetInstructionSet());
+    }
+
+    // random input, half floats are kept finite
+    TArray64<uint8> Source;
+    Source.SetNumUninitialized(NumPixels * 16);
+    FRandomStream Random(0x5EED);
+    for (int64 Index = 0; Index < Source.Num(); ++Index)
+    {
+        Source[Index] = uint8(Random.RandHelper(256));
+    }
+    TArray64<float> SourceFloats;
+    SourceFloats.SetNumUninitialized(NumPixels * 4);
+    for (int64 Index = 0; Index < SourceFloats.Num(); ++Index)
+    {
+        SourceFloats[Index] = Random.FRandRange(-1000.0f, 1000.0f);
+    }
+    uint16* SourceHalfs = reinterpret_cast<uint16*>(Source.GetData());
+    for (int64 Index = 0; Index < NumPixels * 4; ++Index)
+    {
+        SourceHalfs[Index] &= 0xBBFF;
+    }
+
+    TArray64<uint8> Reference, Result;
+    Reference.SetNumUninitialized(NumPixels * 16);
+    Result.SetNumUninitialized(NumPixels * 16);
+
+    struct FKernelRun
+    {
+        const TCHAR* Name;
+        int64 OutputBytes;
+        TFunction<void(const FKernelTable&, uint8*)> Run;
+    };
+
+    const uint8* Input = Source.GetData();
+    const float* InputFloats = SourceFloats.GetData();
+    const TArray<FKernelRun> Kernels = {
+        { TEXT("RGBAToBGRA"),    NumPixels * 4,  [=](const FKernelTable& Table, uint8* Output) { Table.RGBAToBGRA(Input, Output, NumPixels); } },
+        { TEXT("RGBToBGRA"),     NumPixels * 4,  [=](const FKernelTable& Table, uint8* Output) { Table.RGBToBGRA(Input, Output, NumPixels); } },
+        { TEXT("BGRToBGRA"),     NumPixels * 4,  [=](const FKernelTable& Table, uint8* Output) { Table.BGRToBGRA(Input, Output, NumPixels); } },
+        { TEXT("G8ToBGRA"),      NumPixels * 4,  [=](const FKernelTable& Table, uint8* Output) { Table.G8ToBGRA(Input, Output, NumPixels); } },
+        { TEXT("RGBA16ToBGRA8"), NumPixels * 4,  [=](const FKernelTable& Table, uint8* Output) { Table.RGBA16ToBGRA8((const uint16*)Input, Output, NumPixels); } },
+        { TEXT("HalfToFloat"),   NumPixels * 16, [=](const FKernelTable& Table, uint8* Output) { Table.HalfToFloat((const uint16*)Input, (float*)Output, NumPixels * 4); } },
+        { TEXT("FloatToHalf"),   NumPixels * 8,  [=](const FKernelTable& Table, uint8* Output) { Table.FloatToHalf(InputFloats, (uint16*)Output, NumPixels * 4); } },
+        { TEXT("FindPixel32"),   sizeof(int64),  [=](const FKernelTable& Table, uint8* Output) { *(int64*)Output = Table.FindPixel32((const uint32*)Input, NumPixels, 0x00FFFFFF); } },
+        { TEXT("RGBEToHalf"),    NumPixels * 8,  [=](const FKernelTable& Table, uint8* Output) { Table.RGBEToHalf(Input, (uint16*)Output, NumPixels); } },
+    };
+
+    UE_LOG(LogPixelKernels, Display, TEXT("Pixel kernels, %.1f megapixels, best of %d runs, running with %s"), NumPixels / 1000000.0, NumRuns, GetInstructionSetName(GetInstructionSet()));
+
+    for (const FKernelRun& Kernel : Kernels)
+    {
+        Kernel.Run(MakeKernelTable(EInstructionSet::Scalar), Reference.GetData());
+
+        for (EInstructionSet InstructionSet : InstructionSets)
+        {
+            const FKernelTable Table = MakeKernelTable(InstructionSet);
+
+            double BestSeconds = TNumericLimits<double>::Max();
+            for (int32 RunIndex = 0; RunIndex < NumRuns; ++RunIndex)
+            {
+                const uint64 StartCycles = FPlatformTime::Cycles64();
+                Kernel.Run(Table, Result.GetData());
+                BestSeconds = FMath::Min(BestSeconds, FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles));
+            }
+
+            // half rounding of the scalar path may differ in the last bit, anything further off is a mismatch
+            const bool bRoundsToHalf = FCString::Strcmp(Kernel.Name, TEXT("FloatToHalf")) == 0 || FCString::Strcmp(Kernel.Name, TEXT("RGBEToHalf")) == 0;
+            const bool bMatchesScalar = bRoundsToHalf
+                ? HalfsMatchWithinOneUlp((const uint16*)Reference.GetData(), (const uint16*)Result.GetData(), Kernel.OutputBytes / sizeof(uint16))
+                : FMemory::Memcmp(Reference.GetData(), Result.GetData(), Kernel.OutputBytes) == 0;
+
+            UE_LOG(LogPixelKernels, Display, TEXT("  %-14s %-6s %8.2f ms %8.0f MP/s %7.2f GB/s written%s"),
+                Kernel.Name, GetInstructionSetName(InstructionSet), BestSeconds * 1000.0, NumPixels / BestSeconds / 1000000.0,
+                Kernel.OutputBytes / BestSeconds / (1024.0 * 1024.0 * 1024.0), bMatchesScalar ? TEXT("") : TEXT("  MISMATCH"));
+        }
+    }
+}
+
+static FAutoConsoleCommand BenchmarkPixelKernelsCommand(
+    TEXT("RuntimeImageLoader.BenchmarkPixelKernels"),
+    TEXT("Measures the pixel conversion kernels with every instruction set this CPU supports. Usage: RuntimeImageLoader.BenchmarkPixelKernels [Megapixels]"),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkPixelKernels));
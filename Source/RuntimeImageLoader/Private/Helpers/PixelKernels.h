@@ -0,0 +1,53 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Pixel format conversions shared by the decoders, vectorized with SSE2 and AVX2 on x86 and NEON on arm64.
+ * The widest instruction set the CPU supports is detected once on first use.
+ * Source and destination must not overlap, except for RGBAToBGRA which also works in place.
+ */
+namespace FPixelKernels
+{
+    enum class EInstructionSet : uint8
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+        NEON
+    };
+
+    /** Swaps red and blue of 8-bit 4 channel pixels, converts BGRA to RGBA just as well */
+    void RGBAToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels);
+
+    /** Expands 8-bit RGB to BGRA with opaque alpha */
+    void RGBToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels);
+
+    /** Expands 8-bit BGR to BGRA with opaque alpha */
+    void BGRToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels);
+
+    /** Expands 8-bit grayscale to opaque BGRA */
+    void G8ToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels);
+
+    /** Converts 16-bit RGBA to 8-bit BGRA with rounding, the gamma space is kept */
+    void RGBA16ToBGRA8(const uint16* Source, uint8* Dest, int64 NumPixels);
+
+    /** Converts IEEE half floats to floats */
+    void HalfToFloat(const uint16* Source, float* Dest, int64 NumValues);
+
+    /** Converts floats to IEEE half floats, rounding to nearest */
+    void FloatToHalf(const float* Source, uint16* Dest, int64 NumValues);
+
+    /** Expands Radiance shared exponent BGRE8 pixels to RGBA16F with opaque alpha, matching FColor::FromRGBE */
+    void RGBEToHalf(const uint8* Source, uint16* Dest, int64 NumPixels);
+
+    /** Index of the first 32-bit pixel equal to Value, INDEX_NONE if there is none */
+    int64 FindPixel32(const uint32* Pixels, int64 NumPixels, uint32 Value);
+
+    /** The instruction set the kernels run with on this CPU */
+    EInstructionSet GetInstructionSet();
+
+    const TCHAR* GetInstructionSetName(EInstructionSet InstructionSet);
+}
@@ -1,6 +1,7 @@
 // Copyright 2023 Petr Leontev. All Rights Reserved.
 
 #include "QOIHelpers.h"
+#include "PixelKernels.h"
 
 #define QOI_IMPLEMENTATION 1
 
@@ -62,19 +63,14 @@ bool FQOILoader::Load(const uint8* Buffer, uint32 Length)
 
     bool bSourceHasAlpha = static_cast<uint8>(ImageDescr.channels) == 4;
 
-    const int32 PixelsLen = Width * Height * ImageDescr.channels;
-    const uint32 Step = ImageDescr.channels;
-    int32 RawDataIndex = 0;
-
-    // convert RGBA to BGRA
-    for (int32 Index = 0; Index < PixelsLen; Index += Step)
+    // convert RGBA / RGB to BGRA
+    if (bSourceHasAlpha)
+    {
+        FPixelKernels::RGBAToBGRA((const uint8*)DecodedPixels, RawData.GetData(), int64(Width) * Height);
+    }
+    else
     {
-        RawData[RawDataIndex]     = DecodedPixels[Index + 2];
-        RawData[RawDataIndex + 1] = DecodedPixels[Index + 1];
-        RawData[RawDataIndex + 2] = DecodedPixels[Index];
-        RawData[RawDataIndex + 3] = (bSourceHasAlpha) ? DecodedPixels[Index + 3] : 255;
-        
-        RawDataIndex += 4;
+        FPixelKernels::RGBToBGRA((const uint8*)DecodedPixels, RawData.GetData(), int64(Width) * Height);
     }
 
     QOI_FREE(DecodedPixels);
@@ -14,7 +14,7 @@ public:
 
 public:
     // Resulting image data and properties
-    TArray<uint8> RawData;
+    TArray64<uint8> RawData;
     int32 Width;
     int32 Height;
     ETextureSourceFormat TextureSourceFormat = TSF_Invalid;
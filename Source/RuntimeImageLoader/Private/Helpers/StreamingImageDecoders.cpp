@@ -0,0 +1,758 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "StreamingImageDecoders.h"
+#include "Stats/Stats.h"
+
+#include "Helpers/EXRHelpers.h"
+#include "Helpers/PNGHelpers.h"
+#include "Helpers/PixelKernels.h"
+#include "Helpers/TIFFHelpers.h"
+#include "RuntimeImageUtils.h"
+
+#include <setjmp.h>
+
+THIRD_PARTY_INCLUDES_START
+#include "png.h"
+#if RUNTIMEIMAGELOADER_WITH_LIBTIFF
+#include "tiffio.h"
+#endif
+THIRD_PARTY_INCLUDES_END
+
+DEFINE_LOG_CATEGORY_STATIC(LogStreamingImageDecoders, Log, All);
+
+
+namespace FStreamingImageDecoders
+{
+    /** Byte-wise reads over an archive through a fixed size buffer, used by the run length decoders */
+    class FArchiveByteReader
+    {
+    public:
+        explicit FArchiveByteReader(FArchive& InArchive)
+            : Archive(InArchive)
+            , Remaining(InArchive.TotalSize() - InArchive.Tell())
+        {
+            Buffer.SetNumUninitialized(BufferSize);
+        }
+
+        bool ReadByte(uint8& OutByte)
+        {
+            if (Position == Buffered && !Refill())
+            {
+                return false;
+            }
+
+            OutByte = Buffer[Position++];
+            return true;
+        }
+
+        bool Read(uint8* OutData, int64 Num)
+        {
+            while (Num > 0)
+            {
+                if (Position == Buffered && !Refill())
+                {
+                    return false;
+                }
+
+                const int64 NumToCopy = FMath::Min(Num, Buffered - Position);
+                FMemory::Memcpy(OutData, Buffer.GetData() + Position, NumToCopy);
+
+                OutData += NumToCopy;
+                Position += NumToCopy;
+                Num -= NumToCopy;
+            }
+
+            return true;
+        }
+
+    private:
+        bool Refill()
+        {
+            const int64 NumToRead = FMath::Min(BufferSize, Remaining);
+            if (NumToRead <= 0)
+            {
+                return false;
+            }
+
+            Archive.Serialize(Buffer.GetData(), NumToRead);
+            if (Archive.IsError())
+            {
+                return false;
+            }
+
+            Remaining -= NumToRead;
+            Buffered = NumToRead;
+            Position = 0;
+            return true;
+        }
+
+        static constexpr int64 BufferSize = 256 * 1024;
+
+        FArchive& Archive;
+        TArray<uint8> Buffer;
+        int64 Remaining = 0;
+        int64 Buffered = 0;
+        int64 Position = 0;
+    };
+
+    //
+    // HDR
+    //
+    // Radiance RGBE is decoded scanline by scanline straight into BGRE8, only one scanline of channel planes is kept aside
+    static bool ReadHDRLine(FArchiveByteReader& Reader, TArray<ANSICHAR>& OutLine)
+    {
+        constexpr int32 MaxLineLength = 4096;
+
+        OutLine.Reset();
+
+        uint8 Char = 0;
+        while (Reader.ReadByte(Char))
+        {
+            if (Char == '\n')
+            {
+                OutLine.Add(0);
+                return true;
+            }
+
+            if (OutLine.Num() >= MaxLineLength)
+            {
+                return false;
+            }
+
+            OutLine.Add(ANSICHAR(Char));
+        }
+
+        return false;
+    }
+
+    static void WriteRGBEPixel(const uint8* RGBE, uint8* OutBGRE)
+    {
+        OutBGRE[0] = RGBE[2];
+        OutBGRE[1] = RGBE[1];
+        OutBGRE[2] = RGBE[0];
+        OutBGRE[3] = RGBE[3];
+    }
+
+    static bool DecodeHDRPlanarScanline(FArchiveByteReader& Reader, int32 Width, uint8* Planes)
+    {
+        for (int32 Channel = 0; Channel < 4; ++Channel)
+        {
+            uint8* Plane = Planes + int64(Channel) * Width;
+
+            int32 X = 0;
+            while (X < Width)
+            {
+                uint8 Count = 0;
+                if (!Reader.ReadByte(Count))
+                {
+                    return false;
+                }
+
+                if (Count > 128)
+                {
+                    const int32 RunLength = Count - 128;
+                    uint8 Value = 0;
+                    if (X + RunLength > Width || !Reader.ReadByte(Value))
+                    {
+                        return false;
+                    }
+
+                    FMemory::Memset(Plane + X, Value, RunLength);
+                    X += RunLength;
+                }
+                else
+                {
+                    if (Count == 0 || X + Count > Width || !Reader.Read(Plane + X, Count))
+                    {
+                        return false;
+                    }
+
+                    X += Count;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    static bool DecodeHDRFlatScanline(FArchiveByteReader& Reader, int32 Width, const uint8* FirstPixel, uint8* OutRow)
+    {
+        // flat pixels, optionally with the original (1, 1, 1, count) run length encoding
+        uint8 Pixel[4] = { FirstPixel[0], FirstPixel[1], FirstPixel[2], FirstPixel[3] };
+        int32 RepeatShift = 0;
+        int32 X = 0;
+
+        while (true)
+        {
+            if (Pixel[0] == 1 && Pixel[1] == 1 && Pixel[2] == 1)
+            {
+                if (X == 0 || RepeatShift > 24)
+                {
+                    return false;
+                }
+
+                const int64 RepeatCount = int64(Pixel[3]) << RepeatShift;
+                if (X + RepeatCount > Width)
+                {
+                    return false;
+                }
+
+                const uint8* PreviousPixel = OutRow + int64(X - 1) * 4;
+                for (int64 Repeat = 0; Repeat < RepeatCount; ++Repeat, ++X)
+                {
+                    FMemory::Memcpy(OutRow + int64(X) * 4, PreviousPixel, 4);
+                }
+
+                RepeatShift += 8;
+            }
+            else
+            {
+                WriteRGBEPixel(Pixel, OutRow + int64(X) * 4);
+                ++X;
+                RepeatShift = 0;
+            }
+
+            if (X >= Width)
+            {
+                return true;
+            }
+
+            if (!Reader.Read(Pixel, 4))
+            {
+                return false;
+            }
+        }
+    }
+
+    static bool DecodeHDR(FArchive& Archive, const FIntRect& RequestedRegion, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(STAT_FStreamingImageDecoders_DecodeHDR);
+
+        FArchiveByteReader Reader(Archive);
+        TArray<ANSICHAR> Line;
+
+        if (!ReadHDRLine(Reader, Line) || FCStringAnsi::Strncmp(Line.GetData(), "#?", 2) != 0)
+        {
+            OutError = TEXT("Failed to decode HDR: invalid signature");
+            return false;
+        }
+
+        // header variables end with an empty line
+        while (true)
+        {
+            if (!ReadHDRLine(Reader, Line))
+            {
+                OutError = TEXT("Failed to decode HDR: truncated header");
+                return false;
+            }
+
+            if (Line[0] == 0)
+            {
+                break;
+            }
+
+            if (FCStringAnsi::Strncmp(Line.GetData(), "FORMAT=", 7) == 0 && FCStringAnsi::Strcmp(Line.GetData() + 7, "32-bit_rle_rgbe") != 0)
+            {
+                OutError = FString::Printf(TEXT("Failed to decode HDR: unsupported pixel format %s"), ANSI_TO_TCHAR(Line.GetData() + 7));
+                return false;
+            }
+        }
+
+        // only the standard top to bottom, left to right orientation is supported
+        if (!ReadHDRLine(Reader, Line) || FCStringAnsi::Strncmp(Line.GetData(), "-Y ", 3) != 0)
+        {
+            OutError = TEXT("Failed to decode HDR: unsupported image orientation");
+            return false;
+        }
+
+        const ANSICHAR* WidthToken = FCStringAnsi::Strstr(Line.GetData(), "+X ");
+        const int32 Height = FCStringAnsi::Atoi(Line.GetData() + 3);
+        const int32 Width = WidthToken ? FCStringAnsi::Atoi(WidthToken + 3) : 0;
+
+        if (Width <= 0 || Height <= 0)
+        {
+            OutError = TEXT("Failed to decode HDR: unsupported image orientation");
+            return false;
+        }
+
+        FIntRect Region;
+        if (!FRuntimeImageUtils::ClipRegion(RequestedRegion, Width, Height, Region, OutError))
+        {
+            return false;
+        }
+
+        OutImage.Init2D(Region.Width(), Region.Height(), TSF_BGRE8);
+        OutImage.SourceSizeX = Width;
+        OutImage.SourceSizeY = Height;
+        uint8* RawData = OutImage.RawData.GetData();
+
+        TArray<uint8> Planes;
+        Planes.SetNumUninitialized(Width * 4);
+
+        // scanlines outside the region are decoded into a scratch row, the ones below it are never read
+        const bool bCropColumns = Region.Width() != Width;
+        TArray<uint8> ScratchRow;
+        if (Region.Width() != Width || Region.Height() != Height)
+        {
+            ScratchRow.SetNumUninitialized(Width * 4);
+        }
+
+        for (int32 Y = 0; Y < Region.Max.Y; ++Y)
+        {
+            const bool bIsInRegion = Y >= Region.Min.Y;
+            uint8* RegionRow = RawData + int64(Y - Region.Min.Y) * Region.Width() * 4;
+            uint8* Row = bIsInRegion && !bCropColumns ? RegionRow : ScratchRow.GetData();
+
+            uint8 ScanlineHeader[4];
+            if (!Reader.Read(ScanlineHeader, 4))
+            {
+                OutError = FString::Printf(TEXT("Failed to decode HDR: truncated at scanline %d"), Y);
+                return false;
+            }
+
+            const bool bIsPlanarRLE = Width >= 8 && Width < 0x8000 && ScanlineHeader[0] == 2 && ScanlineHeader[1] == 2 && (int32(ScanlineHeader[2]) << 8 | ScanlineHeader[3]) == Width;
+            if (bIsPlanarRLE)
+            {
+                if (!DecodeHDRPlanarScanline(Reader, Width, Planes.GetData()))
+                {
+                    OutError = FString::Printf(TEXT("Failed to decode HDR: corrupted scanline %d"), Y);
+                    return false;
+                }
+
+                const uint8* R = Planes.GetData();
+                const uint8* G = R + Width;
+                const uint8* B = G + Width;
+                const uint8* E = B + Width;
+                for (int32 X = 0; X < Width; ++X)
+                {
+                    uint8* Pixel = Row + int64(X) * 4;
+                    Pixel[0] = B[X];
+                    Pixel[1] = G[X];
+                    Pixel[2] = R[X];
+                    Pixel[3] = E[X];
+                }
+            }
+            else if (!DecodeHDRFlatScanline(Reader, Width, ScanlineHeader, Row))
+            {
+                OutError = FString::Printf(TEXT("Failed to decode HDR: corrupted scanline %d"), Y);
+                return false;
+            }
+
+            if (bIsInRegion && bCropColumns)
+            {
+                FMemory::Memcpy(RegionRow, Row + int64(Region.Min.X) * 4, int64(Region.Width()) * 4);
+            }
+        }
+
+        OutImage.SRGB = false;
+        OutImage.GammaSpace = EGammaSpace::Linear;
+        OutImage.CompressionSettings = TC_HDR;
+
+        return true;
+    }
+
+    //
+    // PNG
+    //
+    // libpng pulls the stream through the read callback, rows are inflated straight into the image
+    static void PNGReadFromArchive(png_structp PngPtr, png_bytep Data, png_size_t Length)
+    {
+        FArchive* Archive = static_cast<FArchive*>(png_get_io_ptr(PngPtr));
+        if (Archive->Tell() + int64(Length) > Archive->TotalSize())
+        {
+            png_error(PngPtr, "Unexpected end of file");
+        }
+
+        Archive->Serialize(Data, Length);
+        if (Archive->IsError())
+        {
+            png_error(PngPtr, "File read error");
+        }
+    }
+
+    static void PNGError(png_structp PngPtr, png_const_charp Message)
+    {
+        FString* OutError = static_cast<FString*>(png_get_error_ptr(PngPtr));
+        *OutError = FString::Printf(TEXT("Failed to decode PNG: %s"), ANSI_TO_TCHAR(Message));
+
+        longjmp(png_jmpbuf(PngPtr), 1);
+    }
+
+    static void PNGWarning(png_structp PngPtr, png_const_charp Message)
+    {
+    }
+
+#ifdef _MSC_VER
+#pragma warning(push)
+    // no objects with destructors are created between setjmp and the libpng calls that may jump back
+#pragma warning(disable : 4611)
+#endif
+
+    static bool DecodePNG(FArchive& Archive, const FIntRect& RequestedRegion, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(STAT_FStreamingImageDecoders_DecodePNG);
+
+        png_structp PngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, &OutError, PNGError, PNGWarning);
+        png_infop InfoPtr = PngPtr ? png_create_info_struct(PngPtr) : nullptr;
+        if (!InfoPtr)
+        {
+            png_destroy_read_struct(&PngPtr, nullptr, nullptr);
+            OutError = TEXT("Failed to decode PNG: out of memory");
+            return false;
+        }
+
+        TArray<png_bytep> RowPointers;
+        TArray64<uint8> ScratchRow;
+        FIntRect Region;
+        bool bSuccess = false;
+
+        if (setjmp(png_jmpbuf(PngPtr)) == 0)
+        {
+            png_set_read_fn(PngPtr, &Archive, PNGReadFromArchive);
+            png_read_info(PngPtr, InfoPtr);
+
+            png_uint_32 Width = 0;
+            png_uint_32 Height = 0;
+            int32 BitDepth = 0;
+            int32 ColorType = 0;
+            int32 InterlaceType = 0;
+            png_get_IHDR(PngPtr, InfoPtr, &Width, &Height, &BitDepth, &ColorType, &InterlaceType, nullptr, nullptr);
+
+            if (Width > png_uint_32(MAX_int32) || Height > png_uint_32(MAX_int32))
+            {
+                png_error(PngPtr, "Image is too large");
+            }
+
+            const bool bHasTransparency = png_get_valid(PngPtr, InfoPtr, PNG_INFO_tRNS) != 0;
+
+            // palettes, low bit depth gray and tRNS chunks are expanded to full channels
+            png_set_expand(PngPtr);
+
+            // same source formats as the whole-buffer PNG path
+            ETextureSourceFormat TextureFormat = TSF_BGRA8;
+            if (ColorType == PNG_COLOR_TYPE_GRAY && !bHasTransparency && BitDepth <= 8)
+            {
+                TextureFormat = TSF_G8;
+            }
+            else if (ColorType == PNG_COLOR_TYPE_GRAY && !bHasTransparency && BitDepth == 16)
+            {
+                TextureFormat = TSF_G16;
+#if PLATFORM_LITTLE_ENDIAN
+                png_set_swap(PngPtr);
+#endif
+            }
+            else if (BitDepth == 16)
+            {
+                TextureFormat = TSF_RGBA16;
+                png_set_gray_to_rgb(PngPtr);
+                png_set_add_alpha(PngPtr, 0xFFFF, PNG_FILLER_AFTER);
+#if PLATFORM_LITTLE_ENDIAN
+                png_set_swap(PngPtr);
+#endif
+            }
+            else
+            {
+                png_set_gray_to_rgb(PngPtr);
+                png_set_bgr(PngPtr);
+                png_set_add_alpha(PngPtr, 0xFF, PNG_FILLER_AFTER);
+            }
+
+            png_set_interlace_handling(PngPtr);
+            png_read_update_info(PngPtr, InfoPtr);
+
+            if (!FRuntimeImageUtils::ClipRegion(RequestedRegion, int32(Width), int32(Height), Region, OutError))
+            {
+                longjmp(png_jmpbuf(PngPtr), 1);
+            }
+
+            // the rows of interlaced images are complete after the last pass only, they are cropped after decoding
+            const bool bDecodeRegion = InterlaceType == PNG_INTERLACE_NONE && (Region.Width() != int32(Width) || Region.Height() != int32(Height));
+            if (bDecodeRegion)
+            {
+                OutImage.Init2D(Region.Width(), Region.Height(), TextureFormat);
+                OutImage.SourceSizeX = int32(Width);
+                OutImage.SourceSizeY = int32(Height);
+            }
+            else
+            {
+                OutImage.Init2D(Width, Height, TextureFormat);
+            }
+
+            const int64 PixelBytes = OutImage.GetBytesPerPixel();
+            const int64 RowBytes = int64(Width) * PixelBytes;
+            if (int64(png_get_rowbytes(PngPtr, InfoPtr)) != RowBytes)
+            {
+                png_error(PngPtr, "Unexpected row size");
+            }
+
+            if (bDecodeRegion)
+            {
+                // rows below the region are never inflated
+                const int64 RegionRowBytes = int64(Region.Width()) * PixelBytes;
+                ScratchRow.SetNumUninitialized(RowBytes);
+                for (int32 Y = 0; Y < Region.Max.Y; ++Y)
+                {
+                    png_read_row(PngPtr, ScratchRow.GetData(), nullptr);
+                    if (Y >= Region.Min.Y)
+                    {
+                        FMemory::Memcpy(OutImage.RawData.GetData() + (Y - Region.Min.Y) * RegionRowBytes, ScratchRow.GetData() + Region.Min.X * PixelBytes, RegionRowBytes);
+                    }
+                }
+            }
+            else
+            {
+                RowPointers.SetNumUninitialized(Height);
+                for (png_uint_32 Y = 0; Y < Height; ++Y)
+                {
+                    RowPointers[Y] = OutImage.RawData.GetData() + Y * RowBytes;
+                }
+
+                png_read_image(PngPtr, RowPointers.GetData());
+                png_read_end(PngPtr, nullptr);
+            }
+
+            bSuccess = true;
+        }
+
+        png_destroy_read_struct(&PngPtr, &InfoPtr, nullptr);
+
+        if (!bSuccess)
+        {
+            return false;
+        }
+
+        OutImage.SRGB = OutImage.TextureSourceFormat != TSF_RGBA16 && OutImage.TextureSourceFormat != TSF_G16;
+        OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+
+        FPNGHelpers::FillZeroAlphaPNGData(OutImage.SizeX, OutImage.SizeY, OutImage.TextureSourceFormat, OutImage.RawData.GetData());
+
+        return true;
+    }
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#if RUNTIMEIMAGELOADER_WITH_LIBTIFF
+    //
+    // TIFF
+    //
+    // Strips and tiles are decoded one at a time and converted into the image, libtiff seeks with 64-bit offsets
+    static tmsize_t TIFFReadFromArchive(thandle_t Handle, void* Data, tmsize_t Size)
+    {
+        FArchive* Archive = static_cast<FArchive*>(Handle);
+
+        const int64 NumToRead = FMath::Min<int64>(Size, Archive->TotalSize() - Archive->Tell());
+        if (NumToRead <= 0)
+        {
+            return 0;
+        }
+
+        Archive->Serialize(Data, NumToRead);
+        return Archive->IsError() ? tmsize_t(-1) : tmsize_t(NumToRead);
+    }
+
+    static tmsize_t TIFFWriteToArchive(thandle_t Handle, void* Data, tmsize_t Size)
+    {
+        return 0;
+    }
+
+    static toff_t TIFFSeekArchive(thandle_t Handle, toff_t Offset, int Whence)
+    {
+        FArchive* Archive = static_cast<FArchive*>(Handle);
+
+        int64 Position = int64(Offset);
+        if (Whence == SEEK_CUR)
+        {
+            Position += Archive->Tell();
+        }
+        else if (Whence == SEEK_END)
+        {
+            Position += Archive->TotalSize();
+        }
+
+        if (Position < 0 || Position > Archive->TotalSize())
+        {
+            return toff_t(-1);
+        }
+
+        Archive->Seek(Position);
+        return toff_t(Archive->Tell());
+    }
+
+    static int TIFFCloseArchive(thandle_t Handle)
+    {
+        return 0;
+    }
+
+    static toff_t TIFFArchiveSize(thandle_t Handle)
+    {
+        return toff_t(static_cast<FArchive*>(Handle)->TotalSize());
+    }
+
+    static int TIFFMapArchive(thandle_t Handle, void** OutBase, toff_t* OutSize)
+    {
+        return 0;
+    }
+
+    static void TIFFUnmapArchive(thandle_t Handle, void* Base, toff_t Size)
+    {
+    }
+
+    static bool DecodeTIFFDirectory(TIFF* Tiff, const FIntRect& RequestedRegion, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        using namespace FTIFFHelpers;
+
+        FTIFFChunkLayout Layout;
+        if (!GetChunkLayout(Tiff, Layout, OutError))
+        {
+            return false;
+        }
+
+        if (Layout.Layout != ETIFFLayout::RGBA)
+        {
+            // strips and tiles outside the region are skipped
+            if (!FRuntimeImageUtils::ClipRegion(RequestedRegion, Layout.Width, Layout.Height, Layout.Region, OutError))
+            {
+                return false;
+            }
+
+            InitImage(Layout, OutImage);
+            return DecodeChunks(Tiff, Layout, 0, Layout.NumChunks, OutImage, OutError);
+        }
+
+        // libtiff decodes strip by strip into the raster, which is the image itself
+        OutImage.Init2D(Layout.Width, Layout.Height, TSF_BGRA8);
+        if (!TIFFReadRGBAImageOriented(Tiff, Layout.Width, Layout.Height, reinterpret_cast<uint32*>(OutImage.RawData.GetData()), ORIENTATION_TOPLEFT, 1))
+        {
+            OutError = TEXT("Failed to decode TIFF: unsupported sample layout");
+            return false;
+        }
+
+        // raster is RGBA in memory
+        FPixelKernels::RGBAToBGRA(OutImage.RawData.GetData(), OutImage.RawData.GetData(), int64(Layout.Width) * Layout.Height);
+
+        OutImage.SRGB = true;
+        OutImage.GammaSpace = EGammaSpace::sRGB;
+        OutImage.CompressionSettings = TC_Default;
+        return true;
+    }
+
+    static bool DecodeTIFF(FArchive& Archive, const FIntRect& RequestedRegion, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(STAT_FStreamingImageDecoders_DecodeTIFF);
+
+        // "m" disables memory mapping, the archive is the only source of data
+        TIFF* Tiff = TIFFClientOpen("RuntimeImageLoader", "rm", static_cast<thandle_t>(&Archive),
+            TIFFReadFromArchive, TIFFWriteToArchive, TIFFSeekArchive, TIFFCloseArchive, TIFFArchiveSize, TIFFMapArchive, TIFFUnmapArchive);
+
+        if (!Tiff)
+        {
+            OutError = TEXT("Failed to decode TIFF: invalid header");
+            return false;
+        }
+
+        const bool bSuccess = DecodeTIFFDirectory(Tiff, RequestedRegion, OutImage, OutError);
+        TIFFClose(Tiff);
+
+        return bSuccess;
+    }
+#endif // RUNTIMEIMAGELOADER_WITH_LIBTIFF
+
+#if RUNTIMEIMAGELOADER_WITH_OPENEXR
+    //
+    // EXR
+    //
+    static bool DecodeEXR(FArchive& Archive, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(STAT_FStreamingImageDecoders_DecodeEXR);
+
+        return FEXRHelpers::Decode(Archive, Options, OutImage, OutError);
+    }
+#endif // RUNTIMEIMAGELOADER_WITH_OPENEXR
+
+    ERuntimeImageFormat SniffFormat(FArchive& Archive)
+    {
+        const int64 StartPosition = Archive.Tell();
+
+        uint8 Magic[8] = { 0 };
+        const int64 NumToRead = FMath::Min<int64>(sizeof(Magic), Archive.TotalSize() - StartPosition);
+        if (NumToRead < 4)
+        {
+            return ERuntimeImageFormat::Unknown;
+        }
+
+        Archive.Serialize(Magic, NumToRead);
+        Archive.Seek(StartPosition);
+
+        if (Archive.IsError())
+        {
+            return ERuntimeImageFormat::Unknown;
+        }
+
+        static const uint8 PNGSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        if (NumToRead == sizeof(PNGSignature) && FMemory::Memcmp(Magic, PNGSignature, sizeof(PNGSignature)) == 0)
+        {
+            return ERuntimeImageFormat::PNG;
+        }
+
+        if (Magic[0] == '#' && Magic[1] == '?')
+        {
+            return ERuntimeImageFormat::HDR;
+        }
+
+        // classic TIFF (42) and BigTIFF (43) in both byte orders
+        if ((Magic[0] == 'I' && Magic[1] == 'I' && (Magic[2] == 42 || Magic[2] == 43) && Magic[3] == 0) ||
+            (Magic[0] == 'M' && Magic[1] == 'M' && Magic[2] == 0 && (Magic[3] == 42 || Magic[3] == 43)))
+        {
+            return ERuntimeImageFormat::TIFF;
+        }
+
+        if (Magic[0] == 0x76 && Magic[1] == 0x2F && Magic[2] == 0x31 && Magic[3] == 0x01)
+        {
+            return ERuntimeImageFormat::EXR;
+        }
+
+        return ERuntimeImageFormat::Unknown;
+    }
+
+    bool CanDecode(ERuntimeImageFormat Format)
+    {
+        switch (Format)
+        {
+        case ERuntimeImageFormat::PNG:
+        case ERuntimeImageFormat::HDR:
+            return true;
+        case ERuntimeImageFormat::TIFF:
+            return RUNTIMEIMAGELOADER_WITH_LIBTIFF != 0;
+        case ERuntimeImageFormat::EXR:
+            return RUNTIMEIMAGELOADER_WITH_OPENEXR != 0;
+        default:
+            return false;
+        }
+    }
+
+    bool Decode(ERuntimeImageFormat Format, FArchive& Archive, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        UE_LOG(LogStreamingImageDecoders, Verbose, TEXT("Streaming decode of %lld bytes"), Archive.TotalSize() - Archive.Tell());
+
+        switch (Format)
+        {
+        case ERuntimeImageFormat::PNG:
+            return DecodePNG(Archive, Options.Region, OutImage, OutError);
+        case ERuntimeImageFormat::HDR:
+            return DecodeHDR(Archive, Options.Region, OutImage, OutError);
+#if RUNTIMEIMAGELOADER_WITH_LIBTIFF
+        case ERuntimeImageFormat::TIFF:
+            return DecodeTIFF(Archive, Options.Region, OutImage, OutError);
+#endif
+#if RUNTIMEIMAGELOADER_WITH_OPENEXR
+        case ERuntimeImageFormat::EXR:
+            return DecodeEXR(Archive, Options, OutImage, OutError);
+#endif
+        default:
+            OutError = TEXT("Streaming decode is not supported for this format");
+            return false;
+        }
+    }
+}
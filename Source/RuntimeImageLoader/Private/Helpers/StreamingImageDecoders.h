@@ -0,0 +1,30 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/Archive.h"
+
+#include "ImageHeaderInfo.h"
+#include "RuntimeImageData.h"
+#include "ImageDecoders/IRuntimeImageDecoder.h"
+
+/**
+ * Decoders that pull the encoded image from an archive instead of a whole-file buffer.
+ * Only the decoded pixels and a bounded working set (one scanline, strip or zlib window) are kept in memory,
+ * which makes multi-gigabyte images loadable. Offsets are 64-bit throughout.
+ */
+namespace FStreamingImageDecoders
+{
+    /** Detects the format from the first bytes of the archive, the archive position is restored afterwards */
+    ERuntimeImageFormat SniffFormat(FArchive& Archive);
+
+    /** Whether the format has a streaming decoder on this platform */
+    bool CanDecode(ERuntimeImageFormat Format);
+
+    /**
+     * Decodes the image starting at the current archive position.
+     * PNG, HDR, TIFF and EXR stop decoding after the last row of Options.Region and keep only its pixels
+     */
+    bool Decode(ERuntimeImageFormat Format, FArchive& Archive, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError);
+}
@@ -1,272 +1,234 @@
 // Copyright 2023 Petr Leontev. All Rights Reserved.
 
 #include "TGAHelpers.h"
+#include "PixelKernels.h"
+#include "Algo/Reverse.h"
+
+#include "RuntimeImageUtils.h"
 
 
 namespace FTGAHelpers
 {
-    void DecompressTGA_RLE_32bpp(const FTGAFileHeader* TGA, uint32* TextureData)
+    /** Converts a span of file pixels to texture pixels */
+    typedef void (*FConvertPixelsFunction)(const uint8* Source, uint8* Dest, int64 NumPixels);
+
+    static void ConvertPixels_32bpp(const uint8* Source, uint8* Dest, int64 NumPixels)
     {
-        uint8* IdData = (uint8*)TGA + sizeof(FTGAFileHeader);
-        uint8* ColorMap = IdData + TGA->IdFieldLength;
-        uint8* ImageData = (uint8*)(ColorMap + (TGA->ColorMapEntrySize + 4) / 8 * TGA->ColorMapLength);
-        uint32 Pixel = 0;
-        int32 RLERun = 0;
-        int32 RAWRun = 0;
-
-        for (int32 Y = TGA->Height - 1; Y >= 0; Y--) // Y-flipped.
-        {
-            for (int32 X = 0; X < TGA->Width; X++)
-            {
-                if (RLERun > 0)
-                {
-                    RLERun--;  // reuse current Pixel data.
-                }
-                else if (RAWRun == 0) // new raw pixel or RLE-run.
-                {
-                    uint8 RLEChunk = *(ImageData++);
-                    if (RLEChunk & 0x80)
-                    {
-                        RLERun = (RLEChunk & 0x7F) + 1;
-                        RAWRun = 1;
-                    }
-                    else
-                    {
-                        RAWRun = (RLEChunk & 0x7F) + 1;
-                    }
-                }
-                // Retrieve new pixel data - raw run or single pixel for RLE stretch.
-                if (RAWRun > 0)
-                {
-                    Pixel = *(uint32*)ImageData; // RGBA 32-bit dword.
-                    ImageData += 4;
-                    RAWRun--;
-                    RLERun--;
-                }
-                // Store.
-                *((TextureData + Y * TGA->Width) + X) = Pixel;
-            }
-        }
+        // already BGRA
+        FMemory::Memcpy(Dest, Source, NumPixels * 4);
     }
 
-    void DecompressTGA_RLE_24bpp(const FTGAFileHeader* TGA, uint32* TextureData)
+    static void ConvertPixels_24bpp(const uint8* Source, uint8* Dest, int64 NumPixels)
     {
-        uint8* IdData = (uint8*)TGA + sizeof(FTGAFileHeader);
-        uint8* ColorMap = IdData + TGA->IdFieldLength;
-        uint8* ImageData = (uint8*)(ColorMap + (TGA->ColorMapEntrySize + 4) / 8 * TGA->ColorMapLength);
-        uint8 Pixel[4] = {};
-        int32 RLERun = 0;
-        int32 RAWRun = 0;
-
-        for (int32 Y = TGA->Height - 1; Y >= 0; Y--) // Y-flipped.
-        {
-            for (int32 X = 0; X < TGA->Width; X++)
-            {
-                if (RLERun > 0)
-                    RLERun--;  // reuse current Pixel data.
-                else if (RAWRun == 0) // new raw pixel or RLE-run.
-                {
-                    uint8 RLEChunk = *(ImageData++);
-                    if (RLEChunk & 0x80)
-                    {
-                        RLERun = (RLEChunk & 0x7F) + 1;
-                        RAWRun = 1;
-                    }
-                    else
-                    {
-                        RAWRun = (RLEChunk & 0x7F) + 1;
-                    }
-                }
-                // Retrieve new pixel data - raw run or single pixel for RLE stretch.
-                if (RAWRun > 0)
-                {
-                    Pixel[0] = *(ImageData++);
-                    Pixel[1] = *(ImageData++);
-                    Pixel[2] = *(ImageData++);
-                    Pixel[3] = 255;
-                    RAWRun--;
-                    RLERun--;
-                }
-                // Store.
-                *((TextureData + Y * TGA->Width) + X) = *(uint32*)&Pixel;
-            }
-        }
+        FPixelKernels::BGRToBGRA(Source, Dest, NumPixels);
     }
 
-    void DecompressTGA_RLE_16bpp(const FTGAFileHeader* TGA, uint32* TextureData)
+    static void ConvertPixels_16bpp(const uint8* Source, uint8* Dest, int64 NumPixels)
     {
-        uint8* IdData = (uint8*)TGA + sizeof(FTGAFileHeader);
-        uint8* ColorMap = IdData + TGA->IdFieldLength;
-        uint16* ImageData = (uint16*)(ColorMap + (TGA->ColorMapEntrySize + 4) / 8 * TGA->ColorMapLength);
-        uint16 FilePixel = 0;
-        uint32 TexturePixel = 0;
-        int32 RLERun = 0;
-        int32 RAWRun = 0;
-
-        for (int32 Y = TGA->Height - 1; Y >= 0; Y--) // Y-flipped.
+        for (int64 Index = 0; Index < NumPixels; ++Index, Source += 2, Dest += 4)
         {
-            for (int32 X = 0; X < TGA->Width; X++)
-            {
-                if (RLERun > 0)
-                    RLERun--;  // reuse current Pixel data.
-                else if (RAWRun == 0) // new raw pixel or RLE-run.
-                {
-                    uint8 RLEChunk = *((uint8*)ImageData);
-                    ImageData = (uint16*)(((uint8*)ImageData) + 1);
-                    if (RLEChunk & 0x80)
-                    {
-                        RLERun = (RLEChunk & 0x7F) + 1;
-                        RAWRun = 1;
-                    }
-                    else
-                    {
-                        RAWRun = (RLEChunk & 0x7F) + 1;
-                    }
-                }
-                // Retrieve new pixel data - raw run or single pixel for RLE stretch.
-                if (RAWRun > 0)
-                {
-                    FilePixel = *(ImageData++);
-                    RAWRun--;
-                    RLERun--;
-                }
-                // Convert file format A1R5G5B5 into pixel format B8G8R8B8
-                TexturePixel = (FilePixel & 0x001F) << 3;
-                TexturePixel |= (FilePixel & 0x03E0) << 6;
-                TexturePixel |= (FilePixel & 0x7C00) << 9;
-                TexturePixel |= (FilePixel & 0x8000) << 16;
-                // Store.
-                *((TextureData + Y * TGA->Width) + X) = TexturePixel;
-            }
+            const uint16 FilePixel = uint16(Source[0] | (Source[1] << 8));
+
+            // Convert file format A1R5G5B5 into pixel format B8G8R8A8
+            uint32 TexturePixel = (FilePixel & 0x001F) << 3;
+            TexturePixel |= (FilePixel & 0x03E0) << 6;
+            TexturePixel |= (FilePixel & 0x7C00) << 9;
+            TexturePixel |= (FilePixel & 0x8000) << 16;
+            FMemory::Memcpy(Dest, &TexturePixel, 4);
         }
     }
 
-    void DecompressTGA_32bpp(const FTGAFileHeader* TGA, uint32* TextureData)
+    static void ConvertPixels_8bpp(const uint8* Source, uint8* Dest, int64 NumPixels)
     {
+        FMemory::Memcpy(Dest, Source, NumPixels);
+    }
 
-        uint8* IdData = (uint8*)TGA + sizeof(FTGAFileHeader);
-        uint8* ColorMap = IdData + TGA->IdFieldLength;
-        uint32* ImageData = (uint32*)(ColorMap + (TGA->ColorMapEntrySize + 4) / 8 * TGA->ColorMapLength);
+    struct FTGADecodeTarget
+    {
+        uint8* Data;
+        int32 Width;
+        int32 Height;
+        int32 BytesPerPixel;
+        bool bTopToBottom;
 
-        for (int32 Y = 0; Y < TGA->Height; Y++)
+        /** Texture row index of the given row in file order */
+        int32 GetTextureRow(int32 FileRow) const
         {
-            FMemory::Memcpy(TextureData + Y * TGA->Width, ImageData + (TGA->Height - Y - 1) * TGA->Width, TGA->Width * 4);
+            return bTopToBottom ? FileRow : Height - 1 - FileRow;
         }
-    }
 
-    void DecompressTGA_16bpp(const FTGAFileHeader* TGA, uint32* TextureData)
-    {
-        uint8* IdData = (uint8*)TGA + sizeof(FTGAFileHeader);
-        uint8* ColorMap = IdData + TGA->IdFieldLength;
-        uint16* ImageData = (uint16*)(ColorMap + (TGA->ColorMapEntrySize + 4) / 8 * TGA->ColorMapLength);
-        uint16 FilePixel = 0;
-        uint32 TexturePixel = 0;
+        /** Texture row of the given row in file order */
+        uint8* GetRow(int32 FileRow) const
+        {
+            return Data + int64(GetTextureRow(FileRow)) * Width * BytesPerPixel;
+        }
+    };
 
-        for (int32 Y = TGA->Height - 1; Y >= 0; Y--)
+    static void FillPixels(uint8* Dest, const uint8* Pixel, int32 BytesPerPixel, int32 NumPixels)
+    {
+        if (BytesPerPixel == 1)
+        {
+            FMemory::Memset(Dest, Pixel[0], NumPixels);
+        }
+        else
         {
-            for (int32 X = 0; X < TGA->Width; X++)
+            // rows of 4 byte pixels start at 4 byte aligned offsets of RawData
+            uint32 Value;
+            FMemory::Memcpy(&Value, Pixel, 4);
+            uint32* DestPixels = reinterpret_cast<uint32*>(Dest);
+            for (int32 Index = 0; Index < NumPixels; ++Index)
             {
-                FilePixel = *ImageData++;
-                // Convert file format A1R5G5B5 into pixel format B8G8R8A8
-                TexturePixel = (FilePixel & 0x001F) << 3;
-                TexturePixel |= (FilePixel & 0x03E0) << 6;
-                TexturePixel |= (FilePixel & 0x7C00) << 9;
-                TexturePixel |= (FilePixel & 0x8000) << 16;
-                // Store.
-                *((TextureData + Y * TGA->Width) + X) = TexturePixel;
+                DestPixels[Index] = Value;
             }
         }
     }
 
-    void DecompressTGA_24bpp(const FTGAFileHeader* TGA, uint32* TextureData)
+    /** Target.Data holds the region only, pixels outside of it are stepped over without being converted */
+    static bool DecodeUncompressed(const uint8* ImageData, const uint8* ImageDataEnd, int32 SourceBytesPerPixel, FConvertPixelsFunction ConvertPixels, const FTGADecodeTarget& Target, const FIntRect& Region, FString& OutError)
     {
-        uint8* IdData = (uint8*)TGA + sizeof(FTGAFileHeader);
-        uint8* ColorMap = IdData + TGA->IdFieldLength;
-        uint8* ImageData = (uint8*)(ColorMap + (TGA->ColorMapEntrySize + 4) / 8 * TGA->ColorMapLength);
-        uint8 Pixel[4];
+        const int64 SourceRowBytes = int64(Target.Width) * SourceBytesPerPixel;
+        if (ImageDataEnd - ImageData < SourceRowBytes * Target.Height)
+        {
+            OutError = FString::Printf(TEXT("TGA data is truncated: %lld bytes of pixel data expected, %lld found"), SourceRowBytes * Target.Height, (int64)(ImageDataEnd - ImageData));
+            return false;
+        }
 
-        for (int32 Y = 0; Y < TGA->Height; Y++)
+        const int64 RegionRowBytes = int64(Region.Width()) * Target.BytesPerPixel;
+        for (int32 Y = 0; Y < Target.Height; ++Y, ImageData += SourceRowBytes)
         {
-            for (int32 X = 0; X < TGA->Width; X++)
+            const int32 Row = Target.GetTextureRow(Y);
+            if (Row >= Region.Min.Y && Row < Region.Max.Y)
             {
-                Pixel[0] = *((ImageData + (TGA->Height - Y - 1)*TGA->Width * 3) + X * 3 + 0);
-                Pixel[1] = *((ImageData + (TGA->Height - Y - 1)*TGA->Width * 3) + X * 3 + 1);
-                Pixel[2] = *((ImageData + (TGA->Height - Y - 1)*TGA->Width * 3) + X * 3 + 2);
-                Pixel[3] = 255;
-                *((TextureData + Y * TGA->Width) + X) = *(uint32*)&Pixel;
+                ConvertPixels(ImageData + int64(Region.Min.X) * SourceBytesPerPixel, Target.Data + (Row - Region.Min.Y) * RegionRowBytes, Region.Width());
             }
         }
+
+        return true;
     }
 
-    void DecompressTGA_8bpp(const FTGAFileHeader* TGA, uint8* TextureData)
+    static bool DecodeRLE(const uint8* ImageData, const uint8* ImageDataEnd, int32 SourceBytesPerPixel, FConvertPixelsFunction ConvertPixels, const FTGADecodeTarget& Target, FString& OutError)
     {
-        const uint8*  const IdData = (uint8*)TGA + sizeof(FTGAFileHeader);
-        const uint8*  const ColorMap = IdData + TGA->IdFieldLength;
-        const uint8*  const ImageData = (uint8*)(ColorMap + (TGA->ColorMapEntrySize + 4) / 8 * TGA->ColorMapLength);
+        // RLE compression: CHUNKS: 1 -byte header, high bit 0 = raw, 1 = compressed
+        // bits 0-6 are a 7-bit count; count+1 = number of raw pixels following, or rle pixels to be expanded.
+        int64 NumPixelsLeft = int64(Target.Width) * Target.Height;
+        int32 Row = 0;
+        int32 Column = 0;
+        uint8 RunPixel[4];
 
-        int32 RevY = 0;
-        for (int32 Y = TGA->Height - 1; Y >= 0; --Y)
+        while (NumPixelsLeft > 0)
         {
-            const uint8* ImageCol = ImageData + (Y * TGA->Width);
-            uint8* TextureCol = TextureData + (RevY++ * TGA->Width);
-            FMemory::Memcpy(TextureCol, ImageCol, TGA->Width);
-        }
-    }
+            if (ImageData >= ImageDataEnd)
+            {
+                OutError = FString::Printf(TEXT("TGA data is truncated: %lld pixels are missing"), NumPixelsLeft);
+                return false;
+            }
 
+            const uint8 PacketHeader = *ImageData++;
+            const bool bIsRunLengthPacket = (PacketHeader & 0x80) != 0;
+            const int32 NumPacketPixels = (int32)FMath::Min<int64>((PacketHeader & 0x7F) + 1, NumPixelsLeft);
 
-    bool DecompressTGA_helper(const FTGAFileHeader* TGA, uint32*& TextureData, const int32 TextureDataSize, FString& OutError)
-    {
-        if (TGA->ImageTypeCode == 10) // 10 = RLE compressed 
-        {
-            // RLE compression: CHUNKS: 1 -byte header, high bit 0 = raw, 1 = compressed
-            // bits 0-6 are a 7-bit count; count+1 = number of raw pixels following, or rle pixels to be expanded. 
-            if (TGA->BitsPerPixel == 32)
+            const int64 PacketBytes = bIsRunLengthPacket ? SourceBytesPerPixel : int64(NumPacketPixels) * SourceBytesPerPixel;
+            if (ImageDataEnd - ImageData < PacketBytes)
             {
-                DecompressTGA_RLE_32bpp(TGA, TextureData);
+                OutError = FString::Printf(TEXT("TGA data is truncated: %lld pixels are missing"), NumPixelsLeft);
+                return false;
             }
-            else if (TGA->BitsPerPixel == 24)
+
+            if (bIsRunLengthPacket)
             {
-                DecompressTGA_RLE_24bpp(TGA, TextureData);
+                ConvertPixels(ImageData, RunPixel, 1);
             }
-            else if (TGA->BitsPerPixel == 16)
+
+            // packets are allowed to continue on the next row
+            for (int32 NumLeft = NumPacketPixels; NumLeft > 0;)
             {
-                DecompressTGA_RLE_16bpp(TGA, TextureData);
+                const int32 NumRowPixels = FMath::Min(NumLeft, Target.Width - Column);
+                uint8* Dest = Target.GetRow(Row) + int64(Column) * Target.BytesPerPixel;
+
+                if (bIsRunLengthPacket)
+                {
+                    FillPixels(Dest, RunPixel, Target.BytesPerPixel, NumRowPixels);
+                }
+                else
+                {
+                    ConvertPixels(ImageData, Dest, NumRowPixels);
+                    ImageData += int64(NumRowPixels) * SourceBytesPerPixel;
+                }
+
+                NumLeft -= NumRowPixels;
+                Column += NumRowPixels;
+                if (Column == Target.Width)
+                {
+                    Column = 0;
+                    ++Row;
+                }
             }
-            else
+
+            if (bIsRunLengthPacket)
             {
-                OutError = FString::Printf(TEXT("TGA uses an unsupported rle-compressed bit-depth: %u"), TGA->BitsPerPixel);
-                return false;
+                ImageData += SourceBytesPerPixel;
             }
+            NumPixelsLeft -= NumPacketPixels;
+        }
+
+        return true;
+    }
+
+    bool DecompressTGA(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError, const FIntRect& Region)
+    {
+        if (Buffer == nullptr || Length < (int64)sizeof(FTGAFileHeader))
+        {
+            OutError = TEXT("TGA data is too small to contain a header");
+            return false;
         }
-        else if (TGA->ImageTypeCode == 2) // 2 = Uncompressed RGB
+
+        const FTGAFileHeader* TGA = reinterpret_cast<const FTGAFileHeader*>(Buffer);
+
+        const int64 ImageDataOffset = sizeof(FTGAFileHeader) + TGA->IdFieldLength + int64(TGA->ColorMapEntrySize + 4) / 8 * TGA->ColorMapLength;
+        if (ImageDataOffset > Length)
         {
-            if (TGA->BitsPerPixel == 32)
-            {
-                DecompressTGA_32bpp(TGA, TextureData);
-            }
-            else if (TGA->BitsPerPixel == 16)
-            {
-                DecompressTGA_16bpp(TGA, TextureData);
-            }
-            else if (TGA->BitsPerPixel == 24)
-            {
-                DecompressTGA_24bpp(TGA, TextureData);
-            }
-            else
-            {
-                OutError = FString::Printf(TEXT("TGA uses an unsupported bit-depth: %u"), TGA->BitsPerPixel);
-                return false;
-            }
+            OutError = TEXT("TGA data is truncated before the pixel data");
+            return false;
         }
+
+        const bool bIsRLE = TGA->ImageTypeCode == 10 || TGA->ImageTypeCode == 11;
+        const bool bIsGrayscale = TGA->ColorMapType == 0 && (TGA->ImageTypeCode == 3 || TGA->ImageTypeCode == 11);
         // Support for alpha stored as pseudo-color 8-bit TGA
-        else if (TGA->ColorMapType == 1 && TGA->ImageTypeCode == 1 && TGA->BitsPerPixel == 8)
+        const bool bIsPseudoColor = TGA->ColorMapType == 1 && TGA->ImageTypeCode == 1;
+        const bool bIsTrueColor = TGA->ColorMapType == 0 && (TGA->ImageTypeCode == 2 || TGA->ImageTypeCode == 10);
+
+        FConvertPixelsFunction ConvertPixels = nullptr;
+        ETextureSourceFormat TextureFormat = TSF_Invalid;
+        if (bIsGrayscale || bIsPseudoColor)
         {
-            DecompressTGA_8bpp(TGA, (uint8*)TextureData);
+            if (TGA->BitsPerPixel != 8)
+            {
+                OutError = FString::Printf(TEXT("TGA uses an unsupported grayscale bit-depth: %u"), TGA->BitsPerPixel);
+                return false;
+            }
+
+            // Notes: The Scaleform GFx exporter (dll) strips all font glyphs into a single 8-bit texture.
+            // The targa format uses this for a palette index; GFx uses a palette of (i,i,i,i) so the index
+            // is also the alpha value.
+            //
+            // We store the image as PF_G8, where it will be used as alpha in the Glyph shader.
+            // Standard grayscale images are stored the same way.
+            TextureFormat = TSF_G8;
+            ConvertPixels = &ConvertPixels_8bpp;
         }
-        // standard grayscale
-        else if (TGA->ColorMapType == 0 && TGA->ImageTypeCode == 3 && TGA->BitsPerPixel == 8)
+        else if (bIsTrueColor)
         {
-            DecompressTGA_8bpp(TGA, (uint8*)TextureData);
+            switch (TGA->BitsPerPixel)
+            {
+                case 32: ConvertPixels = &ConvertPixels_32bpp; break;
+                case 24: ConvertPixels = &ConvertPixels_24bpp; break;
+                case 16: ConvertPixels = &ConvertPixels_16bpp; break;
+                default:
+                    OutError = FString::Printf(bIsRLE ? TEXT("TGA uses an unsupported rle-compressed bit-depth: %u") : TEXT("TGA uses an unsupported bit-depth: %u"), TGA->BitsPerPixel);
+                    return false;
+            }
+
+            TextureFormat = TSF_BGRA8;
         }
         else
         {
@@ -274,96 +236,58 @@ namespace FTGAHelpers
             return false;
         }
 
-        // Flip the image data if the flip bits are set in the TGA header.
-        bool FlipX = (TGA->ImageDescriptor & 0x10) ? 1 : 0;
-        bool FlipY = (TGA->ImageDescriptor & 0x20) ? 1 : 0;
-        if (FlipY || FlipX)
+        // RLE packets and right-to-left rows have to be decoded as a whole, the caller crops them
+        FIntRect DecodeRegion(0, 0, TGA->Width, TGA->Height);
+        if (!bIsRLE && !(TGA->ImageDescriptor & 0x10) && !FRuntimeImageUtils::ClipRegion(Region, TGA->Width, TGA->Height, DecodeRegion, OutError))
         {
-            TArray<uint8> FlippedData;
-            FlippedData.AddUninitialized(TextureDataSize);
-
-            int32 NumBlocksX = TGA->Width;
-            int32 NumBlocksY = TGA->Height;
-            int32 BlockBytes = TGA->BitsPerPixel == 8 ? 1 : 4;
-
-            uint8* MipData = (uint8*)TextureData;
-
-            for (int32 Y = 0; Y < NumBlocksY; Y++)
-            {
-                for (int32 X = 0; X < NumBlocksX; X++)
-                {
-                    int32 DestX = FlipX ? (NumBlocksX - X - 1) : X;
-                    int32 DestY = FlipY ? (NumBlocksY - Y - 1) : Y;
-                    FMemory::Memcpy(
-                        &FlippedData[(DestX + DestY * NumBlocksX) * BlockBytes],
-                        &MipData[(X + Y * NumBlocksX) * BlockBytes],
-                        BlockBytes
-                    );
-                }
-            }
-            FMemory::Memcpy(MipData, FlippedData.GetData(), FlippedData.Num());
+            return false;
         }
 
-        return true;
-    }
-
-    bool DecompressTGA(const FTGAFileHeader* TGA, FRuntimeImageData& OutImage, FString& OutError)
-    {
-        if (TGA->ColorMapType == 1 && TGA->ImageTypeCode == 1 && TGA->BitsPerPixel == 8)
+        OutImage.Init2D(DecodeRegion.Width(), DecodeRegion.Height(), TextureFormat);
+        OutImage.SourceSizeX = TGA->Width;
+        OutImage.SourceSizeY = TGA->Height;
+        if (TextureFormat == TSF_G8)
         {
-            // Notes: The Scaleform GFx exporter (dll) strips all font glyphs into a single 8-bit texture.
-            // The targa format uses this for a palette index; GFx uses a palette of (i,i,i,i) so the index
-            // is also the alpha value.
-            //
-            // We store the image as PF_G8, where it will be used as alpha in the Glyph shader.
-            OutImage.Init2D(
-                TGA->Width,
-                TGA->Height,
-                TSF_G8);
             OutImage.CompressionSettings = TC_Grayscale;
         }
-        else if (TGA->ColorMapType == 0 && TGA->ImageTypeCode == 3 && TGA->BitsPerPixel == 8)
+
+        // bit 5 of the descriptor marks a top-left origin, TGA defaults to bottom-left
+        FTGADecodeTarget Target;
+        Target.Data = OutImage.RawData.GetData();
+        Target.Width = TGA->Width;
+        Target.Height = TGA->Height;
+        Target.BytesPerPixel = bIsTrueColor ? 4 : 1;
+        Target.bTopToBottom = (TGA->ImageDescriptor & 0x20) != 0;
+
+        const int32 SourceBytesPerPixel = TGA->BitsPerPixel / 8;
+        const uint8* ImageData = Buffer + ImageDataOffset;
+        const uint8* ImageDataEnd = Buffer + Length;
+
+        const bool bResult = bIsRLE
+            ? DecodeRLE(ImageData, ImageDataEnd, SourceBytesPerPixel, ConvertPixels, Target, OutError)
+            : DecodeUncompressed(ImageData, ImageDataEnd, SourceBytesPerPixel, ConvertPixels, Target, DecodeRegion, OutError);
+        if (!bResult)
         {
-            // standard grayscale images
-            OutImage.Init2D(
-                TGA->Width,
-                TGA->Height,
-                TSF_G8);
-            OutImage.CompressionSettings = TC_Grayscale;
+            return false;
         }
-        else
+
+        // bit 4 marks a right-to-left pixel order, which is rare enough to be fixed up afterwards
+        if (TGA->ImageDescriptor & 0x10)
         {
-            if (TGA->ImageTypeCode == 10) // 10 = RLE compressed 
+            for (int32 Y = 0; Y < Target.Height; ++Y)
             {
-                if (TGA->BitsPerPixel != 32 &&
-                    TGA->BitsPerPixel != 24 &&
-                    TGA->BitsPerPixel != 16)
+                uint8* Row = Target.GetRow(Y);
+                if (Target.BytesPerPixel == 4)
                 {
-                    OutError = FString::Printf(TEXT("TGA uses an unsupported rle-compressed bit-depth: %u"), TGA->BitsPerPixel);
-                    return false;
+                    Algo::Reverse(reinterpret_cast<uint32*>(Row), Target.Width);
                 }
-            }
-            else
-            {
-                if (TGA->BitsPerPixel != 32 &&
-                    TGA->BitsPerPixel != 16 &&
-                    TGA->BitsPerPixel != 24)
+                else
                 {
-                    OutError = FString::Printf(TEXT("TGA uses an unsupported bit-depth: %u"), TGA->BitsPerPixel);
-                    return false;
+                    Algo::Reverse(Row, Target.Width);
                 }
             }
-
-            OutImage.Init2D(
-                TGA->Width,
-                TGA->Height,
-                TSF_BGRA8
-            );
         }
 
-        int32 TextureDataSize = OutImage.RawData.Num();
-        uint32* TextureData = (uint32*)OutImage.RawData.GetData();
-
-        return DecompressTGA_helper(TGA, TextureData, TextureDataSize, OutError);
+        return true;
     }
-}
\ No newline at end of file
+}
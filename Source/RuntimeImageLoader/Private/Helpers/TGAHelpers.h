@@ -38,7 +38,11 @@ namespace FTGAHelpers
 
     #pragma pack(pop)
 
-    bool DecompressTGA_helper(const FTGAFileHeader* TGA, uint32*& TextureData, const int32 TextureDataSize, FString& OutError);
-    bool DecompressTGA(const FTGAFileHeader* TGA, FRuntimeImageData& OutImage, FString& OutError);
+    /**
+     * Decodes an uncompressed or RLE compressed TGA into BGRA8, or G8 for grayscale and 8-bit pseudo-color images.
+     * Every read is checked against Length, the image origin is applied while decoding so no flip pass is needed.
+     * Uncompressed left-to-right images convert the pixels of the region only, other images are decoded as a whole.
+     */
+    bool DecompressTGA(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError, const FIntRect& Region = FIntRect());
 
 }
\ No newline at end of file
@@ -0,0 +1,462 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "TIFFHelpers.h"
+
+#if RUNTIMEIMAGELOADER_WITH_LIBTIFF
+
+#include "Async/ParallelFor.h"
+#include "Math/Float16.h"
+#include "Stats/Stats.h"
+
+#include "PixelKernels.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "tiffio.h"
+THIRD_PARTY_INCLUDES_END
+
+
+namespace FTIFFHelpers
+{
+    static ETIFFLayout GetTIFFLayout(TIFF* Tiff, uint16& OutSamplesPerPixel)
+    {
+        uint16 BitsPerSample = 1;
+        uint16 SampleFormat = SAMPLEFORMAT_UINT;
+        uint16 PlanarConfig = PLANARCONFIG_CONTIG;
+        uint16 Photometric = PHOTOMETRIC_RGB;
+        uint16 Orientation = ORIENTATION_TOPLEFT;
+
+        TIFFGetFieldDefaulted(Tiff, TIFFTAG_SAMPLESPERPIXEL, &OutSamplesPerPixel);
+        TIFFGetFieldDefaulted(Tiff, TIFFTAG_BITSPERSAMPLE, &BitsPerSample);
+        TIFFGetFieldDefaulted(Tiff, TIFFTAG_SAMPLEFORMAT, &SampleFormat);
+        TIFFGetFieldDefaulted(Tiff, TIFFTAG_PLANARCONFIG, &PlanarConfig);
+        TIFFGetFieldDefaulted(Tiff, TIFFTAG_ORIENTATION, &Orientation);
+        if (!TIFFGetField(Tiff, TIFFTAG_PHOTOMETRIC, &Photometric))
+        {
+            return ETIFFLayout::RGBA;
+        }
+
+        if (PlanarConfig != PLANARCONFIG_CONTIG || Orientation != ORIENTATION_TOPLEFT)
+        {
+            return ETIFFLayout::RGBA;
+        }
+
+        if (Photometric == PHOTOMETRIC_MINISBLACK && SampleFormat == SAMPLEFORMAT_IEEEFP && BitsPerSample == 32 && OutSamplesPerPixel == 1)
+        {
+            return ETIFFLayout::Float32;
+        }
+
+        if (Photometric == PHOTOMETRIC_MINISBLACK && SampleFormat == SAMPLEFORMAT_UINT && OutSamplesPerPixel == 1)
+        {
+            return BitsPerSample == 8 ? ETIFFLayout::Gray8 : BitsPerSample == 16 ? ETIFFLayout::Gray16 : ETIFFLayout::RGBA;
+        }
+
+        if (Photometric == PHOTOMETRIC_RGB && OutSamplesPerPixel >= 3)
+        {
+            if (SampleFormat == SAMPLEFORMAT_IEEEFP && BitsPerSample == 32)
+            {
+                return ETIFFLayout::Float32;
+            }
+
+            if (SampleFormat == SAMPLEFORMAT_UINT)
+            {
+                return BitsPerSample == 8 ? ETIFFLayout::Color8 : BitsPerSample == 16 ? ETIFFLayout::Color16 : ETIFFLayout::RGBA;
+            }
+        }
+
+        return ETIFFLayout::RGBA;
+    }
+
+    static void ConvertTIFFPixels(const uint8* Source, uint8* Dest, int64 NumPixels, ETIFFLayout Layout, int32 SamplesPerPixel)
+    {
+        switch (Layout)
+        {
+        case ETIFFLayout::Gray8:
+            FMemory::Memcpy(Dest, Source, NumPixels);
+            break;
+
+        case ETIFFLayout::Gray16:
+            FMemory::Memcpy(Dest, Source, NumPixels * sizeof(uint16));
+            break;
+
+        case ETIFFLayout::Color8:
+            if (SamplesPerPixel == 4)
+            {
+                FPixelKernels::RGBAToBGRA(Source, Dest, NumPixels);
+                break;
+            }
+            if (SamplesPerPixel == 3)
+            {
+                FPixelKernels::RGBToBGRA(Source, Dest, NumPixels);
+                break;
+            }
+            for (int64 Index = 0; Index < NumPixels; ++Index, Source += SamplesPerPixel, Dest += 4)
+            {
+                Dest[0] = Source[2];
+                Dest[1] = Source[1];
+                Dest[2] = Source[0];
+                Dest[3] = SamplesPerPixel >= 4 ? Source[3] : 0xFF;
+            }
+            break;
+
+        case ETIFFLayout::Color16:
+        {
+            const uint16* SourceSamples = reinterpret_cast<const uint16*>(Source);
+            uint16* DestSamples = reinterpret_cast<uint16*>(Dest);
+            for (int64 Index = 0; Index < NumPixels; ++Index, SourceSamples += SamplesPerPixel, DestSamples += 4)
+            {
+                DestSamples[0] = SourceSamples[0];
+                DestSamples[1] = SourceSamples[1];
+                DestSamples[2] = SourceSamples[2];
+                DestSamples[3] = SamplesPerPixel >= 4 ? SourceSamples[3] : 0xFFFF;
+            }
+            break;
+        }
+
+        case ETIFFLayout::Float32:
+        {
+            if (SamplesPerPixel == 4)
+            {
+                FPixelKernels::FloatToHalf(reinterpret_cast<const float*>(Source), reinterpret_cast<uint16*>(Dest), NumPixels * 4);
+                break;
+            }
+
+            const float* SourceSamples = reinterpret_cast<const float*>(Source);
+            FFloat16* DestSamples = reinterpret_cast<FFloat16*>(Dest);
+            for (int64 Index = 0; Index < NumPixels; ++Index, SourceSamples += SamplesPerPixel, DestSamples += 4)
+            {
+                const bool bIsGray = SamplesPerPixel < 3;
+                DestSamples[0].Set(SourceSamples[0]);
+                DestSamples[1].Set(SourceSamples[bIsGray ? 0 : 1]);
+                DestSamples[2].Set(SourceSamples[bIsGray ? 0 : 2]);
+                DestSamples[3].Set(SamplesPerPixel >= 4 ? SourceSamples[3] : 1.0f);
+            }
+            break;
+        }
+
+        default:
+            checkNoEntry();
+            break;
+        }
+    }
+
+    bool GetChunkLayout(TIFF* Tiff, FTIFFChunkLayout& OutLayout, FString& OutError)
+    {
+        uint32 Width = 0;
+        uint32 Height = 0;
+        TIFFGetField(Tiff, TIFFTAG_IMAGEWIDTH, &Width);
+        TIFFGetField(Tiff, TIFFTAG_IMAGELENGTH, &Height);
+
+        if (Width == 0 || Height == 0 || Width > uint32(MAX_int32) || Height > uint32(MAX_int32))
+        {
+            OutError = FString::Printf(TEXT("Failed to decode TIFF: invalid dimensions %u x %u"), Width, Height);
+            return false;
+        }
+
+        OutLayout.Width = int32(Width);
+        OutLayout.Height = int32(Height);
+        OutLayout.Layout = GetTIFFLayout(Tiff, OutLayout.SamplesPerPixel);
+        OutLayout.NumChunks = TIFFIsTiled(Tiff) ? TIFFNumberOfTiles(Tiff) : TIFFNumberOfStrips(Tiff);
+        OutLayout.Region = FIntRect(0, 0, OutLayout.Width, OutLayout.Height);
+
+        if (TIFFIsTiled(Tiff))
+        {
+            uint32 TileWidth = 0;
+            uint32 TileHeight = 0;
+            TIFFGetField(Tiff, TIFFTAG_TILEWIDTH, &TileWidth);
+            TIFFGetField(Tiff, TIFFTAG_TILELENGTH, &TileHeight);
+            OutLayout.ChunkHeight = FMath::Max(TileHeight, 1u);
+            OutLayout.ChunksAcross = TileWidth > 0 ? FMath::DivideAndRoundUp(Width, TileWidth) : 1;
+        }
+        else
+        {
+            uint32 RowsPerStrip = Height;
+            TIFFGetFieldDefaulted(Tiff, TIFFTAG_ROWSPERSTRIP, &RowsPerStrip);
+            OutLayout.ChunkHeight = FMath::Clamp(RowsPerStrip, 1u, Height);
+            OutLayout.ChunksAcross = 1;
+        }
+
+        return true;
+    }
+
+    void InitImage(const FTIFFChunkLayout& Layout, FRuntimeImageData& OutImage)
+    {
+        const int32 SizeX = Layout.Region.Width();
+        const int32 SizeY = Layout.Region.Height();
+
+        switch (Layout.Layout)
+        {
+        case ETIFFLayout::Gray8:    OutImage.Init2D(SizeX, SizeY, TSF_G8); OutImage.SRGB = false; OutImage.CompressionSettings = TC_Grayscale; break;
+        case ETIFFLayout::Gray16:   OutImage.Init2D(SizeX, SizeY, TSF_G16); OutImage.SRGB = false; OutImage.CompressionSettings = TC_Grayscale; break;
+        case ETIFFLayout::Color8:   OutImage.Init2D(SizeX, SizeY, TSF_BGRA8); OutImage.SRGB = true; OutImage.CompressionSettings = TC_Default; break;
+        case ETIFFLayout::Color16:  OutImage.Init2D(SizeX, SizeY, TSF_RGBA16); OutImage.SRGB = false; OutImage.CompressionSettings = TC_Default; break;
+        default:                    OutImage.Init2D(SizeX, SizeY, TSF_RGBA16F); OutImage.SRGB = false; OutImage.CompressionSettings = TC_HDR_Compressed; break;
+        }
+
+        OutImage.SourceSizeX = Layout.Width;
+        OutImage.SourceSizeY = Layout.Height;
+        OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+    }
+
+    bool DecodeChunks(TIFF* Tiff, const FTIFFChunkLayout& Layout, uint32 FirstChunk, uint32 EndChunk, FRuntimeImageData& Image, FString& OutError)
+    {
+        const uint32 Width = uint32(Layout.Width);
+        const uint32 Height = uint32(Layout.Height);
+        const FIntRect& Region = Layout.Region;
+        const int64 DestPixelBytes = Image.GetBytesPerPixel();
+        const int64 DestRowBytes = DestPixelBytes * Region.Width();
+        uint8* RawData = Image.RawData.GetData();
+
+        TArray64<uint8> ChunkBuffer;
+
+        if (TIFFIsTiled(Tiff))
+        {
+            uint32 TileWidth = 0;
+            uint32 TileHeight = 0;
+            TIFFGetField(Tiff, TIFFTAG_TILEWIDTH, &TileWidth);
+            TIFFGetField(Tiff, TIFFTAG_TILELENGTH, &TileHeight);
+
+            const int64 TileRowBytes = TIFFTileRowSize64(Tiff);
+            ChunkBuffer.SetNumUninitialized(TIFFTileSize64(Tiff));
+
+            if (TileWidth == 0 || TileHeight == 0 || ChunkBuffer.Num() == 0)
+            {
+                OutError = TEXT("Failed to decode TIFF: invalid tile size");
+                return false;
+            }
+
+            // contiguous samples have a single plane, tiles are numbered row by row
+            const uint32 TilesAcross = FMath::DivideAndRoundUp(Width, TileWidth);
+            const int64 SourcePixelBytes = TileRowBytes / TileWidth;
+            for (uint32 Tile = FirstChunk; Tile < EndChunk; ++Tile)
+            {
+                const uint32 TileX = (Tile % TilesAcross) * TileWidth;
+                const uint32 TileY = (Tile / TilesAcross) * TileHeight;
+                if (TileY >= Height || TileY >= uint32(Region.Max.Y))
+                {
+                    break;
+                }
+
+                // tiles outside the region are never decompressed
+                FIntRect Overlap(TileX, TileY, FMath::Min(TileX + TileWidth, Width), FMath::Min(TileY + TileHeight, Height));
+                Overlap.Clip(Region);
+                if (Overlap.Width() <= 0 || Overlap.Height() <= 0)
+                {
+                    continue;
+                }
+
+                if (TIFFReadEncodedTile(Tiff, Tile, ChunkBuffer.GetData(), tmsize_t(ChunkBuffer.Num())) < 0)
+                {
+                    OutError = FString::Printf(TEXT("Failed to decode TIFF: corrupted tile at %u x %u"), TileX, TileY);
+                    return false;
+                }
+
+                for (int32 Y = Overlap.Min.Y; Y < Overlap.Max.Y; ++Y)
+                {
+                    const uint8* Source = ChunkBuffer.GetData() + (Y - TileY) * TileRowBytes + (Overlap.Min.X - TileX) * SourcePixelBytes;
+                    uint8* Dest = RawData + (Y - Region.Min.Y) * DestRowBytes + (Overlap.Min.X - Region.Min.X) * DestPixelBytes;
+                    ConvertTIFFPixels(Source, Dest, Overlap.Width(), Layout.Layout, Layout.SamplesPerPixel);
+                }
+            }
+        }
+        else
+        {
+            uint32 RowsPerStrip = Height;
+            TIFFGetFieldDefaulted(Tiff, TIFFTAG_ROWSPERSTRIP, &RowsPerStrip);
+            RowsPerStrip = FMath::Clamp(RowsPerStrip, 1u, Height);
+
+            const int64 SourceRowBytes = TIFFScanlineSize64(Tiff);
+            ChunkBuffer.SetNumUninitialized(TIFFStripSize64(Tiff));
+
+            if (ChunkBuffer.Num() < SourceRowBytes * RowsPerStrip)
+            {
+                OutError = TEXT("Failed to decode TIFF: invalid strip size");
+                return false;
+            }
+
+            const int64 SourcePixelBytes = SourceRowBytes / Width;
+            for (uint32 Strip = FirstChunk; Strip < EndChunk; ++Strip)
+            {
+                const uint32 StripY = Strip * RowsPerStrip;
+                if (StripY >= Height || StripY >= uint32(Region.Max.Y))
+                {
+                    break;
+                }
+
+                // strips above the region are never decompressed
+                const int32 FirstRow = FMath::Max<int32>(StripY, Region.Min.Y);
+                const int32 EndRow = FMath::Min<int32>(StripY + FMath::Min(RowsPerStrip, Height - StripY), Region.Max.Y);
+                if (FirstRow >= EndRow)
+                {
+                    continue;
+                }
+
+                if (TIFFReadEncodedStrip(Tiff, Strip, ChunkBuffer.GetData(), tmsize_t(ChunkBuffer.Num())) < 0)
+                {
+                    OutError = FString::Printf(TEXT("Failed to decode TIFF: corrupted strip %u"), Strip);
+                    return false;
+                }
+
+                for (int32 Y = FirstRow; Y < EndRow; ++Y)
+                {
+                    const uint8* Source = ChunkBuffer.GetData() + (Y - StripY) * SourceRowBytes + Region.Min.X * SourcePixelBytes;
+                    ConvertTIFFPixels(Source, RawData + (Y - Region.Min.Y) * DestRowBytes, Region.Width(), Layout.Layout, Layout.SamplesPerPixel);
+                }
+            }
+        }
+
+        return true;
+    }
+
+    //
+    // In-memory client, libtiff reads the mapped buffer directly and only keeps a position per handle
+    //
+    struct FTIFFMemorySource
+    {
+        const uint8* Data;
+        int64 Length;
+        int64 Position;
+    };
+
+    static tmsize_t TIFFReadFromMemory(thandle_t Handle, void* Data, tmsize_t Size)
+    {
+        FTIFFMemorySource* Source = static_cast<FTIFFMemorySource*>(Handle);
+
+        const int64 NumToRead = FMath::Clamp<int64>(Size, 0, Source->Length - Source->Position);
+        FMemory::Memcpy(Data, Source->Data + Source->Position, NumToRead);
+        Source->Position += NumToRead;
+        return tmsize_t(NumToRead);
+    }
+
+    static tmsize_t TIFFWriteToMemory(thandle_t Handle, void* Data, tmsize_t Size)
+    {
+        return 0;
+    }
+
+    static toff_t TIFFSeekMemory(thandle_t Handle, toff_t Offset, int Whence)
+    {
+        FTIFFMemorySource* Source = static_cast<FTIFFMemorySource*>(Handle);
+
+        int64 Position = int64(Offset);
+        if (Whence == SEEK_CUR)
+        {
+            Position += Source->Position;
+        }
+        else if (Whence == SEEK_END)
+        {
+            Position += Source->Length;
+        }
+
+        if (Position < 0 || Position > Source->Length)
+        {
+            return toff_t(-1);
+        }
+
+        Source->Position = Position;
+        return toff_t(Position);
+    }
+
+    static int TIFFCloseMemory(thandle_t Handle)
+    {
+        return 0;
+    }
+
+    static toff_t TIFFMemorySize(thandle_t Handle)
+    {
+        return toff_t(static_cast<FTIFFMemorySource*>(Handle)->Length);
+    }
+
+    static int TIFFMapMemory(thandle_t Handle, void** OutBase, toff_t* OutSize)
+    {
+        FTIFFMemorySource* Source = static_cast<FTIFFMemorySource*>(Handle);
+        *OutBase = const_cast<uint8*>(Source->Data);
+        *OutSize = toff_t(Source->Length);
+        return 1;
+    }
+
+    static void TIFFUnmapMemory(thandle_t Handle, void* Base, toff_t Size)
+    {
+    }
+
+    static TIFF* OpenMemory(FTIFFMemorySource& Source)
+    {
+        return TIFFClientOpen("RuntimeImageLoader", "r", static_cast<thandle_t>(&Source),
+            TIFFReadFromMemory, TIFFWriteToMemory, TIFFSeekMemory, TIFFCloseMemory, TIFFMemorySize, TIFFMapMemory, TIFFUnmapMemory);
+    }
+
+    bool ParseChunkLayout(const uint8* Buffer, int64 Length, FTIFFChunkLayout& OutLayout, FString& OutError)
+    {
+        FTIFFMemorySource Source = { Buffer, Length, 0 };
+        TIFF* Tiff = OpenMemory(Source);
+        if (!Tiff)
+        {
+            OutError = TEXT("Failed to decode TIFF: invalid header");
+            return false;
+        }
+
+        const bool bSuccess = GetChunkLayout(Tiff, OutLayout, OutError);
+        TIFFClose(Tiff);
+
+        return bSuccess;
+    }
+
+    bool DecodeParallel(const uint8* Buffer, int64 Length, const FTIFFChunkLayout& Layout, int32 MaxParts, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(STAT_FTIFFHelpers_DecodeParallel);
+
+        if (Layout.Layout == ETIFFLayout::RGBA || Layout.NumChunks == 0)
+        {
+            OutError = TEXT("Failed to decode TIFF: the sample layout needs the RGBA interface");
+            return false;
+        }
+
+        // only the chunk rows that overlap the region are split between the parts
+        const int32 NumAllChunks = int32(FMath::Min<uint32>(Layout.NumChunks, MAX_int32));
+        const int32 RegionFirstChunk = FMath::Min<int32>(uint32(Layout.Region.Min.Y) / Layout.ChunkHeight * Layout.ChunksAcross, NumAllChunks);
+        const int32 RegionEndChunk = FMath::Min<int32>(FMath::DivideAndRoundUp(uint32(Layout.Region.Max.Y), Layout.ChunkHeight) * Layout.ChunksAcross, NumAllChunks);
+        const int32 NumChunks = RegionEndChunk - RegionFirstChunk;
+        if (NumChunks <= 0)
+        {
+            OutError = TEXT("Failed to decode TIFF: the region is outside of the image");
+            return false;
+        }
+
+        const int32 ChunksPerPart = FMath::DivideAndRoundUp(NumChunks, FMath::Clamp(MaxParts, 1, NumChunks));
+        const int32 NumParts = FMath::DivideAndRoundUp(NumChunks, ChunksPerPart);
+
+        InitImage(Layout, OutImage);
+
+        TArray<FString> PartErrors;
+        PartErrors.SetNum(NumParts);
+
+        // libtiff handles hold the codec state, every part opens its own on the shared buffer
+        ParallelFor(NumParts, [&](int32 PartIndex)
+        {
+            FTIFFMemorySource Source = { Buffer, Length, 0 };
+            TIFF* Tiff = OpenMemory(Source);
+            if (!Tiff)
+            {
+                PartErrors[PartIndex] = TEXT("Failed to decode TIFF: invalid header");
+                return;
+            }
+
+            const uint32 FirstChunk = uint32(RegionFirstChunk + PartIndex * ChunksPerPart);
+            const uint32 EndChunk = uint32(RegionFirstChunk + FMath::Min((PartIndex + 1) * ChunksPerPart, NumChunks));
+            DecodeChunks(Tiff, Layout, FirstChunk, EndChunk, OutImage, PartErrors[PartIndex]);
+
+            TIFFClose(Tiff);
+        });
+
+        for (const FString& PartError : PartErrors)
+        {
+            if (!PartError.IsEmpty())
+            {
+                OutError = PartError;
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+#endif // RUNTIMEIMAGELOADER_WITH_LIBTIFF
@@ -0,0 +1,64 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RuntimeImageData.h"
+
+#if RUNTIMEIMAGELOADER_WITH_LIBTIFF
+
+typedef struct tiff TIFF;
+
+/**
+ * Strip and tile decoding shared by the streaming TIFF decoder and the in-memory TIFF decoder.
+ * Layouts that map directly to a texture format are converted chunk by chunk, which lets independent
+ * ranges of strips or tiles be decoded on several threads, every thread reading through its own libtiff handle.
+ */
+namespace FTIFFHelpers
+{
+    enum class ETIFFLayout : uint8
+    {
+        Gray8,
+        Gray16,
+        Color8,
+        Color16,
+        Float32,
+        // palettes, YCbCr, CMYK, bit packed and planar images go through libtiff's RGBA interface
+        RGBA
+    };
+
+    struct FTIFFChunkLayout
+    {
+        int32 Width = 0;
+        int32 Height = 0;
+        ETIFFLayout Layout = ETIFFLayout::RGBA;
+        uint16 SamplesPerPixel = 1;
+
+        /** Strips, or tiles for tiled images, of the first image */
+        uint32 NumChunks = 0;
+
+        /** Rows covered by one strip or tile, and the number of chunks side by side */
+        uint32 ChunkHeight = 1;
+        uint32 ChunksAcross = 1;
+
+        /** Part of the image to decode, the whole image unless it is narrowed by the caller */
+        FIntRect Region;
+    };
+
+    /** Reads the layout of the current directory, fails for invalid dimensions */
+    bool GetChunkLayout(TIFF* Tiff, FTIFFChunkLayout& OutLayout, FString& OutError);
+
+    /** Allocates the region in the texture format the layout converts to, not valid for the RGBA layout */
+    void InitImage(const FTIFFChunkLayout& Layout, FRuntimeImageData& OutImage);
+
+    /** Decodes the parts of the strips or tiles in [FirstChunk, EndChunk) that overlap the region into the image allocated by InitImage */
+    bool DecodeChunks(TIFF* Tiff, const FTIFFChunkLayout& Layout, uint32 FirstChunk, uint32 EndChunk, FRuntimeImageData& Image, FString& OutError);
+
+    /** Reads the chunk layout of the first image of a TIFF held in memory */
+    bool ParseChunkLayout(const uint8* Buffer, int64 Length, FTIFFChunkLayout& OutLayout, FString& OutError);
+
+    /** Decodes the region of the first image of a TIFF held in memory with its chunks split into up to MaxParts parallel parts */
+    bool DecodeParallel(const uint8* Buffer, int64 Length, const FTIFFChunkLayout& Layout, int32 MaxParts, FRuntimeImageData& OutImage, FString& OutError);
+}
+
+#endif // RUNTIMEIMAGELOADER_WITH_LIBTIFF
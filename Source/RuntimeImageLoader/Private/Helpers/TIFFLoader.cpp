@@ -1,12 +1,14 @@
 // Copyright 2023 Petr Leontev. All Rights Reserved.
 
 #include "TIFFLoader.h"
+#include "PixelKernels.h"
 
 DEFINE_LOG_CATEGORY_STATIC(LogRuntimeImageLoaderTIFFLoader, Log, All);
 
 #if WITH_FREEIMAGE_LIB
 
 #include "Misc/Paths.h"
+#include "Async/ParallelFor.h"
 
 #if PLATFORM_WINDOWS
 #include "Windows/AllowWindowsPlatformTypes.h"
@@ -21,9 +23,11 @@ class FFreeImageWrapper
 public:
 	static bool IsValid() { return FreeImageDllHandle != nullptr; }
 
-	static void FreeImage_Initialise(bool bLoadLocalPluginsOnly); // Loads and inits FreeImage on first call
+	static void FreeImage_Initialise(bool bLoadLocalPluginsOnly); // Loads and inits FreeImage on first call, safe to call from any thread
 
 private:
+	static void LoadAndInitialise(bool bLoadLocalPluginsOnly);
+
 	static void* FreeImageDllHandle; // Lazy init on first use, never release for now
 };
 
@@ -31,19 +35,18 @@ void* FFreeImageWrapper::FreeImageDllHandle = nullptr;
 
 void FFreeImageWrapper::FreeImage_Initialise(bool bLoadLocalPluginsOnly)
 {
-	if (FreeImageDllHandle != nullptr)
-	{
-		return;
-	}
+	// function local statics are initialized exactly once, other threads wait until it's done
+	static const bool bInitialised = (LoadAndInitialise(bLoadLocalPluginsOnly), true);
+	(void)bInitialised;
+}
 
-	if (FreeImageDllHandle == nullptr)
-	{
-		FString FreeImageDir = FPaths::Combine(FPaths::EngineDir(), TEXT("Binaries/ThirdParty/FreeImage"), FPlatformProcess::GetBinariesSubdirectory());
-		FString FreeImageLibDir = FPaths::Combine( FreeImageDir, TEXT(FREEIMAGE_LIB_FILENAME));
-		FPlatformProcess::PushDllDirectory(*FreeImageDir);
-		FreeImageDllHandle = FPlatformProcess::GetDllHandle(*FreeImageLibDir);
-		FPlatformProcess::PopDllDirectory(*FreeImageDir);
-	}
+void FFreeImageWrapper::LoadAndInitialise(bool bLoadLocalPluginsOnly)
+{
+	FString FreeImageDir = FPaths::Combine(FPaths::EngineDir(), TEXT("Binaries/ThirdParty/FreeImage"), FPlatformProcess::GetBinariesSubdirectory());
+	FString FreeImageLibDir = FPaths::Combine( FreeImageDir, TEXT(FREEIMAGE_LIB_FILENAME));
+	FPlatformProcess::PushDllDirectory(*FreeImageDir);
+	FreeImageDllHandle = FPlatformProcess::GetDllHandle(*FreeImageLibDir);
+	FPlatformProcess::PopDllDirectory(*FreeImageDir);
 
 	if (FreeImageDllHandle)
 	{
@@ -178,7 +181,7 @@ bool FRuntimeTiffLoadHelper::Load(const uint8 * Buffer, uint32 Length)
 	if (bIsSourceFloatingPoint)
 	{
 		// Floating point images converted to RGBA16F
-		RawData.SetNumUninitialized(Height * Width * 4 * sizeof(FFloat16));
+		RawData.SetNumUninitialized(int64(Height) * Width * 4 * sizeof(FFloat16));
 
 		TextureSourceFormat = TSF_RGBA16F;
 		CompressionSettings = TC_HDR_Compressed;
@@ -189,20 +192,13 @@ bool FRuntimeTiffLoadHelper::Load(const uint8 * Buffer, uint32 Length)
 		{
 			BYTE* Bits = FreeImage_GetBits(ConvertedBitmap);
 			int32 Pitch = FreeImage_GetPitch(ConvertedBitmap);
-			for (int Y = 0; Y < Height; Y++)
+			ParallelFor(Height, [this, Bits, Pitch](int32 Y)
 			{
-				BYTE* ScanLine = Bits + Pitch * Y;
-				FIRGBAF* Pixels = (FIRGBAF*)ScanLine;
-				for (int X = 0; X < Width; X++)
-				{
-					FIRGBAF P = Pixels[X];
-					FFloat16* TargetPixel = ((FFloat16*)RawData.GetData()) + (X + Y * Width) * 4;
-					TargetPixel[0].Set(P.red);
-					TargetPixel[1].Set(P.green);
-					TargetPixel[2].Set(P.blue);
-					TargetPixel[3].Set(P.alpha);
-				}
-			}
+				BYTE* ScanLine = Bits + int64(Pitch) * Y;
+				uint16* TargetScanLine = ((uint16*)RawData.GetData()) + int64(Y) * Width * 4;
+				// FIRGBAF is laid out as RGBA floats
+				FPixelKernels::FloatToHalf((const float*)ScanLine, TargetScanLine, int64(Width) * 4);
+			});
 
 			FreeImage_Unload(ConvertedBitmap);
 		}
@@ -214,8 +210,9 @@ bool FRuntimeTiffLoadHelper::Load(const uint8 * Buffer, uint32 Length)
 		{
 			ConvertToRGBA16();
 		}
+		else
 		{
-			RawData.SetNumUninitialized(Height * Width * 4);
+			RawData.SetNumUninitialized(int64(Height) * Width);
 
 			TextureSourceFormat = TSF_G8;
 			CompressionSettings = TC_Grayscale;
@@ -235,16 +232,12 @@ bool FRuntimeTiffLoadHelper::Load(const uint8 * Buffer, uint32 Length)
 
 				BYTE* Bits = FreeImage_GetBits(ConvertedBitmap);
 				int32 Pitch = FreeImage_GetPitch(ConvertedBitmap);
-				for (int Y = 0; Y < Height; Y++)
+				ParallelFor(Height, [this, Bits, Pitch](int32 Y)
 				{
-					BYTE* ScanLine = Bits + Pitch * Y;
-					uint8* TargetPixels = ((uint8*)RawData.GetData()) + Y * Width;
-					for (int X = 0; X < Width; X++)
-					{
-						uint8 P = ScanLine[X];
-						TargetPixels[X] = P;
-					}
-				}
+					BYTE* ScanLine = Bits + int64(Pitch) * Y;
+					uint8* TargetPixels = ((uint8*)RawData.GetData()) + int64(Y) * Width;
+					FMemory::Memcpy(TargetPixels, ScanLine, Width);
+				});
 				FreeImage_Unload(ConvertedBitmap);
 			}
 		}
@@ -259,7 +252,7 @@ bool FRuntimeTiffLoadHelper::Load(const uint8 * Buffer, uint32 Length)
 		{
 			// Convert to RGBA(8-bit)
 
-			RawData.SetNumUninitialized(Height * Width * 4);
+			RawData.SetNumUninitialized(int64(Height) * Width * 4);
 
 			TextureSourceFormat = TSF_BGRA8;
 			CompressionSettings = TC_Default;
@@ -271,20 +264,17 @@ bool FRuntimeTiffLoadHelper::Load(const uint8 * Buffer, uint32 Length)
 
 				BYTE* Bits = FreeImage_GetBits(ConvertedBitmap);
 				int32 Pitch = FreeImage_GetPitch(ConvertedBitmap);
-				for (int Y = 0; Y < Height; Y++)
+				ParallelFor(Height, [this, Bits, Pitch](int32 Y)
 				{
-					BYTE* ScanLine = Bits + Pitch * Y;
-					for (int X = 0; X < Width; X++)
-					{
-						uint8* P = ScanLine + X * 4;
-						uint8* TargetPixel = ((uint8*)RawData.GetData()) + (X + Y * Width) * 4;
-						// FI_RGBA_X - cross-platform way to retrieve channels
-						TargetPixel[0] = P[FI_RGBA_BLUE];
-						TargetPixel[1] = P[FI_RGBA_GREEN];
-						TargetPixel[2] = P[FI_RGBA_RED];
-						TargetPixel[3] = P[FI_RGBA_ALPHA];
-					}
-				}
+					BYTE* ScanLine = Bits + int64(Pitch) * Y;
+					uint8* TargetScanLine = ((uint8*)RawData.GetData()) + int64(Y) * Width * 4;
+					// FI_RGBA_X - cross-platform way to retrieve channels, FreeImage stores BGRA on little endian and RGBA on big endian
+#if FI_RGBA_BLUE == 0 && FI_RGBA_RED == 2
+					FMemory::Memcpy(TargetScanLine, ScanLine, int64(Width) * 4);
+#else
+					FPixelKernels::RGBAToBGRA(ScanLine, TargetScanLine, Width);
+#endif
+				});
 
 				FreeImage_Unload(ConvertedBitmap);
 			}
@@ -296,7 +286,7 @@ bool FRuntimeTiffLoadHelper::Load(const uint8 * Buffer, uint32 Length)
 
 bool FRuntimeTiffLoadHelper::ConvertToRGBA16()
 {
-	RawData.SetNumUninitialized(Height * Width * 4 * 2);
+	RawData.SetNumUninitialized(int64(Height) * Width * 4 * sizeof(uint16));
 
 	TextureSourceFormat = TSF_RGBA16;
 	CompressionSettings = TC_Default;
@@ -307,21 +297,13 @@ bool FRuntimeTiffLoadHelper::ConvertToRGBA16()
 	{
 		BYTE* Bits = FreeImage_GetBits(ConvertedBitmap);
 		int32 Pitch = FreeImage_GetPitch(ConvertedBitmap);
-		for (int Y = 0; Y < Height; Y++)
+		ParallelFor(Height, [this, Bits, Pitch](int32 Y)
 		{
-			BYTE* ScanLine = Bits + Pitch * Y;
-			FIRGBA16* Pixels = (FIRGBA16*)ScanLine;
-			uint16* TargetScanLine = ((uint16*)RawData.GetData()) + Y * Width * 4;
-			for (int X = 0; X < Width; X++)
-			{
-				FIRGBA16 P = Pixels[X];
-				uint16* TargetPixel = TargetScanLine + X * 4;
-				TargetPixel[0] = P.red;
-				TargetPixel[1] = P.green;
-				TargetPixel[2] = P.blue;
-				TargetPixel[3] = P.alpha;
-			}
-		}
+			BYTE* ScanLine = Bits + int64(Pitch) * Y;
+			uint16* TargetScanLine = ((uint16*)RawData.GetData()) + int64(Y) * Width * 4;
+			// FIRGBA16 is already laid out as RGBA16
+			FMemory::Memcpy(TargetScanLine, ScanLine, int64(Width) * 4 * sizeof(uint16));
+		});
 
 		FreeImage_Unload(ConvertedBitmap);
 		return true;
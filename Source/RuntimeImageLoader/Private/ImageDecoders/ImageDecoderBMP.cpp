@@ -0,0 +1,57 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageDecoderBMP.h"
+#include "IImageWrapper.h"
+#include "Stats/Stats.h"
+
+#include "RuntimeImageUtils.h"
+#include "Helpers/ImageWrapperPool.h"
+
+
+bool FImageDecoderBMP::CanDecode(const uint8* Buffer, int64 Length) const
+{
+    return Length >= 2 && Buffer[0] == 'B' && Buffer[1] == 'M';
+}
+
+bool FImageDecoderBMP::Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDecoderBMP_Decode);
+
+    using namespace FRuntimeImageUtils;
+
+    FImageWrapperPool::FScopedImageWrapper BmpImageWrapper(EImageFormat::BMP);
+    if (!BmpImageWrapper.SetCompressed(Buffer, Length))
+    {
+        OutError = TEXT("Failed to decode BMP. The image is corrupted!");
+        return false;
+    }
+
+    // Check the resolution of the imported texture to ensure validity
+    if (!IsImportResolutionValid(BmpImageWrapper->GetWidth(), BmpImageWrapper->GetHeight(), true))
+    {
+        OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), BmpImageWrapper->GetWidth(), BmpImageWrapper->GetHeight());
+        return false;
+    }
+
+    TArray64<uint8> RawBMP;
+    if (BmpImageWrapper->GetRaw(BmpImageWrapper->GetFormat(), BmpImageWrapper->GetBitDepth(), RawBMP))
+    {
+        // Set texture properties.
+        OutImage.Init2D(
+            BmpImageWrapper->GetWidth(),
+            BmpImageWrapper->GetHeight(),
+            TSF_BGRA8,
+            MoveTemp(RawBMP)
+        );
+
+        OutImage.SRGB = true;
+        OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+    }
+    else
+    {
+        OutError = FString::Printf(TEXT("Failed to decode BMP. Bit depth: %d"), BmpImageWrapper->GetBitDepth());
+        return false;
+    }
+
+    return true;
+}
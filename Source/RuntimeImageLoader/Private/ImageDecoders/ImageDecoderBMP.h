@@ -0,0 +1,14 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageDecoders/IRuntimeImageDecoder.h"
+
+class FImageDecoderBMP : public IRuntimeImageDecoder
+{
+public:
+    virtual FName GetName() const override { return TEXT("BMP"); }
+    virtual bool CanDecode(const uint8* Buffer, int64 Length) const override;
+    virtual bool Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError) override;
+};
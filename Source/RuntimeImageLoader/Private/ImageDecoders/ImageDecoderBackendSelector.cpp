@@ -0,0 +1,326 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageDecoderBackendSelector.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Stats/Stats.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogImageDecoderBackendSelector, Log, All);
+
+
+static TAutoConsoleVariable<int32> CVarDecoderBackend(
+    TEXT("RuntimeImageLoader.DecoderBackend"), 0,
+    TEXT("Decoder used for PNG, JPEG, BMP, TGA and HDR images.\n")
+    TEXT(" 0: the faster one on this machine, measured on the first loads of every format (default)\n")
+    TEXT(" 1: engine ImageWrapper\n")
+    TEXT(" 2: stb_image"));
+
+static TAutoConsoleVariable<int32> CVarDecoderBackendCalibrationSamples(
+    TEXT("RuntimeImageLoader.DecoderBackend.CalibrationSamples"), 3,
+    TEXT("Number of loads decoded by every backend before the faster one is chosen for a format."));
+
+// images this small are decoded in microseconds and mostly measure call overhead
+static constexpr int64 MinCalibrationPixels = 256 * 256;
+
+static const TCHAR* GetBackendName(EImageDecoderBackend Backend)
+{
+    return Backend == EImageDecoderBackend::Stb ? TEXT("stb_image") : TEXT("ImageWrapper");
+}
+
+//
+// Selectors and choices cached across sessions, the cache is only valid for the CPU it was measured on
+//
+namespace FImageDecoderBackendCache
+{
+    static FCriticalSection& GetLock()
+    {
+        static FCriticalSection Lock;
+        return Lock;
+    }
+
+    static TArray<FImageDecoderBackendSelector*>& GetSelectors()
+    {
+        static TArray<FImageDecoderBackendSelector*> Selectors;
+        return Selectors;
+    }
+
+    static FString GetCacheFilename()
+    {
+        return FPaths::ProjectSavedDir() / TEXT("RuntimeImageLoader") / TEXT("DecoderBackends.txt");
+    }
+
+    static TMap<FName, EImageDecoderBackend>& GetChoices()
+    {
+        static TMap<FName, EImageDecoderBackend> Choices;
+        static bool bIsLoaded = false;
+
+        if (!bIsLoaded)
+        {
+            bIsLoaded = true;
+
+            TArray<FString> Lines;
+            if (FFileHelper::LoadFileToStringArray(Lines, *GetCacheFilename()) && Lines.Num() > 0 && Lines[0] == FPlatformMisc::GetCPUBrand().TrimStartAndEnd())
+            {
+                for (int32 LineIndex = 1; LineIndex < Lines.Num(); ++LineIndex)
+                {
+                    FString FormatName, BackendName;
+                    if (Lines[LineIndex].Split(TEXT("="), &FormatName, &BackendName))
+                    {
+                        Choices.Add(*FormatName, BackendName == GetBackendName(EImageDecoderBackend::Stb) ? EImageDecoderBackend::Stb : EImageDecoderBackend::ImageWrapper);
+                    }
+                }
+            }
+        }
+
+        return Choices;
+    }
+
+    static void SaveChoice(FName FormatName, EImageDecoderBackend Backend)
+    {
+        FScopeLock Lock(&GetLock());
+
+        TMap<FName, EImageDecoderBackend>& Choices = GetChoices();
+        Choices.Add(FormatName, Backend);
+
+        TArray<FString> Lines;
+        Lines.Add(FPlatformMisc::GetCPUBrand().TrimStartAndEnd());
+        for (const TPair<FName, EImageDecoderBackend>& Choice : Choices)
+        {
+            Lines.Add(FString::Printf(TEXT("%s=%s"), *Choice.Key.ToString(), GetBackendName(Choice.Value)));
+        }
+
+        FFileHelper::SaveStringArrayToFile(Lines, *GetCacheFilename());
+    }
+
+    static TOptional<EImageDecoderBackend> FindChoice(FName FormatName)
+    {
+        FScopeLock Lock(&GetLock());
+
+        const EImageDecoderBackend* Choice = GetChoices().Find(FormatName);
+        return Choice ? TOptional<EImageDecoderBackend>(*Choice) : TOptional<EImageDecoderBackend>();
+    }
+}
+
+FImageDecoderBackendSelector::FImageDecoderBackendSelector(FRuntimeImageDecoderRef InImageWrapperDecoder, FRuntimeImageDecoderRef InStbDecoder)
+    : Backends{ InImageWrapperDecoder, InStbDecoder }
+{
+    ChosenBackend = FImageDecoderBackendCache::FindChoice(GetName());
+
+    FScopeLock Lock(&FImageDecoderBackendCache::GetLock());
+    FImageDecoderBackendCache::GetSelectors().Add(this);
+}
+
+FImageDecoderBackendSelector::~FImageDecoderBackendSelector()
+{
+    FScopeLock Lock(&FImageDecoderBackendCache::GetLock());
+    FImageDecoderBackendCache::GetSelectors().Remove(this);
+}
+
+TArray<FImageDecoderBackendSelector*> FImageDecoderBackendSelector::GetAllSelectors()
+{
+    FScopeLock Lock(&FImageDecoderBackendCache::GetLock());
+    return FImageDecoderBackendCache::GetSelectors();
+}
+
+bool FImageDecoderBackendSelector::Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError)
+{
+    return DecodeWithOptions(Buffer, Length, FRuntimeImageDecodeOptions(), OutImage, OutError);
+}
+
+bool FImageDecoderBackendSelector::DecodeWithOptions(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError)
+{
+    // the engine backend may decode a downscaled image directly, that is not comparable with a full decode
+    if (Options.MinScale < 1.0f && CVarDecoderBackend.GetValueOnAnyThread() != 2)
+    {
+        return Backends[(int32)EImageDecoderBackend::ImageWrapper]->DecodeWithOptions(Buffer, Length, Options, OutImage, OutError);
+    }
+
+    bool bRecordSample = false;
+    const EImageDecoderBackend Backend = SelectBackend(bRecordSample);
+
+    const uint64 StartCycles = FPlatformTime::Cycles64();
+    if (Backends[(int32)Backend]->DecodeWithOptions(Buffer, Length, Options, OutImage, OutError))
+    {
+        if (bRecordSample)
+        {
+            RecordSample(Backend, FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles), int64(OutImage.SizeX) * OutImage.SizeY);
+        }
+        return true;
+    }
+
+    // stb_image lacks some variants the engine handles, such as 12-bit JPEGs
+    if (Backend == EImageDecoderBackend::Stb)
+    {
+        OutError.Reset();
+        return Backends[(int32)EImageDecoderBackend::ImageWrapper]->DecodeWithOptions(Buffer, Length, Options, OutImage, OutError);
+    }
+
+    return false;
+}
+
+EImageDecoderBackend FImageDecoderBackendSelector::SelectBackend(bool& bOutRecordSample)
+{
+    bOutRecordSample = false;
+
+    switch (CVarDecoderBackend.GetValueOnAnyThread())
+    {
+        case 1: return EImageDecoderBackend::ImageWrapper;
+        case 2: return EImageDecoderBackend::Stb;
+        default: break;
+    }
+
+    FScopeLock Lock(&CalibrationLock);
+
+    if (ChosenBackend.IsSet())
+    {
+        return ChosenBackend.GetValue();
+    }
+
+    // backends take turns until every one has enough samples
+    bOutRecordSample = true;
+    return NumSamples[(int32)EImageDecoderBackend::Stb] < NumSamples[(int32)EImageDecoderBackend::ImageWrapper] ? EImageDecoderBackend::Stb : EImageDecoderBackend::ImageWrapper;
+}
+
+void FImageDecoderBackendSelector::RecordSample(EImageDecoderBackend Backend, double Seconds, int64 NumPixels)
+{
+    if (NumPixels < MinCalibrationPixels)
+    {
+        return;
+    }
+
+    TOptional<EImageDecoderBackend> FasterBackend;
+    {
+        FScopeLock Lock(&CalibrationLock);
+
+        if (ChosenBackend.IsSet())
+        {
+            return;
+        }
+
+        // running average of the time per megapixel
+        const int32 BackendIndex = (int32)Backend;
+        ++NumSamples[BackendIndex];
+        SecondsPerMegapixel[BackendIndex] += (Seconds * 1000000.0 / NumPixels - SecondsPerMegapixel[BackendIndex]) / NumSamples[BackendIndex];
+
+        const int32 RequiredSamples = FMath::Max(CVarDecoderBackendCalibrationSamples.GetValueOnAnyThread(), 1);
+        if (NumSamples[(int32)EImageDecoderBackend::ImageWrapper] >= RequiredSamples && NumSamples[(int32)EImageDecoderBackend::Stb] >= RequiredSamples)
+        {
+            FasterBackend = SecondsPerMegapixel[(int32)EImageDecoderBackend::Stb] < SecondsPerMegapixel[(int32)EImageDecoderBackend::ImageWrapper]
+                ? EImageDecoderBackend::Stb : EImageDecoderBackend::ImageWrapper;
+        }
+    }
+
+    if (FasterBackend.IsSet())
+    {
+        ChooseBackend(FasterBackend.GetValue());
+    }
+}
+
+void FImageDecoderBackendSelector::ChooseBackend(EImageDecoderBackend Backend)
+{
+    {
+        FScopeLock Lock(&CalibrationLock);
+        ChosenBackend = Backend;
+    }
+
+    UE_LOG(LogImageDecoderBackendSelector, Log, TEXT("%s images are decoded with %s (ImageWrapper %.2f ms/MP, stb_image %.2f ms/MP)"),
+        *GetName().ToString(), GetBackendName(Backend),
+        SecondsPerMegapixel[(int32)EImageDecoderBackend::ImageWrapper] * 1000.0, SecondsPerMegapixel[(int32)EImageDecoderBackend::Stb] * 1000.0);
+
+    FImageDecoderBackendCache::SaveChoice(GetName(), Backend);
+}
+
+bool FImageDecoderBackendSelector::Calibrate(const uint8* Buffer, int64 Length, int32 NumIterations)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDecoderBackendSelector_Calibrate);
+
+    double BestSecondsPerMegapixel[(int32)EImageDecoderBackend::Num];
+
+    for (int32 BackendIndex = 0; BackendIndex < (int32)EImageDecoderBackend::Num; ++BackendIndex)
+    {
+        BestSecondsPerMegapixel[BackendIndex] = TNumericLimits<double>::Max();
+
+        for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+        {
+            FRuntimeImageData ImageData;
+            FString Error;
+
+            const uint64 StartCycles = FPlatformTime::Cycles64();
+            if (!Backends[BackendIndex]->Decode(Buffer, Length, ImageData, Error))
+            {
+                UE_LOG(LogImageDecoderBackendSelector, Warning, TEXT("%s can't decode the calibration image: %s"), GetBackendName((EImageDecoderBackend)BackendIndex), *Error);
+                return false;
+            }
+            const double Seconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+
+            BestSecondsPerMegapixel[BackendIndex] = FMath::Min(BestSecondsPerMegapixel[BackendIndex], Seconds * 1000000.0 / FMath::Max<int64>(int64(ImageData.SizeX) * ImageData.SizeY, 1));
+        }
+    }
+
+    {
+        FScopeLock Lock(&CalibrationLock);
+        for (int32 BackendIndex = 0; BackendIndex < (int32)EImageDecoderBackend::Num; ++BackendIndex)
+        {
+            NumSamples[BackendIndex] = NumIterations;
+            SecondsPerMegapixel[BackendIndex] = BestSecondsPerMegapixel[BackendIndex];
+        }
+    }
+
+    ChooseBackend(BestSecondsPerMegapixel[(int32)EImageDecoderBackend::Stb] < BestSecondsPerMegapixel[(int32)EImageDecoderBackend::ImageWrapper]
+        ? EImageDecoderBackend::Stb : EImageDecoderBackend::ImageWrapper);
+
+    return true;
+}
+
+//
+// RuntimeImageLoader.CalibrateDecoderBackends [Iterations] [ImageFile...]
+// Measures both backends on the given images and stores the choice for their formats, lists the current choices without files
+//
+static void CalibrateDecoderBackends(const TArray<FString>& Args)
+{
+    int32 FirstFileArg = 0;
+    int32 NumIterations = 5;
+    if (Args.Num() > 0 && Args[0].IsNumeric())
+    {
+        NumIterations = FMath::Max(FCString::Atoi(*Args[0]), 1);
+        FirstFileArg = 1;
+    }
+
+    for (int32 ArgIndex = FirstFileArg; ArgIndex < Args.Num(); ++ArgIndex)
+    {
+        TArray<uint8> ImageBytes;
+        if (!FFileHelper::LoadFileToArray(ImageBytes, *Args[ArgIndex]))
+        {
+            UE_LOG(LogImageDecoderBackendSelector, Warning, TEXT("Failed to read %s"), *Args[ArgIndex]);
+            continue;
+        }
+
+        FRuntimeImageDecoderPtr Decoder = FRuntimeImageDecoderRegistry::Get().FindDecoder(ImageBytes.GetData(), ImageBytes.Num());
+        FImageDecoderBackendSelector* const* Selector = Decoder.IsValid()
+            ? FImageDecoderBackendSelector::GetAllSelectors().FindByPredicate([&Decoder](FImageDecoderBackendSelector* Candidate) { return Candidate == Decoder.Get(); })
+            : nullptr;
+
+        if (Selector == nullptr)
+        {
+            UE_LOG(LogImageDecoderBackendSelector, Display, TEXT("%s: the format has a single decoder"), *FPaths::GetCleanFilename(Args[ArgIndex]));
+            continue;
+        }
+
+        (*Selector)->Calibrate(ImageBytes.GetData(), ImageBytes.Num(), NumIterations);
+    }
+
+    for (FImageDecoderBackendSelector* Selector : FImageDecoderBackendSelector::GetAllSelectors())
+    {
+        const TOptional<EImageDecoderBackend> Choice = FImageDecoderBackendCache::FindChoice(Selector->GetName());
+        UE_LOG(LogImageDecoderBackendSelector, Display, TEXT("  %-6s %s"), *Selector->GetName().ToString(), Choice.IsSet() ? GetBackendName(Choice.GetValue()) : TEXT("not calibrated yet"));
+    }
+}
+
+static FAutoConsoleCommand CalibrateDecoderBackendsCommand(
+    TEXT("RuntimeImageLoader.CalibrateDecoderBackends"),
+    TEXT("Picks the faster of ImageWrapper and stb_image for the formats of the given images. Usage: RuntimeImageLoader.CalibrateDecoderBackends [Iterations] [ImageFile...]"),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&CalibrateDecoderBackends));
@@ -0,0 +1,52 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageDecoders/RuntimeImageDecoderRegistry.h"
+
+enum class EImageDecoderBackend : uint8
+{
+    ImageWrapper,
+    Stb,
+    Num
+};
+
+/**
+ * Decodes one format with either the engine decoder or stb_image, whichever is faster on the running machine.
+ * Until the choice is made the backends take turns on real loads and their decode time per megapixel is recorded,
+ * the winner is cached in Saved/RuntimeImageLoader so later sessions on the same CPU use it right away.
+ */
+class FImageDecoderBackendSelector : public IRuntimeImageDecoder
+{
+public:
+    FImageDecoderBackendSelector(FRuntimeImageDecoderRef InImageWrapperDecoder, FRuntimeImageDecoderRef InStbDecoder);
+    virtual ~FImageDecoderBackendSelector();
+
+    virtual FName GetName() const override { return Backends[(int32)EImageDecoderBackend::ImageWrapper]->GetName(); }
+    virtual bool CanDecode(const uint8* Buffer, int64 Length) const override { return Backends[(int32)EImageDecoderBackend::ImageWrapper]->CanDecode(Buffer, Length); }
+    virtual int32 GetPriority() const override { return Backends[(int32)EImageDecoderBackend::ImageWrapper]->GetPriority(); }
+
+    virtual bool Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError) override;
+    virtual bool DecodeWithOptions(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError) override;
+    /** Previews are decoded by the engine backend only, stb_image has no access to the passes */
+    virtual bool DecodePreview(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError) override { return Backends[(int32)EImageDecoderBackend::ImageWrapper]->DecodePreview(Buffer, Length, OutImage, OutError); }
+
+    /** Decodes the image with every backend and picks the faster one, used by RuntimeImageLoader.CalibrateDecoderBackends */
+    bool Calibrate(const uint8* Buffer, int64 Length, int32 NumIterations);
+
+    /** Selectors of all formats, for the calibration command */
+    static TArray<FImageDecoderBackendSelector*> GetAllSelectors();
+
+private:
+    EImageDecoderBackend SelectBackend(bool& bOutRecordSample);
+    void RecordSample(EImageDecoderBackend Backend, double Seconds, int64 NumPixels);
+    void ChooseBackend(EImageDecoderBackend Backend);
+
+    FRuntimeImageDecoderRef Backends[(int32)EImageDecoderBackend::Num];
+
+    FCriticalSection CalibrationLock;
+    int32 NumSamples[(int32)EImageDecoderBackend::Num] = {};
+    double SecondsPerMegapixel[(int32)EImageDecoderBackend::Num] = {};
+    TOptional<EImageDecoderBackend> ChosenBackend;
+};
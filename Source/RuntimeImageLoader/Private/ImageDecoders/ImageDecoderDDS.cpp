@@ -0,0 +1,21 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageDecoderDDS.h"
+
+#include "Helpers/BlockCompressedHelpers.h"
+
+
+bool FImageDecoderDDS::CanDecode(const uint8* Buffer, int64 Length) const
+{
+    return FBlockCompressedHelpers::IsDDS(Buffer, Length);
+}
+
+bool FImageDecoderDDS::Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError)
+{
+    return DecodeWithOptions(Buffer, Length, FRuntimeImageDecodeOptions(), OutImage, OutError);
+}
+
+bool FImageDecoderDDS::DecodeWithOptions(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError)
+{
+    return FBlockCompressedHelpers::DecodeDDS(Buffer, Length, Options, OutImage, OutError);
+}
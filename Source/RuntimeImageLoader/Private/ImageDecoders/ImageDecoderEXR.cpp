@@ -0,0 +1,87 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageDecoderEXR.h"
+#include "IImageWrapper.h"
+#include "Stats/Stats.h"
+
+#include "RuntimeImageUtils.h"
+#include "Helpers/ImageWrapperPool.h"
+
+#include "Helpers/EXRHelpers.h"
+
+
+bool FImageDecoderEXR::CanDecode(const uint8* Buffer, int64 Length) const
+{
+    return Length >= 4 && Buffer[0] == 0x76 && Buffer[1] == 0x2F && Buffer[2] == 0x31 && Buffer[3] == 0x01;
+}
+
+bool FImageDecoderEXR::Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError)
+{
+    return DecodeWithOptions(Buffer, Length, FRuntimeImageDecodeOptions(), OutImage, OutError);
+}
+
+bool FImageDecoderEXR::DecodeWithOptions(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDecoderEXR_Decode);
+
+#if RUNTIMEIMAGELOADER_WITH_OPENEXR
+    // OpenEXR decodes on its own thread pool, keeps 32-bit channels and reads any subset of the channels
+    return FEXRHelpers::Decode(Buffer, Length, Options, OutImage, OutError);
+#else
+    using namespace FRuntimeImageUtils;
+
+    FImageWrapperPool::FScopedImageWrapper ExrImageWrapper(EImageFormat::EXR);
+    if (!ExrImageWrapper.SetCompressed(Buffer, Length))
+    {
+        OutError = TEXT("Failed to decode EXR. The image is corrupted!");
+        return false;
+    }
+
+    int32 Width = ExrImageWrapper->GetWidth();
+    int32 Height = ExrImageWrapper->GetHeight();
+
+    if (!IsImportResolutionValid(Width, Height, true))
+    {
+        return false;
+    }
+
+    // Select the texture's source format
+    ETextureSourceFormat TextureFormat = TSF_Invalid;
+    int32 BitDepth = ExrImageWrapper->GetBitDepth();
+    ERGBFormat Format = ExrImageWrapper->GetFormat();
+
+    if (Format == ERGBFormat::RGBA && BitDepth == 16)
+    {
+        TextureFormat = TSF_RGBA16F;
+        Format = ERGBFormat::BGRA;
+    }
+
+    if (TextureFormat == TSF_Invalid)
+    {
+        OutError = TEXT("EXR file contains data in an unsupported format.");
+        return false;
+    }
+
+    TArray64<uint8> RawExr;
+    if (ExrImageWrapper->GetRaw(Format, BitDepth, RawExr))
+    {
+        OutImage.Init2D(
+            Width,
+            Height,
+            TextureFormat,
+            MoveTemp(RawExr)
+        );
+
+        OutImage.SRGB = false;
+        OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+        OutImage.CompressionSettings = TC_HDR;
+    }
+    else
+    {
+        OutError = FString::Printf(TEXT("Failed to decode EXR. Bit depth: %d"), BitDepth);
+        return false;
+    }
+
+    return true;
+#endif
+}
@@ -0,0 +1,17 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageDecoders/IRuntimeImageDecoder.h"
+
+class FImageDecoderEXR : public IRuntimeImageDecoder
+{
+public:
+    virtual FName GetName() const override { return TEXT("EXR"); }
+    virtual bool CanDecode(const uint8* Buffer, int64 Length) const override;
+    virtual bool Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError) override;
+
+    /** Reads the channels listed in the options, ignored when the engine has no OpenEXR for the plugin to link */
+    virtual bool DecodeWithOptions(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError) override;
+};
@@ -0,0 +1,62 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageDecoderHDR.h"
+#include "IImageWrapper.h"
+#include "Stats/Stats.h"
+
+#include "RuntimeImageUtils.h"
+#include "Helpers/ImageWrapperPool.h"
+
+
+bool FImageDecoderHDR::CanDecode(const uint8* Buffer, int64 Length) const
+{
+    // Radiance files start with "#?RADIANCE" or "#?RGBE"
+    return Length >= 2 && Buffer[0] == '#' && Buffer[1] == '?';
+}
+
+bool FImageDecoderHDR::Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDecoderHDR_Decode);
+
+    using namespace FRuntimeImageUtils;
+
+    FImageWrapperPool::FScopedImageWrapper HdrImageWrapper(EImageFormat::HDR);
+    if (!HdrImageWrapper.SetCompressed(Buffer, Length))
+    {
+        OutError = TEXT("Failed to decode HDR. The image is corrupted!");
+        return false;
+    }
+
+    if (!IsImportResolutionValid(HdrImageWrapper->GetWidth(), HdrImageWrapper->GetHeight(), true))
+    {
+        OutError = FString::Printf(TEXT("HDR Texture resolution is not supported: %d x %d"), HdrImageWrapper->GetWidth(), HdrImageWrapper->GetHeight());
+        return false;
+    }
+
+    // Select the texture's source format
+    ETextureSourceFormat TextureFormat = TSF_BGRE8;
+    int32 BitDepth = HdrImageWrapper->GetBitDepth();
+    ERGBFormat Format = HdrImageWrapper->GetFormat();
+
+    TArray64<uint8> RawHDR;
+    if (HdrImageWrapper->GetRaw(ERGBFormat::BGRE, BitDepth, RawHDR))
+    {
+        OutImage.Init2D(
+            HdrImageWrapper->GetWidth(),
+            HdrImageWrapper->GetHeight(),
+            TextureFormat,
+            MoveTemp(RawHDR)
+        );
+
+        OutImage.SRGB = false;
+        OutImage.GammaSpace = EGammaSpace::Linear;
+        OutImage.CompressionSettings = TC_HDR;
+    }
+    else
+    {
+        OutError = TEXT("Failed to load .HDR image. Input image is not valid cubemap texture!");
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,391 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageDecoderJPEG.h"
+#include "IImageWrapper.h"
+#include "Misc/ScopeExit.h"
+#include "HAL/IConsoleManager.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Stats/Stats.h"
+
+#include "RuntimeImageUtils.h"
+#include "Helpers/ImageWrapperPool.h"
+
+#include "Helpers/JPEGParallelDecoder.h"
+
+#if RUNTIMEIMAGELOADER_WITH_LIBJPEGTURBO
+#include <stdio.h>
+#include <setjmp.h>
+
+THIRD_PARTY_INCLUDES_START
+#include "turbojpeg.h"
+#include "jpeglib.h"
+THIRD_PARTY_INCLUDES_END
+
+static TAutoConsoleVariable<bool> CVarJPEGParallelDecode(
+    TEXT("RuntimeImageLoader.JPEG.ParallelDecode"), true,
+    TEXT("Decode JPEGs with restart markers on several threads."));
+
+static TAutoConsoleVariable<float> CVarJPEGParallelDecodeMinMegapixels(
+    TEXT("RuntimeImageLoader.JPEG.ParallelDecodeMinMegapixels"), 4.0f,
+    TEXT("Smaller JPEGs are decoded on the image reader thread only."));
+#endif
+
+
+bool FImageDecoderJPEG::CanDecode(const uint8* Buffer, int64 Length) const
+{
+    return Length >= 3 && Buffer[0] == 0xFF && Buffer[1] == 0xD8 && Buffer[2] == 0xFF;
+}
+
+bool FImageDecoderJPEG::Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDecoderJPEG_Decode);
+
+    using namespace FRuntimeImageUtils;
+    // JPEG can only be 8-bit depth
+
+#if RUNTIMEIMAGELOADER_WITH_LIBJPEGTURBO
+    if (CVarJPEGParallelDecode.GetValueOnAnyThread())
+    {
+        FJPEGParallelDecoder::FRestartLayout RestartLayout;
+        if (FJPEGParallelDecoder::ParseRestartLayout(Buffer, Length, RestartLayout)
+            && int64(RestartLayout.Width) * RestartLayout.Height >= int64(CVarJPEGParallelDecodeMinMegapixels.GetValueOnAnyThread() * 1000000.0f)
+            && IsImportResolutionValid(RestartLayout.Width, RestartLayout.Height, true))
+        {
+            const int32 NumCores = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+            if (FJPEGParallelDecoder::Decode(Buffer, Length, RestartLayout, NumCores, OutImage, OutError))
+            {
+                return true;
+            }
+
+            // the serial decoder reports its own error if the image is really broken
+            OutError.Reset();
+        }
+    }
+#endif
+
+    FImageWrapperPool::FScopedImageWrapper JpegImageWrapper(EImageFormat::JPEG);
+    if (!JpegImageWrapper.SetCompressed(Buffer, Length))
+    {
+        OutError = TEXT("Failed to decode JPEG. The image is corrupted!");
+        return false;
+    }
+
+    if (!IsImportResolutionValid(JpegImageWrapper->GetWidth(), JpegImageWrapper->GetHeight(), true))
+    {
+        OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), JpegImageWrapper->GetWidth(), JpegImageWrapper->GetHeight());
+        return false;
+    }
+
+    // Select the texture's source format
+    ETextureSourceFormat TextureFormat = TSF_Invalid;
+    int32 BitDepth = JpegImageWrapper->GetBitDepth();
+    ERGBFormat Format = JpegImageWrapper->GetFormat();
+
+    if (Format == ERGBFormat::Gray)
+    {
+        if (BitDepth <= 8)
+        {
+            TextureFormat = TSF_G8;
+            Format = ERGBFormat::Gray;
+            BitDepth = 8;
+        }
+    }
+    else if (Format == ERGBFormat::RGBA || Format == ERGBFormat::BGRA)
+    {
+        if (BitDepth <= 8)
+        {
+            TextureFormat = TSF_BGRA8;
+            Format = ERGBFormat::BGRA;
+            BitDepth = 8;
+        }
+    }
+
+    if (TextureFormat == TSF_Invalid)
+    {
+        OutError = FString::Printf(TEXT("JPEG file contains data in an unsupported format. Bit depth: %d"), BitDepth);
+        return false;
+    }
+
+    TArray64<uint8> RawJPEG;
+    if (JpegImageWrapper->GetRaw(Format, BitDepth, RawJPEG))
+    {
+        OutImage.Init2D(
+            JpegImageWrapper->GetWidth(),
+            JpegImageWrapper->GetHeight(),
+            TextureFormat,
+            MoveTemp(RawJPEG)
+        );
+        OutImage.SRGB = true;
+        OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+    }
+    else
+    {
+        OutError = TEXT("Failed to decode JPEG. Please contact devs");
+        return false;
+    }
+
+    return true;
+}
+
+bool FImageDecoderJPEG::DecodeWithOptions(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError)
+{
+#if RUNTIMEIMAGELOADER_WITH_LIBJPEGTURBO
+    if (Options.HasRegion())
+    {
+        return DecodeRegion(Buffer, Length, Options.Region, OutImage, OutError);
+    }
+
+    // 1/2 is the largest reduction the DCT can do, anything above it is a full decode
+    if (Options.MinScale <= 0.5f)
+    {
+        return DecodeScaled(Buffer, Length, Options.MinScale, OutImage, OutError);
+    }
+#endif
+
+    return Decode(Buffer, Length, OutImage, OutError);
+}
+
+#if RUNTIMEIMAGELOADER_WITH_LIBJPEGTURBO
+bool FImageDecoderJPEG::DecodeScaled(const uint8* Buffer, int64 Length, float MinScale, FRuntimeImageData& OutImage, FString& OutError)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDecoderJPEG_DecodeScaled);
+
+    using namespace FRuntimeImageUtils;
+
+    tjhandle Decompressor = tjInitDecompress();
+    if (Decompressor == nullptr)
+    {
+        return Decode(Buffer, Length, OutImage, OutError);
+    }
+    ON_SCOPE_EXIT { tjDestroy(Decompressor); };
+
+    int Width = 0, Height = 0, Subsampling = 0, Colorspace = 0;
+    if (tjDecompressHeader3(Decompressor, Buffer, (unsigned long)Length, &Width, &Height, &Subsampling, &Colorspace) != 0)
+    {
+        OutError = FString::Printf(TEXT("Failed to decode JPEG. The image is corrupted! %s"), UTF8_TO_TCHAR(tjGetErrorStr2(Decompressor)));
+        return false;
+    }
+
+    // CMYK can't be converted to BGRA by TurboJPEG
+    if (Colorspace == TJCS_CMYK || Colorspace == TJCS_YCCK)
+    {
+        return Decode(Buffer, Length, OutImage, OutError);
+    }
+
+    // the smallest power of two reduction that still covers the requested size
+    int32 ScaleDenominator = 2;
+    while (ScaleDenominator < 8 && 1.0f / (ScaleDenominator * 2) >= MinScale)
+    {
+        ScaleDenominator *= 2;
+    }
+
+    const tjscalingfactor ScalingFactor = { 1, ScaleDenominator };
+    const int32 ScaledWidth = TJSCALED(Width, ScalingFactor);
+    const int32 ScaledHeight = TJSCALED(Height, ScalingFactor);
+
+    if (!IsImportResolutionValid(ScaledWidth, ScaledHeight, true))
+    {
+        OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), ScaledWidth, ScaledHeight);
+        return false;
+    }
+
+    const bool bIsGray = Colorspace == TJCS_GRAY;
+    const int PixelFormat = bIsGray ? TJPF_GRAY : TJPF_BGRA;
+
+    TArray64<uint8> RawJPEG;
+    RawJPEG.SetNumUninitialized(int64(ScaledWidth) * ScaledHeight * tjPixelSize[PixelFormat]);
+
+    if (tjDecompress2(Decompressor, Buffer, (unsigned long)Length, RawJPEG.GetData(), ScaledWidth, 0, ScaledHeight, PixelFormat, 0) != 0)
+    {
+        OutError = FString::Printf(TEXT("Failed to decode JPEG. %s"), UTF8_TO_TCHAR(tjGetErrorStr2(Decompressor)));
+        return false;
+    }
+
+    OutImage.Init2D(ScaledWidth, ScaledHeight, bIsGray ? TSF_G8 : TSF_BGRA8, MoveTemp(RawJPEG));
+    OutImage.SourceSizeX = Width;
+    OutImage.SourceSizeY = Height;
+    OutImage.SRGB = true;
+    OutImage.GammaSpace = EGammaSpace::sRGB;
+
+    return true;
+}
+
+struct FJPEGErrorManager
+{
+    jpeg_error_mgr Base;
+    jmp_buf JumpBuffer;
+};
+
+static void JPEGErrorExit(j_common_ptr Info)
+{
+    FJPEGErrorManager* ErrorManager = reinterpret_cast<FJPEGErrorManager*>(Info->err);
+    longjmp(ErrorManager->JumpBuffer, 1);
+}
+
+static void JPEGOutputMessage(j_common_ptr Info)
+{
+}
+#endif // RUNTIMEIMAGELOADER_WITH_LIBJPEGTURBO
+
+#ifdef _MSC_VER
+#pragma warning(push)
+    // no objects with destructors are created between setjmp and the libjpeg calls that may jump back
+#pragma warning(disable : 4611)
+#endif
+
+bool FImageDecoderJPEG::DecodePreview(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError)
+{
+#if RUNTIMEIMAGELOADER_WITH_LIBJPEGTURBO
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDecoderJPEG_DecodePreview);
+
+    // TurboJPEG has no access to single scans, the buffered image mode of the libjpeg API has
+    jpeg_decompress_struct Info;
+    FJPEGErrorManager ErrorManager;
+    Info.err = jpeg_std_error(&ErrorManager.Base);
+    ErrorManager.Base.error_exit = JPEGErrorExit;
+    ErrorManager.Base.output_message = JPEGOutputMessage;
+
+    bool bSuccess = false;
+
+    if (setjmp(ErrorManager.JumpBuffer) == 0)
+    {
+        jpeg_create_decompress(&Info);
+        jpeg_mem_src(&Info, Buffer, (unsigned long)Length);
+        jpeg_read_header(&Info, TRUE);
+
+        // CMYK can't be converted to BGRA, baseline images have no coarse scan to show
+        if (Info.progressive_mode && Info.jpeg_color_space != JCS_CMYK && Info.jpeg_color_space != JCS_YCCK)
+        {
+            const bool bIsGray = Info.jpeg_color_space == JCS_GRAYSCALE;
+            Info.out_color_space = bIsGray ? JCS_GRAYSCALE : JCS_EXT_BGRA;
+            Info.buffered_image = TRUE;
+
+            // the first scan usually carries the DC coefficients only, which is one pixel per block
+            Info.scale_num = 1;
+            Info.scale_denom = 8;
+
+            jpeg_start_decompress(&Info);
+            jpeg_start_output(&Info, Info.input_scan_number);
+
+            OutImage.Init2D(Info.output_width, Info.output_height, bIsGray ? TSF_G8 : TSF_BGRA8);
+
+            const int64 RowBytes = int64(Info.output_width) * Info.output_components;
+            while (Info.output_scanline < Info.output_height)
+            {
+                JSAMPROW Row = OutImage.RawData.GetData() + Info.output_scanline * RowBytes;
+                jpeg_read_scanlines(&Info, &Row, 1);
+            }
+
+            OutImage.SourceSizeX = Info.image_width;
+            OutImage.SourceSizeY = Info.image_height;
+            OutImage.SRGB = true;
+            OutImage.GammaSpace = EGammaSpace::sRGB;
+
+            bSuccess = true;
+        }
+    }
+    else
+    {
+        char Message[JMSG_LENGTH_MAX];
+        ErrorManager.Base.format_message(reinterpret_cast<j_common_ptr>(&Info), Message);
+        OutError = FString::Printf(TEXT("Failed to decode JPEG preview: %s"), ANSI_TO_TCHAR(Message));
+    }
+
+    // the remaining scans are left to the full decode
+    jpeg_destroy_decompress(&Info);
+
+    return bSuccess;
+#else
+    return false;
+#endif
+}
+
+#if RUNTIMEIMAGELOADER_WITH_LIBJPEGTURBO
+bool FImageDecoderJPEG::DecodeRegion(const uint8* Buffer, int64 Length, const FIntRect& RequestedRegion, FRuntimeImageData& OutImage, FString& OutError)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDecoderJPEG_DecodeRegion);
+
+    // TurboJPEG decodes whole images only, cropping and skipping scanlines are part of the libjpeg API
+    jpeg_decompress_struct Info;
+    FJPEGErrorManager ErrorManager;
+    Info.err = jpeg_std_error(&ErrorManager.Base);
+    ErrorManager.Base.error_exit = JPEGErrorExit;
+    ErrorManager.Base.output_message = JPEGOutputMessage;
+
+    TArray64<uint8> ScratchRow;
+    FIntRect Region;
+    bool bIsCMYK = false;
+    bool bSuccess = false;
+
+    if (setjmp(ErrorManager.JumpBuffer) == 0)
+    {
+        jpeg_create_decompress(&Info);
+        jpeg_mem_src(&Info, Buffer, (unsigned long)Length);
+        jpeg_read_header(&Info, TRUE);
+
+        // CMYK can't be converted to BGRA by libjpeg
+        bIsCMYK = Info.jpeg_color_space == JCS_CMYK || Info.jpeg_color_space == JCS_YCCK;
+
+        if (!bIsCMYK
+            && FRuntimeImageUtils::ClipRegion(RequestedRegion, int32(Info.image_width), int32(Info.image_height), Region, OutError)
+            && FRuntimeImageUtils::IsImportResolutionValid(Region.Width(), Region.Height(), true))
+        {
+            const bool bIsGray = Info.jpeg_color_space == JCS_GRAYSCALE;
+            Info.out_color_space = bIsGray ? JCS_GRAYSCALE : JCS_EXT_BGRA;
+
+            jpeg_start_decompress(&Info);
+
+            // the crop is widened to whole iMCU columns, so the left edge may move to the left
+            JDIMENSION XOffset = JDIMENSION(Region.Min.X);
+            JDIMENSION CropWidth = JDIMENSION(Region.Width());
+            jpeg_crop_scanline(&Info, &XOffset, &CropWidth);
+            jpeg_skip_scanlines(&Info, JDIMENSION(Region.Min.Y));
+
+            OutImage.Init2D(Region.Width(), Region.Height(), bIsGray ? TSF_G8 : TSF_BGRA8);
+
+            const int64 PixelBytes = Info.output_components;
+            const int64 RegionRowBytes = Region.Width() * PixelBytes;
+            ScratchRow.SetNumUninitialized(int64(Info.output_width) * PixelBytes);
+
+            for (int32 Y = 0; Y < Region.Height(); ++Y)
+            {
+                JSAMPROW Row = ScratchRow.GetData();
+                jpeg_read_scanlines(&Info, &Row, 1);
+                FMemory::Memcpy(OutImage.RawData.GetData() + Y * RegionRowBytes, ScratchRow.GetData() + (Region.Min.X - int64(XOffset)) * PixelBytes, RegionRowBytes);
+            }
+
+            OutImage.SourceSizeX = Info.image_width;
+            OutImage.SourceSizeY = Info.image_height;
+            OutImage.SRGB = true;
+            OutImage.GammaSpace = EGammaSpace::sRGB;
+
+            bSuccess = true;
+        }
+        else if (!bIsCMYK && OutError.IsEmpty())
+        {
+            OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), Region.Width(), Region.Height());
+        }
+    }
+    else
+    {
+        char Message[JMSG_LENGTH_MAX];
+        ErrorManager.Base.format_message(reinterpret_cast<j_common_ptr>(&Info), Message);
+        OutError = FString::Printf(TEXT("Failed to decode JPEG. %s"), ANSI_TO_TCHAR(Message));
+    }
+
+    // the rows below the region are never decoded, so the decompression isn't finished
+    jpeg_destroy_decompress(&Info);
+
+    if (bIsCMYK)
+    {
+        // decoded as a whole and cropped by the caller
+        return Decode(Buffer, Length, OutImage, OutError);
+    }
+
+    return bSuccess;
+}
+#endif // RUNTIMEIMAGELOADER_WITH_LIBJPEGTURBO
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
@@ -0,0 +1,26 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageDecoders/IRuntimeImageDecoder.h"
+
+class FImageDecoderJPEG : public IRuntimeImageDecoder
+{
+public:
+    virtual FName GetName() const override { return TEXT("JPEG"); }
+    virtual bool CanDecode(const uint8* Buffer, int64 Length) const override;
+    virtual bool Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError) override;
+    virtual bool DecodeWithOptions(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError) override;
+    /** Decodes the first scan of a progressive JPEG at 1/8 of the full size */
+    virtual bool DecodePreview(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError) override;
+
+private:
+#if RUNTIMEIMAGELOADER_WITH_LIBJPEGTURBO
+    /** Decodes at 1/2, 1/4 or 1/8 of the full size by skipping DCT coefficients, the rest of the downscale is left to the resampler */
+    bool DecodeScaled(const uint8* Buffer, int64 Length, float MinScale, FRuntimeImageData& OutImage, FString& OutError);
+
+    /** Decodes the rows of the region only, cropped to the iMCU columns that cover it. Rows above it are skipped without the IDCT */
+    bool DecodeRegion(const uint8* Buffer, int64 Length, const FIntRect& RequestedRegion, FRuntimeImageData& OutImage, FString& OutError);
+#endif
+};
@@ -0,0 +1,21 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageDecoderKTX2.h"
+
+#include "Helpers/BlockCompressedHelpers.h"
+
+
+bool FImageDecoderKTX2::CanDecode(const uint8* Buffer, int64 Length) const
+{
+    return FBlockCompressedHelpers::IsKTX2(Buffer, Length);
+}
+
+bool FImageDecoderKTX2::Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError)
+{
+    return DecodeWithOptions(Buffer, Length, FRuntimeImageDecodeOptions(), OutImage, OutError);
+}
+
+bool FImageDecoderKTX2::DecodeWithOptions(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError)
+{
+    return FBlockCompressedHelpers::DecodeKTX2(Buffer, Length, Options, OutImage, OutError);
+}
@@ -0,0 +1,16 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageDecoders/IRuntimeImageDecoder.h"
+
+/** BC1-BC7 blocks are passed to the RHI without being decoded, percent sizes skip mips of pre-built chains */
+class FImageDecoderKTX2 : public IRuntimeImageDecoder
+{
+public:
+    virtual FName GetName() const override { return TEXT("KTX2"); }
+    virtual bool CanDecode(const uint8* Buffer, int64 Length) const override;
+    virtual bool Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError) override;
+    virtual bool DecodeWithOptions(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError) override;
+};
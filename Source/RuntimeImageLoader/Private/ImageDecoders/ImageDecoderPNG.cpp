@@ -0,0 +1,112 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageDecoderPNG.h"
+#include "IImageWrapper.h"
+#include "Stats/Stats.h"
+
+#include "RuntimeImageUtils.h"
+#include "Helpers/ImageHeaderHelpers.h"
+#include "Helpers/ImageWrapperPool.h"
+#include "Helpers/PNGHelpers.h"
+
+
+bool FImageDecoderPNG::CanDecode(const uint8* Buffer, int64 Length) const
+{
+    static const uint8 Signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    return Length >= sizeof(Signature) && FMemory::Memcmp(Buffer, Signature, sizeof(Signature)) == 0;
+}
+
+bool FImageDecoderPNG::Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDecoderPNG_Decode);
+
+    using namespace FRuntimeImageUtils;
+    // PNG support both 8 and 16 bit depth images (24 and 48 bits per pixel respectively or 32 and 64 bits when alpha channel is used)
+
+    FImageWrapperPool::FScopedImageWrapper PngImageWrapper(EImageFormat::PNG);
+    if (!PngImageWrapper.SetCompressed(Buffer, Length))
+    {
+        OutError = TEXT("Failed to decode PNG. The image is corrupted!");
+        return false;
+    }
+
+    if (!IsImportResolutionValid(PngImageWrapper->GetWidth(), PngImageWrapper->GetHeight(), true))
+    {
+        OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), PngImageWrapper->GetWidth(), PngImageWrapper->GetHeight());
+        return false;
+    }
+
+    // Select the texture's source format
+    ETextureSourceFormat TextureFormat = TSF_Invalid;
+    int32 BitDepth = PngImageWrapper->GetBitDepth();
+    ERGBFormat Format = PngImageWrapper->GetFormat();
+
+    if (Format == ERGBFormat::Gray)
+    {
+        if (BitDepth <= 8)
+        {
+            TextureFormat = TSF_G8;
+            Format = ERGBFormat::Gray;
+            BitDepth = 8;
+        }
+        else if (BitDepth == 16)
+        {
+            // heightmaps and masks stay single channel, gray with alpha or a tRNS chunk needs the RGBA expansion
+            FImageHeaderInfo HeaderInfo;
+            int64 RequiredBytes = 0;
+            const bool bIsOpaque = FImageHeaderHelpers::ParseHeader(Buffer, Length, HeaderInfo, RequiredBytes) == FImageHeaderHelpers::EParseResult::Success && !HeaderInfo.bHasAlpha;
+
+            TextureFormat = bIsOpaque ? TSF_G16 : TSF_RGBA16;
+            Format = bIsOpaque ? ERGBFormat::Gray : ERGBFormat::RGBA;
+            BitDepth = 16;
+        }
+    }
+    else if (Format == ERGBFormat::RGBA || Format == ERGBFormat::BGRA)
+    {
+        if (BitDepth <= 8)
+        {
+            TextureFormat = TSF_BGRA8;
+            Format = ERGBFormat::BGRA;
+            BitDepth = 8;
+        }
+        else if (BitDepth == 16)
+        {
+            TextureFormat = TSF_RGBA16;
+            Format = ERGBFormat::RGBA;
+            BitDepth = 16;
+        }
+    }
+
+    if (BitDepth > 16)
+    {
+        OutError = TEXT("Only 8 and 16 bit depth PNG images are currently supported.");
+        return false;
+    }
+
+    TArray64<uint8> RawPNG;
+    if (PngImageWrapper->GetRaw(Format, BitDepth, RawPNG))
+    {
+        OutImage.Init2D(
+            PngImageWrapper->GetWidth(),
+            PngImageWrapper->GetHeight(),
+            TextureFormat,
+            MoveTemp(RawPNG)
+        );
+        OutImage.SRGB = BitDepth < 16;
+        OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear; 
+
+        FPNGHelpers::FillZeroAlphaPNGData(OutImage.SizeX, OutImage.SizeY, OutImage.TextureSourceFormat, OutImage.RawData.GetData());
+    }
+    else
+    {
+        OutError = FString::Printf(TEXT("Failed to decode PNG. Bit depth: %d"), BitDepth);
+        return false;
+    }
+
+    return true;
+}
+
+bool FImageDecoderPNG::DecodePreview(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError)
+{
+    return FPNGHelpers::DecodeInterlacedPreview(Buffer, Length, OutImage, OutError);
+}
@@ -0,0 +1,43 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageDecoderQOI.h"
+#include "Stats/Stats.h"
+
+#include "Helpers/QOIHelpers.h"
+
+
+bool FImageDecoderQOI::CanDecode(const uint8* Buffer, int64 Length) const
+{
+    return Length >= 4 && Buffer[0] == 'q' && Buffer[1] == 'o' && Buffer[2] == 'i' && Buffer[3] == 'f';
+}
+
+bool FImageDecoderQOI::Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDecoderQOI_Decode);
+
+    FQOILoader QOILoader;
+    if (!QOILoader.IsValidImage(Buffer, uint32(Length)))
+    {
+        OutError = TEXT("Failed to decode QOI. The image is corrupted!");
+        return false;
+    }
+
+    if (QOILoader.Load(Buffer, uint32(Length)))
+    {
+        OutImage.Init2D(
+            QOILoader.Width,
+            QOILoader.Height,
+            QOILoader.TextureSourceFormat,
+            MoveTemp(QOILoader.RawData)
+        );
+
+        OutImage.SRGB = QOILoader.bSRGB;
+        OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+        OutImage.CompressionSettings = QOILoader.CompressionSettings;
+
+        return true;
+    }
+
+    OutError = QOILoader.GetLastError();
+    return false;
+}
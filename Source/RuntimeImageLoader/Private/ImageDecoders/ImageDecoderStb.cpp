@@ -0,0 +1,149 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageDecoderStb.h"
+#include "Stats/Stats.h"
+
+#include "RuntimeImageUtils.h"
+#include "Helpers/PNGHelpers.h"
+#include "Helpers/PixelKernels.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "stb_image.h"
+THIRD_PARTY_INCLUDES_END
+
+
+bool FImageDecoderStb::CanDecode(const uint8* Buffer, int64 Length) const
+{
+    int32 Width, Height, Channels;
+    return Length <= MAX_int32 && stbi_info_from_memory(Buffer, int32(Length), &Width, &Height, &Channels) == 1;
+}
+
+bool FImageDecoderStb::Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDecoderStb_Decode);
+
+    using namespace FRuntimeImageUtils;
+
+    if (Length > MAX_int32)
+    {
+        OutError = TEXT("Failed to decode image with stb_image. The image is larger than 2 GB!");
+        return false;
+    }
+
+    if (stbi_is_hdr_from_memory(Buffer, int32(Length)))
+    {
+        return DecodeHDR(Buffer, int32(Length), OutImage, OutError);
+    }
+
+    int32 Width, Height, Channels;
+    if (stbi_info_from_memory(Buffer, int32(Length), &Width, &Height, &Channels) != 1)
+    {
+        OutError = FString::Printf(TEXT("Failed to decode %s with stb_image: %s"), *FormatName.ToString(), UTF8_TO_TCHAR(stbi_failure_reason()));
+        return false;
+    }
+
+    if (!IsImportResolutionValid(Width, Height, true))
+    {
+        OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), Width, Height);
+        return false;
+    }
+
+    const int64 NumPixels = int64(Width) * Height;
+
+    if (stbi_is_16_bit_from_memory(Buffer, int32(Length)))
+    {
+        // gray without alpha stays single channel
+        const bool bIsGray = Channels == 1;
+
+        uint16* Pixels = stbi_load_16_from_memory(Buffer, int32(Length), &Width, &Height, &Channels, bIsGray ? 1 : 4);
+        if (Pixels == nullptr)
+        {
+            OutError = FString::Printf(TEXT("Failed to decode %s with stb_image: %s"), *FormatName.ToString(), UTF8_TO_TCHAR(stbi_failure_reason()));
+            return false;
+        }
+
+        OutImage.Init2D(Width, Height, bIsGray ? TSF_G16 : TSF_RGBA16, Pixels);
+        stbi_image_free(Pixels);
+
+        OutImage.SRGB = false;
+    }
+    else
+    {
+        const bool bIsGray = Channels == 1;
+
+        uint8* Pixels = stbi_load_from_memory(Buffer, int32(Length), &Width, &Height, &Channels, bIsGray ? 1 : 4);
+        if (Pixels == nullptr)
+        {
+            OutError = FString::Printf(TEXT("Failed to decode %s with stb_image: %s"), *FormatName.ToString(), UTF8_TO_TCHAR(stbi_failure_reason()));
+            return false;
+        }
+
+        if (bIsGray)
+        {
+            OutImage.Init2D(Width, Height, TSF_G8, Pixels);
+        }
+        else
+        {
+            // stb_image only produces RGBA
+            OutImage.Init2D(Width, Height, TSF_BGRA8);
+            FPixelKernels::RGBAToBGRA(Pixels, OutImage.RawData.GetData(), NumPixels);
+        }
+        stbi_image_free(Pixels);
+
+        OutImage.SRGB = true;
+
+        // same as the TGA decoder, grayscales are commonly used as masks
+        if (bIsGray && FormatName == TEXT("TGA"))
+        {
+            OutImage.CompressionSettings = TC_Grayscale;
+            OutImage.SRGB = false;
+        }
+    }
+
+    OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+
+    if (FormatName == TEXT("PNG"))
+    {
+        FPNGHelpers::FillZeroAlphaPNGData(OutImage.SizeX, OutImage.SizeY, OutImage.TextureSourceFormat, OutImage.RawData.GetData());
+    }
+
+    return true;
+}
+
+bool FImageDecoderStb::DecodeHDR(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError)
+{
+    using namespace FRuntimeImageUtils;
+
+    int32 Width, Height, Channels;
+    float* Pixels = stbi_loadf_from_memory(Buffer, Length, &Width, &Height, &Channels, 3);
+    if (Pixels == nullptr)
+    {
+        OutError = FString::Printf(TEXT("Failed to decode HDR with stb_image: %s"), UTF8_TO_TCHAR(stbi_failure_reason()));
+        return false;
+    }
+
+    if (!IsImportResolutionValid(Width, Height, true))
+    {
+        stbi_image_free(Pixels);
+        OutError = FString::Printf(TEXT("HDR Texture resolution is not supported: %d x %d"), Width, Height);
+        return false;
+    }
+
+    // the engine decoder keeps the shared exponent encoding, which is what the cubemap path expects
+    OutImage.Init2D(Width, Height, TSF_BGRE8);
+
+    const int64 NumPixels = int64(Width) * Height;
+    FColor* TargetPixels = reinterpret_cast<FColor*>(OutImage.RawData.GetData());
+    for (int64 PixelIndex = 0; PixelIndex < NumPixels; ++PixelIndex)
+    {
+        const float* SourcePixel = Pixels + PixelIndex * 3;
+        TargetPixels[PixelIndex] = FLinearColor(SourcePixel[0], SourcePixel[1], SourcePixel[2]).ToRGBE();
+    }
+    stbi_image_free(Pixels);
+
+    OutImage.SRGB = false;
+    OutImage.GammaSpace = EGammaSpace::Linear;
+    OutImage.CompressionSettings = TC_HDR;
+
+    return true;
+}
@@ -0,0 +1,28 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageDecoders/IRuntimeImageDecoder.h"
+
+/**
+ * Decodes PNG, JPEG, BMP, TGA and HDR with stb_image.
+ * Produces the same texture source formats as the engine based decoders of these formats, so either can be used for an image.
+ */
+class FImageDecoderStb : public IRuntimeImageDecoder
+{
+public:
+    explicit FImageDecoderStb(FName InFormatName)
+        : FormatName(InFormatName)
+    {
+    }
+
+    virtual FName GetName() const override { return FormatName; }
+    virtual bool CanDecode(const uint8* Buffer, int64 Length) const override;
+    virtual bool Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError) override;
+
+private:
+    bool DecodeHDR(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError);
+
+    FName FormatName;
+};
@@ -0,0 +1,66 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageDecoderTGA.h"
+#include "Stats/Stats.h"
+
+#include "RuntimeImageUtils.h"
+#include "Helpers/TGAHelpers.h"
+
+
+bool FImageDecoderTGA::CanDecode(const uint8* Buffer, int64 Length) const
+{
+    // Support for alpha stored as pseudo-color 8-bit TGA
+    const FTGAHelpers::FTGAFileHeader* TGA = (FTGAHelpers::FTGAFileHeader*)Buffer;
+    return Length >= sizeof(FTGAHelpers::FTGAFileHeader) &&
+        ((TGA->ColorMapType == 0 && TGA->ImageTypeCode == 2) ||
+        // ImageTypeCode 3 is greyscale
+        (TGA->ColorMapType == 0 && TGA->ImageTypeCode == 3) ||
+        (TGA->ColorMapType == 0 && TGA->ImageTypeCode == 10) ||
+        // ImageTypeCode 11 is RLE compressed greyscale
+        (TGA->ColorMapType == 0 && TGA->ImageTypeCode == 11) ||
+        (TGA->ColorMapType == 1 && TGA->ImageTypeCode == 1 && TGA->BitsPerPixel == 8));
+}
+
+bool FImageDecoderTGA::Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError)
+{
+    return DecodeWithOptions(Buffer, Length, FRuntimeImageDecodeOptions(), OutImage, OutError);
+}
+
+bool FImageDecoderTGA::DecodeWithOptions(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDecoderTGA_Decode);
+
+    using namespace FRuntimeImageUtils;
+
+    if (Length < sizeof(FTGAHelpers::FTGAFileHeader))
+    {
+        OutError = TEXT("Failed to decode TGA. The image is corrupted!");
+        return false;
+    }
+
+    const FTGAHelpers::FTGAFileHeader* TGA = (FTGAHelpers::FTGAFileHeader*)Buffer;
+
+    // Check the resolution of the imported texture to ensure validity
+    if (!IsImportResolutionValid(TGA->Width, TGA->Height, true))
+    {
+        OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), TGA->Width, TGA->Height);
+        return false;
+    }
+
+    FString DecompressError;
+    if (!FTGAHelpers::DecompressTGA(Buffer, Length, OutImage, DecompressError, Options.Region))
+    {
+        OutError = FString::Printf(TEXT("Failed to decompress TGA: %s"), *DecompressError);
+        return false;
+    }
+
+    if (OutImage.CompressionSettings == TC_Grayscale && TGA->ImageTypeCode != 1)
+    {
+        // default grayscales to linear as they wont get compression otherwise and are commonly used as masks
+        OutImage.SRGB = false;
+    }
+
+    OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+
+    return true;
+}
@@ -0,0 +1,19 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageDecoders/IRuntimeImageDecoder.h"
+
+class FImageDecoderTGA : public IRuntimeImageDecoder
+{
+public:
+    virtual FName GetName() const override { return TEXT("TGA"); }
+    virtual bool CanDecode(const uint8* Buffer, int64 Length) const override;
+    virtual bool Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError) override;
+    /** Uncompressed images convert the rows and columns of the region only */
+    virtual bool DecodeWithOptions(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError) override;
+
+    /** TGA has no magic number, it is recognised by header plausibility and asked last */
+    virtual int32 GetPriority() const override { return -100; }
+};
@@ -0,0 +1,118 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageDecoderTIFF.h"
+#include "HAL/IConsoleManager.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Serialization/LargeMemoryReader.h"
+#include "Stats/Stats.h"
+
+#include "RuntimeImageUtils.h"
+
+#include "Helpers/StreamingImageDecoders.h"
+#include "Helpers/TIFFHelpers.h"
+#include "Helpers/TIFFLoader.h"
+
+#if WITH_FREEIMAGE_LIB || RUNTIMEIMAGELOADER_WITH_LIBTIFF
+
+#if RUNTIMEIMAGELOADER_WITH_LIBTIFF
+static TAutoConsoleVariable<bool> CVarTIFFParallelDecode(
+    TEXT("RuntimeImageLoader.TIFF.ParallelDecode"), true,
+    TEXT("Decode the strips or tiles of TIFFs on several threads."));
+
+static TAutoConsoleVariable<float> CVarTIFFParallelDecodeMinMegapixels(
+    TEXT("RuntimeImageLoader.TIFF.ParallelDecodeMinMegapixels"), 4.0f,
+    TEXT("Smaller TIFFs are decoded on the image reader thread only."));
+#endif
+
+
+bool FImageDecoderTIFF::CanDecode(const uint8* Buffer, int64 Length) const
+{
+    return Length >= 4 &&
+        ((Buffer[0] == 'I' && Buffer[1] == 'I' && Buffer[2] == 42 && Buffer[3] == 0) ||
+        (Buffer[0] == 'M' && Buffer[1] == 'M' && Buffer[2] == 0 && Buffer[3] == 42));
+}
+
+bool FImageDecoderTIFF::Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError)
+{
+    return DecodeWithOptions(Buffer, Length, FRuntimeImageDecodeOptions(), OutImage, OutError);
+}
+
+bool FImageDecoderTIFF::DecodeWithOptions(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageDecoderTIFF_Decode);
+
+    using namespace FRuntimeImageUtils;
+
+#if RUNTIMEIMAGELOADER_WITH_LIBTIFF
+    FTIFFHelpers::FTIFFChunkLayout ChunkLayout;
+    if (FTIFFHelpers::ParseChunkLayout(Buffer, Length, ChunkLayout, OutError))
+    {
+        if (!ClipRegion(Options.Region, ChunkLayout.Width, ChunkLayout.Height, ChunkLayout.Region, OutError))
+        {
+            return false;
+        }
+
+        if (!IsImportResolutionValid(ChunkLayout.Region.Width(), ChunkLayout.Region.Height(), true))
+        {
+            OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), ChunkLayout.Region.Width(), ChunkLayout.Region.Height());
+            return false;
+        }
+
+        // a region is decoded through the chunks even when it is too small to be worth more than one thread
+        const bool bIsLargeEnough = int64(ChunkLayout.Region.Width()) * ChunkLayout.Region.Height() >= int64(CVarTIFFParallelDecodeMinMegapixels.GetValueOnAnyThread() * 1000000.0f);
+        const bool bDecodeParallel = CVarTIFFParallelDecode.GetValueOnAnyThread() && bIsLargeEnough && ChunkLayout.NumChunks > 1;
+        if (ChunkLayout.Layout != FTIFFHelpers::ETIFFLayout::RGBA && (bDecodeParallel || Options.HasRegion()))
+        {
+            const int32 NumCores = bDecodeParallel ? FTaskGraphInterface::Get().GetNumWorkerThreads() + 1 : 1;
+            if (FTIFFHelpers::DecodeParallel(Buffer, Length, ChunkLayout, NumCores, OutImage, OutError))
+            {
+                return true;
+            }
+        }
+    }
+
+    // FreeImage reports its own error if the image is really broken
+    OutError.Reset();
+#endif
+
+#if WITH_FREEIMAGE_LIB
+    // FreeImage keeps the memory stream and bitmap in the helper, so every decode gets its own
+    FRuntimeTiffLoadHelper TiffLoaderHelper;
+    if (!TiffLoaderHelper.IsValid())
+    {
+        OutError = TEXT("Failed to decode TIFF. FreeImage is not available!");
+        return false;
+    }
+
+    if (TiffLoaderHelper.Load(Buffer, uint32(Length)))
+    {
+        if (!IsImportResolutionValid(TiffLoaderHelper.Width, TiffLoaderHelper.Height, true))
+        {
+            OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), TiffLoaderHelper.Width, TiffLoaderHelper.Height);
+            return false;
+        }
+
+        OutImage.Init2D(
+            TiffLoaderHelper.Width,
+            TiffLoaderHelper.Height,
+            TiffLoaderHelper.TextureSourceFormat,
+            MoveTemp(TiffLoaderHelper.RawData)
+        );
+
+        OutImage.SRGB = TiffLoaderHelper.bSRGB;
+        OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+        OutImage.CompressionSettings = TiffLoaderHelper.CompressionSettings;
+
+        return true;
+    }
+
+    OutError = TEXT("Failed to decode TIFF. Unsupported format!");
+    return false;
+#else
+    // without FreeImage the streaming decoder handles the remaining layouts
+    FLargeMemoryReader Reader(Buffer, Length);
+    return FStreamingImageDecoders::Decode(ERuntimeImageFormat::TIFF, Reader, Options, OutImage, OutError);
+#endif
+}
+
+#endif // WITH_FREEIMAGE_LIB || RUNTIMEIMAGELOADER_WITH_LIBTIFF
@@ -0,0 +1,24 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageDecoders/IRuntimeImageDecoder.h"
+
+#if WITH_FREEIMAGE_LIB || RUNTIMEIMAGELOADER_WITH_LIBTIFF
+
+/**
+ * Decodes the first image of a TIFF. Layouts libtiff can hand out strip by strip are decoded in parallel,
+ * everything else goes through FreeImage. No state is kept between decodes so any number of loads may run at once.
+ */
+class FImageDecoderTIFF : public IRuntimeImageDecoder
+{
+public:
+    virtual FName GetName() const override { return TEXT("TIFF"); }
+    virtual bool CanDecode(const uint8* Buffer, int64 Length) const override;
+    virtual bool Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError) override;
+
+    /** Strips and tiles outside of the region in the options are not decompressed, if libtiff handles the layout */
+    virtual bool DecodeWithOptions(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError) override;
+};
+#endif // WITH_FREEIMAGE_LIB || RUNTIMEIMAGELOADER_WITH_LIBTIFF
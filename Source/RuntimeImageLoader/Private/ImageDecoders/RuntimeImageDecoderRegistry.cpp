@@ -0,0 +1,204 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageDecoders/RuntimeImageDecoderRegistry.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#include "ImageDecoderPNG.h"
+#include "ImageDecoderJPEG.h"
+#include "ImageDecoderBMP.h"
+#include "ImageDecoderTGA.h"
+#include "ImageDecoderEXR.h"
+#include "ImageDecoderTIFF.h"
+#include "ImageDecoderQOI.h"
+#include "ImageDecoderHDR.h"
+#include "ImageDecoderDDS.h"
+#include "ImageDecoderKTX2.h"
+#include "ImageDecoderStb.h"
+#include "ImageDecoderBackendSelector.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogRuntimeImageDecoderRegistry, Log, All);
+
+
+FRuntimeImageDecoderRegistry& FRuntimeImageDecoderRegistry::Get()
+{
+    static FRuntimeImageDecoderRegistry Registry;
+    return Registry;
+}
+
+FRuntimeImageDecoderRegistry::FRuntimeImageDecoderRegistry()
+{
+    RegisterBuiltinDecoders();
+}
+
+void FRuntimeImageDecoderRegistry::RegisterBuiltinDecoders()
+{
+    // formats stb_image can decode as well get the faster of both backends
+    auto AddWithStbBackend = [this](FRuntimeImageDecoderRef Decoder)
+    {
+        Decoders.Add(MakeShared<FImageDecoderBackendSelector, ESPMode::ThreadSafe>(Decoder, MakeShared<FImageDecoderStb, ESPMode::ThreadSafe>(Decoder->GetName())));
+    };
+
+    AddWithStbBackend(MakeShared<FImageDecoderPNG, ESPMode::ThreadSafe>());
+    AddWithStbBackend(MakeShared<FImageDecoderJPEG, ESPMode::ThreadSafe>());
+    AddWithStbBackend(MakeShared<FImageDecoderBMP, ESPMode::ThreadSafe>());
+    Decoders.Add(MakeShared<FImageDecoderEXR, ESPMode::ThreadSafe>());
+#if WITH_FREEIMAGE_LIB || RUNTIMEIMAGELOADER_WITH_LIBTIFF
+    Decoders.Add(MakeShared<FImageDecoderTIFF, ESPMode::ThreadSafe>());
+#endif
+    Decoders.Add(MakeShared<FImageDecoderQOI, ESPMode::ThreadSafe>());
+    AddWithStbBackend(MakeShared<FImageDecoderHDR, ESPMode::ThreadSafe>());
+    AddWithStbBackend(MakeShared<FImageDecoderTGA, ESPMode::ThreadSafe>());
+    Decoders.Add(MakeShared<FImageDecoderDDS, ESPMode::ThreadSafe>());
+    Decoders.Add(MakeShared<FImageDecoderKTX2, ESPMode::ThreadSafe>());
+
+    Decoders.StableSort([](const FRuntimeImageDecoderRef& A, const FRuntimeImageDecoderRef& B)
+    {
+        return A->GetPriority() > B->GetPriority();
+    });
+}
+
+void FRuntimeImageDecoderRegistry::RegisterDecoder(FRuntimeImageDecoderRef Decoder)
+{
+    FRWScopeLock Lock(DecodersLock, SLT_Write);
+
+    // a decoder with the same name is replaced, so projects can override built-in formats
+    Decoders.RemoveAll([&Decoder](const FRuntimeImageDecoderRef& Existing) { return Existing->GetName() == Decoder->GetName(); });
+
+    // ahead of already registered decoders of the same priority
+    const int32 InsertIndex = Decoders.IndexOfByPredicate([&Decoder](const FRuntimeImageDecoderRef& Existing) { return Existing->GetPriority() <= Decoder->GetPriority(); });
+    Decoders.Insert(Decoder, InsertIndex == INDEX_NONE ? Decoders.Num() : InsertIndex);
+
+    UE_LOG(LogRuntimeImageDecoderRegistry, Log, TEXT("Registered image decoder: %s"), *Decoder->GetName().ToString());
+}
+
+void FRuntimeImageDecoderRegistry::UnregisterDecoder(FName DecoderName)
+{
+    FRWScopeLock Lock(DecodersLock, SLT_Write);
+
+    Decoders.RemoveAll([DecoderName](const FRuntimeImageDecoderRef& Existing) { return Existing->GetName() == DecoderName; });
+}
+
+FRuntimeImageDecoderPtr FRuntimeImageDecoderRegistry::FindDecoder(const uint8* Buffer, int64 Length) const
+{
+    if (Buffer == nullptr || Length <= 0)
+    {
+        return nullptr;
+    }
+
+    FRWScopeLock Lock(DecodersLock, SLT_ReadOnly);
+
+    for (const FRuntimeImageDecoderRef& Decoder : Decoders)
+    {
+        if (Decoder->CanDecode(Buffer, Length))
+        {
+            return Decoder;
+        }
+    }
+
+    return nullptr;
+}
+
+TArray<FRuntimeImageDecoderRef> FRuntimeImageDecoderRegistry::GetDecoders() const
+{
+    FRWScopeLock Lock(DecodersLock, SLT_ReadOnly);
+    return Decoders;
+}
+
+//
+// Benchmark
+//
+// RuntimeImageLoader.BenchmarkDecoderDispatch [Iterations] [ImageFile...]
+// Measures the cost of picking a decoder for the signature of every built-in format, and dispatch plus decode time of the given files
+static void BenchmarkDecoderDispatch(const TArray<FString>& Args)
+{
+    int32 FirstFileArg = 0;
+    int32 NumIterations = 100000;
+    if (Args.Num() > 0 && Args[0].IsNumeric())
+    {
+        NumIterations = FMath::Max(FCString::Atoi(*Args[0]), 1);
+        FirstFileArg = 1;
+    }
+
+    struct FSignatureSample
+    {
+        const TCHAR* Name;
+        TArray<uint8> Bytes;
+    };
+
+    auto MakeSample = [](const TCHAR* Name, std::initializer_list<uint8> Signature)
+    {
+        FSignatureSample Sample{ Name, TArray<uint8>(Signature) };
+        Sample.Bytes.SetNumZeroed(64);
+        return Sample;
+    };
+
+    TArray<FSignatureSample> Samples;
+    Samples.Add(MakeSample(TEXT("PNG"), { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' }));
+    Samples.Add(MakeSample(TEXT("JPEG"), { 0xFF, 0xD8, 0xFF, 0xE0 }));
+    Samples.Add(MakeSample(TEXT("BMP"), { 'B', 'M' }));
+    Samples.Add(MakeSample(TEXT("EXR"), { 0x76, 0x2F, 0x31, 0x01 }));
+    Samples.Add(MakeSample(TEXT("TIFF"), { 'I', 'I', 42, 0 }));
+    Samples.Add(MakeSample(TEXT("QOI"), { 'q', 'o', 'i', 'f' }));
+    Samples.Add(MakeSample(TEXT("HDR"), { '#', '?', 'R', 'G', 'B', 'E' }));
+    Samples.Add(MakeSample(TEXT("DDS"), { 'D', 'D', 'S', ' ' }));
+    Samples.Add(MakeSample(TEXT("KTX2"), { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' }));
+    // uncompressed true color header
+    Samples.Add(MakeSample(TEXT("TGA"), { 0, 0, 2 }));
+    Samples.Add(MakeSample(TEXT("Unknown"), { 'X' }));
+
+    FRuntimeImageDecoderRegistry& Registry = FRuntimeImageDecoderRegistry::Get();
+
+    UE_LOG(LogRuntimeImageDecoderRegistry, Display, TEXT("Decoder dispatch, %d iterations per format, %d registered decoders"), NumIterations, Registry.GetDecoders().Num());
+
+    for (const FSignatureSample& Sample : Samples)
+    {
+        FRuntimeImageDecoderPtr Decoder;
+
+        const uint64 StartCycles = FPlatformTime::Cycles64();
+        for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+        {
+            Decoder = Registry.FindDecoder(Sample.Bytes.GetData(), Sample.Bytes.Num());
+        }
+        const double Seconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+
+        UE_LOG(LogRuntimeImageDecoderRegistry, Display, TEXT("  %-8s -> %-8s %8.1f ns"),
+            Sample.Name, Decoder.IsValid() ? *Decoder->GetName().ToString() : TEXT("none"), Seconds * 1e9 / NumIterations);
+    }
+
+    for (int32 ArgIndex = FirstFileArg; ArgIndex < Args.Num(); ++ArgIndex)
+    {
+        TArray<uint8> ImageBytes;
+        if (!FFileHelper::LoadFileToArray(ImageBytes, *Args[ArgIndex]))
+        {
+            UE_LOG(LogRuntimeImageDecoderRegistry, Warning, TEXT("  Failed to read %s"), *Args[ArgIndex]);
+            continue;
+        }
+
+        const uint64 DispatchStartCycles = FPlatformTime::Cycles64();
+        FRuntimeImageDecoderPtr Decoder = Registry.FindDecoder(ImageBytes.GetData(), ImageBytes.Num());
+        const double DispatchSeconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - DispatchStartCycles);
+
+        if (!Decoder.IsValid())
+        {
+            UE_LOG(LogRuntimeImageDecoderRegistry, Display, TEXT("  %s: no decoder"), *FPaths::GetCleanFilename(Args[ArgIndex]));
+            continue;
+        }
+
+        FRuntimeImageData ImageData;
+        FString Error;
+        const uint64 DecodeStartCycles = FPlatformTime::Cycles64();
+        const bool bDecoded = Decoder->Decode(ImageBytes.GetData(), ImageBytes.Num(), ImageData, Error);
+        const double DecodeSeconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - DecodeStartCycles);
+
+        UE_LOG(LogRuntimeImageDecoderRegistry, Display, TEXT("  %s: %s dispatch %.1f us, decode %.2f ms%s"),
+            *FPaths::GetCleanFilename(Args[ArgIndex]), *Decoder->GetName().ToString(), DispatchSeconds * 1e6, DecodeSeconds * 1e3, bDecoded ? TEXT("") : *(TEXT(", failed: ") + Error));
+    }
+}
+
+static FAutoConsoleCommand BenchmarkDecoderDispatchCommand(
+    TEXT("RuntimeImageLoader.BenchmarkDecoderDispatch"),
+    TEXT("Measures the cost of picking an image decoder per format. Usage: RuntimeImageLoader.BenchmarkDecoderDispatch [Iterations] [ImageFile...]"),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkDecoderDispatch));
@@ -0,0 +1,178 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageHeaderProbe.h"
+#include "Async/ParallelFor.h"
+#include "Stats/Stats.h"
+
+#include "ImageReaders/ImageReaderFactory.h"
+#include "ImageReaders/ImageReaderHttp.h"
+#include "Helpers/ImageHeaderHelpers.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "stb_image.h"
+THIRD_PARTY_INCLUDES_END
+
+
+bool FImageHeaderProbe::Probe(const FString& ImageURI, FImageHeaderInfo& OutInfo)
+{
+    TArray<FImageHeaderInfo> Infos;
+    ProbeBatch({ ImageURI }, Infos);
+
+    OutInfo = MoveTemp(Infos[0]);
+    return OutInfo.bSuccess;
+}
+
+void FImageHeaderProbe::ProbeBatch(const TArray<FString>& ImageURIs, TArray<FImageHeaderInfo>& OutInfos)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageHeaderProbe_ProbeBatch);
+
+    OutInfos.Reset(ImageURIs.Num());
+    OutInfos.AddDefaulted(ImageURIs.Num());
+
+    struct FRemoteProbe
+    {
+        FImageHeaderInfo* Info;
+        TSharedPtr<FImageReaderHttp, ESPMode::ThreadSafe> Reader;
+        int64 RequestedBytes;
+    };
+
+    TArray<FRemoteProbe> RemoteProbes;
+    TArray<int32> LocalIndices;
+
+    for (int32 Index = 0; Index < ImageURIs.Num(); ++Index)
+    {
+        OutInfos[Index].ImageFilename = ImageURIs[Index];
+
+        if (IsRemote(ImageURIs[Index]))
+        {
+            RemoteProbes.Add({ &OutInfos[Index], MakeShared<FImageReaderHttp, ESPMode::ThreadSafe>(), FImageHeaderHelpers::DefaultProbeBytes });
+        }
+        else
+        {
+            LocalIndices.Add(Index);
+        }
+    }
+
+    // put every ranged request in flight before touching the disk so network latency overlaps with local probing
+    for (FRemoteProbe& RemoteProbe : RemoteProbes)
+    {
+        RemoteProbe.Reader->BeginRead(RemoteProbe.Info->ImageFilename, RemoteProbe.RequestedBytes);
+    }
+
+    ParallelFor(LocalIndices.Num(), [&OutInfos, &LocalIndices](int32 Index)
+    {
+        ProbeLocal(OutInfos[LocalIndices[Index]]);
+    });
+
+    while (RemoteProbes.Num() > 0)
+    {
+        TArray<FRemoteProbe> NextRemoteProbes;
+
+        for (FRemoteProbe& RemoteProbe : RemoteProbes)
+        {
+            const TArray<uint8> Bytes = RemoteProbe.Reader->EndRead();
+            if (Bytes.Num() == 0)
+            {
+                RemoteProbe.Info->OutError = FString::Printf(TEXT("Failed to read %s image. Error: %s"), *RemoteProbe.Info->ImageFilename, *RemoteProbe.Reader->GetLastError());
+                continue;
+            }
+
+            int64 NextRequestBytes = 0;
+            if (!ParseBytes(Bytes, RemoteProbe.RequestedBytes, *RemoteProbe.Info, NextRequestBytes))
+            {
+                RemoteProbe.RequestedBytes = NextRequestBytes;
+                RemoteProbe.Reader->BeginRead(RemoteProbe.Info->ImageFilename, NextRequestBytes);
+
+                NextRemoteProbes.Add(RemoteProbe);
+            }
+        }
+
+        RemoteProbes = MoveTemp(NextRemoteProbes);
+    }
+}
+
+bool FImageHeaderProbe::ProbeBytes(const TArray<uint8>& Bytes, FImageHeaderInfo& OutInfo)
+{
+    int64 NextRequestBytes = 0;
+    ParseBytes(Bytes, 0, OutInfo, NextRequestBytes);
+
+    return OutInfo.bSuccess;
+}
+
+bool FImageHeaderProbe::IsRemote(const FString& ImageURI)
+{
+    return ImageURI.StartsWith("http://") || ImageURI.StartsWith("https://");
+}
+
+void FImageHeaderProbe::ProbeLocal(FImageHeaderInfo& InOutInfo)
+{
+    TSharedPtr<IImageReader, ESPMode::ThreadSafe> ImageReader = FImageReaderFactory::CreateReader(InOutInfo.ImageFilename);
+
+    int64 RequestedBytes = FImageHeaderHelpers::DefaultProbeBytes;
+    while (true)
+    {
+        const TArray<uint8> Bytes = (RequestedBytes > 0) ?
+            ImageReader->ReadImageHeader(InOutInfo.ImageFilename, RequestedBytes) :
+            ImageReader->ReadImage(InOutInfo.ImageFilename);
+
+        if (Bytes.Num() == 0)
+        {
+            InOutInfo.OutError = FString::Printf(TEXT("Failed to read %s image. Error: %s"), *InOutInfo.ImageFilename, *ImageReader->GetLastError());
+            return;
+        }
+
+        if (ParseBytes(Bytes, RequestedBytes, InOutInfo, RequestedBytes))
+        {
+            return;
+        }
+    }
+}
+
+bool FImageHeaderProbe::ParseBytes(const TArray<uint8>& Bytes, int64 RequestedBytes, FImageHeaderInfo& InOutInfo, int64& OutNextRequestBytes)
+{
+    // a short read means the whole image is already in memory
+    const bool bHasWholeImage = RequestedBytes == 0 || Bytes.Num() < RequestedBytes;
+
+    int64 RequiredBytes = 0;
+    switch (FImageHeaderHelpers::ParseHeader(Bytes.GetData(), Bytes.Num(), InOutInfo, RequiredBytes))
+    {
+        case FImageHeaderHelpers::EParseResult::Success:
+        {
+            InOutInfo.bSuccess = true;
+            return true;
+        }
+
+        case FImageHeaderHelpers::EParseResult::NeedMoreData:
+        {
+            if (bHasWholeImage)
+            {
+                InOutInfo.OutError = FString::Printf(TEXT("Image header is truncated: %s"), *InOutInfo.ImageFilename);
+                return true;
+            }
+
+            // first retry covers the usual JPEG APPn segments, after that fall back to reading everything
+            OutNextRequestBytes = (RequestedBytes < FImageHeaderHelpers::ExtendedProbeBytes) ?
+                FMath::Max(RequiredBytes, FImageHeaderHelpers::ExtendedProbeBytes) : 0;
+            return false;
+        }
+
+        default:
+            break;
+    }
+
+    // formats without a native header parser (PSD, PNM, PIC...)
+    if (stbi_info_from_memory(Bytes.GetData(), Bytes.Num(), &InOutInfo.Width, &InOutInfo.Height, &InOutInfo.Channels) == 1)
+    {
+        InOutInfo.Format = ERuntimeImageFormat::Unknown;
+        InOutInfo.bIsHDR = stbi_is_hdr_from_memory(Bytes.GetData(), Bytes.Num()) != 0;
+        InOutInfo.BitDepth = InOutInfo.bIsHDR ? 32 : (stbi_is_16_bit_from_memory(Bytes.GetData(), Bytes.Num()) ? 16 : 8);
+        InOutInfo.bHasAlpha = InOutInfo.Channels == 2 || InOutInfo.Channels == 4;
+        InOutInfo.NumFrames = 1;
+        InOutInfo.bSuccess = true;
+        return true;
+    }
+
+    InOutInfo.OutError = TEXT("Failed to get image dimensions! Try to load an image via LoadImage or LoadImageAsync! stb error (if any): ");
+    InOutInfo.OutError += stbi_failure_reason();
+    return true;
+}
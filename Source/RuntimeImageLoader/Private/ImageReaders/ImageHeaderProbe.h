@@ -0,0 +1,25 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageHeaderInfo.h"
+
+/**
+ * Reads image dimensions, bit depth, frame count and the HDR and alpha flags from the first bytes of local files and remote URLs without downloading or decoding the whole image.
+ * Remote images are fetched with HTTP range requests; all requests of a batch are in flight at the same time.
+ */
+class FImageHeaderProbe
+{
+public:
+    static bool Probe(const FString& ImageURI, FImageHeaderInfo& OutInfo);
+    static void ProbeBatch(const TArray<FString>& ImageURIs, TArray<FImageHeaderInfo>& OutInfos);
+
+    /** Parses an image that is already in memory, only its header bytes are looked at */
+    static bool ProbeBytes(const TArray<uint8>& Bytes, FImageHeaderInfo& OutInfo);
+
+private:
+    static bool IsRemote(const FString& ImageURI);
+    static void ProbeLocal(FImageHeaderInfo& InOutInfo);
+    static bool ParseBytes(const TArray<uint8>& Bytes, int64 RequestedBytes, FImageHeaderInfo& InOutInfo, int64& OutNextRequestBytes);
+};
@@ -0,0 +1,127 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageReaderDataUri.h"
+#include "Misc/Parse.h"
+#include "Stats/Stats.h"
+
+#include "Helpers/Base64Helpers.h"
+
+
+TArray<uint8> FImageReaderDataUri::ReadImage(const FString& ImageURI)
+{
+    return ReadPayload(ImageURI, 0);
+}
+
+TArray<uint8> FImageReaderDataUri::ReadImageHeader(const FString& ImageURI, int64 NumBytes)
+{
+    return ReadPayload(ImageURI, NumBytes);
+}
+
+TArray<uint8> FImageReaderDataUri::ReadPayload(const FString& ImageURI, int64 MaxBytes)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageReaderDataUri_ReadPayload);
+
+    int32 CommaIndex = INDEX_NONE;
+    if (!IsDataURI(ImageURI) || !ImageURI.FindChar(TEXT(','), CommaIndex))
+    {
+        OutError = TEXT("Malformed data URI, expected data:[<media type>][;base64],<data>");
+        return TArray<uint8>();
+    }
+
+    // media type and parameters are not needed, the decoder sniffs the format from the data
+    static const FString Base64Marker = TEXT(";base64");
+    const bool bIsBase64 = CommaIndex >= Base64Marker.Len() && FCString::Strnicmp(*ImageURI + CommaIndex - Base64Marker.Len(), *Base64Marker, Base64Marker.Len()) == 0;
+
+    const TCHAR* Payload = *ImageURI + CommaIndex + 1;
+    const int64 PayloadLength = ImageURI.Len() - CommaIndex - 1;
+
+    if (bIsBase64)
+    {
+        return DecodeBase64(Payload, PayloadLength, MaxBytes);
+    }
+
+    TArray<uint8> ImageData;
+    ImageData.Reserve(PayloadLength);
+
+    for (int64 Index = 0; Index < PayloadLength && (MaxBytes <= 0 || ImageData.Num() < MaxBytes); ++Index)
+    {
+        const TCHAR Char = Payload[Index];
+
+        if (Char == TEXT('%') && Index + 2 < PayloadLength && FChar::IsHexDigit(Payload[Index + 1]) && FChar::IsHexDigit(Payload[Index + 2]))
+        {
+            ImageData.Add(uint8((FParse::HexDigit(Payload[Index + 1]) << 4) | FParse::HexDigit(Payload[Index + 2])));
+            Index += 2;
+        }
+        else if (uint32(Char) <= 0xFF)
+        {
+            ImageData.Add(uint8(Char));
+        }
+        else
+        {
+            OutError = TEXT("Data URI contains characters that are not percent-encoded");
+            return TArray<uint8>();
+        }
+    }
+
+    if (ImageData.Num() == 0)
+    {
+        OutError = TEXT("Data URI is empty");
+    }
+
+    return ImageData;
+}
+
+TArray<uint8> FImageReaderDataUri::ReadBase64(const FString& ImageBase64, int64 MaxBytes)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageReaderDataUri_ReadBase64);
+
+    return DecodeBase64(*ImageBase64, ImageBase64.Len(), MaxBytes);
+}
+
+TArray<uint8> FImageReaderDataUri::DecodeBase64(const TCHAR* Payload, int64 PayloadLength, int64 MaxBytes)
+{
+    // every 4 characters hold 3 bytes, headers only need the leading characters
+    if (MaxBytes > 0)
+    {
+        PayloadLength = FMath::Min(PayloadLength, FMath::DivideAndRoundUp<int64>(MaxBytes, 3) * 4);
+    }
+
+    TArray<uint8> ImageData;
+    ImageData.SetNumUninitialized(FBase64Helpers::GetMaxDecodedSize(PayloadLength));
+
+    int64 DecodedLength = 0;
+    if (!FBase64Helpers::Decode(Payload, PayloadLength, ImageData.GetData(), ImageData.Num(), DecodedLength))
+    {
+        OutError = TEXT("Image contains invalid base64 data");
+        return TArray<uint8>();
+    }
+
+    ImageData.SetNum(DecodedLength);
+
+    if (ImageData.Num() == 0)
+    {
+        OutError = TEXT("Base64 image is empty");
+    }
+
+    return ImageData;
+}
+
+FString FImageReaderDataUri::GetLastError() const
+{
+    return OutError;
+}
+
+void FImageReaderDataUri::Flush()
+{
+    // reads are synchronous
+}
+
+void FImageReaderDataUri::Cancel()
+{
+    // reads are synchronous
+}
+
+bool FImageReaderDataUri::IsDataURI(const FString& ImageURI)
+{
+    return ImageURI.StartsWith(TEXT("data:"));
+}
@@ -0,0 +1,34 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageReaders/IImageReader.h"
+
+/**
+ * Reads images embedded into data URIs: data:image/png;base64,iVBORw0KGgo...
+ * Base64 payloads are decoded straight into the buffer handed over to the decoder, percent-encoded payloads are supported as well.
+ */
+class FImageReaderDataUri : public IImageReader
+{
+public:
+    virtual ~FImageReaderDataUri() {}
+
+    virtual TArray<uint8> ReadImage(const FString& ImageURI) override;
+    virtual TArray<uint8> ReadImageHeader(const FString& ImageURI, int64 NumBytes) override;
+    virtual FString GetLastError() const override;
+    virtual void Flush() override;
+    virtual void Cancel() override;
+
+    static bool IsDataURI(const FString& ImageURI);
+
+    /** Decodes raw base64 that is not wrapped into a data URI, see FInputImageDescription::ImageBase64 */
+    TArray<uint8> ReadBase64(const FString& ImageBase64, int64 MaxBytes = 0);
+
+private:
+    TArray<uint8> ReadPayload(const FString& ImageURI, int64 MaxBytes);
+    TArray<uint8> DecodeBase64(const TCHAR* Payload, int64 PayloadLength, int64 MaxBytes);
+
+private:
+    FString OutError;
+};
@@ -1,6 +1,8 @@
 #include "ImageReaderFactory.h"
 #include "ImageReaderLocal.h"
 #include "ImageReaderHttp.h"
+#include "ImageReaderZip.h"
+#include "ImageReaderDataUri.h"
 
 TSharedPtr<IImageReader, ESPMode::ThreadSafe> FImageReaderFactory::CreateReader(const FString& ImageURI)
 {
@@ -9,5 +11,15 @@ TSharedPtr<IImageReader, ESPMode::ThreadSafe> FImageReaderFactory::CreateReader(
         return MakeShared<FImageReaderHttp, ESPMode::ThreadSafe>();
     }
 
+    if (FImageReaderDataUri::IsDataURI(ImageURI))
+    {
+        return MakeShared<FImageReaderDataUri, ESPMode::ThreadSafe>();
+    }
+
+    if (FImageReaderZip::IsZipURI(ImageURI))
+    {
+        return MakeShared<FImageReaderZip, ESPMode::ThreadSafe>();
+    }
+
     return MakeShared<FImageReaderLocal, ESPMode::ThreadSafe>();
 }
@@ -4,42 +4,318 @@
 #include "Runtime/Launch/Resources/Version.h"
 #include "Interfaces/IHttpRequest.h"
 #include "Interfaces/IHttpResponse.h"
+#include "HAL/Event.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
 #include "HttpManager.h"
 #include "HttpModule.h"
 
+DEFINE_LOG_CATEGORY_STATIC(LogImageReaderHttp, Log, All);
+
+
+static TAutoConsoleVariable<int32> CVarHttpMaxRetries(
+    TEXT("RuntimeImageLoader.Http.MaxRetries"), 3,
+    TEXT("Number of times a failed image download is retried. Connection errors, timeouts, 408, 429 and 5xx responses are retried."));
+
+static TAutoConsoleVariable<float> CVarHttpRetryBaseDelay(
+    TEXT("RuntimeImageLoader.Http.RetryBaseDelay"), 0.25f,
+    TEXT("Base delay in seconds of the exponential backoff between retries, the actual delay is randomised between 0 and Base * 2^Retry."));
+
+static TAutoConsoleVariable<float> CVarHttpRetryMaxDelay(
+    TEXT("RuntimeImageLoader.Http.RetryMaxDelay"), 8.0f,
+    TEXT("Upper bound in seconds of the backoff delay between retries."));
+
+static TAutoConsoleVariable<float> CVarHttpTimeout(
+    TEXT("RuntimeImageLoader.Http.Timeout"), 60.0f,
+    TEXT("Timeout in seconds of a single image download attempt."));
+
+static TAutoConsoleVariable<float> CVarHttpHedgePercentile(
+    TEXT("RuntimeImageLoader.Http.HedgePercentile"), 0.0f,
+    TEXT("When an image download takes longer than this percentile of recent download latencies, a duplicate request is issued and the first answer wins. 0 disables hedging."));
+
+static TAutoConsoleVariable<float> CVarHttpHedgeMinDelay(
+    TEXT("RuntimeImageLoader.Http.HedgeMinDelay"), 0.05f,
+    TEXT("Minimum delay in seconds before a hedged request is issued."));
+
+static TAutoConsoleVariable<int32> CVarHttpHedgeMinSamples(
+    TEXT("RuntimeImageLoader.Http.HedgeMinSamples"), 20,
+    TEXT("Number of latency samples required before hedging kicks in."));
+
+
+namespace HttpLatencyStats
+{
+    constexpr int32 MaxSamples = 256;
+
+    static FCriticalSection SamplesMutex;
+    static TArray<float> Samples;
+    static int32 NextSampleIndex = 0;
+}
+
+FImageReaderHttp::FImageReaderHttp()
+{
+    AttemptCompletedEvent = FPlatformProcess::GetSynchEventFromPool(false);
+}
+
 FImageReaderHttp::~FImageReaderHttp()
 {
-    DownloadFuture = nullptr;
+    CancelAttempts();
+
+    FPlatformProcess::ReturnSynchEventToPool(AttemptCompletedEvent);
+    AttemptCompletedEvent = nullptr;
 }
 
 TArray<uint8> FImageReaderHttp::ReadImage(const FString& ImageURI)
 {
-    check (!DownloadFuture.IsValid());
+    BeginRead(ImageURI);
+    return EndRead();
+}
+
+TArray<uint8> FImageReaderHttp::ReadImageHeader(const FString& ImageURI, int64 NumBytes)
+{
+    BeginRead(ImageURI, NumBytes);
+    return EndRead();
+}
+
+void FImageReaderHttp::BeginRead(const FString& ImageURI, int64 RangeBytes)
+{
+    check (!bReadInProgress);
+
+    bReadInProgress = true;
+    bCancelled = false;
+    CurrentURI = ImageURI;
+    CurrentRangeBytes = RangeBytes;
+    OutImageData.Reset();
+    OutError.Reset();
+
+    StartAttempt();
+}
+
+TArray<uint8> FImageReaderHttp::EndRead()
+{
+    check (bReadInProgress);
+
+    const int32 MaxRetries = FMath::Max(0, CVarHttpMaxRetries.GetValueOnAnyThread());
+    const double HedgeDelay = GetHedgeDelay();
+
+    int32 NumRetries = 0;
+    bool bHedged = false;
+    double NextRetryTime = -1.0;
+    double LastAttemptStartTime = FPlatformTime::Seconds();
+    bool bSuccess = false;
+    bool bFatalError = false;
+
+    while (!bSuccess && !bFatalError)
+    {
+        if (bCancelled)
+        {
+            OutError = TEXT("Request was cancelled");
+            break;
+        }
+
+        // request delegates are dispatched on the game thread, so pump them while waiting on it
+        if (IsInGameThread())
+        {
+            FHttpModule::Get().GetHttpManager().Tick(0.0f);
+        }
+
+        TArray<FAttemptResult> Results;
+        int32 NumInFlight = 0;
+        {
+            FScopeLock AttemptsLock(&AttemptsMutex);
+            Results = MoveTemp(CompletedAttempts);
+            CompletedAttempts.Reset();
+            NumInFlight = InFlightAttempts.Num();
+        }
+
+        for (FAttemptResult& Result : Results)
+        {
+            if (Result.bSucceeded)
+            {
+                OutImageData = MoveTemp(Result.Content);
+                bSuccess = true;
+                break;
+            }
+
+            OutError = Result.Error;
+
+            // some servers reject ranged requests outright, fall back to downloading everything
+            if (Result.bRangeRejected && CurrentRangeBytes > 0)
+            {
+                CurrentRangeBytes = 0;
+                LastAttemptStartTime = FPlatformTime::Seconds();
+                StartAttempt();
+                ++NumInFlight;
+            }
+            else if (!Result.bRetryable)
+            {
+                bFatalError = true;
+                break;
+            }
+        }
+
+        if (bSuccess || bFatalError)
+        {
+            break;
+        }
+
+        const double Now = FPlatformTime::Seconds();
+        double WaitSeconds = 0.1;
+
+        if (NumInFlight == 0)
+        {
+            if (NextRetryTime < 0.0)
+            {
+                if (NumRetries >= MaxRetries)
+                {
+                    break;
+                }
+                NextRetryTime = Now + GetRetryDelay(NumRetries);
+            }
+
+            if (Now >= NextRetryTime)
+            {
+                ++NumRetries;
+                NextRetryTime = -1.0;
+
+                UE_LOG(LogImageReaderHttp, Verbose, TEXT("Retrying (%d/%d) %s. Last error: %s"), NumRetries, MaxRetries, *CurrentURI, *OutError);
+
+                LastAttemptStartTime = Now;
+                StartAttempt();
+                continue;
+            }
+
+            WaitSeconds = FMath::Min(WaitSeconds, NextRetryTime - Now);
+        }
+        else if (!bHedged && HedgeDelay > 0.0)
+        {
+            const double HedgeTime = LastAttemptStartTime + HedgeDelay;
+            if (Now >= HedgeTime)
+            {
+                bHedged = true;
+
+                UE_LOG(LogImageReaderHttp, Verbose, TEXT("Hedging %s after %.3f s"), *CurrentURI, HedgeDelay);
+
+                StartAttempt();
+                continue;
+            }
+
+            WaitSeconds = FMath::Min(WaitSeconds, HedgeTime - Now);
+        }
+
+        if (IsInGameThread())
+        {
+            WaitSeconds = FMath::Min(WaitSeconds, 0.005);
+        }
+
+        AttemptCompletedEvent->Wait(FMath::Max(1, FMath::CeilToInt(float(WaitSeconds * 1000.0))));
+    }
 
-    DownloadFuture = MakeShared<TFutureState<bool>, ESPMode::ThreadSafe>();
+    // hedged or timed out attempts that are still running lost the race
+    CancelAttempts();
+    bReadInProgress = false;
+
+    if (bSuccess)
+    {
+        return MoveTemp(OutImageData);
+    }
+    return TArray<uint8>();
+}
+
+void FImageReaderHttp::StartAttempt()
+{
+    FInFlightAttempt Attempt;
+    Attempt.StartTime = FPlatformTime::Seconds();
+    Attempt.bRanged = CurrentRangeBytes > 0;
 
     // Create the Http request and add to pending request list
-    CurrentHttpRequest = FHttpModule::Get().CreateRequest();
+    Attempt.HttpRequest = FHttpModule::Get().CreateRequest();
     {
-        CurrentHttpRequest->OnProcessRequestComplete().BindRaw(this, &FImageReaderHttp::HandleImageRequest);
+        Attempt.HttpRequest->OnProcessRequestComplete().BindRaw(this, &FImageReaderHttp::HandleImageRequest);
 
-        CurrentHttpRequest->SetURL(ImageURI);
-        CurrentHttpRequest->SetVerb(TEXT("GET"));
-        CurrentHttpRequest->SetTimeout(60.0f);
-        CurrentHttpRequest->ProcessRequest();
+        Attempt.HttpRequest->SetURL(CurrentURI);
+        Attempt.HttpRequest->SetVerb(TEXT("GET"));
+        if (Attempt.bRanged)
+        {
+            Attempt.HttpRequest->SetHeader(TEXT("Range"), FString::Printf(TEXT("bytes=0-%lld"), CurrentRangeBytes - 1));
+        }
+        Attempt.HttpRequest->SetTimeout(CVarHttpTimeout.GetValueOnAnyThread());
     }
 
-    if (IsInGameThread())
+    TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = Attempt.HttpRequest;
     {
-        Flush();
+        FScopeLock AttemptsLock(&AttemptsMutex);
+        InFlightAttempts.Add(MoveTemp(Attempt));
     }
 
-    bool bResult = DownloadFuture->GetResult();
-    if (bResult)
+    HttpRequest->ProcessRequest();
+}
+
+void FImageReaderHttp::CancelAttempts()
+{
+    TArray<FInFlightAttempt> Attempts;
     {
-        return OutImageData;
+        FScopeLock AttemptsLock(&AttemptsMutex);
+        Attempts = MoveTemp(InFlightAttempts);
+        InFlightAttempts.Reset();
+        CompletedAttempts.Reset();
+    }
+
+    for (FInFlightAttempt& Attempt : Attempts)
+    {
+        Attempt.HttpRequest->OnProcessRequestComplete().Unbind();
+        Attempt.HttpRequest->CancelRequest();
+    }
+}
+
+double FImageReaderHttp::GetRetryDelay(int32 RetryIndex)
+{
+    // full jitter keeps many clients that failed together from retrying in lockstep
+    const double BaseDelay = FMath::Max(0.0f, CVarHttpRetryBaseDelay.GetValueOnAnyThread());
+    const double MaxDelay = FMath::Max(0.0f, CVarHttpRetryMaxDelay.GetValueOnAnyThread());
+    const double Delay = FMath::Min(MaxDelay, BaseDelay * double(1 << FMath::Min(RetryIndex, 30)));
+
+    return FMath::FRandRange(0.0f, float(Delay));
+}
+
+double FImageReaderHttp::GetHedgeDelay()
+{
+    const float Percentile = CVarHttpHedgePercentile.GetValueOnAnyThread();
+    if (Percentile <= 0.0f)
+    {
+        return -1.0;
+    }
+
+    TArray<float> SortedSamples;
+    {
+        FScopeLock SamplesLock(&HttpLatencyStats::SamplesMutex);
+        if (HttpLatencyStats::Samples.Num() < FMath::Max(1, CVarHttpHedgeMinSamples.GetValueOnAnyThread()))
+        {
+            return -1.0;
+        }
+        SortedSamples = HttpLatencyStats::Samples;
+    }
+
+    SortedSamples.Sort();
+
+    const int32 PercentileIndex = FMath::Clamp(FMath::CeilToInt(SortedSamples.Num() * FMath::Min(Percentile, 100.0f) * 0.01f) - 1, 0, SortedSamples.Num() - 1);
+    return FMath::Max(SortedSamples[PercentileIndex], CVarHttpHedgeMinDelay.GetValueOnAnyThread());
+}
+
+void FImageReaderHttp::RecordLatency(double Seconds)
+{
+    FScopeLock SamplesLock(&HttpLatencyStats::SamplesMutex);
+
+    if (HttpLatencyStats::Samples.Num() < HttpLatencyStats::MaxSamples)
+    {
+        HttpLatencyStats::Samples.Add(Seconds);
+    }
+    else
+    {
+        HttpLatencyStats::Samples[HttpLatencyStats::NextSampleIndex] = Seconds;
+        HttpLatencyStats::NextSampleIndex = (HttpLatencyStats::NextSampleIndex + 1) % HttpLatencyStats::MaxSamples;
     }
-    return TArray<uint8>();
 }
 
 FString FImageReaderHttp::GetLastError() const
@@ -58,43 +334,65 @@ void FImageReaderHttp::Flush()
 
 void FImageReaderHttp::Cancel()
 {
-    if (CurrentHttpRequest.IsValid() && DownloadFuture.IsValid() && !DownloadFuture->IsComplete())
-    {
-        CurrentHttpRequest->OnProcessRequestComplete().Unbind();
-        CurrentHttpRequest->CancelRequest();
-        DownloadFuture->EmplaceResult(false);
-    }
+    bCancelled = true;
+
+    CancelAttempts();
+    AttemptCompletedEvent->Trigger();
 }
 
 void FImageReaderHttp::HandleImageRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded)
 {
-    bool bSuccess = false;
-	
-	if (HttpResponse != nullptr)
-	{
-    bSuccess = (HttpResponse->GetResponseCode() == 200);
-	}
-    
-    if (bSuccess)
+    FScopeLock AttemptsLock(&AttemptsMutex);
+
+    const int32 AttemptIndex = InFlightAttempts.IndexOfByPredicate([&HttpRequest](const FInFlightAttempt& Attempt)
+    {
+        return Attempt.HttpRequest.Get() == HttpRequest.Get();
+    });
+
+    // cancelled or lost the race
+    if (AttemptIndex == INDEX_NONE)
     {
-        OutImageData.Append(HttpResponse->GetContent().GetData(), HttpResponse->GetContentLength());
+        return;
     }
-    else
+
+    const FInFlightAttempt Attempt = InFlightAttempts[AttemptIndex];
+    InFlightAttempts.RemoveAtSwap(AttemptIndex);
+
+    FAttemptResult& Result = CompletedAttempts.AddDefaulted_GetRef();
+
+    if (HttpResponse != nullptr)
     {
-        if (HttpResponse != nullptr) 
-		{
-        int32 ResponseCode = HttpResponse->GetResponseCode();
-        FString Response = HttpResponse->GetContentAsString();
-        OutError = FString::Printf(TEXT("Error code: %d, Content: %s"), ResponseCode, *Response);
+        const int32 ResponseCode = HttpResponse->GetResponseCode();
+
+        // 206 is a partial response, 200 means the server ignored the Range header and sent everything
+        Result.bSucceeded = (ResponseCode == 200) || (Attempt.bRanged && ResponseCode == 206);
+
+        if (Result.bSucceeded)
+        {
+            Result.Content = HttpResponse->GetContent();
+
+            // ranged probes are much smaller than images and would skew the hedging percentile
+            if (!Attempt.bRanged)
+            {
+                RecordLatency(FPlatformTime::Seconds() - Attempt.StartTime);
+            }
         }
-		else
-		{
-		OutError = FString::Printf(TEXT("Connection issue"));
-		}
-    }
+        else
+        {
+            FString Response = HttpResponse->GetContentAsString();
+            Result.Error = FString::Printf(TEXT("Error code: %d, Content: %s"), ResponseCode, *Response);
 
-    if (DownloadFuture && !DownloadFuture->IsComplete())
+            // 416 answers a range the server can't satisfy, 400 and 501 come from servers that don't understand the Range header.
+            // Other client errors such as 404 would fail the same way without the range
+            Result.bRangeRejected = Attempt.bRanged && (ResponseCode == 416 || ResponseCode == 400 || ResponseCode == 501);
+            Result.bRetryable = !Result.bRangeRejected && (ResponseCode <= 0 || ResponseCode == 408 || ResponseCode == 429 || ResponseCode >= 500);
+        }
+    }
+    else
     {
-        DownloadFuture->EmplaceResult(bSuccess);
+        Result.Error = FString::Printf(TEXT("Connection issue"));
+        Result.bRetryable = true;
     }
+
+    AttemptCompletedEvent->Trigger();
 }
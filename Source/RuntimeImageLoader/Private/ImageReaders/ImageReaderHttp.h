@@ -4,27 +4,75 @@
 
 #include "CoreMinimal.h"
 #include "Interfaces/IHttpRequest.h"
-#include "Async/Future.h"
+#include "HAL/ThreadSafeBool.h"
 #include "ImageReaders/IImageReader.h"
 
+/**
+ * Downloads images over http(s). Failed attempts are retried with jittered exponential backoff and a duplicate request can be
+ * issued when the first one is slower than the recent latency percentile, whichever answers first wins.
+ * Both are configured with RuntimeImageLoader.Http.* console variables.
+ */
 class FImageReaderHttp : public IImageReader
 {
 public:
+    FImageReaderHttp();
     virtual ~FImageReaderHttp();
 
     virtual TArray<uint8> ReadImage(const FString& ImageURI) override;
+    virtual TArray<uint8> ReadImageHeader(const FString& ImageURI, int64 NumBytes) override;
     virtual FString GetLastError() const override;
     virtual void Flush() override;
     virtual void Cancel() override;
 
+public:
+    /** 
+     * Non-blocking part of ReadImage/ReadImageHeader. Lets callers start many downloads before waiting on any of them.
+     * @param RangeBytes - number of leading bytes to request, 0 downloads the whole image
+     */
+    void BeginRead(const FString& ImageURI, int64 RangeBytes = 0);
+
+    /** Blocks until the download started by BeginRead has finished and returns its data. Retries and hedging happen here */
+    TArray<uint8> EndRead();
+
+    /** Randomised delay before the retry with the given index, between 0 and RetryBaseDelay * 2^RetryIndex capped at RetryMaxDelay */
+    static double GetRetryDelay(int32 RetryIndex);
+
 private:
+    struct FInFlightAttempt
+    {
+        TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest;
+        double StartTime = 0.0;
+        bool bRanged = false;
+    };
+
+    struct FAttemptResult
+    {
+        bool bSucceeded = false;
+        bool bRetryable = false;
+        bool bRangeRejected = false;
+        TArray<uint8> Content;
+        FString Error;
+    };
+
+    void StartAttempt();
+    void CancelAttempts();
+
+    static double GetHedgeDelay();
+    static void RecordLatency(double Seconds);
+
     /** Handles image requests coming from the web */
     void HandleImageRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded);
 
 private:
-    TSharedPtr<TFutureState<bool>, ESPMode::ThreadSafe> DownloadFuture;
+    FString CurrentURI;
+    int64 CurrentRangeBytes = 0;
+    bool bReadInProgress = false;
+    FThreadSafeBool bCancelled = false;
 
-    TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> CurrentHttpRequest;
+    TArray<FInFlightAttempt> InFlightAttempts;
+    TArray<FAttemptResult> CompletedAttempts;
+    FCriticalSection AttemptsMutex;
+    FEvent* AttemptCompletedEvent = nullptr;
 
     TArray<uint8> OutImageData;
     FString OutError;
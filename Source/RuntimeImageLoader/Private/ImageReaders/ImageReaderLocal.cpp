@@ -9,9 +9,6 @@ TArray<uint8> FImageReaderLocal::ReadImage(const FString& ImageURI)
 {
     QUICK_SCOPE_CYCLE_COUNTER(STAT_RuntimeImageUtils_ImportFileAsTexture);
 
-    // TODO:
-    const int64 MAX_FILESIZE_BYTES = 999999999;
-
     IFileManager& FileManager = IFileManager::Get();
     if (!FileManager.FileExists(*ImageURI))
     {
@@ -22,10 +19,10 @@ TArray<uint8> FImageReaderLocal::ReadImage(const FString& ImageURI)
     const int64 ImageFileSizeBytes = FileManager.FileSize(*ImageURI);
     check(ImageFileSizeBytes != INDEX_NONE);
 
-    // check filesize
-    if (ImageFileSizeBytes > MAX_FILESIZE_BYTES)
+    // the whole file goes into a 32-bit array, larger images of streamable formats never get here
+    if (ImageFileSizeBytes >= MAX_int32)
     {
-        OutError = FString::Printf(TEXT("Image filesize > %d MBs): %s"), MAX_FILESIZE_BYTES, *ImageURI);
+        OutError = FString::Printf(TEXT("Image file is too large to be read into memory (%lld bytes), only PNG, HDR, TIFF and EXR can be decoded from files of this size: %s"), ImageFileSizeBytes, *ImageURI);
         return TArray<uint8>();
     }
 
@@ -40,6 +37,43 @@ TArray<uint8> FImageReaderLocal::ReadImage(const FString& ImageURI)
     return OutImageData;
 }
 
+TArray<uint8> FImageReaderLocal::ReadImageHeader(const FString& ImageURI, int64 NumBytes)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageReaderLocal_ReadImageHeader);
+
+    TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*ImageURI));
+    if (!Reader.IsValid())
+    {
+        OutError = FString::Printf(TEXT("Image does not exist: %s"), *ImageURI);
+        return TArray<uint8>();
+    }
+
+    const int64 BytesToRead = FMath::Min(NumBytes, Reader->TotalSize());
+
+    TArray<uint8> HeaderData;
+    HeaderData.SetNumUninitialized(BytesToRead);
+    Reader->Serialize(HeaderData.GetData(), BytesToRead);
+
+    if (!Reader->Close())
+    {
+        OutError = FString::Printf(TEXT("Image loading I/O error: %s"), *ImageURI);
+        return TArray<uint8>();
+    }
+
+    return HeaderData;
+}
+
+TUniquePtr<FArchive> FImageReaderLocal::OpenImageArchive(const FString& ImageURI)
+{
+    TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*ImageURI));
+    if (!Reader.IsValid())
+    {
+        OutError = FString::Printf(TEXT("Image does not exist: %s"), *ImageURI);
+    }
+
+    return Reader;
+}
+
 FString FImageReaderLocal::GetLastError() const
 {
     return OutError;
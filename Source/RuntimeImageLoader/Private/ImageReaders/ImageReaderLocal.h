@@ -11,6 +11,8 @@ public:
     virtual ~FImageReaderLocal() {}
 
     virtual TArray<uint8> ReadImage(const FString& ImageURI) override;
+    virtual TArray<uint8> ReadImageHeader(const FString& ImageURI, int64 NumBytes) override;
+    virtual TUniquePtr<FArchive> OpenImageArchive(const FString& ImageURI) override;
     virtual FString GetLastError() const override;
     virtual void Flush() override;
     virtual void Cancel() override;
@@ -0,0 +1,607 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "ImageReaderZip.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/DateTime.h"
+#include "Stats/Stats.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "zlib.h"
+THIRD_PARTY_INCLUDES_END
+
+DEFINE_LOG_CATEGORY_STATIC(LogImageReaderZip, Log, All);
+
+static TAutoConsoleVariable<int32> CVarZipMaxCachedArchives(
+    TEXT("RuntimeImageLoader.Zip.MaxCachedArchives"), 4,
+    TEXT("Number of recently used zip archives whose index and mapping are kept open. Older archives are unmapped once no read uses them."));
+
+
+namespace ZipFormat
+{
+    constexpr uint32 LocalFileHeaderSignature = 0x04034b50;
+    constexpr uint32 CentralDirectoryHeaderSignature = 0x02014b50;
+    constexpr uint32 EndOfCentralDirectorySignature = 0x06054b50;
+    constexpr uint32 Zip64EndOfCentralDirectorySignature = 0x06064b50;
+    constexpr uint32 Zip64EndOfCentralDirectoryLocatorSignature = 0x07064b50;
+
+    constexpr int64 LocalFileHeaderSize = 30;
+    constexpr int64 CentralDirectoryHeaderSize = 46;
+    constexpr int64 EndOfCentralDirectorySize = 22;
+    constexpr int64 Zip64EndOfCentralDirectorySize = 56;
+    constexpr int64 Zip64EndOfCentralDirectoryLocatorSize = 20;
+
+    constexpr uint16 MethodStored = 0;
+    constexpr uint16 MethodDeflated = 8;
+    constexpr uint16 FlagEncrypted = 0x1;
+    constexpr uint16 Zip64ExtraFieldId = 0x0001;
+
+    static uint16 ReadLE16(const uint8* Data)
+    {
+        return uint16(Data[0]) | (uint16(Data[1]) << 8);
+    }
+
+    static uint32 ReadLE32(const uint8* Data)
+    {
+        return uint32(Data[0]) | (uint32(Data[1]) << 8) | (uint32(Data[2]) << 16) | (uint32(Data[3]) << 24);
+    }
+
+    static uint64 ReadLE64(const uint8* Data)
+    {
+        return uint64(ReadLE32(Data)) | (uint64(ReadLE32(Data + 4)) << 32);
+    }
+}
+
+struct FZipEntry
+{
+    int64 LocalHeaderOffset = 0;
+    int64 CompressedSize = 0;
+    int64 UncompressedSize = 0;
+    uint16 Method = 0;
+    uint16 Flags = 0;
+};
+
+/** Zip entry names are case sensitive, unlike the default FString keys */
+struct FZipEntryKeyFuncs : TDefaultMapKeyFuncs<FString, FZipEntry, false>
+{
+    static bool Matches(const FString& A, const FString& B)
+    {
+        return A.Equals(B, ESearchCase::CaseSensitive);
+    }
+
+    static uint32 GetKeyHash(const FString& Key)
+    {
+        return FCrc::StrCrc32(*Key);
+    }
+};
+
+/** Central directory of a single archive. Immutable once built, so any number of readers can use it concurrently */
+class FZipArchiveIndex
+{
+public:
+    static TSharedPtr<FZipArchiveIndex, ESPMode::ThreadSafe> FindOrCreate(const FString& ArchivePath, FString& OutError);
+    static void ClearCache();
+
+    const FZipEntry* FindEntry(const FString& EntryPath) const;
+    bool GetEntryData(const FZipEntry& Entry, const uint8*& OutData, FString& OutError) const;
+
+private:
+    bool Open(const FString& ArchivePath, FString& OutError);
+    bool BuildIndex(FString& OutError);
+    static void ParseZip64ExtraField(const uint8* ExtraField, int64 ExtraFieldLength, FZipEntry& InOutEntry);
+
+private:
+    // region must be released before the handle, members are destroyed in reverse order
+    TUniquePtr<IMappedFileHandle> MappedHandle;
+    TUniquePtr<IMappedFileRegion> MappedRegion;
+
+    // used on platforms that can't memory map files
+    TArray64<uint8> FileData;
+
+    const uint8* Data = nullptr;
+    int64 Size = 0;
+    FDateTime TimeStamp;
+
+    TMap<FString, FZipEntry, FDefaultSetAllocator, FZipEntryKeyFuncs> Entries;
+
+    struct FCachedArchive
+    {
+        FString ArchivePath;
+        TSharedPtr<FZipArchiveIndex, ESPMode::ThreadSafe> Index;
+    };
+
+    static FCriticalSection CacheMutex;
+    // least recently used first
+    static TArray<FCachedArchive> Cache;
+};
+
+FCriticalSection FZipArchiveIndex::CacheMutex;
+TArray<FZipArchiveIndex::FCachedArchive> FZipArchiveIndex::Cache;
+
+TSharedPtr<FZipArchiveIndex, ESPMode::ThreadSafe> FZipArchiveIndex::FindOrCreate(const FString& ArchivePath, FString& OutError)
+{
+    const FString FullArchivePath = FPaths::ConvertRelativePathToFull(ArchivePath);
+    const FDateTime ArchiveTimeStamp = IFileManager::Get().GetTimeStamp(*FullArchivePath);
+
+    if (ArchiveTimeStamp == FDateTime::MinValue())
+    {
+        OutError = FString::Printf(TEXT("Zip archive does not exist: %s"), *FullArchivePath);
+        return nullptr;
+    }
+
+    auto FindCached = [&FullArchivePath, &ArchiveTimeStamp]() -> TSharedPtr<FZipArchiveIndex, ESPMode::ThreadSafe>
+    {
+        const int32 CacheIndex = Cache.IndexOfByPredicate([&FullArchivePath](const FCachedArchive& Cached) { return Cached.ArchivePath == FullArchivePath; });
+        if (CacheIndex == INDEX_NONE)
+        {
+            return nullptr;
+        }
+
+        // archive replaced on disk -> readers still holding the old index keep using their mapping
+        FCachedArchive Cached = MoveTemp(Cache[CacheIndex]);
+        Cache.RemoveAt(CacheIndex);
+        if (Cached.Index->TimeStamp != ArchiveTimeStamp)
+        {
+            return nullptr;
+        }
+
+        TSharedPtr<FZipArchiveIndex, ESPMode::ThreadSafe> Index = Cached.Index;
+        Cache.Add(MoveTemp(Cached));
+        return Index;
+    };
+
+    {
+        FScopeLock CacheLock(&CacheMutex);
+        if (TSharedPtr<FZipArchiveIndex, ESPMode::ThreadSafe> CachedIndex = FindCached())
+        {
+            return CachedIndex;
+        }
+    }
+
+    // mapping and parsing a large central directory must not hold up loads from other archives
+    TSharedPtr<FZipArchiveIndex, ESPMode::ThreadSafe> NewIndex = MakeShared<FZipArchiveIndex, ESPMode::ThreadSafe>();
+    if (!NewIndex->Open(FullArchivePath, OutError))
+    {
+        return nullptr;
+    }
+    NewIndex->TimeStamp = ArchiveTimeStamp;
+
+    FScopeLock CacheLock(&CacheMutex);
+
+    // another reader indexed the same archive in the meantime
+    if (TSharedPtr<FZipArchiveIndex, ESPMode::ThreadSafe> CachedIndex = FindCached())
+    {
+        return CachedIndex;
+    }
+
+    Cache.Add({ FullArchivePath, NewIndex });
+
+    // evicted archives stay mapped until the reads that still use them finish
+    const int32 MaxCachedArchives = FMath::Max(CVarZipMaxCachedArchives.GetValueOnAnyThread(), 0);
+    if (Cache.Num() > MaxCachedArchives)
+    {
+        Cache.RemoveAt(0, Cache.Num() - MaxCachedArchives);
+    }
+
+    return NewIndex;
+}
+
+void FZipArchiveIndex::ClearCache()
+{
+    FScopeLock CacheLock(&CacheMutex);
+    Cache.Empty();
+}
+
+const FZipEntry* FZipArchiveIndex::FindEntry(const FString& EntryPath) const
+{
+    return Entries.Find(EntryPath);
+}
+
+bool FZipArchiveIndex::GetEntryData(const FZipEntry& Entry, const uint8*& OutData, FString& OutError) const
+{
+    using namespace ZipFormat;
+
+    if (Entry.LocalHeaderOffset < 0 || Entry.LocalHeaderOffset > Size || Size - Entry.LocalHeaderOffset < LocalFileHeaderSize)
+    {
+        OutError = TEXT("Zip entry local header is out of bounds");
+        return false;
+    }
+
+    const uint8* LocalHeader = Data + Entry.LocalHeaderOffset;
+    if (ReadLE32(LocalHeader) != LocalFileHeaderSignature)
+    {
+        OutError = TEXT("Zip entry local header is corrupted");
+        return false;
+    }
+
+    // local name and extra field lengths may differ from the central directory ones
+    const int64 DataOffset = Entry.LocalHeaderOffset + LocalFileHeaderSize + ReadLE16(LocalHeader + 26) + ReadLE16(LocalHeader + 28);
+    if (DataOffset > Size || Entry.CompressedSize < 0 || Entry.CompressedSize > Size - DataOffset)
+    {
+        OutError = TEXT("Zip entry data is out of bounds");
+        return false;
+    }
+
+    OutData = Data + DataOffset;
+    return true;
+}
+
+bool FZipArchiveIndex::Open(const FString& ArchivePath, FString& OutError)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FZipArchiveIndex_Open);
+
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+    MappedHandle.Reset(PlatformFile.OpenMapped(*ArchivePath));
+    if (MappedHandle.IsValid())
+    {
+        MappedRegion.Reset(MappedHandle->MapRegion(0, MappedHandle->GetFileSize()));
+    }
+
+    if (MappedRegion.IsValid())
+    {
+        Data = MappedRegion->GetMappedPtr();
+        Size = MappedRegion->GetMappedSize();
+    }
+    else
+    {
+        UE_LOG(LogImageReaderZip, Warning, TEXT("Memory mapping is not available, loading the whole archive into memory: %s"), *ArchivePath);
+
+        MappedRegion.Reset();
+        MappedHandle.Reset();
+
+        if (!FFileHelper::LoadFileToArray(FileData, *ArchivePath))
+        {
+            OutError = FString::Printf(TEXT("Zip archive loading I/O error: %s"), *ArchivePath);
+            return false;
+        }
+
+        Data = FileData.GetData();
+        Size = FileData.Num();
+    }
+
+    if (!BuildIndex(OutError))
+    {
+        OutError = FString::Printf(TEXT("%s: %s"), *OutError, *ArchivePath);
+        return false;
+    }
+
+    UE_LOG(LogImageReaderZip, Log, TEXT("Indexed %d entries of zip archive: %s"), Entries.Num(), *ArchivePath);
+
+    return true;
+}
+
+bool FZipArchiveIndex::BuildIndex(FString& OutError)
+{
+    using namespace ZipFormat;
+
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FZipArchiveIndex_BuildIndex);
+
+    if (Size < EndOfCentralDirectorySize)
+    {
+        OutError = TEXT("File is too small to be a zip archive");
+        return false;
+    }
+
+    // end of central directory record is followed by a comment of up to 64 KB
+    const int64 SearchEnd = FMath::Max<int64>(0, Size - EndOfCentralDirectorySize - MAX_uint16);
+    int64 EndOfCentralDirectoryOffset = INDEX_NONE;
+
+    for (int64 Offset = Size - EndOfCentralDirectorySize; Offset >= SearchEnd; --Offset)
+    {
+        if (ReadLE32(Data + Offset) == EndOfCentralDirectorySignature)
+        {
+            EndOfCentralDirectoryOffset = Offset;
+            break;
+        }
+    }
+
+    if (EndOfCentralDirectoryOffset == INDEX_NONE)
+    {
+        OutError = TEXT("End of central directory record not found");
+        return false;
+    }
+
+    const uint8* EndOfCentralDirectory = Data + EndOfCentralDirectoryOffset;
+    uint64 NumEntries = ReadLE16(EndOfCentralDirectory + 10);
+    uint64 CentralDirectorySize = ReadLE32(EndOfCentralDirectory + 12);
+    uint64 CentralDirectoryOffset = ReadLE32(EndOfCentralDirectory + 16);
+
+    if (NumEntries == MAX_uint16 || CentralDirectorySize == MAX_uint32 || CentralDirectoryOffset == MAX_uint32)
+    {
+        const int64 LocatorOffset = EndOfCentralDirectoryOffset - Zip64EndOfCentralDirectoryLocatorSize;
+        if (LocatorOffset < 0 || ReadLE32(Data + LocatorOffset) != Zip64EndOfCentralDirectoryLocatorSignature)
+        {
+            OutError = TEXT("Zip64 end of central directory locator not found");
+            return false;
+        }
+
+        const uint64 Zip64Offset = ReadLE64(Data + LocatorOffset + 8);
+        // a crafted offset must not wrap the bounds check around
+        if (Zip64Offset > uint64(Size) || uint64(Size) - Zip64Offset < uint64(Zip64EndOfCentralDirectorySize) || ReadLE32(Data + Zip64Offset) != Zip64EndOfCentralDirectorySignature)
+        {
+            OutError = TEXT("Zip64 end of central directory record is corrupted");
+            return false;
+        }
+
+        NumEntries = ReadLE64(Data + Zip64Offset + 32);
+        CentralDirectorySize = ReadLE64(Data + Zip64Offset + 40);
+        CentralDirectoryOffset = ReadLE64(Data + Zip64Offset + 48);
+    }
+
+    if (CentralDirectoryOffset > uint64(Size) || CentralDirectorySize > uint64(Size) - CentralDirectoryOffset)
+    {
+        OutError = TEXT("Central directory is out of bounds");
+        return false;
+    }
+
+    // every entry takes at least a fixed-size header, this also guards against absurd entry counts
+    if (NumEntries > CentralDirectorySize / CentralDirectoryHeaderSize)
+    {
+        OutError = TEXT("Central directory entry count is corrupted");
+        return false;
+    }
+
+    Entries.Reserve(NumEntries);
+
+    int64 Offset = CentralDirectoryOffset;
+    const int64 CentralDirectoryEnd = CentralDirectoryOffset + CentralDirectorySize;
+
+    for (uint64 EntryIndex = 0; EntryIndex < NumEntries; ++EntryIndex)
+    {
+        if (Offset + CentralDirectoryHeaderSize > CentralDirectoryEnd || ReadLE32(Data + Offset) != CentralDirectoryHeaderSignature)
+        {
+            OutError = TEXT("Central directory is corrupted");
+            return false;
+        }
+
+        const uint8* Header = Data + Offset;
+        const int64 NameLength = ReadLE16(Header + 28);
+        const int64 ExtraFieldLength = ReadLE16(Header + 30);
+        const int64 CommentLength = ReadLE16(Header + 32);
+
+        if (Offset + CentralDirectoryHeaderSize + NameLength + ExtraFieldLength + CommentLength > CentralDirectoryEnd)
+        {
+            OutError = TEXT("Central directory is corrupted");
+            return false;
+        }
+
+        FZipEntry Entry;
+        Entry.Flags = ReadLE16(Header + 8);
+        Entry.Method = ReadLE16(Header + 10);
+        Entry.CompressedSize = ReadLE32(Header + 20);
+        Entry.UncompressedSize = ReadLE32(Header + 24);
+        Entry.LocalHeaderOffset = ReadLE32(Header + 42);
+
+        const uint8* Name = Header + CentralDirectoryHeaderSize;
+        ParseZip64ExtraField(Name + NameLength, ExtraFieldLength, Entry);
+
+        Offset += CentralDirectoryHeaderSize + NameLength + ExtraFieldLength + CommentLength;
+
+        // UTF-8 names are flagged with bit 11, legacy CP437 names are decoded the same way which is exact for ASCII
+        FUTF8ToTCHAR NameConverter(reinterpret_cast<const ANSICHAR*>(Name), NameLength);
+        FString EntryPath(NameConverter.Length(), NameConverter.Get());
+        EntryPath.ReplaceInline(TEXT("\\"), TEXT("/"));
+
+        // skip directories
+        if (EntryPath.IsEmpty() || EntryPath.EndsWith(TEXT("/")))
+        {
+            continue;
+        }
+
+        Entries.Add(MoveTemp(EntryPath), Entry);
+    }
+
+    return true;
+}
+
+void FZipArchiveIndex::ParseZip64ExtraField(const uint8* ExtraField, int64 ExtraFieldLength, FZipEntry& InOutEntry)
+{
+    using namespace ZipFormat;
+
+    int64 Position = 0;
+    while (Position + 4 <= ExtraFieldLength)
+    {
+        const uint16 FieldId = ReadLE16(ExtraField + Position);
+        const int64 FieldSize = ReadLE16(ExtraField + Position + 2);
+        const uint8* FieldData = ExtraField + Position + 4;
+
+        if (Position + 4 + FieldSize > ExtraFieldLength)
+        {
+            return;
+        }
+
+        if (FieldId == Zip64ExtraFieldId)
+        {
+            // only the values that overflowed in the central directory header are present, in this order
+            int64 FieldPosition = 0;
+            if (InOutEntry.UncompressedSize == MAX_uint32 && FieldPosition + 8 <= FieldSize)
+            {
+                InOutEntry.UncompressedSize = ReadLE64(FieldData + FieldPosition);
+                FieldPosition += 8;
+            }
+            if (InOutEntry.CompressedSize == MAX_uint32 && FieldPosition + 8 <= FieldSize)
+            {
+                InOutEntry.CompressedSize = ReadLE64(FieldData + FieldPosition);
+                FieldPosition += 8;
+            }
+            if (InOutEntry.LocalHeaderOffset == MAX_uint32 && FieldPosition + 8 <= FieldSize)
+            {
+                InOutEntry.LocalHeaderOffset = ReadLE64(FieldData + FieldPosition);
+            }
+            return;
+        }
+
+        Position += 4 + FieldSize;
+    }
+}
+
+// ------------------------------------------------------
+
+static bool SplitZipURI(const FString& ImageURI, FString& OutArchivePath, FString& OutEntryPath)
+{
+    static const FString ZipScheme = TEXT("zip://");
+
+    if (!ImageURI.StartsWith(ZipScheme))
+    {
+        return false;
+    }
+
+    if (!ImageURI.RightChop(ZipScheme.Len()).Split(TEXT("!/"), &OutArchivePath, &OutEntryPath))
+    {
+        return false;
+    }
+
+    return !OutArchivePath.IsEmpty() && !OutEntryPath.IsEmpty();
+}
+
+/** Inflates a raw deflate stream. With bAllowPartial the output may be shorter than the full stream, used for header reads */
+static bool InflateRaw(const uint8* CompressedData, int64 CompressedSize, uint8* OutData, int64 OutSize, bool bAllowPartial)
+{
+    if (CompressedSize > MAX_uint32 || OutSize > MAX_uint32)
+    {
+        return false;
+    }
+
+    z_stream Stream;
+    FMemory::Memzero(Stream);
+    Stream.next_in = const_cast<Bytef*>(CompressedData);
+    Stream.avail_in = static_cast<uInt>(CompressedSize);
+    Stream.next_out = OutData;
+    Stream.avail_out = static_cast<uInt>(OutSize);
+
+    // negative window bits select a raw deflate stream without the zlib header
+    if (inflateInit2(&Stream, -MAX_WBITS) != Z_OK)
+    {
+        return false;
+    }
+
+    const int32 Result = inflate(&Stream, Z_FINISH);
+    const bool bOutputFull = Stream.avail_out == 0;
+    inflateEnd(&Stream);
+
+    return Result == Z_STREAM_END || (bAllowPartial && bOutputFull);
+}
+
+TArray<uint8> FImageReaderZip::ReadImage(const FString& ImageURI)
+{
+    return ReadEntry(ImageURI, 0);
+}
+
+TArray<uint8> FImageReaderZip::ReadImageHeader(const FString& ImageURI, int64 NumBytes)
+{
+    return ReadEntry(ImageURI, NumBytes);
+}
+
+TArray<uint8> FImageReaderZip::ReadEntry(const FString& ImageURI, int64 MaxBytes)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageReaderZip_ReadEntry);
+
+    using namespace ZipFormat;
+
+    FString ArchivePath, EntryPath;
+    if (!SplitZipURI(ImageURI, ArchivePath, EntryPath))
+    {
+        OutError = FString::Printf(TEXT("Invalid zip URI, expected zip://Archive.zip!/Path/In/Archive.png: %s"), *ImageURI);
+        return TArray<uint8>();
+    }
+
+    TSharedPtr<FZipArchiveIndex, ESPMode::ThreadSafe> ArchiveIndex = FZipArchiveIndex::FindOrCreate(ArchivePath, OutError);
+    if (!ArchiveIndex.IsValid())
+    {
+        return TArray<uint8>();
+    }
+
+    const FZipEntry* Entry = ArchiveIndex->FindEntry(EntryPath);
+    if (Entry == nullptr)
+    {
+        OutError = FString::Printf(TEXT("Image does not exist in zip archive: %s"), *ImageURI);
+        return TArray<uint8>();
+    }
+
+    if (Entry->Flags & FlagEncrypted)
+    {
+        OutError = FString::Printf(TEXT("Encrypted zip entries are not supported: %s"), *ImageURI);
+        return TArray<uint8>();
+    }
+
+    if (Entry->UncompressedSize > MAX_int32)
+    {
+        OutError = FString::Printf(TEXT("Zip entry is too large: %lld bytes: %s"), Entry->UncompressedSize, *ImageURI);
+        return TArray<uint8>();
+    }
+
+    const uint8* EntryData = nullptr;
+    if (!ArchiveIndex->GetEntryData(*Entry, EntryData, OutError))
+    {
+        return TArray<uint8>();
+    }
+
+    const int64 OutputSize = (MaxBytes > 0) ? FMath::Min(MaxBytes, Entry->UncompressedSize) : Entry->UncompressedSize;
+
+    TArray<uint8> ImageData;
+    ImageData.SetNumUninitialized(OutputSize);
+
+    switch (Entry->Method)
+    {
+        case MethodStored:
+        {
+            if (Entry->CompressedSize < OutputSize)
+            {
+                OutError = FString::Printf(TEXT("Zip entry is corrupted: %s"), *ImageURI);
+                return TArray<uint8>();
+            }
+
+            FMemory::Memcpy(ImageData.GetData(), EntryData, OutputSize);
+            break;
+        }
+
+        case MethodDeflated:
+        {
+            if (!InflateRaw(EntryData, Entry->CompressedSize, ImageData.GetData(), OutputSize, MaxBytes > 0))
+            {
+                OutError = FString::Printf(TEXT("Failed to inflate zip entry: %s"), *ImageURI);
+                return TArray<uint8>();
+            }
+            break;
+        }
+
+        default:
+        {
+            OutError = FString::Printf(TEXT("Unsupported zip compression method %d: %s"), Entry->Method, *ImageURI);
+            return TArray<uint8>();
+        }
+    }
+
+    return ImageData;
+}
+
+FString FImageReaderZip::GetLastError() const
+{
+    return OutError;
+}
+
+void FImageReaderZip::Flush()
+{
+    // reads are synchronous
+}
+
+void FImageReaderZip::Cancel()
+{
+    // reads are synchronous
+}
+
+bool FImageReaderZip::IsZipURI(const FString& ImageURI)
+{
+    return ImageURI.StartsWith(TEXT("zip://"));
+}
+
+void FImageReaderZip::ClearArchiveCache()
+{
+    FZipArchiveIndex::ClearCache();
+}
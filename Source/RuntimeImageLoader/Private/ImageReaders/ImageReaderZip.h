@@ -0,0 +1,36 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageReaders/IImageReader.h"
+
+class FZipArchiveIndex;
+
+/**
+ * Reads images stored inside zip archives without extracting them: zip://Path/To/Archive.zip!/Path/In/Archive.png
+ * The central directory of each archive is parsed once and shared by all readers, entries are served from a memory mapped archive.
+ * Only the most recently used archives stay indexed and mapped, see RuntimeImageLoader.Zip.MaxCachedArchives. Entry names are case sensitive.
+ */
+class FImageReaderZip : public IImageReader
+{
+public:
+    virtual ~FImageReaderZip() {}
+
+    virtual TArray<uint8> ReadImage(const FString& ImageURI) override;
+    virtual TArray<uint8> ReadImageHeader(const FString& ImageURI, int64 NumBytes) override;
+    virtual FString GetLastError() const override;
+    virtual void Flush() override;
+    virtual void Cancel() override;
+
+    static bool IsZipURI(const FString& ImageURI);
+
+    /** Drops cached central directory indices, archives are reopened and reindexed on next access */
+    static void ClearArchiveCache();
+
+private:
+    TArray<uint8> ReadEntry(const FString& ImageURI, int64 MaxBytes);
+
+private:
+    FString OutError;
+};
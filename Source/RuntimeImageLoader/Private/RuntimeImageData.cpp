@@ -1,6 +1,7 @@
 // Copyright 2023 Petr Leontev. All Rights Reserved.
 
 #include "RuntimeImageData.h"
+#include "RHI.h"
 
 // Duplicate the code in "int32 FTextureSource::GetBytesPerPixel(ETextureSourceFormat Format)"
 // Because that was Editor only code
@@ -15,6 +16,11 @@ int32 GetBytesPerPixel(ETextureSourceFormat Format)
 	    case TSF_BGRE8:		BytesPerPixel = 4; break;
 	    case TSF_RGBA16:	BytesPerPixel = 8; break;
 	    case TSF_RGBA16F:	BytesPerPixel = 8; break;
+#if (ENGINE_MAJOR_VERSION == 5) && (ENGINE_MINOR_VERSION >= 1)
+	    case TSF_RGBA32F:	BytesPerPixel = 16; break;
+	    case TSF_R16F:		BytesPerPixel = 2; break;
+	    case TSF_R32F:		BytesPerPixel = 4; break;
+#endif
 	    default:			BytesPerPixel = 0; break;
 	}
 	return BytesPerPixel;
@@ -33,6 +39,11 @@ ERawImageFormat::Type ToRawImageFormat(ETextureSourceFormat SourceFormat)
         case TSF_BGRE8:		return ERawImageFormat::BGRE8;
         case TSF_RGBA16:	return ERawImageFormat::RGBA16;
         case TSF_RGBA16F:	return ERawImageFormat::RGBA16F;
+#if (ENGINE_MAJOR_VERSION == 5) && (ENGINE_MINOR_VERSION >= 1)
+        case TSF_RGBA32F:	return ERawImageFormat::RGBA32F;
+        case TSF_R16F:		return ERawImageFormat::R16F;
+        case TSF_R32F:		return ERawImageFormat::R32F;
+#endif
     }
     checkNoEntry();
 	return ERawImageFormat::BGRA8;
@@ -42,17 +53,103 @@ void FRuntimeImageData::Init2D(int32 InSizeX, int32 InSizeY, ETextureSourceForma
 {
     SizeX = InSizeX;
     SizeY = InSizeY;
+    SourceSizeX = InSizeX;
+    SourceSizeY = InSizeY;
     NumSlices = 1;
     NumMips = 1;
     TextureSourceFormat = InFormat;
     Format = ToRawImageFormat(InFormat);
+    bBlockCompressed = false;
 
-    const int32 RawDataSize = SizeX * SizeY * GetBytesPerPixel();
+    // 64-bit so that images above 2 GB of pixel data don't overflow
+    const int64 RawDataSize = int64(SizeX) * SizeY * GetBytesPerPixel();
 
-    RawData.AddUninitialized(RawDataSize);
+    RawData.SetNumUninitialized(RawDataSize);
 
     if (InData)
     {
         FMemory::Memcpy(RawData.GetData(), InData, RawData.Num());
     }
 }
+
+void FRuntimeImageData::Init2D(int32 InSizeX, int32 InSizeY, ETextureSourceFormat InFormat, TArray64<uint8>&& InData)
+{
+    SizeX = InSizeX;
+    SizeY = InSizeY;
+    SourceSizeX = InSizeX;
+    SourceSizeY = InSizeY;
+    NumSlices = 1;
+    NumMips = 1;
+    TextureSourceFormat = InFormat;
+    Format = ToRawImageFormat(InFormat);
+    bBlockCompressed = false;
+
+    RawData = MoveTemp(InData);
+
+    const int64 RawDataSize = int64(SizeX) * SizeY * GetBytesPerPixel();
+    if (!ensureMsgf(RawData.Num() >= RawDataSize, TEXT("Decoded image holds %lld bytes, %lld expected"), RawData.Num(), RawDataSize))
+    {
+        RawData.SetNumZeroed(RawDataSize);
+    }
+}
+
+void FRuntimeImageData::InitBlockCompressed(int32 InSizeX, int32 InSizeY, int32 InNumMips, int32 InNumFaces, EPixelFormat InPixelFormat, TArray64<uint8>&& InData)
+{
+    SizeX = InSizeX;
+    SizeY = InSizeY;
+    SourceSizeX = InSizeX;
+    SourceSizeY = InSizeY;
+    NumSlices = InNumFaces;
+    NumMips = InNumMips;
+    PixelFormat = InPixelFormat;
+    // FImage can't describe the blocks, nothing on the CPU side may interpret RawData as pixels
+    TextureSourceFormat = TSF_Invalid;
+    Format = ERawImageFormat::BGRA8;
+    bBlockCompressed = true;
+
+    RawData = MoveTemp(InData);
+
+    const int64 RawDataSize = GetMipOffset(0, NumSlices);
+    if (!ensureMsgf(RawData.Num() >= RawDataSize, TEXT("Block compressed image holds %lld bytes, %lld expected"), RawData.Num(), RawDataSize))
+    {
+        RawData.SetNumZeroed(RawDataSize);
+    }
+}
+
+int64 FRuntimeImageData::GetPixelFormatImageSize(EPixelFormat InPixelFormat, int32 InSizeX, int32 InSizeY)
+{
+    const FPixelFormatInfo& FormatInfo = GPixelFormats[InPixelFormat];
+    const int64 NumBlocksX = FMath::DivideAndRoundUp(InSizeX, FormatInfo.BlockSizeX);
+    const int64 NumBlocksY = FMath::DivideAndRoundUp(InSizeY, FormatInfo.BlockSizeY);
+
+    return NumBlocksX * NumBlocksY * FormatInfo.BlockBytes;
+}
+
+uint32 FRuntimeImageData::GetMipPitch(int32 MipIndex) const
+{
+    const FPixelFormatInfo& FormatInfo = GPixelFormats[PixelFormat];
+    const int32 MipSizeX = FMath::Max(SizeX >> MipIndex, 1);
+
+    return uint32(FMath::DivideAndRoundUp(MipSizeX, FormatInfo.BlockSizeX) * FormatInfo.BlockBytes);
+}
+
+int64 FRuntimeImageData::GetMipSize(int32 MipIndex) const
+{
+    return GetPixelFormatImageSize(PixelFormat, FMath::Max(SizeX >> MipIndex, 1), FMath::Max(SizeY >> MipIndex, 1));
+}
+
+int64 FRuntimeImageData::GetMipOffset(int32 MipIndex, int32 FaceIndex) const
+{
+    int64 FaceSize = 0;
+    int64 MipOffset = 0;
+    for (int32 Mip = 0; Mip < NumMips; ++Mip)
+    {
+        if (Mip == MipIndex)
+        {
+            MipOffset = FaceSize;
+        }
+        FaceSize += GetMipSize(Mip);
+    }
+
+    return FaceSize * FaceIndex + MipOffset;
+}
@@ -5,11 +5,21 @@
 #include "UObject/WeakObjectPtr.h"
 #include "HAL/Platform.h"
 #include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/IConsoleManager.h"
 #include "GenericPlatform/GenericPlatformFile.h"
 #include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 #include "Interfaces/IPluginManager.h"
 #include "RuntimeImageUtils.h"
 #include "InputImageDescription.h"
+#include "ImageReaders/ImageHeaderProbe.h"
+#include "Helpers/ImageDirectoryScanner.h"
+#include "Helpers/ImageDirectoryWatcher.h"
+#include "ImageReaders/ImageReaderDataUri.h"
+#include "RenderUtils.h"
+#include "TextureResource.h"
+#include "Runtime/Launch/Resources/Version.h"
 
 THIRD_PARTY_INCLUDES_START
 #define STB_IMAGE_IMPLEMENTATION
@@ -19,6 +29,40 @@ THIRD_PARTY_INCLUDES_END
 
 DEFINE_LOG_CATEGORY_STATIC(LogRuntimeImageLoader, Log, All);
 
+static TAutoConsoleVariable<int32> CVarPrefetchMaxMegabytes(
+    TEXT("RuntimeImageLoader.Prefetch.MaxMegabytes"), 512,
+    TEXT("Memory budget of prefetched bytes, pixels and textures that were not consumed yet. The least recently prefetched images are dropped first."));
+
+static int64 GetPrefetchedImageSizeBytes(const FPrefetchedImage& PrefetchedImage)
+{
+    int64 SizeBytes = PrefetchedImage.ImageBytes.Num();
+
+    if (PrefetchedImage.ImageData.IsValid())
+    {
+        SizeBytes += PrefetchedImage.ImageData->RawData.Num();
+    }
+
+    if (IsValid(PrefetchedImage.Texture))
+    {
+#if ENGINE_MAJOR_VERSION < 5
+        const FTextureResource* TextureResource = PrefetchedImage.Texture->Resource;
+#else
+        const FTextureResource* TextureResource = PrefetchedImage.Texture->GetResource();
+#endif
+        if (TextureResource != nullptr && TextureResource->TextureRHI.IsValid())
+        {
+            const FIntVector TextureSize = TextureResource->TextureRHI->GetSizeXYZ();
+            const EPixelFormat PixelFormat = TextureResource->TextureRHI->GetFormat();
+            for (uint32 MipIndex = 0; MipIndex < TextureResource->TextureRHI->GetNumMips(); ++MipIndex)
+            {
+                SizeBytes += CalculateImageBytes(FMath::Max(TextureSize.X >> MipIndex, 1), FMath::Max(TextureSize.Y >> MipIndex, 1), 0, PixelFormat);
+            }
+        }
+    }
+
+    return SizeBytes;
+}
+
 void URuntimeImageLoader::Initialize(FSubsystemCollectionBase& Collection)
 {
     InitializeImageReader();
@@ -26,6 +70,12 @@ void URuntimeImageLoader::Initialize(FSubsystemCollectionBase& Collection)
 
 void URuntimeImageLoader::Deinitialize()
 {
+    ClearPrefetchedImages();
+
+    WatchedDirectories.Empty();
+    WatchedTextures.Empty();
+    PendingWatchedLoads.Empty();
+
     ImageReader->Deinitialize();
     ImageReader = nullptr;
 }
@@ -42,9 +92,14 @@ void URuntimeImageLoader::LoadImageAsync(const FString& ImageFilename, const FTr
         return;
     }
 
+    LoadInputImageAsync(FInputImageDescription(ImageFilename), TransformParams, OutTexture, bSuccess, OutError, LatentInfo);
+}
+
+void URuntimeImageLoader::LoadInputImageAsync(FInputImageDescription&& InputImage, const FTransformImageParams& TransformParams, UTexture2D*& OutTexture, bool& bSuccess, FString& OutError, FLatentActionInfo LatentInfo)
+{
     FLoadImageRequest Request;
     {
-        Request.Params.InputImage = FInputImageDescription(ImageFilename);
+        Request.Params.InputImage = MoveTemp(InputImage);
         Request.Params.TransformParams = TransformParams;
 
         Request.OnRequestCompleted.BindLambda(
@@ -85,7 +140,7 @@ void URuntimeImageLoader::LoadImageAsync(const FString& ImageFilename, const FTr
         );
     }
 
-    Requests.Enqueue(Request);
+    Requests.Enqueue(MoveTemp(Request));
 }
 
 void URuntimeImageLoader::LoadImageFromBytesAsync(UPARAM(ref) TArray<uint8>& ImageBytes, const FTransformImageParams& TransformParams, UTexture2D*& OutTexture, bool& bSuccess, FString& OutError, FLatentActionInfo LatentInfo, UObject* WorldContextObject /*= nullptr*/)
@@ -141,6 +196,27 @@ void URuntimeImageLoader::LoadImageFromBytesAsync(UPARAM(ref) TArray<uint8>& Ima
     Requests.Enqueue(Request);
 }
 
+void URuntimeImageLoader::LoadImageFromBase64Async(const FString& ImageBase64, const FTransformImageParams& TransformParams, UTexture2D*& OutTexture, bool& bSuccess, FString& OutError, FLatentActionInfo LatentInfo, UObject* WorldContextObject /*= nullptr*/)
+{
+    if (!IsValid(WorldContextObject))
+    {
+        return;
+    }
+
+    // raw base64 is handed over as it is, nothing is decoded or concatenated on the game thread
+    FInputImageDescription InputImage;
+    if (FImageReaderDataUri::IsDataURI(ImageBase64))
+    {
+        InputImage.ImageFilename = ImageBase64;
+    }
+    else
+    {
+        InputImage.ImageBase64 = ImageBase64;
+    }
+
+    LoadInputImageAsync(MoveTemp(InputImage), TransformParams, OutTexture, bSuccess, OutError, LatentInfo);
+}
+
 void URuntimeImageLoader::LoadHDRIAsCubemapAsync(const FString& ImageFilename, const FTransformImageParams& TransformParams, UTextureCube*& OutTextureCube, bool& bSuccess, FString& OutError, FLatentActionInfo LatentInfo, UObject* WorldContextObject /*= nullptr*/)
 {
     if (!IsValid(WorldContextObject))
@@ -209,6 +285,8 @@ void URuntimeImageLoader::LoadImageSync(const FString& ImageFilename, const FTra
     {
         ReadRequest.InputImage = FInputImageDescription(ImageFilename);
         ReadRequest.TransformParams = TransformParams;
+        // nothing could show a preview before a blocking load returns
+        ReadRequest.TransformParams.bProgressivePreview = false;
     }
 
     ImageReader->BlockTillAllRequestsFinished();
@@ -229,6 +307,8 @@ void URuntimeImageLoader::LoadImageFromBytesSync(UPARAM(ref) TArray<uint8>& Imag
     {
         ReadRequest.InputImage = FInputImageDescription(MoveTemp(ImageBytes));
         ReadRequest.TransformParams = TransformParams;
+        // nothing could show a preview before a blocking load returns
+        ReadRequest.TransformParams.bProgressivePreview = false;
     }
 
     ImageReader->BlockTillAllRequestsFinished();
@@ -299,26 +379,122 @@ void URuntimeImageLoader::LoadImagePixels(const FInputImageDescription& InputIma
 
 void URuntimeImageLoader::GetImageResolution(const FString& ImageFilename, int32& OutWidth, int32& OutHeight, int32& OutChannels, bool& bSuccess, FString& OutError)
 {
-    if (stbi_info(TCHAR_TO_ANSI(*ImageFilename), &OutWidth, &OutHeight, &OutChannels) == 1)
+    FImageHeaderInfo ImageInfo;
+    bSuccess = FImageHeaderProbe::Probe(ImageFilename, ImageInfo);
+
+    OutWidth = ImageInfo.Width;
+    OutHeight = ImageInfo.Height;
+    OutChannels = ImageInfo.Channels;
+    OutError = ImageInfo.OutError;
+}
+
+void URuntimeImageLoader::GetImageResolutionBatch(const TArray<FString>& ImageFilenames, TArray<FImageHeaderInfo>& OutImageInfos, bool& bSuccess, FString& OutError)
+{
+    FImageHeaderProbe::ProbeBatch(ImageFilenames, OutImageInfos);
+
+    int32 NumFailed = 0;
+    for (const FImageHeaderInfo& ImageInfo : OutImageInfos)
     {
-        bSuccess = true;
-        return;
+        if (!ImageInfo.bSuccess)
+        {
+            UE_LOG(LogRuntimeImageLoader, Warning, TEXT("Failed to get image dimensions: %s. Error: %s"), *ImageInfo.ImageFilename, *ImageInfo.OutError);
+            ++NumFailed;
+        }
     }
 
-    OutError = TEXT("Failed to get image dimensions! Try to load an image via LoadImage or LoadImageAsync! stb error (if any): ");
-    OutError += stbi_failure_reason();
+    bSuccess = NumFailed == 0;
+    if (!bSuccess)
+    {
+        OutError = FString::Printf(TEXT("Failed to get dimensions of %d out of %d images"), NumFailed, OutImageInfos.Num());
+    }
 }
 
 void URuntimeImageLoader::GetImageResolutionFromBytes(UPARAM(ref) TArray<uint8>& ImageBytes, int32& OutWidth, int32& OutHeight, int32& OutChannels, bool& bSuccess, FString& OutError)
 {
-    if (stbi_info_from_memory(ImageBytes.GetData(), ImageBytes.Num(), &OutWidth, &OutHeight, &OutChannels) == 1)
+    FImageHeaderInfo ImageInfo;
+    bSuccess = FImageHeaderProbe::ProbeBytes(ImageBytes, ImageInfo);
+
+    OutWidth = ImageInfo.Width;
+    OutHeight = ImageInfo.Height;
+    OutChannels = ImageInfo.Channels;
+    OutError = ImageInfo.OutError;
+}
+
+void URuntimeImageLoader::GetImageInfo(const FString& ImageFilename, FImageHeaderInfo& OutImageInfo, bool& bSuccess, FString& OutError)
+{
+    bSuccess = FImageHeaderProbe::Probe(ImageFilename, OutImageInfo);
+    OutError = OutImageInfo.OutError;
+}
+
+void URuntimeImageLoader::GetImageInfoFromBytes(UPARAM(ref) TArray<uint8>& ImageBytes, FImageHeaderInfo& OutImageInfo, bool& bSuccess, FString& OutError)
+{
+    OutImageInfo = FImageHeaderInfo();
+    bSuccess = FImageHeaderProbe::ProbeBytes(ImageBytes, OutImageInfo);
+    OutError = OutImageInfo.OutError;
+}
+
+void URuntimeImageLoader::PrefetchImages(const TArray<FString>& ImageFilenames, EPrefetchLevel PrefetchLevel, const FTransformImageParams& TransformParams)
+{
+    for (const FString& ImageFilename : ImageFilenames)
     {
-        bSuccess = true;
-        return;
+        if (ImageFilename.IsEmpty())
+        {
+            continue;
+        }
+
+        bool bIsAlreadyPending = false;
+        PendingPrefetches.Add(ImageFilename, &bIsAlreadyPending);
+        if (bIsAlreadyPending)
+        {
+            continue;
+        }
+
+        FLoadImageRequest Request;
+        {
+            Request.Params.InputImage = FInputImageDescription(ImageFilename);
+            Request.Params.TransformParams = TransformParams;
+            Request.Params.TransformParams.bOnlyBytes = PrefetchLevel == EPrefetchLevel::Bytes;
+            Request.Params.TransformParams.bOnlyImageData = PrefetchLevel == EPrefetchLevel::Pixels;
+            Request.Params.TransformParams.bProgressivePreview = false;
+
+            Request.OnRequestCompleted.BindLambda(
+                [this, ImageFilename, PrefetchLevel, TransformParams](const FImageReadResult& ReadResult)
+                {
+                    if (!ReadResult.OutError.IsEmpty())
+                    {
+                        UE_LOG(LogRuntimeImageLoader, Warning, TEXT("Failed to prefetch image. Error: %s"), *ReadResult.OutError);
+                        return;
+                    }
+
+                    FPrefetchedImage PrefetchedImage;
+                    PrefetchedImage.Level = PrefetchLevel;
+                    PrefetchedImage.TransformParams = TransformParams;
+                    PrefetchedImage.ImageBytes = ReadResult.OutImageBytes;
+                    PrefetchedImage.ImageData = ReadResult.OutImageData;
+                    PrefetchedImage.Texture = ReadResult.OutTexture;
+
+                    // cubemaps are not cached at texture level
+                    if (PrefetchLevel == EPrefetchLevel::Texture && !IsValid(PrefetchedImage.Texture))
+                    {
+                        return;
+                    }
+
+                    AddPrefetchedImage(ImageFilename, MoveTemp(PrefetchedImage));
+                }
+            );
+        }
+
+        PrefetchRequests.Enqueue(Request);
     }
+}
 
-    OutError = TEXT("Failed to get image dimensions! Try to load an image via LoadImage or LoadImageAsync! stb error (if any): ");
-    OutError += stbi_failure_reason();
+void URuntimeImageLoader::ClearPrefetchedImages()
+{
+    PrefetchRequests.Empty();
+    PendingPrefetches.Empty();
+    PrefetchedImages.Empty();
+    PrefetchedImagesOrder.Empty();
+    PrefetchedImagesBytes = 0;
 }
 
 void URuntimeImageLoader::CancelAll()
@@ -333,7 +509,10 @@ void URuntimeImageLoader::CancelAll()
 #endif
 
     Requests.Empty();
+    PrefetchRequests.Empty();
+    PendingPrefetches.Empty();
     ActiveRequest.Invalidate();
+    PendingWatchedLoads.Empty();
 
     ImageReader->Clear();
 }
@@ -366,65 +545,179 @@ bool URuntimeImageLoader::LoadImageToByteArray(const FString& ImageFilename, TAr
     return true;
 }
 
-class FImageFileVisitor : public IPlatformFile::FDirectoryVisitor
+void URuntimeImageLoader::FindImagesInDirectory(const FString& Directory, bool bIsRecursive, TArray<FString>& OutImageFilenames, bool& bSuccess, FString& OutError)
+{
+    TArray<FImageHeaderInfo> ImageInfos;
+    ScanImagesInDirectory(Directory, bIsRecursive, ImageInfos, bSuccess, OutError);
+
+    OutImageFilenames.Reset(ImageInfos.Num());
+    for (const FImageHeaderInfo& ImageInfo : ImageInfos)
+    {
+        OutImageFilenames.Add(ImageInfo.ImageFilename);
+    }
+}
+
+void URuntimeImageLoader::ScanImagesInDirectory(const FString& Directory, bool bIsRecursive, TArray<FImageHeaderInfo>& OutImageInfos, bool& bSuccess, FString& OutError)
+{
+    bSuccess = FImageDirectoryScanner::Scan(Directory, bIsRecursive, OutImageInfos, OutError);
+}
+
+FString URuntimeImageLoader::GetThisPluginResourcesDirectory()
 {
-public:
-    virtual bool Visit(const TCHAR* FilenameOrDirectory, bool bIsDirectory) override
+    return IPluginManager::Get().FindPlugin(TEXT("RuntimeImageLoader"))->GetBaseDir() / TEXT("Resources");
+}
+
+void URuntimeImageLoader::WatchDirectory(const FString& Directory, bool bIsRecursive, const FTransformImageParams& TransformParams, bool& bSuccess, FString& OutError)
+{
+    TSharedPtr<FImageDirectoryWatcher> Watcher = MakeShared<FImageDirectoryWatcher>(Directory, bIsRecursive);
+
+    bSuccess = Watcher->Start(OutError);
+    if (!bSuccess)
     {
-        if (!bIsDirectory)
+        return;
+    }
+
+    // watching again replaces the previous watcher, textures that are already loaded are reused
+    FWatchedImageDirectory& WatchedDirectory = WatchedDirectories.Add(Watcher->GetDirectory());
+    WatchedDirectory.Watcher = Watcher;
+    WatchedDirectory.TransformParams = TransformParams;
+}
+
+void URuntimeImageLoader::UnwatchDirectory(const FString& Directory)
+{
+    FString FullDirectory = FPaths::ConvertRelativePathToFull(Directory);
+    FPaths::NormalizeDirectoryName(FullDirectory);
+
+    WatchedDirectories.Remove(FullDirectory);
+
+    for (auto It = WatchedTextures.CreateIterator(); It; ++It)
+    {
+        if (FPaths::IsUnderDirectory(It.Key(), FullDirectory))
         {
-            const FString Filename(FilenameOrDirectory);
+            It.RemoveCurrent();
+        }
+    }
 
-            for (const FString& ImageFormat : FRuntimeImageUtils::SupportedImageFormats)
-            {
-                if (Filename.EndsWith(ImageFormat))
-                {
-                    Files.Add(Filename);
-                    break;
-                }
-            }
+    // loads in flight still complete, they are just not repeated for later changes
+    for (auto It = PendingWatchedLoads.CreateIterator(); It; ++It)
+    {
+        if (FPaths::IsUnderDirectory(It.Key(), FullDirectory))
+        {
+            It.RemoveCurrent();
         }
-        return true;
     }
+}
 
-    TArray<FString> Files;
-};
+UTexture2D* URuntimeImageLoader::GetWatchedTexture(const FString& ImageFilename) const
+{
+    UTexture2D* const* Texture = WatchedTextures.Find(FPaths::ConvertRelativePathToFull(ImageFilename));
+    return Texture ? *Texture : nullptr;
+}
 
-void URuntimeImageLoader::FindImagesInDirectory(const FString& Directory, bool bIsRecursive, TArray<FString>& OutImageFilenames, bool& bSuccess, FString& OutError)
+void URuntimeImageLoader::TickWatchedDirectories()
 {
-    if (Directory.IsEmpty() || !IFileManager::Get().DirectoryExists(*Directory))
+    if (WatchedDirectories.Num() == 0)
     {
-        bSuccess = false;
-        OutError = FString::Printf(TEXT("Directory not found: %s"), *Directory);
         return;
     }
 
-    FImageFileVisitor DirectoryVisitor;
-    if (bIsRecursive)
+    const double CurrentTime = FPlatformTime::Seconds();
+
+    for (const TPair<FString, FWatchedImageDirectory>& WatchedDirectory : WatchedDirectories)
     {
-        IFileManager::Get().IterateDirectoryRecursively(*Directory, DirectoryVisitor);
+        TArray<FString> ChangedImages;
+        TArray<FString> RemovedFiles;
+        WatchedDirectory.Value.Watcher->Tick(CurrentTime, ChangedImages, RemovedFiles);
+
+        for (const FString& ImageFilename : ChangedImages)
+        {
+            // a prefetched copy would be stale now
+            RemovePrefetchedImage(ImageFilename);
+
+            ReloadWatchedImage(ImageFilename, WatchedDirectory.Value.TransformParams);
+        }
+
+        for (const FString& Filename : RemovedFiles)
+        {
+            if (WatchedTextures.Remove(Filename) > 0)
+            {
+                OnWatchedImageChanged.Broadcast(Filename, nullptr);
+            }
+        }
     }
-    else
+}
+
+void URuntimeImageLoader::ReloadWatchedImage(const FString& ImageFilename, const FTransformImageParams& TransformParams)
+{
+    // a change during the load is picked up once it completes, so the texture it creates is updated instead of a second one being created
+    if (bool* bChangedWhileLoading = PendingWatchedLoads.Find(ImageFilename))
     {
-        IFileManager::Get().IterateDirectory(*Directory, DirectoryVisitor);
+        *bChangedWhileLoading = true;
+        return;
     }
+    PendingWatchedLoads.Add(ImageFilename, false);
 
-    OutImageFilenames = DirectoryVisitor.Files;
-    bSuccess = true;
-}
+    UTexture2D* const* ExistingTexture = WatchedTextures.Find(ImageFilename);
 
-FString URuntimeImageLoader::GetThisPluginResourcesDirectory()
-{
-    return IPluginManager::Get().FindPlugin(TEXT("RuntimeImageLoader"))->GetBaseDir() / TEXT("Resources");
+    FLoadImageRequest Request;
+    {
+        Request.Params.InputImage = FInputImageDescription(ImageFilename);
+        Request.Params.TransformParams = TransformParams;
+        Request.Params.TargetTexture = ExistingTexture ? *ExistingTexture : nullptr;
+
+        Request.OnRequestCompleted.BindLambda(
+            [this, ImageFilename, TransformParams](const FImageReadResult& ReadResult)
+            {
+                bool bChangedWhileLoading = false;
+                PendingWatchedLoads.RemoveAndCopyValue(ImageFilename, bChangedWhileLoading);
+
+                if (!ReadResult.OutError.IsEmpty() || !IsValid(ReadResult.OutTexture))
+                {
+                    UE_LOG(LogRuntimeImageLoader, Warning, TEXT("Failed to reload watched image: %s. Error: %s"), *ImageFilename, *ReadResult.OutError);
+                }
+                else
+                {
+                    WatchedTextures.Add(ImageFilename, ReadResult.OutTexture);
+                    OnWatchedImageChanged.Broadcast(ImageFilename, ReadResult.OutTexture);
+                }
+
+                if (bChangedWhileLoading)
+                {
+                    ReloadWatchedImage(ImageFilename, TransformParams);
+                }
+            }
+        );
+    }
+
+    Requests.Enqueue(Request);
 }
 
 void URuntimeImageLoader::Tick(float DeltaTime)
 {
     ensure(IsValid(ImageReader));
+
+    TickWatchedDirectories();
     
-    if (!ActiveRequest.IsRequestValid() && !Requests.IsEmpty())
+    // prefetches are dispatched only when there is no other request waiting
+    while (!ActiveRequest.IsRequestValid() && (!Requests.IsEmpty() || !PrefetchRequests.IsEmpty()))
     {
-        Requests.Dequeue(ActiveRequest);
+        if (Requests.Dequeue(ActiveRequest))
+        {
+            if (ApplyPrefetchedImage(ActiveRequest))
+            {
+                ActiveRequest.Invalidate();
+                continue;
+            }
+
+            // the load does the work of a prefetch of the same file that is still queued, the prefetch is dropped
+            PendingPrefetches.Remove(ActiveRequest.Params.InputImage.ImageFilename);
+        }
+        else if (PrefetchRequests.Dequeue(ActiveRequest)
+            && (PendingPrefetches.Remove(ActiveRequest.Params.InputImage.ImageFilename) == 0 || PrefetchedImages.Contains(ActiveRequest.Params.InputImage.ImageFilename)))
+        {
+            ActiveRequest.Invalidate();
+            continue;
+        }
 
         FImageReadRequest ReadRequest(ActiveRequest.Params);
 
@@ -432,6 +725,17 @@ void URuntimeImageLoader::Tick(float DeltaTime)
         ImageReader->Trigger();
     }
 
+    // previews are delivered before the result of their request
+    FImageReadResult PreviewResult;
+    while (ImageReader->GetPreviewResult(PreviewResult))
+    {
+        if (ActiveRequest.IsRequestValid())
+        {
+            ActiveRequest.OnPreview.ExecuteIfBound(PreviewResult);
+            OnImagePreview.Broadcast(PreviewResult.ImageFilename, PreviewResult.OutTexture);
+        }
+    }
+
     if (ActiveRequest.IsRequestValid() && ImageReader->IsWorkCompleted())
     {
         FImageReadResult ReadResult;
@@ -455,6 +759,103 @@ bool URuntimeImageLoader::IsAllowedToTick() const
     return !IsTemplate();
 }
 
+bool URuntimeImageLoader::ApplyPrefetchedImage(FLoadImageRequest& Request)
+{
+    const FString& ImageFilename = Request.Params.InputImage.ImageFilename;
+    const FTransformImageParams& TransformParams = Request.Params.TransformParams;
+
+    FPrefetchedImage* PrefetchedImage = ImageFilename.IsEmpty() ? nullptr : PrefetchedImages.Find(ImageFilename);
+    if (PrefetchedImage == nullptr || TransformParams.bOnlyBytes)
+    {
+        return false;
+    }
+
+    switch (PrefetchedImage->Level)
+    {
+        case EPrefetchLevel::Texture:
+        {
+            // texture is reusable only if it was created exactly as requested
+            if (TransformParams.bOnlyPixels || !(TransformParams == PrefetchedImage->TransformParams))
+            {
+                return false;
+            }
+
+            FImageReadResult ReadResult;
+            ReadResult.ImageFilename = ImageFilename;
+            ReadResult.OutTexture = PrefetchedImage->Texture;
+
+            RemovePrefetchedImage(ImageFilename);
+
+            ensure(Request.OnRequestCompleted.IsBound());
+            Request.OnRequestCompleted.Execute(ReadResult);
+
+            return true;
+        }
+
+        case EPrefetchLevel::Pixels:
+        {
+            // pixels of another region are a different image
+            if (TransformParams.Region != PrefetchedImage->TransformParams.Region)
+            {
+                return false;
+            }
+
+            Request.Params.DecodedImageData = MoveTemp(PrefetchedImage->ImageData);
+            break;
+        }
+
+        case EPrefetchLevel::Bytes:
+        {
+            Request.Params.InputImage.ImageBytes = MoveTemp(PrefetchedImage->ImageBytes);
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    RemovePrefetchedImage(ImageFilename);
+
+    return false;
+}
+
+void URuntimeImageLoader::AddPrefetchedImage(const FString& ImageFilename, FPrefetchedImage&& PrefetchedImage)
+{
+    const int64 BudgetBytes = int64(FMath::Max(CVarPrefetchMaxMegabytes.GetValueOnGameThread(), 0)) * 1024 * 1024;
+
+    PrefetchedImage.SizeBytes = GetPrefetchedImageSizeBytes(PrefetchedImage);
+    if (PrefetchedImage.SizeBytes > BudgetBytes)
+    {
+        UE_LOG(LogRuntimeImageLoader, Verbose, TEXT("Prefetched image does not fit into RuntimeImageLoader.Prefetch.MaxMegabytes and is dropped: %s"), *ImageFilename);
+        return;
+    }
+
+    RemovePrefetchedImage(ImageFilename);
+
+    while (PrefetchedImagesBytes + PrefetchedImage.SizeBytes > BudgetBytes && PrefetchedImagesOrder.Num() > 0)
+    {
+        const FString OldestImageFilename = PrefetchedImagesOrder[0];
+        RemovePrefetchedImage(OldestImageFilename);
+    }
+
+    PrefetchedImagesBytes += PrefetchedImage.SizeBytes;
+    PrefetchedImagesOrder.Add(ImageFilename);
+    PrefetchedImages.Add(ImageFilename, MoveTemp(PrefetchedImage));
+}
+
+void URuntimeImageLoader::RemovePrefetchedImage(const FString& ImageFilename)
+{
+    const FPrefetchedImage* PrefetchedImage = PrefetchedImages.Find(ImageFilename);
+    if (PrefetchedImage == nullptr)
+    {
+        return;
+    }
+
+    PrefetchedImagesBytes -= PrefetchedImage->SizeBytes;
+    PrefetchedImagesOrder.RemoveSingle(ImageFilename);
+    PrefetchedImages.Remove(ImageFilename);
+}
+
 URuntimeImageReader* URuntimeImageLoader::InitializeImageReader()
 {
     if (!IsValid(ImageReader))
@@ -2,14 +2,18 @@
 
 #include "RuntimeImageLoaderModule.h"
 
+#include "Helpers/ImageWrapperPool.h"
+
 #define LOCTEXT_NAMESPACE "FRuntimeImageLoaderModule"
 
 void FRuntimeImageLoaderModule::StartupModule()
 {
+	FImageWrapperPool::Initialize();
 }
 
 void FRuntimeImageLoaderModule::ShutdownModule()
 {
+	FImageWrapperPool::Shutdown();
 }
 
 #undef LOCTEXT_NAMESPACE
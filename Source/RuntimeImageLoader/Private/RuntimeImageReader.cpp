@@ -5,6 +5,8 @@
 #include "GenericPlatform/GenericPlatformProcess.h"
 #include "HAL/RunnableThread.h"
 #include "HAL/Event.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/FileManager.h"
 #include "RenderUtils.h"
 #include "Engine/Texture.h"
 #include "Engine/Texture2D.h"
@@ -14,16 +16,27 @@
 
 #include "ImageReaders/ImageReaderFactory.h"
 #include "ImageReaders/IImageReader.h"
+#include "ImageReaders/ImageReaderDataUri.h"
+#include "ImageReaders/ImageHeaderProbe.h"
 #include "TextureFactory/RuntimeTextureResource.h"
 #include "TextureFactory/RuntimeRHITexture2DFactory.h"
 #include "TextureFactory/RuntimeRHITextureCubeFactory.h"
 #include "TextureFactory/RuntimeTextureFactory.h"
 #include "RuntimeImageUtils.h"
 #include "Helpers/CubemapUtils.h"
+#include "Helpers/PixelKernels.h"
 
 
 DEFINE_LOG_CATEGORY_STATIC(LogRuntimeImageReader, Log, All);
 
+static TAutoConsoleVariable<int32> CVarStreamingDecodeThresholdMB(
+    TEXT("RuntimeImageLoader.StreamingDecodeThresholdMB"), 256,
+    TEXT("Local PNG, HDR, TIFF and EXR files of at least this size are decoded while being read instead of being loaded into memory first."));
+
+static TAutoConsoleVariable<float> CVarProgressivePreviewMinMegapixels(
+    TEXT("RuntimeImageLoader.ProgressivePreviewMinMegapixels"), 1.0f,
+    TEXT("Smaller images are not previewed even if bProgressivePreview is set, they decode quickly enough on their own."));
+
 
 void URuntimeImageReader::Initialize()
 {
@@ -88,6 +101,21 @@ bool URuntimeImageReader::GetResult(FImageReadResult& OutResult)
     return false;
 }
 
+bool URuntimeImageReader::GetPreviewResult(FImageReadResult& OutResult)
+{
+    FScopeLock ResultsLock(&ResultsMutex);
+
+    if (PreviewResults.Num() > 0)
+    {
+        OutResult = PreviewResults[0];
+        PreviewResults.RemoveAt(0);
+
+        return true;
+    }
+
+    return false;
+}
+
 void URuntimeImageReader::Clear()
 {
     Requests.Empty();
@@ -95,6 +123,7 @@ void URuntimeImageReader::Clear()
     {
         FScopeLock ResultsLock(&ResultsMutex);
         Results.Empty();
+        PreviewResults.Empty();
     }
 
     if (ImageReader.IsValid())
@@ -144,10 +173,18 @@ void URuntimeImageReader::BlockTillAllRequestsFinished()
         {
             PendingReadResult.ImageFilename = Request.InputImage.ImageFilename;
 
-            if (PendingReadResult.ImageFilename.Len() > 0)
+            if (FImageReaderDataUri::IsDataURI(PendingReadResult.ImageFilename))
+            {
+                UE_LOG(LogRuntimeImageReader, Log, TEXT("Reading image from data URI, %d characters"), PendingReadResult.ImageFilename.Len());
+            }
+            else if (PendingReadResult.ImageFilename.Len() > 0)
             {
                 UE_LOG(LogRuntimeImageReader, Log, TEXT("Reading image from file: %s"), *PendingReadResult.ImageFilename);
             }
+            else if (Request.InputImage.ImageBase64.Len() > 0)
+            {
+                UE_LOG(LogRuntimeImageReader, Log, TEXT("Reading image from base64, %d characters"), Request.InputImage.ImageBase64.Len());
+            }
             else if (Request.InputImage.ImageBytes.Num() > 0)
             {
                 UE_LOG(
@@ -159,6 +196,9 @@ void URuntimeImageReader::BlockTillAllRequestsFinished()
             if (!ProcessRequest(Request))
             {
                 UE_LOG(LogRuntimeImageReader, Warning, TEXT("Failed to process request"));
+
+                // a failed request returns no texture, not even the preview that was uploaded before the full decode failed
+                PendingReadResult.OutTexture = nullptr;
             }
 
             FScopeLock ResultsLock(&ResultsMutex);
@@ -173,58 +213,121 @@ void URuntimeImageReader::BlockTillAllRequestsFinished()
 
 bool URuntimeImageReader::ProcessRequest(FImageReadRequest& Request)
 {
-    TArray<uint8> ImageBuffer;
+    FRuntimeImageData ImageData;
 
-    // read image data from using URI
-    // if not then read from bytes
-    if (Request.InputImage.ImageFilename.Len() > 0)
+    // the decoder may skip detail that the downscale would throw away, unless the full image is handed out
+    FRuntimeImageDecodeOptions DecodeOptions;
+    if (Request.TransformParams.IsPercentSizeValid() && !Request.TransformParams.bOnlyImageData && !Request.TransformParams.bOnlyPixels)
     {
-        ImageReader = FImageReaderFactory::CreateReader(Request.InputImage.ImageFilename);
+        DecodeOptions.MinScale = FMath::Max(Request.TransformParams.PercentSizeX, Request.TransformParams.PercentSizeY) * 0.01f;
+    }
+    DecodeOptions.Channels = Request.TransformParams.Channels;
+    DecodeOptions.Region = Request.TransformParams.Region;
+
+    TUniquePtr<FArchive> StreamableImage = Request.DecodedImageData.IsValid() ? nullptr : OpenStreamableImage(Request);
+
+    if (Request.DecodedImageData.IsValid())
+    {
+        // prefetched image is owned by this request only
+        ImageData = MoveTemp(*Request.DecodedImageData);
+        Request.DecodedImageData.Reset();
+    }
+    else if (StreamableImage.IsValid())
+    {
+        // the encoded image is never held in memory as a whole
+        if (!FRuntimeImageUtils::ImportArchiveAsImage(*StreamableImage, ImageData, PendingReadResult.OutError, DecodeOptions))
+        {
+            return false;
+        }
+
+        StreamableImage.Reset();
+    }
+    else
+    {
+        TArray<uint8> ImageBuffer;
+
+        // bytes are either supplied by the caller or prefetched for the file
+        // if not then read image data using URI
+        if (Request.InputImage.ImageBytes.Num() > 0)
+        {
+            ImageBuffer = MoveTemp(Request.InputImage.ImageBytes);
+        }
+        else if (Request.InputImage.ImageFilename.Len() > 0)
+        {
+            ImageReader = FImageReaderFactory::CreateReader(Request.InputImage.ImageFilename);
+            {
+                ImageBuffer = ImageReader->ReadImage(Request.InputImage.ImageFilename);
+                if (ImageBuffer.Num() == 0)
+                {
+                    const FString ImageName = FImageReaderDataUri::IsDataURI(Request.InputImage.ImageFilename) ? TEXT("data URI") : Request.InputImage.ImageFilename;
+                    PendingReadResult.OutError = FString::Printf(TEXT("Failed to read %s image. Error: %s"), *ImageName, *ImageReader->GetLastError());
+                    return false;
+                }
+
+            }
+
+            ImageReader = nullptr;
+        }
+        else if (Request.InputImage.ImageBase64.Len() > 0)
         {
-            ImageBuffer = ImageReader->ReadImage(Request.InputImage.ImageFilename);
+            FImageReaderDataUri Base64Reader;
+            ImageBuffer = Base64Reader.ReadBase64(Request.InputImage.ImageBase64);
+            Request.InputImage.ImageBase64.Empty();
+
             if (ImageBuffer.Num() == 0)
             {
-                PendingReadResult.OutError = FString::Printf(TEXT("Failed to read %s image. Error: %s"), *Request.InputImage.ImageFilename, *ImageReader->GetLastError());
+                PendingReadResult.OutError = FString::Printf(TEXT("Failed to read base64 image. Error: %s"), *Base64Reader.GetLastError());
                 return false;
             }
-
+        }
+        else 
+        {
+            PendingReadResult.OutError = FString::Printf(TEXT("Failed to read %s image. Make sure input data is valid!"), *Request.InputImage.ImageFilename);
+            return false;
         }
 
-        ImageReader = nullptr;
-    }
-    else if (Request.InputImage.ImageBytes.Num() > 0)
-    {
-        ImageBuffer = MoveTemp(Request.InputImage.ImageBytes);
-    }
-    else 
-    {
-        PendingReadResult.OutError = FString::Printf(TEXT("Failed to read %s image. Make sure input data is valid!"), *Request.InputImage.ImageFilename);
-        return false;
-    }
+        // sanity check
+        check(ImageBuffer.Num() > 0);
 
-    // sanity check
-    check(ImageBuffer.Num() > 0);
+        // early exit: return pure bytes
+        if (Request.TransformParams.bOnlyBytes)
+        {
+            PendingReadResult.OutImageBytes = MoveTemp(ImageBuffer);
+            return true;
+        }
 
-    // early exit: return pure bytes
-    if (Request.TransformParams.bOnlyBytes)
-    {
-        PendingReadResult.OutImageBytes = MoveTemp(ImageBuffer);
-        return true;
-    }
+        // textures that are reloaded keep showing their previous image instead of a preview, previews always show the whole image
+        if (Request.TransformParams.bProgressivePreview && !Request.TransformParams.bOnlyImageData && !Request.TransformParams.bOnlyPixels && Request.TargetTexture == nullptr && !Request.TransformParams.IsRegionValid())
+        {
+            UploadPreview(Request, ImageBuffer);
+        }
 
-    FRuntimeImageData ImageData;
-    if (!FRuntimeImageUtils::ImportBufferAsImage(ImageBuffer.GetData(), ImageBuffer.Num(), ImageData, PendingReadResult.OutError))
-    {
-        return false;
+        if (!FRuntimeImageUtils::ImportBufferAsImage(ImageBuffer.GetData(), ImageBuffer.Num(), ImageData, PendingReadResult.OutError, DecodeOptions))
+        {
+            return false;
+        }
+
+        if (PendingReadResult.OutError.Len() > 0)
+        {
+            return false;
+        }
     }
 
-    if (PendingReadResult.OutError.Len() > 0)
+    // early exit: return decoded image, transformations are applied by the request that consumes it
+    if (Request.TransformParams.bOnlyImageData)
     {
-        return false;
+        PendingReadResult.OutImageData = MakeShared<FRuntimeImageData, ESPMode::ThreadSafe>(MoveTemp(ImageData));
+        return true;
     }
 
     if (Request.TransformParams.bOnlyPixels)
     {
+        if (ImageData.IsBlockCompressed())
+        {
+            PendingReadResult.OutError = TEXT("Pixels of block compressed images can't be read, load them as a texture instead");
+            return false;
+        }
+
         if (ImageData.TextureSourceFormat == TSF_BGRE8)
         {
             PendingReadResult.OutImagePixels = ImageData.AsBGRE8();
@@ -249,9 +352,36 @@ bool URuntimeImageReader::ProcessRequest(FImageReadRequest& Request)
 
     // sanity checks
     check(ImageData.RawData.Num() > 0);
-    check(ImageData.TextureSourceFormat != TSF_Invalid);
+    check(ImageData.TextureSourceFormat != TSF_Invalid || ImageData.IsBlockCompressed());
+
+    if (ImageData.IsBlockCompressed())
+    {
+        // the decoder picked the pixel format of the blocks, there is no CPU decode to fall back to
+        if (!GPixelFormats[ImageData.PixelFormat].Supported)
+        {
+            PendingReadResult.OutError = FString::Printf(TEXT("Block compressed pixel format is not supported by this RHI: %s"), GPixelFormats[ImageData.PixelFormat].Name);
+            return false;
+        }
+    }
+    else
+    {
+        ImageData.PixelFormat = DeterminePixelFormat(ImageData.Format, Request.TransformParams);
+    }
+
+    // 16-bit normalized formats are optional on mobile RHIs, half floats keep the precision there
+    if (!ImageData.IsBlockCompressed() && (ImageData.Format == ERawImageFormat::G16 || ImageData.Format == ERawImageFormat::RGBA16) && !GPixelFormats[ImageData.PixelFormat].Supported)
+    {
+        FImage HalfFloatImage;
+        ImageData.CopyTo(HalfFloatImage, ERawImageFormat::RGBA16F, EGammaSpace::Linear);
+
+        ImageData.RawData = MoveTemp(HalfFloatImage.RawData);
+        ImageData.Format = ERawImageFormat::RGBA16F;
+        ImageData.TextureSourceFormat = TSF_RGBA16F;
+        ImageData.SRGB = false;
+        ImageData.GammaSpace = EGammaSpace::Linear;
+        ImageData.PixelFormat = DeterminePixelFormat(ImageData.Format, Request.TransformParams);
+    }
 
-    ImageData.PixelFormat = DeterminePixelFormat(ImageData.Format, Request.TransformParams);
     if (ImageData.PixelFormat == PF_Unknown)
     {
         PendingReadResult.OutError = FString::Printf(TEXT("Pixel format is not supported: %d"), (int32)ImageData.PixelFormat);
@@ -259,8 +389,8 @@ bool URuntimeImageReader::ProcessRequest(FImageReadRequest& Request)
     }
 
     // TODO: Below code should be unified and texture source format should be respected by transformation layers
-    // cubemaps texture source format
-    if (ImageData.TextureSourceFormat == TSF_BGRE8)
+    // cubemaps texture source format, or the faces of a block compressed cubemap
+    if (ImageData.TextureSourceFormat == TSF_BGRE8 || ImageData.NumSlices == 6)
     {
         PendingReadResult.OutTextureCube = TextureFactory->CreateTextureCube({ Request.InputImage.ImageFilename, &ImageData });
 
@@ -283,8 +413,24 @@ bool URuntimeImageReader::ProcessRequest(FImageReadRequest& Request)
         // TODO: Split into multiple transformation layers?
         ApplySizeFormatTransformations(ImageData, Request.TransformParams);
 
-        PendingReadResult.OutTexture = TextureFactory->CreateTexture2D({ Request.InputImage.ImageFilename, &ImageData });
-        PendingReadResult.OutTexture->RemoveFromRoot();
+        if (Request.TargetTexture)
+        {
+            // same size and format: pixels go straight into the existing RHI texture, otherwise the texture gets a new resource
+            FRuntimeRHITexture2DFactory RHITexture2DFactory(Request.TargetTexture, ImageData);
+            if (RHITexture2DFactory.Update())
+            {
+                PendingReadResult.OutTexture = Request.TargetTexture;
+                return true;
+            }
+
+            TextureFactory->ResetTexture2D(Request.TargetTexture, { Request.InputImage.ImageFilename, &ImageData });
+            PendingReadResult.OutTexture = Request.TargetTexture;
+        }
+        else
+        {
+            PendingReadResult.OutTexture = TextureFactory->CreateTexture2D({ Request.InputImage.ImageFilename, &ImageData });
+            PendingReadResult.OutTexture->RemoveFromRoot();
+        }
 
         FRuntimeRHITexture2DFactory RHITexture2DFactory(PendingReadResult.OutTexture, ImageData);
         if (!RHITexture2DFactory.Create())
@@ -297,6 +443,88 @@ bool URuntimeImageReader::ProcessRequest(FImageReadRequest& Request)
     return true;
 }
 
+TUniquePtr<FArchive> URuntimeImageReader::OpenStreamableImage(const FImageReadRequest& Request)
+{
+    if (Request.TransformParams.bOnlyBytes || Request.InputImage.ImageBytes.Num() > 0 || Request.InputImage.ImageFilename.IsEmpty())
+    {
+        return nullptr;
+    }
+
+    // a stat is enough to rule out ordinary images, only local files above the threshold get opened here.
+    // FileSize is INDEX_NONE for http, data and zip URIs, those are never streamed
+    const int64 ThresholdBytes = int64(FMath::Max(CVarStreamingDecodeThresholdMB.GetValueOnAnyThread(), 0)) * 1024 * 1024;
+    const int64 FileSizeBytes = IFileManager::Get().FileSize(*Request.InputImage.ImageFilename);
+    if (FileSizeBytes == INDEX_NONE || FileSizeBytes < ThresholdBytes)
+    {
+        return nullptr;
+    }
+
+    TSharedPtr<IImageReader, ESPMode::ThreadSafe> StreamReader = FImageReaderFactory::CreateReader(Request.InputImage.ImageFilename);
+    TUniquePtr<FArchive> Archive = StreamReader->OpenImageArchive(Request.InputImage.ImageFilename);
+    if (!Archive.IsValid() || !FRuntimeImageUtils::CanImportArchiveAsImage(*Archive))
+    {
+        return nullptr;
+    }
+
+    return Archive;
+}
+
+void URuntimeImageReader::UploadPreview(FImageReadRequest& Request, const TArray<uint8>& ImageBuffer)
+{
+    QUICK_SCOPE_CYCLE_COUNTER(STAT_RuntimeImageReader_UploadPreview);
+
+    FImageHeaderInfo ImageInfo;
+    const int64 MinPixels = int64(CVarProgressivePreviewMinMegapixels.GetValueOnAnyThread() * 1000000.0f);
+    if (!FImageHeaderProbe::ProbeBytes(ImageBuffer, ImageInfo) || int64(ImageInfo.Width) * ImageInfo.Height < MinPixels)
+    {
+        return;
+    }
+
+    FRuntimeImageData PreviewData;
+    FString PreviewError;
+    if (!FRuntimeImageUtils::ImportBufferAsPreview(ImageBuffer.GetData(), ImageBuffer.Num(), PreviewData, PreviewError))
+    {
+        if (PreviewError.Len() > 0)
+        {
+            UE_LOG(LogRuntimeImageReader, Verbose, TEXT("Skipping preview: %s"), *PreviewError);
+        }
+        return;
+    }
+
+    // the preview keeps the size of its pass, percent sizes apply to the full image only
+    FTransformImageParams PreviewParams = Request.TransformParams;
+    PreviewParams.PercentSizeX = 100;
+    PreviewParams.PercentSizeY = 100;
+
+    PreviewData.PixelFormat = DeterminePixelFormat(PreviewData.Format, PreviewParams);
+    ApplySizeFormatTransformations(PreviewData, PreviewParams);
+
+    UTexture2D* PreviewTexture = TextureFactory->CreateTexture2D({ Request.InputImage.ImageFilename, &PreviewData });
+    if (!IsValid(PreviewTexture))
+    {
+        return;
+    }
+    PreviewTexture->RemoveFromRoot();
+
+    // the pending result keeps the texture alive until the full image replaces the preview in it, a failed decode drops it
+    PendingReadResult.OutTexture = PreviewTexture;
+    Request.TargetTexture = PreviewTexture;
+
+    FRuntimeRHITexture2DFactory RHITexture2DFactory(PreviewTexture, PreviewData);
+    if (!RHITexture2DFactory.Create())
+    {
+        UE_LOG(LogRuntimeImageReader, Verbose, TEXT("Failed to create RHI texture 2D for the preview, pixel format: %d"), (int32)PreviewData.PixelFormat);
+        return;
+    }
+
+    FImageReadResult PreviewResult;
+    PreviewResult.ImageFilename = Request.InputImage.ImageFilename;
+    PreviewResult.OutTexture = PreviewTexture;
+
+    FScopeLock ResultsLock(&ResultsMutex);
+    PreviewResults.Add(MoveTemp(PreviewResult));
+}
+
 EPixelFormat URuntimeImageReader::DeterminePixelFormat(ERawImageFormat::Type ImageFormat, const FTransformImageParams& Params) const
 {
     EPixelFormat PixelFormat;
@@ -308,9 +536,13 @@ EPixelFormat URuntimeImageReader::DeterminePixelFormat(ERawImageFormat::Type Ima
         case ERawImageFormat::G16:           PixelFormat = PF_G16; break;
         case ERawImageFormat::BGRA8:         PixelFormat = PF_B8G8R8A8; break;
         case ERawImageFormat::BGRE8:         PixelFormat = PF_B8G8R8A8; break;
-        case ERawImageFormat::RGBA16:        PixelFormat = PF_R16G16B16A16_SINT; break;
+        case ERawImageFormat::RGBA16:        PixelFormat = PF_R16G16B16A16_UNORM; break;
         case ERawImageFormat::RGBA16F:       PixelFormat = PF_FloatRGBA; break;
         case ERawImageFormat::RGBA32F:       PixelFormat = PF_A32B32G32R32F; break;
+#if (ENGINE_MAJOR_VERSION == 5) && (ENGINE_MINOR_VERSION >= 1)
+        case ERawImageFormat::R16F:          PixelFormat = PF_R16F; break;
+        case ERawImageFormat::R32F:          PixelFormat = PF_R32_FLOAT; break;
+#endif
         default:                             PixelFormat = PF_Unknown; break;
     }
 
@@ -319,19 +551,32 @@ EPixelFormat URuntimeImageReader::DeterminePixelFormat(ERawImageFormat::Type Ima
 
 void URuntimeImageReader::ApplySizeFormatTransformations(FRuntimeImageData& ImageData, FTransformImageParams TransformParams)
 {
+    // blocks can't be resized or converted, percent sizes were served by skipping the larger mips of the chain
+    if (ImageData.IsBlockCompressed())
+    {
+        ImageData.FilterMode = TransformParams.FilterMode;
+        return;
+    }
+
     if (TransformParams.IsPercentSizeValid())
     {
-        const int32 TransformedSizeX = FMath::Floor(ImageData.SizeX * TransformParams.PercentSizeX * 0.01f);
-        const int32 TransformedSizeY = FMath::Floor(ImageData.SizeY * TransformParams.PercentSizeY * 0.01f);
-        
-        FImage TransformedImage;
-        TransformedImage.Init(TransformedSizeX, TransformedSizeY, ImageData.Format);
+        // relative to the encoded size, the decoder may have downscaled part of the way already
+        const int32 SourceSizeX = ImageData.SourceSizeX > 0 ? ImageData.SourceSizeX : ImageData.SizeX;
+        const int32 SourceSizeY = ImageData.SourceSizeY > 0 ? ImageData.SourceSizeY : ImageData.SizeY;
+        const int32 TransformedSizeX = FMath::Max(FMath::FloorToInt(SourceSizeX * TransformParams.PercentSizeX * 0.01f), 1);
+        const int32 TransformedSizeY = FMath::Max(FMath::FloorToInt(SourceSizeY * TransformParams.PercentSizeY * 0.01f), 1);
+
+        if (TransformedSizeX != ImageData.SizeX || TransformedSizeY != ImageData.SizeY)
+        {
+            FImage TransformedImage;
+            TransformedImage.Init(TransformedSizeX, TransformedSizeY, ImageData.Format);
 
-        ImageData.ResizeTo(TransformedImage, TransformedImage.SizeX, TransformedImage.SizeY, ImageData.Format, ImageData.GammaSpace);
+            ImageData.ResizeTo(TransformedImage, TransformedImage.SizeX, TransformedImage.SizeY, ImageData.Format, ImageData.GammaSpace);
 
-        ImageData.RawData = MoveTemp(TransformedImage.RawData);
-        ImageData.SizeX = TransformedImage.SizeX;
-        ImageData.SizeY = TransformedImage.SizeY;
+            ImageData.RawData = MoveTemp(TransformedImage.RawData);
+            ImageData.SizeX = TransformedImage.SizeX;
+            ImageData.SizeY = TransformedImage.SizeY;
+        }
     }
     else
     {
@@ -340,29 +585,38 @@ void URuntimeImageReader::ApplySizeFormatTransformations(FRuntimeImageData& Imag
 
     if (TransformParams.bForUI)
     {
-        // no need to convert float RGBA and HDR
-        if (ImageData.TextureSourceFormat != TSF_RGBA16F && ImageData.TextureSourceFormat != TSF_BGRE8)
+        // Slate samples single channel textures as red and 16-bit textures can't be sRGB, everything else is shown as uploaded
+        const bool bIsSingleChannel = ImageData.Format == ERawImageFormat::G8 || ImageData.Format == ERawImageFormat::G16
+#if (ENGINE_MAJOR_VERSION == 5) && (ENGINE_MINOR_VERSION >= 1)
+            || ImageData.Format == ERawImageFormat::R16F || ImageData.Format == ERawImageFormat::R32F
+#endif
+            ;
+        const bool bIsSRGB16 = ImageData.Format == ERawImageFormat::RGBA16 && ImageData.GammaSpace == EGammaSpace::sRGB;
+
+        if (bIsSingleChannel || bIsSRGB16)
         {
             FImage BGRAImage;
             BGRAImage.Init(ImageData.SizeX, ImageData.SizeY, ERawImageFormat::BGRA8);
-            ImageData.CopyTo(BGRAImage, ERawImageFormat::BGRA8, EGammaSpace::sRGB);
+
+            // sRGB sources only need a swizzle or a bit depth reduction, anything else goes through the engine gamma conversion
+            const int64 NumPixels = int64(ImageData.SizeX) * ImageData.SizeY;
+            if (ImageData.Format == ERawImageFormat::G8 && ImageData.GammaSpace == EGammaSpace::sRGB)
+            {
+                FPixelKernels::G8ToBGRA(ImageData.RawData.GetData(), BGRAImage.RawData.GetData(), NumPixels);
+            }
+            else if (ImageData.Format == ERawImageFormat::RGBA16 && ImageData.GammaSpace == EGammaSpace::sRGB)
+            {
+                FPixelKernels::RGBA16ToBGRA8((const uint16*)ImageData.RawData.GetData(), BGRAImage.RawData.GetData(), NumPixels);
+            }
+            else
+            {
+                ImageData.CopyTo(BGRAImage, ERawImageFormat::BGRA8, EGammaSpace::sRGB);
+            }
 
             ImageData.RawData = MoveTemp(BGRAImage.RawData);
             ImageData.SRGB = true;
             ImageData.GammaSpace = EGammaSpace::sRGB;
-
-            // modify pixel format
-            switch (ImageData.Format)
-            {
-                case ERawImageFormat::G8:
-                case ERawImageFormat::RGBA16:
-                {
-                    ImageData.PixelFormat = PF_B8G8R8A8;
-                    break;
-                }
-                default:
-                    break;
-            }
+            ImageData.PixelFormat = PF_B8G8R8A8;
         }
     }
     
@@ -22,15 +22,9 @@
 #include "RHIDefinitions.h"
 #include "Runtime/Launch/Resources/Version.h"
 
-#if ENGINE_MINOR_VERSION < 3
-#include "HDRLoader.h"
-#include "DDSLoader.h"
-#endif
-
-#include "Helpers/TGAHelpers.h"
-#include "Helpers/PNGHelpers.h"
-#include "Helpers/TIFFLoader.h"
-#include "Helpers/QOIHelpers.h"
+#include "Helpers/StreamingImageDecoders.h"
+#include "ImageDecoders/RuntimeImageDecoderRegistry.h"
+#include "ImageReaders/ImageReaderDataUri.h"
 
 #define MAX_SUPPORTED_TEXTURE_SIZE int32(1 << (MAX_TEXTURE_MIP_COUNT - 1))
 
@@ -59,389 +53,149 @@ namespace FRuntimeImageUtils
         return bValid;
     }
 
-    bool ImportBufferAsImage(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError)
+    bool ClipRegion(const FIntRect& Region, int32 Width, int32 Height, FIntRect& OutRegion, FString& OutError)
     {
-        QUICK_SCOPE_CYCLE_COUNTER(STAT_EvoImageUtils_ImportFileAsTexture_ImportBufferAsImage);
-        
-        IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
-
-        //
-        // PNG
-        //
-        // PNG support both 8 and 16 bit depth images (24 and 48 bits per pixel respectively or 32 and 64 bits when alpha channel is used) 
-        TSharedPtr<IImageWrapper> PngImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
-        if (PngImageWrapper.IsValid() && PngImageWrapper->SetCompressed(Buffer, Length))
+        if (Region.Width() <= 0 || Region.Height() <= 0)
         {
-            if (!IsImportResolutionValid(PngImageWrapper->GetWidth(), PngImageWrapper->GetHeight(), true))
-            {
-                OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), PngImageWrapper->GetWidth(), PngImageWrapper->GetHeight());
-                return false;
-            }
-
-            // Select the texture's source format
-            ETextureSourceFormat TextureFormat = TSF_Invalid;
-            int32 BitDepth = PngImageWrapper->GetBitDepth();
-            ERGBFormat Format = PngImageWrapper->GetFormat();
-
-            if (Format == ERGBFormat::Gray)
-            {
-                if (BitDepth <= 8)
-                {
-                    TextureFormat = TSF_G8;
-                    Format = ERGBFormat::Gray;
-                    BitDepth = 8;
-                }
-                else if (BitDepth == 16)
-                {
-                    // TODO: TSF_G16?
-                    TextureFormat = TSF_RGBA16;
-                    Format = ERGBFormat::RGBA;
-                    BitDepth = 16;
-                }
-            }
-            else if (Format == ERGBFormat::RGBA || Format == ERGBFormat::BGRA)
-            {
-                if (BitDepth <= 8)
-                {
-                    TextureFormat = TSF_BGRA8;
-                    Format = ERGBFormat::BGRA;
-                    BitDepth = 8;
-                }
-                else if (BitDepth == 16)
-                {
-                    TextureFormat = TSF_RGBA16;
-                    Format = ERGBFormat::RGBA;
-                    BitDepth = 16;
-                }
-            }
-
-            if (BitDepth > 16)
-            {
-                OutError = TEXT("Only 8 and 16 bit depth PNG images are currently supported.");
-                return false;
-            }
-
-            TArray<uint8> RawPNG;
-            if (PngImageWrapper->GetRaw(Format, BitDepth, RawPNG))
-            {
-                OutImage.Init2D(
-                    PngImageWrapper->GetWidth(),
-                    PngImageWrapper->GetHeight(),
-                    TextureFormat,
-                    RawPNG.GetData()
-                );
-                OutImage.SRGB = BitDepth < 16;
-                OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear; 
-
-                FPNGHelpers::FillZeroAlphaPNGData(OutImage.SizeX, OutImage.SizeY, OutImage.TextureSourceFormat, OutImage.RawData.GetData());
-            }
-            else
-            {
-                OutError = FString::Printf(TEXT("Failed to decode PNG. Bit depth: %d"), BitDepth);
-                return false;
-            }
-
+            OutRegion = FIntRect(0, 0, Width, Height);
             return true;
         }
-        //
-        // JPEG
-        //
-        // JPEG can only be 8-bit depth
 
-        TSharedPtr<IImageWrapper> JpegImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::JPEG);
-        if (JpegImageWrapper.IsValid() && JpegImageWrapper->SetCompressed(Buffer, Length))
-        {
-            if (!IsImportResolutionValid(JpegImageWrapper->GetWidth(), JpegImageWrapper->GetHeight(), true))
-            {
-                OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), JpegImageWrapper->GetWidth(), JpegImageWrapper->GetHeight());
-                return false;
-            }
+        OutRegion = FIntRect(
+            FMath::Clamp(Region.Min.X, 0, Width), FMath::Clamp(Region.Min.Y, 0, Height),
+            FMath::Clamp(Region.Max.X, 0, Width), FMath::Clamp(Region.Max.Y, 0, Height)
+        );
 
-            // Select the texture's source format
-            ETextureSourceFormat TextureFormat = TSF_Invalid;
-            int32 BitDepth = JpegImageWrapper->GetBitDepth();
-            ERGBFormat Format = JpegImageWrapper->GetFormat();
+        if (OutRegion.Width() <= 0 || OutRegion.Height() <= 0)
+        {
+            OutError = FString::Printf(TEXT("Region (%d, %d) - (%d, %d) is outside of the %d x %d image"), Region.Min.X, Region.Min.Y, Region.Max.X, Region.Max.Y, Width, Height);
+            return false;
+        }
 
-            if (Format == ERGBFormat::Gray)
-            {
-                if (BitDepth <= 8)
-                {
-                    TextureFormat = TSF_G8;
-                    Format = ERGBFormat::Gray;
-                    BitDepth = 8;
-                }
-            }
-            else if (Format == ERGBFormat::RGBA || Format == ERGBFormat::BGRA)
-            {
-                if (BitDepth <= 8)
-                {
-                    TextureFormat = TSF_BGRA8;
-                    Format = ERGBFormat::BGRA;
-                    BitDepth = 8;
-                }
-            }
+        return true;
+    }
 
-            if (TextureFormat == TSF_Invalid)
-            {
-                OutError = FString::Printf(TEXT("JPEG file contains data in an unsupported format. Bit depth: %d"), BitDepth);
-                return false;
-            }
+    void CropImage(FRuntimeImageData& Image, const FIntRect& Region)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(STAT_RuntimeImageUtils_CropImage);
 
-            TArray<uint8> RawJPEG;
-            if (JpegImageWrapper->GetRaw(Format, BitDepth, RawJPEG))
-            {
-                OutImage.Init2D(
-                    JpegImageWrapper->GetWidth(),
-                    JpegImageWrapper->GetHeight(),
-                    TextureFormat,
-                    RawJPEG.GetData()
-                );
-                OutImage.SRGB = true;
-                OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
-            }
-            else
-            {
-                OutError = TEXT("Failed to decode JPEG. Please contact devs");
-                return false;
-            }
+        const int64 PixelBytes = Image.GetBytesPerPixel();
+        const int64 SourceRowBytes = PixelBytes * Image.SizeX;
+        const int64 RegionRowBytes = PixelBytes * Region.Width();
 
-            return true;
-        }
+        // a new allocation gives the memory of the rest of the image back
+        TArray64<uint8> RegionData;
+        RegionData.SetNumUninitialized(RegionRowBytes * Region.Height());
 
-        //
-        // BMP
-        //
-        TSharedPtr<IImageWrapper> BmpImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::BMP);
-        if (BmpImageWrapper.IsValid() && BmpImageWrapper->SetCompressed(Buffer, Length))
+        const uint8* Source = Image.RawData.GetData() + Region.Min.Y * SourceRowBytes + Region.Min.X * PixelBytes;
+        for (int32 Y = 0; Y < Region.Height(); ++Y)
         {
-            // Check the resolution of the imported texture to ensure validity
-            if (!IsImportResolutionValid(BmpImageWrapper->GetWidth(), BmpImageWrapper->GetHeight(), true))
-            {
-                OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), BmpImageWrapper->GetWidth(), BmpImageWrapper->GetHeight());
-                return false;
-            }
+            FMemory::Memcpy(RegionData.GetData() + Y * RegionRowBytes, Source + Y * SourceRowBytes, RegionRowBytes);
+        }
 
-            TArray<uint8> RawBMP;
-            if (BmpImageWrapper->GetRaw(BmpImageWrapper->GetFormat(), BmpImageWrapper->GetBitDepth(), RawBMP))
-            {
-                // Set texture properties.
-                OutImage.Init2D(
-                    BmpImageWrapper->GetWidth(),
-                    BmpImageWrapper->GetHeight(),
-                    TSF_BGRA8,
-                    RawBMP.GetData()
-                );
-                
-                OutImage.SRGB = true;
-                OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
-            }
-            else
-            {
-                OutError = FString::Printf(TEXT("Failed to decode BMP. Bit depth: %d"), BmpImageWrapper->GetBitDepth());
-                return false;
-            }
+        Image.RawData = MoveTemp(RegionData);
+        Image.SizeX = Region.Width();
+        Image.SizeY = Region.Height();
+    }
 
+    /**
+     * Crops images that were decoded as a whole, decoders that skip the rest of the image return the region already.
+     * The region becomes the source of the image, so that percent sizes are relative to it
+     */
+    static bool ApplyRegion(const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& Image, FString& OutError)
+    {
+        if (!Options.HasRegion())
+        {
             return true;
         }
-       
-        //
-        // TGA
-        //
-        // Support for alpha stored as pseudo-color 8-bit TGA
-        const FTGAHelpers::FTGAFileHeader* TGA = (FTGAHelpers::FTGAFileHeader*)Buffer;
-        if (Length >= sizeof(FTGAHelpers::FTGAFileHeader) &&
-            ((TGA->ColorMapType == 0 && TGA->ImageTypeCode == 2) ||
-            // ImageTypeCode 3 is greyscale
-            (TGA->ColorMapType == 0 && TGA->ImageTypeCode == 3) ||
-            (TGA->ColorMapType == 0 && TGA->ImageTypeCode == 10) ||
-            (TGA->ColorMapType == 1 && TGA->ImageTypeCode == 1 && TGA->BitsPerPixel == 8))
-            )
+
+        FIntRect Region;
+        if (!ClipRegion(Options.Region, Image.SourceSizeX, Image.SourceSizeY, Region, OutError))
         {
-            // Check the resolution of the imported texture to ensure validity
-            if (!IsImportResolutionValid(TGA->Width, TGA->Height, true))
-            {
-                OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), TGA->Width, TGA->Height);
-                return false;
-            }
+            return false;
+        }
 
-            const bool bResult = FTGAHelpers::DecompressTGA(TGA, OutImage, OutError);
-            if (bResult)
-            {
-                if (OutImage.CompressionSettings == TC_Grayscale && TGA->ImageTypeCode == 3)
-                {
-                    // default grayscales to linear as they wont get compression otherwise and are commonly used as masks
-                    OutImage.SRGB = false;
-                    
-                }
-
-                OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
-            }
-            else
+        if (Image.SizeX != Region.Width() || Image.SizeY != Region.Height())
+        {
+            if (Image.IsBlockCompressed())
             {
-                OutError = TEXT("Failed to decompress TGA. Please contact devs");
+                OutError = TEXT("Regions can't be cut out of block compressed images");
                 return false;
             }
 
-            return true;
+            CropImage(Image, Region);
         }
 
+        Image.SourceSizeX = Region.Width();
+        Image.SourceSizeY = Region.Height();
+        return true;
+    }
 
-        //
-        // OpenEXR
-        //
-        TSharedPtr<IImageWrapper> ExrImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::EXR);
-        if (ExrImageWrapper.IsValid() && ExrImageWrapper->SetCompressed(Buffer, Length))
-        {
-            int32 Width = ExrImageWrapper->GetWidth();
-            int32 Height = ExrImageWrapper->GetHeight();
-
-            if (!IsImportResolutionValid(Width, Height, true))
-            {
-                return false;
-            }
-
-            // Select the texture's source format
-            ETextureSourceFormat TextureFormat = TSF_Invalid;
-            int32 BitDepth = ExrImageWrapper->GetBitDepth();
-            ERGBFormat Format = ExrImageWrapper->GetFormat();
+    bool ImportBufferAsImage(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError, const FRuntimeImageDecodeOptions& Options)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(STAT_EvoImageUtils_ImportFileAsTexture_ImportBufferAsImage);
 
-            if (Format == ERGBFormat::RGBA && BitDepth == 16)
-            {
-                TextureFormat = TSF_RGBA16F;
-                Format = ERGBFormat::BGRA;
-            }
+        // regions are given in pixels of the full image, which a downscaled decode doesn't have
+        if (Options.HasRegion() && Options.MinScale < 1.0f)
+        {
+            FRuntimeImageDecodeOptions FullSizeOptions = Options;
+            FullSizeOptions.MinScale = 1.0f;
+            return ImportBufferAsImage(Buffer, Length, OutImage, OutError, FullSizeOptions);
+        }
+        
+        FRuntimeImageDecoderPtr Decoder = FRuntimeImageDecoderRegistry::Get().FindDecoder(Buffer, Length);
+        if (!Decoder.IsValid())
+        {
+            OutError = FString::Printf(TEXT("Failed to decode image. The format is not supported!"));
+            return false;
+        }
 
-            if (TextureFormat == TSF_Invalid)
-            {
-                OutError = TEXT("EXR file contains data in an unsupported format.");
-                return false;
-            }
+        return Decoder->DecodeWithOptions(Buffer, Length, Options, OutImage, OutError) && ApplyRegion(Options, OutImage, OutError);
+    }
 
-            TArray<uint8> RawExr;
-            if (ExrImageWrapper->GetRaw(Format, BitDepth, RawExr))
-            {
-                OutImage.Init2D(
-                    Width,
-                    Height,
-                    TextureFormat,
-                    RawExr.GetData()
-                );
-
-                OutImage.SRGB = false;
-                OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
-                OutImage.CompressionSettings = TC_HDR;
-            }
-            else
-            {
-                OutError = FString::Printf(TEXT("Failed to decode EXR. Bit depth: %d"), BitDepth);
-                return false;
-            }
+    bool ImportBufferAsPreview(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(STAT_RuntimeImageUtils_ImportBufferAsPreview);
 
-            return true;
-        }
+        FRuntimeImageDecoderPtr Decoder = FRuntimeImageDecoderRegistry::Get().FindDecoder(Buffer, Length);
+        return Decoder.IsValid() && Decoder->DecodePreview(Buffer, Length, OutImage, OutError);
+    }
 
-        //
-        // TIFF
-        //
-#if WITH_FREEIMAGE_LIB
-        static FRuntimeTiffLoadHelper TiffLoaderHelper;
-        if (TiffLoaderHelper.IsValid())
-        {
-            TiffLoaderHelper.Reset();
+    bool CanImportArchiveAsImage(FArchive& Archive)
+    {
+        return FStreamingImageDecoders::CanDecode(FStreamingImageDecoders::SniffFormat(Archive));
+    }
 
-            if (TiffLoaderHelper.Load(Buffer, Length))
-            {
-                OutImage.Init2D(
-                    TiffLoaderHelper.Width,
-                    TiffLoaderHelper.Height,
-                    TiffLoaderHelper.TextureSourceFormat,
-                    TiffLoaderHelper.RawData.GetData()
-                );
-
-                OutImage.SRGB = TiffLoaderHelper.bSRGB;
-                OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
-                OutImage.CompressionSettings = TiffLoaderHelper.CompressionSettings;
-
-                return true;
-            }
-        }
-#endif // WITH_FREEIMAGE_LIB
+    bool ImportArchiveAsImage(FArchive& Archive, FRuntimeImageData& OutImage, FString& OutError, const FRuntimeImageDecodeOptions& Options)
+    {
+        QUICK_SCOPE_CYCLE_COUNTER(STAT_RuntimeImageUtils_ImportArchiveAsImage);
 
-        //
-        // QOI
-        //
-        FQOILoader QOILoader;
-        if (QOILoader.IsValidImage(Buffer, Length))
+        const ERuntimeImageFormat Format = FStreamingImageDecoders::SniffFormat(Archive);
+        if (!FStreamingImageDecoders::CanDecode(Format))
         {
-            if (QOILoader.Load(Buffer, Length))
-            {
-                OutImage.Init2D(
-                    QOILoader.Width,
-                    QOILoader.Height,
-                    QOILoader.TextureSourceFormat,
-                    QOILoader.RawData.GetData()
-                );
-                
-                OutImage.SRGB = QOILoader.bSRGB;
-                OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
-                OutImage.CompressionSettings = QOILoader.CompressionSettings;
-
-                return true;
-            }
-
-            OutError = QOILoader.GetLastError();
+            OutError = TEXT("Failed to decode image. The format can't be decoded from a stream!");
             return false;
         }
 
-        //
-        // HDR File
-        //
-        TSharedPtr<IImageWrapper> HdrImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::HDR);
-        if (HdrImageWrapper.IsValid() && HdrImageWrapper->SetCompressed(Buffer, Length))
-        {
-            if (!IsImportResolutionValid(HdrImageWrapper->GetWidth(), HdrImageWrapper->GetHeight(), true))
-            {
-                OutError = FString::Printf(TEXT("HDR Texture resolution is not supported: %d x %d"), HdrImageWrapper->GetWidth(), HdrImageWrapper->GetHeight());
-                return false;
-            }
-
-            // Select the texture's source format
-            ETextureSourceFormat TextureFormat = TSF_BGRE8;
-            int32 BitDepth = HdrImageWrapper->GetBitDepth();
-            ERGBFormat Format = HdrImageWrapper->GetFormat();
-
-            TArray64<uint8> RawHDR;
-            if (HdrImageWrapper->GetRaw(ERGBFormat::BGRE, BitDepth, RawHDR))
-            {
-                OutImage.Init2D(
-                    HdrImageWrapper->GetWidth(),
-                    HdrImageWrapper->GetHeight(),
-                    TextureFormat,
-                    RawHDR.GetData()
-                );
-
-                OutImage.SRGB = false;
-                OutImage.GammaSpace = EGammaSpace::Linear;
-                OutImage.CompressionSettings = TC_HDR;
-            }
-            else
-            {
-                OutError = TEXT("Failed to load .HDR image. Input image is not valid cubemap texture!");
-                return false;
-            }
+        return FStreamingImageDecoders::Decode(Format, Archive, Options, OutImage, OutError) && ApplyRegion(Options, OutImage, OutError);
+    }
 
-            return true;
+    FString GetTextureBaseName(const FString& ImageFilename)
+    {
+        // the whole image is encoded into a data URI, it would overflow the maximum FName length
+        if (FImageReaderDataUri::IsDataURI(ImageFilename))
+        {
+            return TEXT("DataURI");
         }
 
-        OutError = FString::Printf(TEXT("Failed to decode image. The format is not supported!"));
-        return false;
+        return FPaths::GetBaseFilename(ImageFilename);
     }
 
     UTexture2D* CreateTexture(const FString& ImageFilename, const FRuntimeImageData& ImageData)
     {
         check(IsInGameThread());
 
-        const FString& BaseFilename = FPaths::GetBaseFilename(ImageFilename);
+        const FString& BaseFilename = GetTextureBaseName(ImageFilename);
 
         UTexture2D* NewTexture = NewObject<UTexture2D>(
             (UObject*)GetTransientPackage(),
@@ -480,11 +234,50 @@ namespace FRuntimeImageUtils
         return NewTexture;
     }
 
+    void ResetTexture(UTexture2D* Texture, const FRuntimeImageData& ImageData)
+    {
+        check(IsInGameThread());
+        check(IsValid(Texture));
+
+        // old resource is deleted on the render thread, the texture keeps its identity for everything that references it
+        Texture->ReleaseResource();
+
+        Texture->SRGB = ImageData.SRGB;
+        Texture->Filter = ImageData.FilterMode;
+
+#if ENGINE_MAJOR_VERSION < 5
+        FTexturePlatformData* PlatformData = Texture->PlatformData;
+#else
+        FTexturePlatformData* PlatformData = Texture->GetPlatformData();
+#endif
+        if (PlatformData == nullptr)
+        {
+            PlatformData = new FTexturePlatformData();
+#if ENGINE_MAJOR_VERSION < 5
+            Texture->PlatformData = PlatformData;
+#else
+            Texture->SetPlatformData(PlatformData);
+#endif
+        }
+
+        PlatformData->SizeX = ImageData.SizeX;
+        PlatformData->SizeY = ImageData.SizeY;
+        PlatformData->PixelFormat = ImageData.PixelFormat;
+
+        if (PlatformData->Mips.Num() == 0)
+        {
+            PlatformData->Mips.Add(new FTexture2DMipMap());
+        }
+
+        PlatformData->Mips[0].SizeX = ImageData.SizeX;
+        PlatformData->Mips[0].SizeY = ImageData.SizeY;
+    }
+
     UTextureCube* CreateTextureCube(const FString& ImageFilename, const FRuntimeImageData& ImageData)
     {
         check(IsInGameThread());
 
-        const FString& BaseFilename = FPaths::GetBaseFilename(ImageFilename);
+        const FString& BaseFilename = GetTextureBaseName(ImageFilename);
 
         UTextureCube* NewTexture = NewObject<UTextureCube>(
             (UObject*)GetTransientPackage(),
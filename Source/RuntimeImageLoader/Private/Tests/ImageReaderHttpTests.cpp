@@ -0,0 +1,470 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Runtime/Launch/Resources/Version.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Misc/ScopeLock.h"
+#include "IPAddress.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+
+#include "ImageReaders/ImageReaderHttp.h"
+
+#if (ENGINE_MAJOR_VERSION > 5) || (ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 5)
+#define IMAGE_READER_HTTP_TEST_FLAGS (EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+#else
+#define IMAGE_READER_HTTP_TEST_FLAGS (EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+#endif
+
+namespace ImageReaderHttpTests
+{
+    struct FStubResponse
+    {
+        /** 0 closes the connection without an answer */
+        int32 StatusCode = 200;
+        double DelaySeconds = 0.0;
+    };
+
+    /**
+     * Minimal HTTP server on the loopback interface. Requests are answered in order with the scripted responses, the last one repeats.
+     * Every connection is closed after its answer, connections the client closes while an answer is delayed count as abandoned.
+     */
+    class FHttpStubServer : public FRunnable
+    {
+    public:
+        explicit FHttpStubServer(TArray<FStubResponse> InResponses)
+            : Responses(MoveTemp(InResponses))
+        {
+            ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+
+            TSharedRef<FInternetAddr> Address = SocketSubsystem->CreateInternetAddr();
+            Address->SetLoopbackAddress();
+            Address->SetPort(0);
+
+            ListenSocket = SocketSubsystem->CreateSocket(NAME_Stream, TEXT("HttpStubServer"), false);
+            if (ListenSocket == nullptr || !ListenSocket->Bind(*Address) || !ListenSocket->Listen(16))
+            {
+                return;
+            }
+            ListenSocket->SetNonBlocking(true);
+
+            // the system picked a free port
+            ListenSocket->GetAddress(*Address);
+            Port = Address->GetPort();
+
+            Thread = FRunnableThread::Create(this, TEXT("HttpStubServer"));
+        }
+
+        virtual ~FHttpStubServer()
+        {
+            if (Thread != nullptr)
+            {
+                Thread->Kill(true);
+                delete Thread;
+            }
+
+            if (ListenSocket != nullptr)
+            {
+                ListenSocket->Close();
+                ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(ListenSocket);
+            }
+        }
+
+        bool IsRunning() const { return Thread != nullptr; }
+        FString GetURL() const { return FString::Printf(TEXT("http://127.0.0.1:%d/image.png"), Port); }
+
+        int32 GetNumRequests() const
+        {
+            FScopeLock StateLock(&StateMutex);
+            return RequestTimes.Num();
+        }
+
+        TArray<double> GetRequestTimes() const
+        {
+            FScopeLock StateLock(&StateMutex);
+            return RequestTimes;
+        }
+
+        int32 GetNumAbandoned() const
+        {
+            FScopeLock StateLock(&StateMutex);
+            return NumAbandoned;
+        }
+
+        virtual void Stop() override
+        {
+            bStopping = true;
+        }
+
+        virtual uint32 Run() override
+        {
+            TArray<FConnection> Connections;
+
+            while (!bStopping)
+            {
+                bool bHasPendingConnection = false;
+                while (ListenSocket->HasPendingConnection(bHasPendingConnection) && bHasPendingConnection)
+                {
+                    FConnection& Connection = Connections.AddDefaulted_GetRef();
+                    Connection.Socket = ListenSocket->Accept(TEXT("HttpStubConnection"));
+                    if (Connection.Socket == nullptr)
+                    {
+                        Connections.Pop();
+                        break;
+                    }
+                    Connection.Socket->SetNonBlocking(true);
+                }
+
+                for (int32 Index = Connections.Num() - 1; Index >= 0; --Index)
+                {
+                    if (TickConnection(Connections[Index]))
+                    {
+                        CloseConnection(Connections[Index]);
+                        Connections.RemoveAtSwap(Index);
+                    }
+                }
+
+                FPlatformProcess::Sleep(0.001f);
+            }
+
+            for (FConnection& Connection : Connections)
+            {
+                CloseConnection(Connection);
+            }
+
+            return 0;
+        }
+
+    private:
+        struct FConnection
+        {
+            FSocket* Socket = nullptr;
+            TArray<uint8> Request;
+            bool bRequestComplete = false;
+            double AnswerTime = 0.0;
+            FStubResponse Response;
+        };
+
+        /** Returns true when the connection is done */
+        bool TickConnection(FConnection& Connection)
+        {
+            uint8 Buffer[1024];
+            int32 BytesRead = 0;
+
+            // Recv fails once the client closed the connection, a connection without data just reads nothing
+            if (!Connection.Socket->Recv(Buffer, sizeof(Buffer), BytesRead))
+            {
+                if (Connection.bRequestComplete)
+                {
+                    FScopeLock StateLock(&StateMutex);
+                    ++NumAbandoned;
+                }
+                return true;
+            }
+
+            if (!Connection.bRequestComplete)
+            {
+                Connection.Request.Append(Buffer, BytesRead);
+
+                static const char HeadersEnd[] = "\r\n\r\n";
+                const int32 HeadersEndLength = 4;
+                for (int32 Offset = 0; Offset + HeadersEndLength <= Connection.Request.Num(); ++Offset)
+                {
+                    if (FMemory::Memcmp(Connection.Request.GetData() + Offset, HeadersEnd, HeadersEndLength) == 0)
+                    {
+                        Connection.bRequestComplete = true;
+                        break;
+                    }
+                }
+
+                if (Connection.bRequestComplete)
+                {
+                    FScopeLock StateLock(&StateMutex);
+                    Connection.Response = Responses[FMath::Min(RequestTimes.Num(), Responses.Num() - 1)];
+                    Connection.AnswerTime = FPlatformTime::Seconds() + Connection.Response.DelaySeconds;
+                    RequestTimes.Add(FPlatformTime::Seconds());
+                }
+                return false;
+            }
+
+            if (FPlatformTime::Seconds() < Connection.AnswerTime)
+            {
+                return false;
+            }
+
+            if (Connection.Response.StatusCode > 0)
+            {
+                static const char Body[] = "stub image";
+                const FString Answer = FString::Printf(TEXT("HTTP/1.1 %d Stub\r\nContent-Type: application/octet-stream\r\nContent-Length: %d\r\nConnection: close\r\n\r\n%s"),
+                    Connection.Response.StatusCode, int32(sizeof(Body) - 1), ANSI_TO_TCHAR(Body));
+                const FTCHARToUTF8 AnswerUTF8(*Answer);
+
+                int32 TotalSent = 0;
+                while (TotalSent < AnswerUTF8.Length() && !bStopping)
+                {
+                    int32 BytesSent = 0;
+                    if (!Connection.Socket->Send(reinterpret_cast<const uint8*>(AnswerUTF8.Get()) + TotalSent, AnswerUTF8.Length() - TotalSent, BytesSent))
+                    {
+                        break;
+                    }
+                    TotalSent += BytesSent;
+                }
+            }
+
+            return true;
+        }
+
+        static void CloseConnection(FConnection& Connection)
+        {
+            Connection.Socket->Close();
+            ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Connection.Socket);
+            Connection.Socket = nullptr;
+        }
+
+    private:
+        TArray<FStubResponse> Responses;
+        FSocket* ListenSocket = nullptr;
+        int32 Port = 0;
+        FRunnableThread* Thread = nullptr;
+        FThreadSafeBool bStopping = false;
+
+        mutable FCriticalSection StateMutex;
+        TArray<double> RequestTimes;
+        int32 NumAbandoned = 0;
+    };
+
+    /** Sets a console variable for the duration of a test */
+    class FScopedCVar
+    {
+    public:
+        FScopedCVar(const TCHAR* Name, const TCHAR* Value)
+            : CVar(IConsoleManager::Get().FindConsoleVariable(Name))
+        {
+            if (CVar != nullptr)
+            {
+                PreviousValue = CVar->GetString();
+                CVar->Set(Value, ECVF_SetByCode);
+            }
+        }
+
+        ~FScopedCVar()
+        {
+            if (CVar != nullptr)
+            {
+                CVar->Set(*PreviousValue, ECVF_SetByCode);
+            }
+        }
+
+    private:
+        IConsoleVariable* CVar = nullptr;
+        FString PreviousValue;
+    };
+
+    /** Fast retries without hedging, so that every test only sees the attempts it scripted */
+    struct FScopedHttpTestSettings
+    {
+        FScopedCVar MaxRetries { TEXT("RuntimeImageLoader.Http.MaxRetries"), TEXT("3") };
+        FScopedCVar RetryBaseDelay { TEXT("RuntimeImageLoader.Http.RetryBaseDelay"), TEXT("0.01") };
+        FScopedCVar RetryMaxDelay { TEXT("RuntimeImageLoader.Http.RetryMaxDelay"), TEXT("0.05") };
+        FScopedCVar Timeout { TEXT("RuntimeImageLoader.Http.Timeout"), TEXT("10") };
+        FScopedCVar HedgePercentile { TEXT("RuntimeImageLoader.Http.HedgePercentile"), TEXT("0") };
+    };
+
+    static TArray<uint8> Download(const FHttpStubServer& Server, int64 RangeBytes = 0)
+    {
+        FImageReaderHttp Reader;
+        Reader.BeginRead(Server.GetURL(), RangeBytes);
+        return Reader.EndRead();
+    }
+}
+
+using namespace ImageReaderHttpTests;
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FImageReaderHttpRetriesTransientErrorsTest, "Plugins.RuntimeImageLoader.Http.RetriesTransientErrors", IMAGE_READER_HTTP_TEST_FLAGS)
+
+bool FImageReaderHttpRetriesTransientErrorsTest::RunTest(const FString& Parameters)
+{
+    FScopedHttpTestSettings Settings;
+
+    // connection failures are scripted as status 0
+    for (const int32 StatusCode : { 500, 503, 408, 429, 0 })
+    {
+        FHttpStubServer Server({ { StatusCode, 0.0 }, { 200, 0.0 } });
+        if (!TestTrue(TEXT("Stub server is running"), Server.IsRunning()))
+        {
+            return false;
+        }
+
+        const TArray<uint8> Data = Download(Server);
+        TestTrue(FString::Printf(TEXT("Download succeeds after a %d"), StatusCode), Data.Num() > 0);
+        TestEqual(FString::Printf(TEXT("A %d is retried once"), StatusCode), Server.GetNumRequests(), 2);
+    }
+
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FImageReaderHttpFailsClientErrorsTest, "Plugins.RuntimeImageLoader.Http.FailsClientErrors", IMAGE_READER_HTTP_TEST_FLAGS)
+
+bool FImageReaderHttpFailsClientErrorsTest::RunTest(const FString& Parameters)
+{
+    FScopedHttpTestSettings Settings;
+
+    for (const int32 StatusCode : { 400, 401, 403, 404, 410 })
+    {
+        FHttpStubServer Server({ { StatusCode, 0.0 }, { 200, 0.0 } });
+        if (!TestTrue(TEXT("Stub server is running"), Server.IsRunning()))
+        {
+            return false;
+        }
+
+        const TArray<uint8> Data = Download(Server);
+        TestEqual(FString::Printf(TEXT("Download fails with a %d"), StatusCode), Data.Num(), 0);
+        TestEqual(FString::Printf(TEXT("A %d is not retried"), StatusCode), Server.GetNumRequests(), 1);
+    }
+
+    // a ranged probe falls back to a full download only when the server rejects the range
+    {
+        FHttpStubServer Server({ { 404, 0.0 }, { 200, 0.0 } });
+        TestEqual(TEXT("Ranged probe of a missing image fails"), Download(Server, 16).Num(), 0);
+        TestEqual(TEXT("Ranged probe of a missing image is not repeated without the range"), Server.GetNumRequests(), 1);
+    }
+    {
+        FHttpStubServer Server({ { 416, 0.0 }, { 200, 0.0 } });
+        TestTrue(TEXT("Rejected range falls back to a full download"), Download(Server, 16).Num() > 0);
+        TestEqual(TEXT("Rejected range is requested again without the range"), Server.GetNumRequests(), 2);
+    }
+
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FImageReaderHttpRetryCapTest, "Plugins.RuntimeImageLoader.Http.RetryCap", IMAGE_READER_HTTP_TEST_FLAGS)
+
+bool FImageReaderHttpRetryCapTest::RunTest(const FString& Parameters)
+{
+    FScopedHttpTestSettings Settings;
+    FScopedCVar MaxRetries(TEXT("RuntimeImageLoader.Http.MaxRetries"), TEXT("2"));
+
+    FHttpStubServer Server({ { 503, 0.0 } });
+    if (!TestTrue(TEXT("Stub server is running"), Server.IsRunning()))
+    {
+        return false;
+    }
+
+    TestEqual(TEXT("Download fails when every attempt fails"), Download(Server).Num(), 0);
+    TestEqual(TEXT("First attempt and MaxRetries retries are made"), Server.GetNumRequests(), 3);
+
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FImageReaderHttpBackoffTest, "Plugins.RuntimeImageLoader.Http.Backoff", IMAGE_READER_HTTP_TEST_FLAGS)
+
+bool FImageReaderHttpBackoffTest::RunTest(const FString& Parameters)
+{
+    FScopedHttpTestSettings Settings;
+    FScopedCVar RetryBaseDelay(TEXT("RuntimeImageLoader.Http.RetryBaseDelay"), TEXT("0.1"));
+    FScopedCVar RetryMaxDelay(TEXT("RuntimeImageLoader.Http.RetryMaxDelay"), TEXT("0.3"));
+
+    // full jitter: delays spread between 0 and the exponential bound, which stops at RetryMaxDelay
+    const double ExpectedBounds[] = { 0.1, 0.2, 0.3, 0.3 };
+    for (int32 RetryIndex = 0; RetryIndex < UE_ARRAY_COUNT(ExpectedBounds); ++RetryIndex)
+    {
+        double MinDelay = TNumericLimits<double>::Max();
+        double MaxDelay = 0.0;
+        for (int32 Sample = 0; Sample < 1000; ++Sample)
+        {
+            const double Delay = FImageReaderHttp::GetRetryDelay(RetryIndex);
+            MinDelay = FMath::Min(MinDelay, Delay);
+            MaxDelay = FMath::Max(MaxDelay, Delay);
+        }
+
+        const double Bound = ExpectedBounds[RetryIndex];
+        TestTrue(FString::Printf(TEXT("Retry %d delay is never negative"), RetryIndex), MinDelay >= 0.0);
+        TestTrue(FString::Printf(TEXT("Retry %d delay stays within %.2f s"), RetryIndex, Bound), MaxDelay <= Bound + KINDA_SMALL_NUMBER);
+        TestTrue(FString::Printf(TEXT("Retry %d delay is jittered"), RetryIndex), MinDelay < Bound * 0.25 && MaxDelay > Bound * 0.75);
+    }
+
+    // the gaps between attempts seen by the server follow the same bounds, plus scheduling slack
+    FHttpStubServer Server({ { 503, 0.0 }, { 503, 0.0 }, { 503, 0.0 }, { 200, 0.0 } });
+    if (!TestTrue(TEXT("Stub server is running"), Server.IsRunning()))
+    {
+        return false;
+    }
+
+    TestTrue(TEXT("Download succeeds after three retries"), Download(Server).Num() > 0);
+
+    const TArray<double> RequestTimes = Server.GetRequestTimes();
+    if (TestEqual(TEXT("Three retries are made"), RequestTimes.Num(), 4))
+    {
+        constexpr double Slack = 0.15;
+        for (int32 RetryIndex = 0; RetryIndex < 3; ++RetryIndex)
+        {
+            const double Gap = RequestTimes[RetryIndex + 1] - RequestTimes[RetryIndex];
+            TestTrue(FString::Printf(TEXT("Retry %d waits at most the backoff bound (%.3f s)"), RetryIndex, Gap), Gap <= ExpectedBounds[RetryIndex] + Slack);
+        }
+    }
+
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FImageReaderHttpHedgeTest, "Plugins.RuntimeImageLoader.Http.Hedge", IMAGE_READER_HTTP_TEST_FLAGS)
+
+bool FImageReaderHttpHedgeTest::RunTest(const FString& Parameters)
+{
+    FScopedHttpTestSettings Settings;
+    FScopedCVar MaxRetries(TEXT("RuntimeImageLoader.Http.MaxRetries"), TEXT("0"));
+    FScopedCVar HedgeMinSamples(TEXT("RuntimeImageLoader.Http.HedgeMinSamples"), TEXT("1"));
+    FScopedCVar HedgeMinDelay(TEXT("RuntimeImageLoader.Http.HedgeMinDelay"), TEXT("0.2"));
+
+    // a fast download records the latency sample hedging needs
+    {
+        FHttpStubServer Server({ { 200, 0.0 } });
+        if (!TestTrue(TEXT("Stub server is running"), Server.IsRunning()))
+        {
+            return false;
+        }
+        TestTrue(TEXT("Warm-up download succeeds"), Download(Server).Num() > 0);
+    }
+
+    // the lowest percentile picks the fastest sample, so slow downloads made before the test don't delay the hedge
+    FScopedCVar HedgePercentile(TEXT("RuntimeImageLoader.Http.HedgePercentile"), TEXT("1"));
+
+    // the first attempt stalls, the hedged one is answered right away
+    constexpr double StallSeconds = 5.0;
+    FHttpStubServer Server({ { 200, StallSeconds }, { 200, 0.0 } });
+
+    const double StartTime = FPlatformTime::Seconds();
+    const TArray<uint8> Data = Download(Server);
+    const double Elapsed = FPlatformTime::Seconds() - StartTime;
+
+    TestTrue(TEXT("Hedged download succeeds"), Data.Num() > 0);
+    TestEqual(TEXT("A hedged request is issued"), Server.GetNumRequests(), 2);
+    TestTrue(FString::Printf(TEXT("Hedged request wins long before the stalled one (%.3f s)"), Elapsed), Elapsed < StallSeconds * 0.5);
+
+    // the losing request is cancelled, its connection is closed before the stub answers it
+    const double CancelDeadline = FPlatformTime::Seconds() + 2.0;
+    while (Server.GetNumAbandoned() == 0 && FPlatformTime::Seconds() < CancelDeadline)
+    {
+        FPlatformProcess::Sleep(0.01f);
+    }
+    TestEqual(TEXT("Losing request is cancelled"), Server.GetNumAbandoned(), 1);
+
+    return true;
+}
+
+#undef IMAGE_READER_HTTP_TEST_FLAGS
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -35,6 +35,66 @@ FTexture2DRHIRef FRuntimeRHITexture2DFactory::Create()
     return RHITexture2D;
 }
 
+bool FRuntimeRHITexture2DFactory::Update()
+{
+#if ENGINE_MAJOR_VERSION < 5
+    FTextureResource* TextureResource = NewTexture->Resource;
+#else
+    FTextureResource* TextureResource = NewTexture->GetResource();
+#endif
+
+    if (TextureResource == nullptr || !TextureResource->TextureRHI.IsValid())
+    {
+        return false;
+    }
+
+    const FIntVector ExistingSize = TextureResource->TextureRHI->GetSizeXYZ();
+    if (ExistingSize.X != ImageData.SizeX || ExistingSize.Y != ImageData.SizeY || TextureResource->TextureRHI->GetFormat() != ImageData.PixelFormat 
+        || TextureResource->TextureRHI->GetNumMips() != ImageData.NumMips || NewTexture->SRGB != ImageData.SRGB)
+    {
+        return false;
+    }
+
+#if (ENGINE_MAJOR_VERSION >= 5) && (ENGINE_MINOR_VERSION > 0)
+    RHITexture2D = TextureResource->TextureRHI;
+#else
+    RHITexture2D = TextureResource->TextureRHI->GetTexture2D();
+#endif
+
+    FGraphEventRef UpdateTextureTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
+        [this]()
+        {
+            UpdateMips();
+        }, TStatId(), nullptr, ENamedThreads::ActualRenderingThread
+    );
+    UpdateTextureTask->Wait();
+
+    return true;
+}
+
+void FRuntimeRHITexture2DFactory::UpdateMips()
+{
+    for (int32 MipIndex = 0; MipIndex < ImageData.NumMips; ++MipIndex)
+    {
+        FUpdateTextureRegion2D TextureRegion2D;
+        {
+            TextureRegion2D.DestX = 0;
+            TextureRegion2D.DestY = 0;
+            TextureRegion2D.SrcX = 0;
+            TextureRegion2D.SrcY = 0;
+            TextureRegion2D.Width = FMath::Max(ImageData.SizeX >> MipIndex, 1);
+            TextureRegion2D.Height = FMath::Max(ImageData.SizeY >> MipIndex, 1);
+        }
+
+        // the pitch of block compressed mips is one row of blocks
+        RHIUpdateTexture2D(
+            RHITexture2D, MipIndex, TextureRegion2D,
+            ImageData.GetMipPitch(MipIndex),
+            ImageData.RawData.GetData() + ImageData.GetMipOffset(MipIndex)
+        );
+    }
+}
+
 struct FTextureDataResource : public FResourceBulkDataInterface
 {
 public:
@@ -53,10 +113,16 @@ private:
 
 FTexture2DRHIRef FRuntimeRHITexture2DFactory::CreateRHITexture2D_Windows()
 {
-    uint32 NumMips = 1;
     uint32 NumSamples = 1;
     void* Mip0Data = (void*)ImageData.RawData.GetData();
 
+    // pre-built chains of block compressed images are uploaded as they are
+    TArray<void*, TInlineAllocator<MAX_TEXTURE_MIP_COUNT>> InitialMipData;
+    for (int32 MipIndex = 0; MipIndex < ImageData.NumMips; ++MipIndex)
+    {
+        InitialMipData.Add((void*)(ImageData.RawData.GetData() + ImageData.GetMipOffset(MipIndex)));
+    }
+
     ETextureCreateFlags TextureFlags = TexCreate_ShaderResource;
     if (ImageData.SRGB)
     {
@@ -76,8 +142,8 @@ FTexture2DRHIRef FRuntimeRHITexture2DFactory::CreateRHITexture2D_Windows()
             ImageData.NumMips,
             TextureFlags,
             ERHIAccess::Unknown,
-            &Mip0Data,
-            1,
+            InitialMipData.GetData(),
+            InitialMipData.Num(),
             TEXT("RuntimeImageReaderTextureData"),
             CompletionEvent
         );
@@ -87,8 +153,8 @@ FTexture2DRHIRef FRuntimeRHITexture2DFactory::CreateRHITexture2D_Windows()
             ImageData.PixelFormat,
             ImageData.NumMips,
             TextureFlags,
-            &Mip0Data,
-            1,
+            InitialMipData.GetData(),
+            InitialMipData.Num(),
             CompletionEvent
         );
 #else
@@ -97,8 +163,8 @@ FTexture2DRHIRef FRuntimeRHITexture2DFactory::CreateRHITexture2D_Windows()
             ImageData.PixelFormat,
             ImageData.NumMips,
             TextureFlags,
-            &Mip0Data,
-            1
+            InitialMipData.GetData(),
+            InitialMipData.Num()
         );
 #endif
     }
@@ -158,9 +224,7 @@ FTexture2DRHIRef FRuntimeRHITexture2DFactory::CreateRHITexture2D_Windows()
 
 FTexture2DRHIRef FRuntimeRHITexture2DFactory::CreateRHITexture2D_Mobile()
 {
-    uint32 NumMips = 1;
     uint32 NumSamples = 1;
-    void* Mip0Data = (void*)ImageData.RawData.GetData();
 
     ETextureCreateFlags TextureFlags = TexCreate_ShaderResource;
     if (ImageData.SRGB)
@@ -210,21 +274,7 @@ FTexture2DRHIRef FRuntimeRHITexture2DFactory::CreateRHITexture2D_Mobile()
                 DummyCreateInfo);
 #endif
 
-            FUpdateTextureRegion2D TextureRegion2D;
-            {
-                TextureRegion2D.DestX = 0;
-                TextureRegion2D.DestY = 0;
-                TextureRegion2D.SrcX = 0;
-                TextureRegion2D.SrcY = 0;
-                TextureRegion2D.Width = ImageData.SizeX;
-                TextureRegion2D.Height = ImageData.SizeY;
-            }
-
-            RHIUpdateTexture2D(
-                RHITexture2D, 0, TextureRegion2D,
-                TextureRegion2D.Width * GPixelFormats[ImageData.PixelFormat].BlockBytes,
-                ImageData.RawData.GetData()
-            );
+            UpdateMips();
         }, TStatId(), nullptr, ENamedThreads::ActualRenderingThread
     );
     CreateTextureTask->Wait();
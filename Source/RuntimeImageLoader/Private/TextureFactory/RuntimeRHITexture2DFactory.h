@@ -24,12 +24,16 @@ public:
     FRuntimeRHITexture2DFactory(UTexture2D* InTexture2D, const FRuntimeImageData& InImageData);
 
     FTexture2DRHIRef Create();
+    /** Uploads the image into the RHI texture the texture already has. Returns false if there is none or its size or format differ */
+    bool Update();
 
 private:
     FTexture2DRHIRef CreateRHITexture2D_Windows();
     FTexture2DRHIRef CreateRHITexture2D_Mobile();
     FTexture2DRHIRef CreateRHITexture2D_Other();
     void FinalizeRHITexture2D();
+    /** Uploads every mip of the image into RHITexture2D, called on the rendering thread */
+    void UpdateMips();
 
 private:
     UTexture2D* NewTexture;
@@ -59,7 +59,6 @@ FTextureCubeRHIRef FRuntimeRHITextureCubeFactory::CreateTextureCubeRHI_Windows()
 {
     FTextureCubeRHIRef TextureCubeRHI = nullptr;
     
-    int32 NumMips = 1;
     uint32 NumSamples = 1;
 
     ensureMsgf(ImageData.SizeX > 0, TEXT("ImageData.SizeX must be > 0"));
@@ -67,6 +66,7 @@ FTextureCubeRHIRef FRuntimeRHITextureCubeFactory::CreateTextureCubeRHI_Windows()
 
     ETextureCreateFlags TextureFlags = TexCreate_ShaderResource | (ImageData.SRGB ? TexCreate_SRGB : TexCreate_None);
 
+    // the RHI reads the bulk data face by face, every face with all of its mips
     FTextureCubeDataResource TextureCubeData((void*)ImageData.RawData.GetData(), ImageData.RawData.Num());
 
     FGraphEventRef CreateTextureTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
@@ -77,7 +77,7 @@ FTextureCubeRHIRef FRuntimeRHITextureCubeFactory::CreateTextureCubeRHI_Windows()
                 FRHITextureCreateDesc::CreateCube(TEXT("RuntimeImageReader_TextureCubeData"))
                 .SetExtent(ImageData.SizeX)
                 .SetFormat(ImageData.PixelFormat)
-                .SetNumMips(1)
+                .SetNumMips(ImageData.NumMips)
                 .SetFlags(TextureFlags)
                 .SetInitialState(ERHIAccess::Unknown)
                 .SetBulkData(&TextureCubeData)
@@ -89,7 +89,7 @@ FTextureCubeRHIRef FRuntimeRHITextureCubeFactory::CreateTextureCubeRHI_Windows()
                 FRHITextureCreateDesc::CreateCube(CreateInfo.DebugName)
                 .SetExtent(ImageData.SizeX)
                 .SetFormat(ImageData.PixelFormat)
-                .SetNumMips(1)
+                .SetNumMips(ImageData.NumMips)
                 .SetFlags(TextureFlags)
                 .SetInitialState(ERHIAccess::Unknown)
                 .SetExtData(CreateInfo.ExtData)
@@ -101,7 +101,7 @@ FTextureCubeRHIRef FRuntimeRHITextureCubeFactory::CreateTextureCubeRHI_Windows()
             FRHIResourceCreateInfo CreateInfo(TEXT("RuntimeImageReader_TextureCubeData"));
             CreateInfo.BulkData = &TextureCubeData;
             TextureCubeRHI = RHICreateTextureCube(
-                ImageData.SizeX, ImageData.PixelFormat, 1, TextureFlags, CreateInfo);
+                ImageData.SizeX, ImageData.PixelFormat, ImageData.NumMips, TextureFlags, CreateInfo);
 #endif
         }, TStatId(), nullptr, ENamedThreads::ActualRenderingThread
     );
@@ -40,6 +40,32 @@ UTexture2D* URuntimeTextureFactory::CreateTexture2D(const FConstructTextureTask&
     return OutResult;
 }
 
+void URuntimeTextureFactory::ResetTexture2D(UTexture2D* Texture, const FConstructTextureTask& Task)
+{
+    if (IsInGameThread())
+    {
+        FRuntimeImageUtils::ResetTexture(Texture, *Task.ImageData);
+        return;
+    }
+
+    if (IsEngineExitRequested())
+    {
+        return;
+    }
+
+    CurrentTask = Async(
+        EAsyncExecution::TaskGraphMainThread,
+        [Texture, Task]()
+        {
+            FRuntimeImageUtils::ResetTexture(Texture, *Task.ImageData);
+
+            return true;
+        }
+    );
+
+    CurrentTask.Get();
+}
+
 UTextureCube* URuntimeTextureFactory::CreateTextureCube(const FConstructTextureTask& Task)
 {
     UTextureCube* OutResult = nullptr;
@@ -27,6 +27,8 @@ public:
 public:
     UTexture2D* CreateTexture2D(const FConstructTextureTask& Task);
     UTextureCube* CreateTextureCube(const FConstructTextureTask& Task);
+    /** Releases the resource of an existing texture and resizes it for the new image data */
+    void ResetTexture2D(UTexture2D* Texture, const FConstructTextureTask& Task);
 
 private:
     TFuture<bool> CurrentTask;
@@ -0,0 +1,60 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RuntimeImageData.h"
+
+/** Hints about how the decoded image is going to be used */
+struct FRuntimeImageDecodeOptions
+{
+    /** The image is downscaled to this fraction of its size after decoding, decoders may produce any size that is not smaller */
+    float MinScale = 1.0f;
+
+    /** Channels to decode from formats with named channels such as EXR ("Z", "diffuse.R"), empty decodes RGBA */
+    TArray<FString> Channels;
+
+    /** Part of the image to decode in pixels of the full image, Max is exclusive. Decoders that can't skip the rest decode everything and the region is cut out afterwards */
+    FIntRect Region;
+
+    bool HasRegion() const
+    {
+        return Region.Width() > 0 && Region.Height() > 0;
+    }
+};
+
+/**
+ * Decodes one image format from an in-memory buffer. Register implementations with FRuntimeImageDecoderRegistry.
+ * Decode can be called from several image reader threads at once.
+ */
+class RUNTIMEIMAGELOADER_API IRuntimeImageDecoder
+{
+public:
+    virtual ~IRuntimeImageDecoder() {}
+
+    virtual FName GetName() const = 0;
+
+    /** Checks the signature bytes only, called for every candidate decoder so it has to be cheap */
+    virtual bool CanDecode(const uint8* Buffer, int64 Length) const = 0;
+
+    virtual bool Decode(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError) = 0;
+
+    /** Decoders that can produce a smaller image cheaper than the full one override this, OutImage.SourceSizeX/Y keep the full size */
+    virtual bool DecodeWithOptions(const uint8* Buffer, int64 Length, const FRuntimeImageDecodeOptions& Options, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        return Decode(Buffer, Length, OutImage, OutError);
+    }
+
+    /**
+     * Progressive formats override this to decode only the first coarse pass of the image, shown while the full decode runs.
+     * Returns false without an error if the image has no such pass. OutImage.SourceSizeX/Y keep the full size.
+     * This is the only intermediate image of a load, later passes or scans are not reported and the next update is the full decode
+     */
+    virtual bool DecodePreview(const uint8* Buffer, int64 Length, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        return false;
+    }
+
+    /** Decoders with higher priority are asked first. Formats without a magic number should use a negative priority */
+    virtual int32 GetPriority() const { return 0; }
+};
@@ -0,0 +1,37 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/ScopeRWLock.h"
+#include "ImageDecoders/IRuntimeImageDecoder.h"
+
+typedef TSharedRef<IRuntimeImageDecoder, ESPMode::ThreadSafe> FRuntimeImageDecoderRef;
+typedef TSharedPtr<IRuntimeImageDecoder, ESPMode::ThreadSafe> FRuntimeImageDecoderPtr;
+
+/**
+ * Picks exactly one decoder for an encoded image by its signature bytes.
+ * Built-in decoders are registered on first use, project decoders registered later take precedence over built-ins of the same priority.
+ */
+class RUNTIMEIMAGELOADER_API FRuntimeImageDecoderRegistry
+{
+public:
+    static FRuntimeImageDecoderRegistry& Get();
+
+    void RegisterDecoder(FRuntimeImageDecoderRef Decoder);
+    void UnregisterDecoder(FName DecoderName);
+
+    /** Returns the first decoder that recognises the signature, or nullptr if the format is unknown */
+    FRuntimeImageDecoderPtr FindDecoder(const uint8* Buffer, int64 Length) const;
+
+    TArray<FRuntimeImageDecoderRef> GetDecoders() const;
+
+private:
+    FRuntimeImageDecoderRegistry();
+
+    void RegisterBuiltinDecoders();
+
+    mutable FRWLock DecodersLock;
+    /** Sorted by descending priority */
+    TArray<FRuntimeImageDecoderRef> Decoders;
+};
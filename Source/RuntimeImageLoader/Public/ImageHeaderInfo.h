@@ -0,0 +1,71 @@
+// Copyright 2023 Petr Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageHeaderInfo.generated.h"
+
+UENUM(BlueprintType)
+enum class ERuntimeImageFormat : uint8
+{
+    Unknown,
+    PNG,
+    JPEG,
+    GIF,
+    WebP,
+    BMP,
+    TGA,
+    EXR,
+    TIFF,
+    QOI,
+    HDR,
+    DDS,
+    KTX2,
+};
+
+USTRUCT(BlueprintType)
+struct RUNTIMEIMAGELOADER_API FImageHeaderInfo
+{
+    GENERATED_BODY()
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (Category = "Runtime Image Loader"))
+    FString ImageFilename = TEXT("");
+
+    // Unknown when the header was recognised by the stb fallback only
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (Category = "Runtime Image Loader"))
+    ERuntimeImageFormat Format = ERuntimeImageFormat::Unknown;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (Category = "Runtime Image Loader"))
+    int32 Width = 0;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (Category = "Runtime Image Loader"))
+    int32 Height = 0;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (Category = "Runtime Image Loader"))
+    int32 Channels = 0;
+
+    // Bits per channel of the stored samples, 32 for float and shared exponent images
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (Category = "Runtime Image Loader"))
+    int32 BitDepth = 0;
+
+    // Animated GIF, WebP and PNG frames. 0 when the image is animated but its frames reach past the probed header bytes
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (Category = "Runtime Image Loader"))
+    int32 NumFrames = 1;
+
+    // Float or shared exponent samples, loaded as float textures
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (Category = "Runtime Image Loader"))
+    bool bIsHDR = false;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (Category = "Runtime Image Loader"))
+    bool bHasAlpha = false;
+
+    // Filled by directory scans only
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (Category = "Runtime Image Loader"))
+    FDateTime ModificationTime;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (Category = "Runtime Image Loader"))
+    bool bSuccess = false;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (Category = "Runtime Image Loader"))
+    FString OutError = TEXT("");
+};
@@ -8,6 +8,10 @@ class IImageReader
 {
 public:
     virtual TArray<uint8> ReadImage(const FString& ImageURI) = 0;
+    /** Reads at least the first NumBytes of the image (or the whole image if it is smaller). Readers that can't do partial reads return everything */
+    virtual TArray<uint8> ReadImageHeader(const FString& ImageURI, int64 NumBytes) { return ReadImage(ImageURI); }
+    /** Opens the image for streaming decode, readers that can't seek within the image return nullptr */
+    virtual TUniquePtr<FArchive> OpenImageArchive(const FString& ImageURI) { return nullptr; }
     virtual FString GetLastError() const { return TEXT(""); };
     virtual void Flush() = 0;
     virtual void Cancel() = 0;
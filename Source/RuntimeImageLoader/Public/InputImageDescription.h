@@ -19,4 +19,8 @@ struct RUNTIMEIMAGELOADER_API FInputImageDescription
 
     UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Loader"))
     TArray<uint8> ImageBytes;
+
+    /** Raw base64 of the encoded image, without a data URI prefix. It is decoded on the image reader thread */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Loader"))
+    FString ImageBase64;
 };
\ No newline at end of file
@@ -14,7 +14,34 @@
 
 struct RUNTIMEIMAGELOADER_API FRuntimeImageData : public FImage
 {
+    /** Allocates RawData for the image and copies InData into it. Pass nullptr to decode straight into RawData afterwards */
     void Init2D(int32 InSizeX, int32 InSizeY, ETextureSourceFormat InFormat, const void* InData = nullptr);
+    /** Takes ownership of already decoded pixels without copying them */
+    void Init2D(int32 InSizeX, int32 InSizeY, ETextureSourceFormat InFormat, TArray64<uint8>&& InData);
+    /**
+     * Takes ownership of GPU block compressed pixels that are uploaded without being decoded.
+     * InData holds InNumMips mips, largest first, for each of InNumFaces faces (1, or 6 for cubemaps) one face after the other
+     */
+    void InitBlockCompressed(int32 InSizeX, int32 InSizeY, int32 InNumMips, int32 InNumFaces, EPixelFormat InPixelFormat, TArray64<uint8>&& InData);
+
+    /** Block compressed pixels can't be read, resized or converted on the CPU, PixelFormat is set by the decoder */
+    bool IsBlockCompressed() const { return bBlockCompressed; }
+
+    /** Bytes of a SizeX x SizeY image in the given pixel format, counted in whole blocks */
+    static int64 GetPixelFormatImageSize(EPixelFormat InPixelFormat, int32 InSizeX, int32 InSizeY);
+
+    /** Bytes of one row of pixels, or of one row of blocks for block compressed formats, of the given mip in PixelFormat */
+    uint32 GetMipPitch(int32 MipIndex) const;
+
+    /** Bytes of the given mip of one face in PixelFormat */
+    int64 GetMipSize(int32 MipIndex) const;
+
+    /** Offset of the given mip of the given face in RawData */
+    int64 GetMipOffset(int32 MipIndex, int32 FaceIndex = 0) const;
+
+    /** Size of the encoded image, larger than SizeX/SizeY when the decoder already downscaled it */
+    int32 SourceSizeX = 0;
+    int32 SourceSizeY = 0;
 
     int32 NumMips = 1;
     bool SRGB = true;
@@ -22,4 +49,7 @@ struct RUNTIMEIMAGELOADER_API FRuntimeImageData : public FImage
     ETextureSourceFormat TextureSourceFormat = TSF_Invalid;
     TextureCompressionSettings CompressionSettings;
     EPixelFormat PixelFormat = PF_B8G8R8A8;
+
+private:
+    bool bBlockCompressed = false;
 };
\ No newline at end of file
@@ -12,12 +12,16 @@
 #include "Materials/MaterialInterface.h"
 #include "Subsystems/WorldSubsystem.h"
 #include "RuntimeImageReader.h"
+#include "ImageHeaderInfo.h"
 #include "RuntimeImageLoader.generated.h"
 
 class UAnimatedTexture2D;
 class URuntimeGifReader;
+class FImageDirectoryWatcher;
 
 DECLARE_DELEGATE_OneParam(FOnRequestCompleted, const FImageReadResult&);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnWatchedImageChanged, const FString&, ImageFilename, UTexture2D*, Texture);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnImagePreview, const FString&, ImageFilename, UTexture2D*, Texture);
 
 struct RUNTIMEIMAGELOADER_API FLoadImageRequest
 {
@@ -29,12 +33,50 @@ public:
 
     bool IsRequestValid() const 
     {
-        return Params.InputImage.ImageFilename.Len() > 0 || Params.InputImage.ImageBytes.Num() > 0;
+        return Params.InputImage.ImageFilename.Len() > 0 || Params.InputImage.ImageBytes.Num() > 0 || Params.InputImage.ImageBase64.Len() > 0;
     }
 
 public:
     FImageReadRequest Params;
     FOnRequestCompleted OnRequestCompleted;
+
+    /** Fires once with the coarse preview texture of a progressive image, the completed request returns the same texture, or none if the full decode fails */
+    FOnRequestCompleted OnPreview;
+};
+
+UENUM(BlueprintType)
+enum class EPrefetchLevel : uint8
+{
+    /** Encoded bytes are kept in memory, loading skips the read */
+    Bytes,
+    /** Decoded image is kept in memory, loading skips the read and decode */
+    Pixels,
+    /** Texture is created ahead of time, loading with the same transform params completes without any work */
+    Texture
+};
+
+USTRUCT()
+struct RUNTIMEIMAGELOADER_API FPrefetchedImage
+{
+    GENERATED_BODY()
+
+    EPrefetchLevel Level = EPrefetchLevel::Bytes;
+    FTransformImageParams TransformParams;
+
+    TArray<uint8> ImageBytes;
+    TSharedPtr<FRuntimeImageData, ESPMode::ThreadSafe> ImageData;
+
+    UPROPERTY()
+    UTexture2D* Texture = nullptr;
+
+    /** Memory held by the bytes, pixels or texture, counted against RuntimeImageLoader.Prefetch.MaxMegabytes */
+    int64 SizeBytes = 0;
+};
+
+struct FWatchedImageDirectory
+{
+    TSharedPtr<FImageDirectoryWatcher> Watcher;
+    FTransformImageParams TransformParams;
 };
 
 /**
@@ -53,6 +95,10 @@ public:
     UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader | Bytes", meta = (AutoCreateRefTerm = "TransformParams", Latent, LatentInfo = "LatentInfo", HidePin = "WorldContextObject", DefaultToSelf = "WorldContextObject"))
     void LoadImageFromBytesAsync(UPARAM(ref) TArray<uint8>& ImageBytes, const FTransformImageParams& TransformParams, UTexture2D*& OutTexture, bool& bSuccess, FString& OutError, FLatentActionInfo LatentInfo, UObject* WorldContextObject = nullptr);
     
+    /** Accepts raw base64 or a data:image/...;base64, URI. Base64 is decoded on the image reader thread */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader | Bytes", meta = (AutoCreateRefTerm = "TransformParams", Latent, LatentInfo = "LatentInfo", HidePin = "WorldContextObject", DefaultToSelf = "WorldContextObject"))
+    void LoadImageFromBase64Async(const FString& ImageBase64, const FTransformImageParams& TransformParams, UTexture2D*& OutTexture, bool& bSuccess, FString& OutError, FLatentActionInfo LatentInfo, UObject* WorldContextObject = nullptr);
+
     UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader | Cubemap", meta = (AutoCreateRefTerm = "TransformParams", Latent, LatentInfo = "LatentInfo", HidePin = "WorldContextObject", DefaultToSelf = "WorldContextObject"))
     void LoadHDRIAsCubemapAsync(const FString& ImageFilename, const FTransformImageParams& TransformParams, UTextureCube*& OutTextureCube, bool& bSuccess, FString& OutError, FLatentActionInfo LatentInfo, UObject* WorldContextObject = nullptr);
 
@@ -65,11 +111,39 @@ public:
     UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader", meta = (Latent, LatentInfo = "LatentInfo", HidePin = "WorldContextObject", DefaultToSelf = "WorldContextObject"))
     void LoadImagePixels(const FInputImageDescription& InputImage, const FTransformImageParams& TransformParams, TArray<FColor>& OutImagePixels, bool& bSuccess, FString& OutError, FLatentActionInfo LatentInfo, UObject* WorldContextObject = nullptr);
 
+    /** Accepts local paths and http(s) URLs. Only the image header is read, remote images are probed with HTTP range requests */
     UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader")
     void GetImageResolution(const FString& ImageFilename, int32& OutWidth, int32& OutHeight, int32& OutChannels, bool& bSuccess, FString& OutError);
 
+    /** Batch version of GetImageResolution and GetImageInfo, local images are probed in parallel and remote images concurrently. bSuccess is true only if every image was probed */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader")
+    void GetImageResolutionBatch(const TArray<FString>& ImageFilenames, TArray<FImageHeaderInfo>& OutImageInfos, bool& bSuccess, FString& OutError);
+
     UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader | Bytes")
     void GetImageResolutionFromBytes(UPARAM(ref) TArray<uint8>& ImageBytes, int32& OutWidth, int32& OutHeight, int32& OutChannels, bool& bSuccess, FString& OutError);
+
+    /**
+     * Reads the format, dimensions, channels, bit depth, frame count and HDR and alpha flags from the image header without decoding the image.
+     * Accepts local paths and http(s) URLs, GetImageResolutionBatch returns the same information for many images at once.
+     */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader")
+    void GetImageInfo(const FString& ImageFilename, FImageHeaderInfo& OutImageInfo, bool& bSuccess, FString& OutError);
+
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader | Bytes")
+    void GetImageInfoFromBytes(UPARAM(ref) TArray<uint8>& ImageBytes, FImageHeaderInfo& OutImageInfo, bool& bSuccess, FString& OutError);
+
+    /**
+     * Warms up images at low priority so that a later async load of the same file picks up where the prefetch stopped.
+     * Prefetches are dispatched only while no other request is waiting. Prefetched images are consumed by the first load,
+     * the least recently prefetched are dropped once they exceed RuntimeImageLoader.Prefetch.MaxMegabytes.
+     * A load of a file whose prefetch is still queued takes the place of the prefetch instead of reading the file twice.
+     */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader | Prefetch", meta = (AutoCreateRefTerm = "TransformParams"))
+    void PrefetchImages(const TArray<FString>& ImageFilenames, EPrefetchLevel PrefetchLevel, const FTransformImageParams& TransformParams);
+
+    /** Drops pending prefetches and every prefetched image that was not consumed yet */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader | Prefetch")
+    void ClearPrefetchedImages();
     
     /** Utilities */
     UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader | Utilities")
@@ -78,12 +152,47 @@ public:
     UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader | Utilities")
     bool LoadImageToByteArray(const FString& ImageFilename, TArray<uint8>& OutImageBytes, FString& OutError);
 
+    /** Images are recognised by content, not by extension. See ScanImagesInDirectory */
     UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader | Utilities")
     void FindImagesInDirectory(const FString& Directory, bool bIsRecursive, TArray<FString>& OutImageFilenames, bool& bSuccess, FString& OutError);
 
+    /**
+     * Finds images by sniffing file headers and returns their format, dimensions and modification time.
+     * Results are cached in an index under Saved/, so a rescan only probes new and modified files.
+     */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader | Utilities")
+    void ScanImagesInDirectory(const FString& Directory, bool bIsRecursive, TArray<FImageHeaderInfo>& OutImageInfos, bool& bSuccess, FString& OutError);
+
     UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Runtime Image Loader | Utilities")
     static FString GetThisPluginResourcesDirectory();
 
+    /**
+     * Loads every image of the directory and keeps the textures in sync with the files.
+     * The directory is scanned in the background, so the images start loading on a later tick and only a missing directory fails right away.
+     * Changes are debounced, only added and modified images are decoded again and existing textures are updated in place.
+     * OnWatchedImageChanged fires for every loaded or reloaded image, and with a null texture for removed files.
+     */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader | Watch", meta = (AutoCreateRefTerm = "TransformParams"))
+    void WatchDirectory(const FString& Directory, bool bIsRecursive, const FTransformImageParams& TransformParams, bool& bSuccess, FString& OutError);
+
+    /** Stops watching the directory and releases its textures */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader | Watch")
+    void UnwatchDirectory(const FString& Directory);
+
+    /** Current texture of an image in a watched directory, null if it is not loaded yet */
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Runtime Image Loader | Watch")
+    UTexture2D* GetWatchedTexture(const FString& ImageFilename) const;
+
+    UPROPERTY(BlueprintAssignable, Category = "Runtime Image Loader | Watch")
+    FOnWatchedImageChanged OnWatchedImageChanged;
+
+    /**
+     * Fires once when the coarse pass of an image loaded with bProgressivePreview is on screen, long before the load completes.
+     * The texture is the one the load returns, the full image replaces the preview in it without any refinement in between
+     */
+    UPROPERTY(BlueprintAssignable, Category = "Runtime Image Loader")
+    FOnImagePreview OnImagePreview;
+
 protected:
     virtual void Initialize(FSubsystemCollectionBase& Collection) override;
     virtual void Deinitialize() override;
@@ -96,10 +205,42 @@ private:
 
     URuntimeImageReader* InitializeImageReader();
 
+    /** Shared by the latent texture loads of files, URIs and base64 */
+    void LoadInputImageAsync(FInputImageDescription&& InputImage, const FTransformImageParams& TransformParams, UTexture2D*& OutTexture, bool& bSuccess, FString& OutError, FLatentActionInfo LatentInfo);
+
+    /** Returns true if the request was completed with a prefetched texture, otherwise hands over prefetched bytes or pixels */
+    bool ApplyPrefetchedImage(FLoadImageRequest& Request);
+
+    /** Keeps the prefetched image within the budget, evicting the least recently prefetched images first */
+    void AddPrefetchedImage(const FString& ImageFilename, FPrefetchedImage&& PrefetchedImage);
+    void RemovePrefetchedImage(const FString& ImageFilename);
+
+    void TickWatchedDirectories();
+    void ReloadWatchedImage(const FString& ImageFilename, const FTransformImageParams& TransformParams);
+
 private:
     UPROPERTY()
     URuntimeImageReader* ImageReader = nullptr;
 
     TQueue<FLoadImageRequest> Requests;
+    TQueue<FLoadImageRequest> PrefetchRequests;
     FLoadImageRequest ActiveRequest;
+
+    UPROPERTY()
+    TMap<FString, FPrefetchedImage> PrefetchedImages;
+
+    /** Prefetched images from least to most recently prefetched, and the memory they hold */
+    TArray<FString> PrefetchedImagesOrder;
+    int64 PrefetchedImagesBytes = 0;
+
+    /** Files with a prefetch waiting in PrefetchRequests */
+    TSet<FString> PendingPrefetches;
+
+    TMap<FString, FWatchedImageDirectory> WatchedDirectories;
+
+    UPROPERTY()
+    TMap<FString, UTexture2D*> WatchedTextures;
+
+    /** Watched images with a load in flight, true when the file changed again while it was loading */
+    TMap<FString, bool> PendingWatchedLoads;
 };
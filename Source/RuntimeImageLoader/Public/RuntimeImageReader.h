@@ -39,20 +39,54 @@ struct RUNTIMEIMAGELOADER_API FTransformImageParams
     UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader", UIMin = 0, UIMax = 100, ClampMin = 0, ClampMax = 100))
     int32 PercentSizeY = 100;
 
+    /** EXR channels to read instead of RGBA, e.g. "Z" or "diffuse.R". One channel gives a single channel texture, up to four are packed into RGBA */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader"))
+    TArray<FString> Channels;
+
+    /**
+     * Interlaced PNGs and progressive JPEGs are shown at a coarse resolution first, see URuntimeImageLoader::OnImagePreview.
+     * A single preview is produced from the first pass or scan, the full image then replaces it in the same texture
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader"))
+    bool bProgressivePreview = false;
+
+    /** Loads only this part of the image, in pixels with Max exclusive. Empty loads the whole image, percent sizes are relative to the region */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader"))
+    FIntRect Region;
+
     // Hidden as there is method in RuntimeImageLoader that sets these flags
     bool bOnlyPixels = false;
     bool bOnlyBytes = false;
+    bool bOnlyImageData = false;
 
     bool IsPercentSizeValid() const
     {
         return PercentSizeX > 0 && PercentSizeX < 100 && PercentSizeY > 0 && PercentSizeY < 100;
     }
+
+    bool IsRegionValid() const
+    {
+        return Region.Width() > 0 && Region.Height() > 0;
+    }
+
+    /** Whether both produce the same texture, bProgressivePreview only changes how it is delivered */
+    bool operator==(const FTransformImageParams& Other) const
+    {
+        return bForUI == Other.bForUI && FilterMode == Other.FilterMode && PercentSizeX == Other.PercentSizeX && PercentSizeY == Other.PercentSizeY
+            && Channels == Other.Channels && Region == Other.Region && bOnlyPixels == Other.bOnlyPixels && bOnlyBytes == Other.bOnlyBytes && bOnlyImageData == Other.bOnlyImageData;
+    }
 };
 
 struct RUNTIMEIMAGELOADER_API FImageReadRequest
 {
     FInputImageDescription InputImage;
     FTransformImageParams TransformParams;
+
+    // Image decoded ahead of time by a prefetch, reading and decoding are skipped
+    TSharedPtr<FRuntimeImageData, ESPMode::ThreadSafe> DecodedImageData;
+
+    // Texture that receives the image instead of a new one, kept alive by the requester
+    UTexture2D* TargetTexture = nullptr;
 };
 
 USTRUCT()
@@ -67,6 +101,9 @@ struct RUNTIMEIMAGELOADER_API FImageReadResult
 
     // For pure bytes only
     TArray<uint8> OutImageBytes;
+
+    // For decoded image data only
+    TSharedPtr<FRuntimeImageData, ESPMode::ThreadSafe> OutImageData;
     
     UPROPERTY()
     UTexture2D* OutTexture = nullptr;
@@ -90,6 +127,8 @@ public:
 public:
     void AddRequest(const FImageReadRequest& Request);
     bool GetResult(FImageReadResult& OutResult);
+    /** Previews of the request being processed, in the order they were uploaded */
+    bool GetPreviewResult(FImageReadResult& OutResult);
     void Clear();
     void Stop();
     bool IsWorkCompleted() const;
@@ -106,6 +145,10 @@ protected:
     /* ~FRunnable interface */
 
 private:
+    /** Opens the file of the request for streaming decode when it is large enough and of a streamable format */
+    TUniquePtr<FArchive> OpenStreamableImage(const FImageReadRequest& Request);
+    /** Uploads the coarse pass of a progressive image and makes its texture the target of the full image */
+    void UploadPreview(FImageReadRequest& Request, const TArray<uint8>& ImageBuffer);
     EPixelFormat DeterminePixelFormat(ERawImageFormat::Type ImageFormat, const FTransformImageParams& Params) const;
     void ApplySizeFormatTransformations(FRuntimeImageData& ImageData, FTransformImageParams TransformParams);
 
@@ -118,6 +161,9 @@ private:
     UPROPERTY()
     FImageReadResult PendingReadResult;
 
+    UPROPERTY()
+    TArray<FImageReadResult> PreviewResults;
+
     FCriticalSection ResultsMutex;
 
 private:
@@ -4,22 +4,39 @@
 
 #include "CoreMinimal.h"
 #include "RuntimeImageData.h"
+#include "ImageDecoders/IRuntimeImageDecoder.h"
 
 class UTexture2D;
 class UTextureCube;
 
 namespace FRuntimeImageUtils
 {
-    bool ImportBufferAsImage(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError);
+    /** Whether a texture of this size can be created on the running RHI */
+    bool IsImportResolutionValid(int32 Width, int32 Height, bool bAllowNonPowerOfTwo);
+
+    bool ImportBufferAsImage(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError, const FRuntimeImageDecodeOptions& Options = FRuntimeImageDecodeOptions());
+    /** Decodes the first pass of an interlaced PNG or a progressive JPEG, false for images without a coarse pass */
+    bool ImportBufferAsPreview(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError);
+
+    /** Whether the archive holds an image of a format that can be decoded without reading the whole file into memory. The archive position is kept */
+    bool CanImportArchiveAsImage(FArchive& Archive);
+    /** Decodes the image while reading it from the archive, for files too large to be held in memory at once */
+    bool ImportArchiveAsImage(FArchive& Archive, FRuntimeImageData& OutImage, FString& OutError, const FRuntimeImageDecodeOptions& Options = FRuntimeImageDecodeOptions());
+
+    /** Clips a region of interest to the image, an empty region selects the whole image. Fails if no pixel of the image is left */
+    bool ClipRegion(const FIntRect& Region, int32 Width, int32 Height, FIntRect& OutRegion, FString& OutError);
+    /** Cuts the region out of the decoded image, the region has to be clipped to the image */
+    void CropImage(FRuntimeImageData& Image, const FIntRect& Region);
 
     UTexture2D* CreateTexture(const FString& ImageFilename, const FRuntimeImageData& ImageData);
     UTextureCube* CreateTextureCube(const FString& ImageFilename, const FRuntimeImageData& ImageData);
+    /** Drops the resource of an existing texture and updates its platform data for a new image, the RHI texture is created afterwards */
+    void ResetTexture(UTexture2D* Texture, const FRuntimeImageData& ImageData);
 
     static TArray<FString> SupportedImageFormats{
         TEXT(".png"), TEXT(".jpg"), TEXT(".jpeg"), 
         TEXT(".bmp"), TEXT(".tga"), TEXT(".exr"), 
         TEXT(".tif"), TEXT(".tiff"), TEXT(".qoi"),
-        TEXT(".hdr"), TEXT(".tiff"), TEXT(".qoi"),
-        TEXT(".jfif")
+        TEXT(".hdr"), TEXT(".jfif")
     };
 }
\ No newline at end of file
@@ -54,12 +54,44 @@ public class RuntimeImageLoader : ModuleRules
 				"ImageCore",
 				"FreeImage",
 				"HTTP",
+				"Sockets",
                 "RuntimeGifLibrary",
 				"Projects",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
 
+        // watched directories use native change notifications in the editor and fall back to polling in games
+        if (Target.bBuildEditor)
+        {
+            PrivateDependencyModuleNames.Add("DirectoryWatcher");
+        }
+
+        AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib", "UElibPNG");
+
+        // libtiff and OpenEXR 3 are used by the streaming decoders, both ship with UE 5.1+ on desktop platforms
+        bool bIsDesktopPlatform = Target.Platform.IsInGroup(UnrealPlatformGroup.Windows) || Target.Platform == UnrealTargetPlatform.Mac || Target.Platform.IsInGroup(UnrealPlatformGroup.Linux);
+        bool bHasStreamingLibraries = Target.Version.MajorVersion > 5 || (Target.Version.MajorVersion == 5 && Target.Version.MinorVersion >= 1);
+        if (bIsDesktopPlatform && bHasStreamingLibraries)
+        {
+            AddEngineThirdPartyPrivateStaticDependencies(Target, "LibTiff", "Imath", "UEOpenExr");
+            PrivateDefinitions.Add("RUNTIMEIMAGELOADER_WITH_LIBTIFF=1");
+            PrivateDefinitions.Add("RUNTIMEIMAGELOADER_WITH_OPENEXR=1");
+
+            // libjpeg-turbo can decode JPEGs at a fraction of their size in the DCT domain
+            AddEngineThirdPartyPrivateStaticDependencies(Target, "LibJpegTurbo");
+            PrivateDefinitions.Add("RUNTIMEIMAGELOADER_WITH_LIBJPEGTURBO=1");
+
+            // OpenEXR reports errors through exceptions
+            bEnableExceptions = true;
+        }
+        else
+        {
+            PrivateDefinitions.Add("RUNTIMEIMAGELOADER_WITH_LIBTIFF=0");
+            PrivateDefinitions.Add("RUNTIMEIMAGELOADER_WITH_OPENEXR=0");
+            PrivateDefinitions.Add("RUNTIMEIMAGELOADER_WITH_LIBJPEGTURBO=0");
+        }
+
         PrivateIncludePaths.AddRange(new string[]
         {
 			Path.Combine(EngineDir, @"Source/Runtime/Renderer/Private")